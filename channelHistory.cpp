@@ -0,0 +1,159 @@
+// channelHistory.cpp
+//
+// Threads: see channelHistory.h
+
+#include <string.h>
+#include <assert.h>
+#include "channelHistory.h"
+
+//.................................................................................................
+// Preprocessor directives
+//.................................................................................................
+
+static_assert( 0 == (HISTORY_RAW_CAPACITY & (HISTORY_RAW_CAPACITY-1)), "assert: HISTORY_RAW_CAPACITY must be a power of 2" );
+static_assert( 0 == (HISTORY_SECOND_CAPACITY & (HISTORY_SECOND_CAPACITY-1)), "assert: HISTORY_SECOND_CAPACITY must be a power of 2" );
+static_assert( 0 == (HISTORY_MINUTE_CAPACITY & (HISTORY_MINUTE_CAPACITY-1)), "assert: HISTORY_MINUTE_CAPACITY must be a power of 2" );
+static_assert( sizeof(ChannelHistory) <= 200000, "assert: the memory footprint of ChannelHistory given in channelHistory.h" );
+
+//.................................................................................................
+// Global variables
+//.................................................................................................
+
+ChannelHistory* TableOfChannelHistories;
+
+//.................................................................................................
+// Local variables
+//.................................................................................................
+
+// The lengths of the intervals of the tiers (0: the raw samples are not aggregated)
+static const uint64_t IntervalOfTier[HISTORY_TIERS_NUMBER] = { 0, HISTORY_SECOND_US, HISTORY_MINUTE_US };
+
+//.................................................................................................
+// Function definitions
+//.................................................................................................
+
+void ChannelHistory::initialize(){
+	memset( WriteIndex, 0, sizeof(WriteIndex) );
+	memset( Accumulators, 0, sizeof(Accumulators) );
+	memset( CurrentSums, 0, sizeof(CurrentSums) );
+	memset( VoltageSums, 0, sizeof(VoltageSums) );
+	__atomic_thread_fence( __ATOMIC_RELEASE );
+}
+
+// Peripheral thread
+void ChannelHistory::addSample( uint64_t Timestamp, float Current, float Voltage, float Setpoint, uint16_t Status ){
+	HistoryRecordStruct Sample;
+
+	Sample.status = Status;
+	Sample.samples = 1;
+	Sample.timestamp = Timestamp;
+	Sample.currentMin = Sample.currentMax = Sample.currentAverage = Current;
+	Sample.voltageMin = Sample.voltageMax = Sample.voltageAverage = Voltage;
+	Sample.setpoint = Setpoint;
+	Sample.reserved = 0;
+
+	appendRecord( HISTORY_TIER_RAW, &Sample );
+	accumulate( HISTORY_TIER_SECOND, &Sample );
+}
+
+// This function copies the records of a given tier whose timestamps are not earlier than FromTimestamp (at most MaxRecords
+// of the newest ones) to RecordsPtr, the oldest one first; it returns the number of the records copied
+uint32_t ChannelHistory::read( uint8_t Tier, uint64_t FromTimestamp, HistoryRecordStruct* RecordsPtr, uint32_t MaxRecords ){
+	HistoryRecordStruct* RingPtr;
+	uint32_t Capacity, Count, SequenceBefore, SequenceAfter;
+	uint64_t Index, EndIndex;
+
+	assert( Tier < HISTORY_TIERS_NUMBER );
+	RingPtr = getRing( Tier, &Capacity );
+	EndIndex = __atomic_load_n( &WriteIndex[Tier], __ATOMIC_ACQUIRE );
+	Count = 0;
+	for (Index = EndIndex; (Index > 0) && (EndIndex - Index < Capacity) && (Count < MaxRecords); Index--){
+		HistoryRecordStruct* RecordPtr = &RingPtr[(Index-1) & (Capacity-1)];
+
+		SequenceBefore = __atomic_load_n( &RecordPtr->sequence, __ATOMIC_ACQUIRE );
+		memcpy( &RecordsPtr[Count], RecordPtr, sizeof(HistoryRecordStruct) );
+		__atomic_thread_fence( __ATOMIC_ACQUIRE );
+		SequenceAfter = __atomic_load_n( &RecordPtr->sequence, __ATOMIC_RELAXED );
+		if ((SequenceBefore != (uint32_t)Index) || (SequenceAfter != SequenceBefore)){
+			break;		// the record is being overwritten by a newer one
+		}
+		if (RecordsPtr[Count].timestamp < FromTimestamp){
+			break;
+		}
+		Count++;
+	}
+	// the records have been copied from the newest one
+	for (uint32_t J = 0; J < Count/2; J++){
+		HistoryRecordStruct Temporary = RecordsPtr[J];
+		RecordsPtr[J] = RecordsPtr[Count-1-J];
+		RecordsPtr[Count-1-J] = Temporary;
+	}
+	return Count;
+}
+
+void ChannelHistory::appendRecord( uint8_t Tier, const HistoryRecordStruct* RecordPtr ){
+	HistoryRecordStruct* RingPtr;
+	HistoryRecordStruct* DestinationPtr;
+	uint32_t Capacity;
+	uint64_t Index = __atomic_load_n( &WriteIndex[Tier], __ATOMIC_RELAXED );
+
+	RingPtr = getRing( Tier, &Capacity );
+	DestinationPtr = &RingPtr[Index & (Capacity-1)];
+
+	// the reader must not take the old sequence number together with the new contents
+	__atomic_store_n( &DestinationPtr->sequence, 0, __ATOMIC_RELAXED );
+	__atomic_thread_fence( __ATOMIC_RELEASE );
+	memcpy( (uint8_t*)DestinationPtr + sizeof(uint32_t), (const uint8_t*)RecordPtr + sizeof(uint32_t),
+			sizeof(HistoryRecordStruct) - sizeof(uint32_t) );
+	__atomic_store_n( &DestinationPtr->sequence, (uint32_t)(Index + 1), __ATOMIC_RELEASE );
+	__atomic_store_n( &WriteIndex[Tier], Index + 1, __ATOMIC_RELEASE );
+}
+
+// This function adds a record of the lower tier to the aggregate of the current interval of a given tier;
+// when the record belongs to the next interval, the aggregate is appended to the ring and passed to the next tier
+void ChannelHistory::accumulate( uint8_t Tier, const HistoryRecordStruct* RecordPtr ){
+	HistoryRecordStruct* AccumulatorPtr = &Accumulators[Tier];
+	uint64_t IntervalStart = RecordPtr->timestamp - RecordPtr->timestamp % IntervalOfTier[Tier];
+
+	if ((0 != AccumulatorPtr->samples) && (AccumulatorPtr->timestamp != IntervalStart)){
+		AccumulatorPtr->currentAverage = (float)(CurrentSums[Tier] / AccumulatorPtr->samples);
+		AccumulatorPtr->voltageAverage = (float)(VoltageSums[Tier] / AccumulatorPtr->samples);
+		appendRecord( Tier, AccumulatorPtr );
+		if (Tier+1 < HISTORY_TIERS_NUMBER){
+			accumulate( Tier+1, AccumulatorPtr );
+		}
+		AccumulatorPtr->samples = 0;
+	}
+
+	if (0 == AccumulatorPtr->samples){
+		*AccumulatorPtr = *RecordPtr;
+		AccumulatorPtr->timestamp = IntervalStart;
+		CurrentSums[Tier] = 0.0;
+		VoltageSums[Tier] = 0.0;
+	}
+	else{
+		AccumulatorPtr->status |= RecordPtr->status;
+		AccumulatorPtr->samples += RecordPtr->samples;
+		AccumulatorPtr->currentMin = (RecordPtr->currentMin < AccumulatorPtr->currentMin)? RecordPtr->currentMin : AccumulatorPtr->currentMin;
+		AccumulatorPtr->currentMax = (RecordPtr->currentMax > AccumulatorPtr->currentMax)? RecordPtr->currentMax : AccumulatorPtr->currentMax;
+		AccumulatorPtr->voltageMin = (RecordPtr->voltageMin < AccumulatorPtr->voltageMin)? RecordPtr->voltageMin : AccumulatorPtr->voltageMin;
+		AccumulatorPtr->voltageMax = (RecordPtr->voltageMax > AccumulatorPtr->voltageMax)? RecordPtr->voltageMax : AccumulatorPtr->voltageMax;
+		AccumulatorPtr->setpoint = RecordPtr->setpoint;
+	}
+	// the averages of the lower tier are weighted by their numbers of samples
+	CurrentSums[Tier] += (double)RecordPtr->currentAverage * RecordPtr->samples;
+	VoltageSums[Tier] += (double)RecordPtr->voltageAverage * RecordPtr->samples;
+}
+
+HistoryRecordStruct* ChannelHistory::getRing( uint8_t Tier, uint32_t* CapacityPtr ){
+	if (HISTORY_TIER_RAW == Tier){
+		*CapacityPtr = HISTORY_RAW_CAPACITY;
+		return RawRecords;
+	}
+	if (HISTORY_TIER_SECOND == Tier){
+		*CapacityPtr = HISTORY_SECOND_CAPACITY;
+		return SecondRecords;
+	}
+	*CapacityPtr = HISTORY_MINUTE_CAPACITY;
+	return MinuteRecords;
+}
@@ -0,0 +1,91 @@
+// channelHistory.h
+//
+// Threads: the peripheral thread adds the samples; any thread can read the history
+//
+// This module keeps the recent history of each channel (the current, the voltage, the setpoint and the status)
+// in rings of a fixed size, so the memory does not depend on the time the program has been running.
+// There are three tiers: the raw samples (one per time tick), the aggregates of one second and the aggregates
+// of one minute (minimum, maximum and average). An aggregate is added when its interval is over, that is when
+// the first sample of the next interval arrives.
+// The reading of a window of the history copies the records from the newest one backwards, so its cost depends only
+// on the length of the window; nothing is allocated. Each record holds its index + 1, which is written last,
+// so a reader detects a record that is being overwritten and stops there (the older records are gone anyway).
+// The rings take about 197 kB per channel (about 50 MB at 256 channels); their pages are touched as they fill,
+// so the resident memory reaches this size only after HISTORY_MINUTE_CAPACITY minutes (about 34 h).
+
+#ifndef CHANNELHISTORY_H_
+#define CHANNELHISTORY_H_
+
+#include <inttypes.h>
+#include "modbusTcpSlave.h"
+
+//.................................................................................................
+// Preprocessor directives
+//.................................................................................................
+
+#define HISTORY_TIER_RAW				0
+#define HISTORY_TIER_SECOND				1
+#define HISTORY_TIER_MINUTE				2
+#define HISTORY_TIERS_NUMBER			3
+
+// The capacities of the rings (records; powers of 2)
+#define HISTORY_RAW_CAPACITY			1024		// 256 s at 4 ticks per second
+#define HISTORY_SECOND_CAPACITY			1024		// 17 min
+#define HISTORY_MINUTE_CAPACITY			2048		// 34 h
+
+#define HISTORY_SECOND_US				1000000ull
+#define HISTORY_MINUTE_US				60000000ull
+
+//.................................................................................................
+// Definitions of types
+//.................................................................................................
+
+// A raw sample has the minimum, the maximum and the average equal
+struct HistoryRecordStruct{
+	uint32_t sequence;					// the index of the record in its ring + 1 (the lower 32 bits); 0 while the record is written
+	uint16_t status;					// MODBUS_ADDRES_SLAVE_STATUS; for an aggregate: the bits set in any of the samples
+	uint16_t samples;					// the number of raw samples in the record
+	uint64_t timestamp;					// us; CLOCK_MONOTONIC; for an aggregate: the beginning of its interval
+	float currentMin;					// A
+	float currentMax;
+	float currentAverage;
+	float voltageMin;					// V
+	float voltageMax;
+	float voltageAverage;
+	float setpoint;						// A; for an aggregate: the last one in the interval
+	uint32_t reserved;
+};
+
+class ChannelHistory{
+private:
+	HistoryRecordStruct RawRecords[HISTORY_RAW_CAPACITY];
+	HistoryRecordStruct SecondRecords[HISTORY_SECOND_CAPACITY];
+	HistoryRecordStruct MinuteRecords[HISTORY_MINUTE_CAPACITY];
+	uint64_t WriteIndex[HISTORY_TIERS_NUMBER];		// the number of records written so far (atomic)
+
+	// The aggregates of the current intervals (HISTORY_TIER_SECOND and HISTORY_TIER_MINUTE); peripheral thread only
+	HistoryRecordStruct Accumulators[HISTORY_TIERS_NUMBER];
+	double CurrentSums[HISTORY_TIERS_NUMBER];
+	double VoltageSums[HISTORY_TIERS_NUMBER];
+
+	void appendRecord( uint8_t Tier, const HistoryRecordStruct* RecordPtr );
+	void accumulate( uint8_t Tier, const HistoryRecordStruct* RecordPtr );
+	HistoryRecordStruct* getRing( uint8_t Tier, uint32_t* CapacityPtr );
+
+public:
+	// The rings are not cleared: only the records below WriteIndex are read
+	void initialize();
+
+	void addSample( uint64_t Timestamp, float Current, float Voltage, float Setpoint, uint16_t Status );
+	uint32_t read( uint8_t Tier, uint64_t FromTimestamp, HistoryRecordStruct* RecordsPtr, uint32_t MaxRecords );
+};
+
+//...............................................................................................
+// Global variables
+//...............................................................................................
+
+// The samples are added by the peripheral thread once per tick (see recordHistoryOfAllChannels);
+// NumberOfChannels histories are allocated (see allocateChannelTables)
+extern ChannelHistory* TableOfChannelHistories;
+
+#endif /* CHANNELHISTORY_H_ */
@@ -3,8 +3,10 @@
 // Threads: multi-thread
 
 #include <string.h>
+#include <assert.h>
 #include <pthread.h>
 #include "dataSharingInterface.h"
+#include "registerStore.h"
 #include "rstlProtocolMaster.h"
 #include <iostream>
 
@@ -38,18 +40,21 @@ uint8_t ControlFromGuiHere;
 
 // This array is used to exchange data between different threads;
 // the array is used in the peripheral thread (both in 'local computer' mode and 'remote computer' mode).
-DataSharingInterface TableOfSharedDataForLowLevel[MAX_NUMBER_OF_SERIAL_PORTS];
+DataSharingInterface* TableOfSharedDataForLowLevel;
 
 // This array is equivalent to TableOfSharedDataForLowLevel; this array is used in the main FLTK thread
-DataSharingInterface TableOfSharedDataForGui[MAX_NUMBER_OF_SERIAL_PORTS];
+DataSharingInterface* TableOfSharedDataForGui;
 
 // This array is equivalent to TableOfSharedDataForLowLevel; this array is mainly used in the Modbus TCP server
 // The array consists of sectors; the first sector contains information:
 //   - whether the local computer has taken control, or has passed control to a remote computer;
 //   - how many Modbus RTU channels there are;
 //   - Modbus TCP server identification label
-// the remaining sectors contain information about individual power supplies
-uint16_t TableOfSharedDataForTcpServer[MAX_NUMBER_OF_SERIAL_PORTS+1][MODBUS_TCP_SECTOR_SIZE];
+// the remaining NumberOfChannels sectors contain information about individual power supplies
+uint16_t (*TableOfSharedDataForTcpServer)[MODBUS_TCP_SECTOR_SIZE];
+
+// The snapshots of TableOfSharedDataForLowLevel; the peripheral thread is the only writer
+SharedDataSnapshot* TableOfPublishedData;
 
 //.................................................................................................
 // Local variables
@@ -57,6 +62,18 @@ uint16_t TableOfSharedDataForTcpServer[MAX_NUMBER_OF_SERIAL_PORTS+1][MODBUS_TCP_
 
 static std::string DummyPortName = "szeregowy";
 
+// The sequence numbers of the snapshots that have been copied to TableOfSharedDataForGui and RegisterStoreForGui;
+// main FLTK thread only
+static uint32_t SequenceCopiedToGui[MAX_NUMBER_OF_CHANNELS];
+static uint32_t StoreSequenceCopiedToGui;
+
+//.................................................................................................
+// Local function prototypes
+//.................................................................................................
+
+// This function converts a latency in microseconds to the unit of the Modbus TCP registers (saturated)
+static uint16_t latencyToRegister( uint32_t Latency );
+
 //.................................................................................................
 // Global function definitions
 //.................................................................................................
@@ -65,11 +82,19 @@ void DataSharingInterface::initialize(){
 	IsPowerSwitchOn = false;
 	OrderCode = RTU_ORDER_NONE;
 	OrderNewValue = 0;
+	OrderPlacementTime = 0;
+	OrderToWireLatencyLast = 0;
+	OrderToWireLatencyMax = 0;
+	DroppedOrders = 0;
+	CoalescedOrders = 0;
+	memset( RoundTripLatency, 0, sizeof(RoundTripLatency) );
 	CommunicationState = CommunicationStatesClass::PORT_NOT_OPEN;
 	PoweringDownState = PoweringDownStatesClass::INACTIVE;
 	PowerSupplyUnitId = 0xFFFu;
 	IsPsuPhysicalIdCompatibile = false;
 	NameOfPortPtr = &DummyPortName;
+	Generation = 1;			// 0 is the generation of a snapshot that has never been published
+	WidgetsGeneration = 1;
 }
 
 CommunicationStatesClass DataSharingInterface::getStateOfCommunication(){
@@ -79,6 +104,9 @@ CommunicationStatesClass DataSharingInterface::getStateOfCommunication(){
 void DataSharingInterface::loadRstlProtocolData( CommunicationStatesClass StateOfChannel, uint16_t* RegistersPtr,
 		LastFrameErrorClass NewLastFrameError, uint16_t NewPerMilleError, uint16_t NewMaxErrorSequence, bool AcknowledgementOfTransmission )
 {
+	uint16_t OldRegisters[MODBUS_TCP_SECTOR_SIZE];
+
+	memcpy( OldRegisters, CopiedRegisters, sizeof(OldRegisters) );
 	CommunicationState = StateOfChannel;
 
 	if (RegistersPtr != nullptr){
@@ -111,6 +139,7 @@ void DataSharingInterface::loadRstlProtocolData( CommunicationStatesClass StateO
 	CopiedRegisters[MODBUS_TCP_ADDRESS_LAST_FRAME_ERROR] &= (uint16_t)0xFF00u;
 	CopiedRegisters[MODBUS_TCP_ADDRESS_LAST_FRAME_ERROR] |= (uint16_t)LastFrameError;
 	CopiedRegisters[MODBUS_TCP_ADDRESS_EXPECTED_ID] = PowerSupplyUnitId;
+	noteChangedRegisters( OldRegisters );
 }
 
 bool DataSharingInterface::isNewOrder(){
@@ -141,6 +170,14 @@ void DataSharingInterface::placeNewOrder( uint8_t Order, uint16_t NewValue ){
 #endif
 	OrderCode = Order;
 	OrderNewValue = NewValue;
+	OrderPlacementTime = getMonotonicMicroseconds();
+}
+
+// This function places an order that has been placed earlier in another table (the time of placing is kept)
+void DataSharingInterface::placeNewOrder( uint8_t Order, uint16_t NewValue, uint64_t PlacementTime ){
+	OrderCode = Order;
+	OrderNewValue = NewValue;
+	OrderPlacementTime = PlacementTime;
 }
 
 uint8_t DataSharingInterface::takeOrder( uint16_t* ValuePtr ){
@@ -161,12 +198,18 @@ uint8_t DataSharingInterface::takeOrder( uint16_t* ValuePtr ){
 	return ReturnValue;
 }
 
-uint8_t DataSharingInterface::takePrimitiveOrder( uint16_t* ValuePtr ){
+uint8_t DataSharingInterface::takeOrder( uint16_t* ValuePtr, uint64_t* PlacementTimePtr ){
+	*PlacementTimePtr = OrderPlacementTime;
+	return takeOrder( ValuePtr );
+}
+
+uint8_t DataSharingInterface::takePrimitiveOrder( uint16_t* ValuePtr, uint64_t* PlacementTimePtr ){
 	uint8_t ReturnValue = OrderCode;
 	if (ReturnValue >= RTU_PRIMITIVE_ORDER_TOTAL_NUMBER){
 		ReturnValue = RTU_ORDER_NONE;
 	}
 	*ValuePtr = OrderNewValue;
+	*PlacementTimePtr = OrderPlacementTime;
 	OrderCode = RTU_ORDER_NONE;
 	return ReturnValue;
 }
@@ -175,18 +218,24 @@ uint8_t DataSharingInterface::previewOrder(){
 	return OrderCode;
 }
 
+uint16_t DataSharingInterface::previewOrderValue(){
+	return OrderNewValue;
+}
+
 void DataSharingInterface::resetOrderCode(){
 	OrderCode = RTU_ORDER_NONE;
 	OrderNewValue = 0;
 }
 
-void DataSharingInterface::exportModbusRegisters( uint16_t* DestinationPtr ){
-	memcpy( DestinationPtr, &CopiedRegisters[0], sizeof(CopiedRegisters) );
-}
-
 void DataSharingInterface::loadModbusTcpData( uint8_t* InputBuffer ){
+	uint16_t OldRegisters[MODBUS_TCP_SECTOR_SIZE];
 	uint8_t J;
-	for (J=0; J < MODBUS_TCP_SECTOR_READING_SIZE; J++){		// The last two registers remain unchanged (order code + order value)
+
+	memcpy( OldRegisters, CopiedRegisters, sizeof(OldRegisters) );
+	for (J=0; J < MODBUS_TCP_SECTOR_SIZE; J++){
+		if ((MODBUS_TCP_ADDRESS_ORDER_CODE == J) || (MODBUS_TCP_ADDRESS_ORDER_VALUE == J)){
+			continue;		// the registers of the order remain unchanged
+		}
 		CopiedRegisters[J] = (((uint16_t)InputBuffer[2*J]) << 8) + (uint16_t)InputBuffer[2*J+1];
 	}
 	PerMilleError = CopiedRegisters[MODBUS_TCP_ADDRESS_PERMILLE_ERROR];
@@ -198,18 +247,29 @@ void DataSharingInterface::loadModbusTcpData( uint8_t* InputBuffer ){
 	LastFrameError    = (LastFrameErrorClass)    (CopiedRegisters[MODBUS_TCP_ADDRESS_LAST_FRAME_ERROR] & 0xFFu);
 	PoweringDownState = (PoweringDownStatesClass)(CopiedRegisters[MODBUS_TCP_ADDRESS_LAST_FRAME_ERROR] >> 8);
 	PowerSupplyUnitId = CopiedRegisters[MODBUS_TCP_ADDRESS_EXPECTED_ID];
+
+	// only the summary of all the orders is available via Modbus TCP
+	RoundTripLatency[ROUND_TRIP_ALL_ORDERS].p50 = (uint32_t)CopiedRegisters[MODBUS_TCP_ADDRESS_ROUND_TRIP_P50] * ROUND_TRIP_REGISTER_UNIT_US;
+	RoundTripLatency[ROUND_TRIP_ALL_ORDERS].p90 = (uint32_t)CopiedRegisters[MODBUS_TCP_ADDRESS_ROUND_TRIP_P90] * ROUND_TRIP_REGISTER_UNIT_US;
+	RoundTripLatency[ROUND_TRIP_ALL_ORDERS].p99 = (uint32_t)CopiedRegisters[MODBUS_TCP_ADDRESS_ROUND_TRIP_P99] * ROUND_TRIP_REGISTER_UNIT_US;
+	RoundTripLatency[ROUND_TRIP_ALL_ORDERS].max = (uint32_t)CopiedRegisters[MODBUS_TCP_ADDRESS_ROUND_TRIP_MAX] * ROUND_TRIP_REGISTER_UNIT_US;
+	RoundTripLatency[ROUND_TRIP_ALL_ORDERS].count = (0 != CopiedRegisters[MODBUS_TCP_ADDRESS_ROUND_TRIP_MAX])? 1 : 0;
+	noteChangedRegisters( OldRegisters );
 }
 
 bool DataSharingInterface::getPowerSwitchState(){
 	return IsPowerSwitchOn;
 }
 
-uint16_t DataSharingInterface::getModbusRegister( uint8_t Offset ){
-	return CopiedRegisters[Offset];
+// The registers in the layout of a Modbus TCP sector (see RegisterStore::loadChannel)
+const uint16_t* DataSharingInterface::getModbusRegisters() const{
+	return CopiedRegisters;
 }
 
+// The text of the description may change while the pointer stays the same (see communicateTcpServer)
 void DataSharingInterface::setDescription( std::string* NewDescriptionPtr ){
 	DescriptionPtr = NewDescriptionPtr;
+	noteChange( true );
 }
 
 std::string* DataSharingInterface::getDescription(){
@@ -222,10 +282,12 @@ std::string* DataSharingInterface::getNameOfPortPtr(){
 
 void DataSharingInterface::setNameOfPortPtr( std::string* NewNamePtr ){
 	NameOfPortPtr = NewNamePtr;
+	noteChange( false );
 }
 
 void DataSharingInterface::setPowerSupplyUnitId( uint16_t NewValue ){
 	PowerSupplyUnitId = NewValue;
+	noteChange( true );
 }
 
 uint16_t DataSharingInterface::getPowerSupplyUnitId(){
@@ -248,13 +310,173 @@ bool DataSharingInterface::getTransmissionAcknowledgement(){
 	return TransmissionAcknowledged;
 }
 
+void DataSharingInterface::loadOrderToWireLatency( uint32_t LastLatency, uint32_t MaxLatency ){
+	if ((OrderToWireLatencyLast != LastLatency) || (OrderToWireLatencyMax != MaxLatency)){
+		OrderToWireLatencyLast = LastLatency;
+		OrderToWireLatencyMax = MaxLatency;
+		noteChange( false );
+	}
+}
+
+uint32_t DataSharingInterface::getOrderToWireLatencyLast(){
+	return OrderToWireLatencyLast;
+}
+
+uint32_t DataSharingInterface::getOrderToWireLatencyMax(){
+	return OrderToWireLatencyMax;
+}
+
+// The summary of all the orders is also placed in the Modbus TCP registers.
+// The number of samples alone is not treated as a change (only whether there are any samples is displayed),
+// otherwise the data of every polled channel would change in every tick
+void DataSharingInterface::loadRoundTripLatency( uint8_t Order, const LatencySummaryStruct* SummaryPtr ){
+	assert( Order <= ROUND_TRIP_ALL_ORDERS );
+	LatencySummaryStruct* OldSummaryPtr = &RoundTripLatency[Order];
+	if ((OldSummaryPtr->p50 != SummaryPtr->p50) || (OldSummaryPtr->p90 != SummaryPtr->p90) ||
+			(OldSummaryPtr->p99 != SummaryPtr->p99) || (OldSummaryPtr->max != SummaryPtr->max) ||
+			((0 == OldSummaryPtr->count) != (0 == SummaryPtr->count)))
+	{
+		noteChange( false );
+	}
+	RoundTripLatency[Order] = *SummaryPtr;
+	if (ROUND_TRIP_ALL_ORDERS == Order){
+		CopiedRegisters[MODBUS_TCP_ADDRESS_ROUND_TRIP_P50] = latencyToRegister( SummaryPtr->p50 );
+		CopiedRegisters[MODBUS_TCP_ADDRESS_ROUND_TRIP_P90] = latencyToRegister( SummaryPtr->p90 );
+		CopiedRegisters[MODBUS_TCP_ADDRESS_ROUND_TRIP_P99] = latencyToRegister( SummaryPtr->p99 );
+		CopiedRegisters[MODBUS_TCP_ADDRESS_ROUND_TRIP_MAX] = latencyToRegister( SummaryPtr->max );
+	}
+}
+
+LatencySummaryStruct DataSharingInterface::getRoundTripLatency( uint8_t Order ){
+	assert( Order <= ROUND_TRIP_ALL_ORDERS );
+	return RoundTripLatency[Order];
+}
+
+void DataSharingInterface::loadOrderQueueCounters( uint32_t NewDroppedOrders, uint32_t NewCoalescedOrders ){
+	if ((DroppedOrders != NewDroppedOrders) || (CoalescedOrders != NewCoalescedOrders)){
+		DroppedOrders = NewDroppedOrders;
+		CoalescedOrders = NewCoalescedOrders;
+		noteChange( false );
+	}
+}
+
+uint32_t DataSharingInterface::getDroppedOrders(){
+	return DroppedOrders;
+}
+
+uint32_t DataSharingInterface::getCoalescedOrders(){
+	return CoalescedOrders;
+}
+
 PoweringDownStatesClass DataSharingInterface::getPoweringDownState(){
 	return PoweringDownState;
 }
 
 void DataSharingInterface::setPoweringDownState( PoweringDownStatesClass NewPoweringDownState ){
+	if (PoweringDownState != NewPoweringDownState){
+		noteChange( true );
+	}
 	PoweringDownState = NewPoweringDownState;
 	CopiedRegisters[MODBUS_TCP_ADDRESS_LAST_FRAME_ERROR] &= (uint16_t)0x00FFu;
 	CopiedRegisters[MODBUS_TCP_ADDRESS_LAST_FRAME_ERROR] |= ((uint16_t)NewPoweringDownState << 8);
 }
 
+uint32_t DataSharingInterface::getGeneration() const{
+	return Generation;
+}
+
+uint32_t DataSharingInterface::getWidgetsGeneration() const{
+	return WidgetsGeneration;
+}
+
+// This function compares the registers with their copy taken before a load
+void DataSharingInterface::noteChangedRegisters( const uint16_t* OldRegistersPtr ){
+	static const uint8_t RegistersDisplayedInWidgets[] = { MODBUS_ADDRES_REQUIRED_VALUE, MODBUS_ADDRES_POWER_SOURCE_ID,
+			MODBUS_ADDRES_SLAVE_STATUS, MODBUS_ADDRES_CURRENT_FILTERED, MODBUS_TCP_ADDRESS_COMMUNICATION_STATE,
+			MODBUS_TCP_ADDRESS_IS_POWER_ON, MODBUS_TCP_ADDRESS_EXPECTED_ID };
+	bool IsDisplayedInWidgets = false;
+
+	if (0 == memcmp( OldRegistersPtr, CopiedRegisters, MODBUS_TCP_SECTOR_SIZE * sizeof(uint16_t) )){
+		return;
+	}
+	for (uint8_t J = 0; J < sizeof(RegistersDisplayedInWidgets); J++){
+		if (OldRegistersPtr[RegistersDisplayedInWidgets[J]] != CopiedRegisters[RegistersDisplayedInWidgets[J]]){
+			IsDisplayedInWidgets = true;
+		}
+	}
+	// the upper byte of this register is the state of powering down, the lower one is displayed only in the diagnostics
+	if (0 != ((OldRegistersPtr[MODBUS_TCP_ADDRESS_LAST_FRAME_ERROR] ^ CopiedRegisters[MODBUS_TCP_ADDRESS_LAST_FRAME_ERROR]) & 0xFF00u)){
+		IsDisplayedInWidgets = true;
+	}
+	noteChange( IsDisplayedInWidgets );
+}
+
+void DataSharingInterface::noteChange( bool IsDisplayedInWidgets ){
+	Generation++;
+	if (IsDisplayedInWidgets){
+		WidgetsGeneration++;
+	}
+}
+
+// Peripheral thread; the data is not published if it has not changed since the last publication
+bool SharedDataSnapshot::isOutOfDate( const DataSharingInterface* SourcePtr ){
+	return SourcePtr->getGeneration() != Snapshot.getPublishedData()->getGeneration();
+}
+
+bool SharedDataSnapshot::publish( const DataSharingInterface* SourcePtr ){
+	if (!isOutOfDate( SourcePtr )){
+		return false;
+	}
+	Snapshot.publish( SourcePtr );
+	return true;
+}
+
+// This function returns the sequence number of the snapshot that has been copied
+uint32_t SharedDataSnapshot::read( DataSharingInterface* DestinationPtr ){
+	return Snapshot.read( DestinationPtr );
+}
+
+uint32_t SharedDataSnapshot::getSequence(){
+	return Snapshot.getSequence();
+}
+
+bool refreshSharedDataForGui( uint8_t Channel ){
+	assert( Channel < NumberOfChannels );
+	if (TableOfPublishedData[Channel].getSequence() == SequenceCopiedToGui[Channel]){
+		return false;		// nothing new has been published since the last copy
+	}
+	SequenceCopiedToGui[Channel] = TableOfPublishedData[Channel].read( &TableOfSharedDataForGui[Channel] );
+	TableOfSharedDataForGui[Channel].resetOrderCode(); // the order in the snapshot belongs to the lower layer
+
+	// the store is published before the snapshots of the channels, so it is at least as new as the snapshot
+	if (PublishedRegisterStore.getSequence() != StoreSequenceCopiedToGui){
+		StoreSequenceCopiedToGui = PublishedRegisterStore.read( &RegisterStoreForGui );
+	}
+	return true;
+}
+
+// Modbus TCP slave thread
+void readPublishedRegisters( uint8_t Channel, uint8_t Offset, uint8_t Number, uint8_t* BufferPtr ){
+	assert( Channel < NumberOfChannels );
+	assert( Offset + Number <= MODBUS_TCP_SECTOR_SIZE );
+	PublishedRegisterStore.readPart( [=]( const RegisterStore* StorePtr ){
+		StorePtr->exportModbusRegisters( Channel, Offset, Number, BufferPtr );
+	});
+	// the registers of the order are kept by the Modbus TCP slave thread itself
+	for (uint8_t J = 0; J < Number; J++){
+		if ((MODBUS_TCP_ADDRESS_ORDER_CODE == Offset+J) || (MODBUS_TCP_ADDRESS_ORDER_VALUE == Offset+J)){
+			uint16_t Register = __atomic_load_n( &TableOfSharedDataForTcpServer[Channel+1][Offset+J], __ATOMIC_RELAXED );
+			BufferPtr[2*J] = (uint8_t)(Register >> 8);
+			BufferPtr[2*J+1] = (uint8_t)(Register & 0xFFu);
+		}
+	}
+}
+
+//.................................................................................................
+// Local function definitions
+//.................................................................................................
+
+static uint16_t latencyToRegister( uint32_t Latency ){
+	uint32_t Value = (Latency + ROUND_TRIP_REGISTER_UNIT_US - 1) / ROUND_TRIP_REGISTER_UNIT_US;
+	return (Value > 0xFFFFu)? 0xFFFFu : (uint16_t)Value;
+}
@@ -7,13 +7,14 @@
 #include <string>
 #include "multiChannel.h"
 #include "rstlProtocolMaster.h"
+#include "seqlockSnapshot.h"
 
 //.................................................................................................
 // Definitions of types
 //.................................................................................................
 
 // This class is used to exchange data between ChannelGuiGroup and TransmissionChannel, which are in different threads
-class DataSharingInterface{
+class alignas(CACHE_LINE_SIZE) DataSharingInterface{
 private:
 	uint16_t CopiedRegisters[MODBUS_TCP_SECTOR_SIZE];	// Registers 0 .. MODBUS_ADDRES_VOLTAGE_STD_DEVIATION can only be modified by the lower layer;
 													// other registers are copies of certain variables declared below
@@ -32,6 +33,21 @@ private:
 
 	uint8_t OrderCode;								// Can only be set by the higher layer and reset by the lower layer
 	uint16_t OrderNewValue;							// Can only be set by the higher layer and reset by the lower layer
+	uint64_t OrderPlacementTime;					// Can only be set by the higher layer; CLOCK_MONOTONIC in microseconds
+
+	uint32_t OrderToWireLatencyLast;				// Can only be modified by the lower layer; microseconds
+	uint32_t OrderToWireLatencyMax;					// Can only be modified by the lower layer; microseconds
+
+	LatencySummaryStruct RoundTripLatency[ROUND_TRIP_ALL_ORDERS+1];	// Can only be modified by the lower layer; the index is the order
+
+	uint32_t DroppedOrders;							// Can only be modified by the lower layer; see OrderQueue
+	uint32_t CoalescedOrders;						// Can only be modified by the lower layer; see OrderQueue
+
+	uint32_t Generation;							// It is incremented when any of the data above changes (except the order)
+	uint32_t WidgetsGeneration;						// It is incremented when the data displayed in ChannelGuiGroup changes
+
+	void noteChangedRegisters( const uint16_t* OldRegistersPtr );
+	void noteChange( bool IsDisplayedInWidgets );
 
 public:
 	void initialize();
@@ -42,16 +58,18 @@ public:
 	bool isNewOrder();
 	bool isNewPrimitiveOrder();
 	void placeNewOrder( uint8_t Order, uint16_t NewValue );
+	void placeNewOrder( uint8_t Order, uint16_t NewValue, uint64_t PlacementTime );
 	uint8_t takeOrder( uint16_t* ValuePtr );
-	uint8_t takePrimitiveOrder( uint16_t* ValuePtr );
+	uint8_t takeOrder( uint16_t* ValuePtr, uint64_t* PlacementTimePtr );
+	uint8_t takePrimitiveOrder( uint16_t* ValuePtr, uint64_t* PlacementTimePtr );
 	uint8_t previewOrder();
+	uint16_t previewOrderValue();
 	void resetOrderCode();
-	void exportModbusRegisters( uint16_t* DestinationPtr );
 
 	void loadModbusTcpData( uint8_t* InputBuffer );
 	bool getPowerSwitchState();
 	void setPortState( bool CurrentState );
-	uint16_t getModbusRegister( uint8_t Offset );
+	const uint16_t* getModbusRegisters() const;
 	void setDescription( std::string* NewDescriptionPtr );
 	std::string* getDescription();
 	std::string* getNameOfPortPtr();
@@ -63,8 +81,36 @@ public:
 	uint16_t getMaxErrorSequence();
 	bool getTransmissionAcknowledgement();
 
+	void loadOrderToWireLatency( uint32_t LastLatency, uint32_t MaxLatency );
+	uint32_t getOrderToWireLatencyLast();
+	uint32_t getOrderToWireLatencyMax();
+
+	void loadRoundTripLatency( uint8_t Order, const LatencySummaryStruct* SummaryPtr );
+	LatencySummaryStruct getRoundTripLatency( uint8_t Order );
+
+	void loadOrderQueueCounters( uint32_t NewDroppedOrders, uint32_t NewCoalescedOrders );
+	uint32_t getDroppedOrders();
+	uint32_t getCoalescedOrders();
+
 	PoweringDownStatesClass getPoweringDownState();
 	void setPoweringDownState( PoweringDownStatesClass NewPoweringDownState );
+
+	uint32_t getGeneration() const;
+	uint32_t getWidgetsGeneration() const;
+};
+
+// This class passes the data of one channel from the peripheral thread to the main FLTK thread without locks
+// (see SeqlockSnapshot); the peripheral thread publishes the data once per synchronization.
+// The data is published only if its generation has changed, so an idle channel costs neither the writer nor the readers.
+class SharedDataSnapshot{
+private:
+	SeqlockSnapshot<DataSharingInterface> Snapshot;
+
+public:
+	bool isOutOfDate( const DataSharingInterface* SourcePtr );
+	bool publish( const DataSharingInterface* SourcePtr );
+	uint32_t read( DataSharingInterface* DestinationPtr );
+	uint32_t getSequence();
 };
 
 //...............................................................................................
@@ -73,11 +119,16 @@ public:
 
 // This array is used to exchange data between different threads;
 // the array is used in the peripheral thread (both in 'local computer' mode and 'remote computer' mode).
-extern DataSharingInterface TableOfSharedDataForLowLevel[MAX_NUMBER_OF_SERIAL_PORTS];
+// The tables of the channels have NumberOfChannels entries; they are allocated by allocateChannelTables
+extern DataSharingInterface* TableOfSharedDataForLowLevel;
 
 // This array is equivalent to TableOfSharedDataForLowLevel;
-// this array is used in the main FLTK thread
-extern DataSharingInterface TableOfSharedDataForGui[MAX_NUMBER_OF_SERIAL_PORTS];
+// this array is used only in the main FLTK thread, which refreshes it from TableOfPublishedData (see refreshSharedDataForGui)
+extern DataSharingInterface* TableOfSharedDataForGui;
+
+// The snapshots of TableOfSharedDataForLowLevel published by the peripheral thread at each synchronization;
+// they are read by the main FLTK thread (the registers are published in PublishedRegisterStore, see registerStore.h)
+extern SharedDataSnapshot* TableOfPublishedData;
 
 //.................................................................................................
 // Global function prototypes
@@ -85,6 +136,12 @@ extern DataSharingInterface TableOfSharedDataForGui[MAX_NUMBER_OF_SERIAL_PORTS];
 
 // This function transfers information about updating the Modbus RTU register containing the setpoint to GUI.
 // The information is needed in to protect against fast multiclicking of the buttons '+1A' '-0.1A' ... '-1A'
-void multiclickCountdown(void);
+// (only the readings of the channel that displays the setpoint entry dialog are counted)
+void multiclickCountdown( uint8_t ChannelIndex );
+
+// This function copies the last snapshot of a given channel to TableOfSharedDataForGui and the last register store
+// to RegisterStoreForGui (only if a new snapshot has been published);
+// it must be called in the main FLTK thread; it returns true if the data has been copied
+bool refreshSharedDataForGui( uint8_t Channel );
 
 #endif /* DATASHARINGINTERFACE_H_ */
@@ -0,0 +1,170 @@
+// deviceWatcher.cpp
+//
+// Threads: peripheral thread (see deviceWatcher.h)
+
+#include <string>
+#include <iostream>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <sys/inotify.h>
+#include "deviceWatcher.h"
+#include "multiChannel.h"
+
+//.................................................................................................
+// Preprocessor directives
+//.................................................................................................
+
+// A device node is created, renamed or its permissions are changed (udev sets them after the node is created)
+#define DEVICE_WATCHER_EVENTS			(IN_CREATE | IN_MOVED_TO | IN_ATTRIB | IN_DELETE_SELF)
+
+// The size of the buffer for the inotify events; it holds at least several events with the longest names
+#define DEVICE_WATCHER_BUFFER_SIZE		4096
+
+//.................................................................................................
+// Local variables
+//.................................................................................................
+
+static int InotifyHandler = -1;
+
+static SerialBus* WatchedBuses;
+static uint8_t NumberOfWatchedBuses;
+
+// The directories are shared by the serial ports; WatchDescriptor is -1 if the directory is not watched
+static std::string DirectoryNames[MAX_NUMBER_OF_SERIAL_PORTS];
+static int WatchDescriptors[MAX_NUMBER_OF_SERIAL_PORTS];
+static uint8_t NumberOfDirectories;
+
+// The name of the device node of each serial port in its directory and the index of the directory
+static std::string DeviceNodeNames[MAX_NUMBER_OF_SERIAL_PORTS];
+static uint8_t DirectoryOfBus[MAX_NUMBER_OF_SERIAL_PORTS];
+
+//.................................................................................................
+// Local function prototypes
+//.................................................................................................
+
+static uint8_t findOrAddDirectory( const std::string& DirectoryName );
+static void stopWatchingDirectory( uint8_t DirectoryIndex );
+
+//.................................................................................................
+// Function definitions
+//.................................................................................................
+
+bool initializeDeviceWatcher( SerialBus* TableOfBuses, uint8_t NumberOfBuses ){
+	uint8_t J, DirectoryIndex;
+
+	assert( -1 == InotifyHandler );
+	assert( NumberOfBuses <= MAX_NUMBER_OF_SERIAL_PORTS );
+
+	WatchedBuses = TableOfBuses;
+	NumberOfWatchedBuses = NumberOfBuses;
+	NumberOfDirectories = 0;
+
+	InotifyHandler = inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+	if (-1 == InotifyHandler){
+		if (VerboseMode){
+			std::cout << " Brak inotify, porty szeregowe będą sprawdzane co sekundę: " << strerror( errno ) << std::endl;
+		}
+		return false;
+	}
+
+	for (J = 0; J < NumberOfBuses; J++){
+		const std::string* PortNamePtr = TableOfBuses[J].getPortNamePtr();
+		size_t Separator = PortNamePtr->find_last_of( '/' );
+
+		if (std::string::npos == Separator){
+			DirectoryIndex = findOrAddDirectory( "." );
+			DeviceNodeNames[J] = *PortNamePtr;
+		}
+		else{
+			DirectoryIndex = findOrAddDirectory( (0 == Separator)? "/" : PortNamePtr->substr( 0, Separator ) );
+			DeviceNodeNames[J] = PortNamePtr->substr( Separator+1 );
+		}
+		DirectoryOfBus[J] = DirectoryIndex;
+		TableOfBuses[J].setDeviceWatched( -1 != WatchDescriptors[DirectoryIndex] );
+	}
+	return true;
+}
+
+void processDeviceEvents(void){
+	alignas(struct inotify_event) char Buffer[DEVICE_WATCHER_BUFFER_SIZE];
+	ssize_t Length, Offset;
+	uint8_t J;
+
+	if (-1 == InotifyHandler){
+		return;
+	}
+
+	while (true){
+		Length = read( InotifyHandler, Buffer, sizeof(Buffer) );
+		if (Length <= 0){
+			return;		// EAGAIN: there are no more events
+		}
+
+		for (Offset = 0; Offset < Length; Offset += (ssize_t)(sizeof(struct inotify_event) + ((struct inotify_event*)&Buffer[Offset])->len)){
+			const struct inotify_event* EventPtr = (const struct inotify_event*)&Buffer[Offset];
+
+			if (0 != (EventPtr->mask & IN_Q_OVERFLOW)){
+				// some events have been lost; every closed serial port is probed once
+				for (J = 0; J < NumberOfWatchedBuses; J++){
+					WatchedBuses[J].notifyDeviceEvent();
+				}
+				continue;
+			}
+			for (J = 0; J < NumberOfDirectories; J++){
+				if (EventPtr->wd == WatchDescriptors[J]){
+					break;
+				}
+			}
+			if (J == NumberOfDirectories){
+				continue;
+			}
+			if (0 != (EventPtr->mask & (IN_DELETE_SELF | IN_IGNORED))){
+				stopWatchingDirectory( J );
+				continue;
+			}
+			if (0 == EventPtr->len){
+				continue;
+			}
+			for (uint8_t Bus = 0; Bus < NumberOfWatchedBuses; Bus++){
+				if ((DirectoryOfBus[Bus] == J) && (DeviceNodeNames[Bus] == EventPtr->name)){
+					WatchedBuses[Bus].notifyDeviceEvent();
+				}
+			}
+		}
+	}
+}
+
+//.................................................................................................
+// Local function definitions
+//.................................................................................................
+
+// This function returns the index of the directory; a new directory is watched at once
+static uint8_t findOrAddDirectory( const std::string& DirectoryName ){
+	uint8_t J;
+
+	for (J = 0; J < NumberOfDirectories; J++){
+		if (DirectoryNames[J] == DirectoryName){
+			return J;
+		}
+	}
+	assert( NumberOfDirectories < MAX_NUMBER_OF_SERIAL_PORTS );
+	DirectoryNames[J] = DirectoryName;
+	WatchDescriptors[J] = inotify_add_watch( InotifyHandler, DirectoryName.c_str(), DEVICE_WATCHER_EVENTS | IN_ONLYDIR );
+	if ((-1 == WatchDescriptors[J]) && VerboseMode){
+		std::cout << " Katalog " << DirectoryName << " nie jest obserwowany: " << strerror( errno ) << std::endl;
+	}
+	NumberOfDirectories++;
+	return J;
+}
+
+// The directory has been removed; its serial ports are probed once per second
+static void stopWatchingDirectory( uint8_t DirectoryIndex ){
+	WatchDescriptors[DirectoryIndex] = -1;
+	for (uint8_t Bus = 0; Bus < NumberOfWatchedBuses; Bus++){
+		if (DirectoryOfBus[Bus] == DirectoryIndex){
+			WatchedBuses[Bus].setDeviceWatched( false );
+		}
+	}
+}
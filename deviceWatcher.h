@@ -0,0 +1,30 @@
+// deviceWatcher.h
+//
+// Threads: peripheral thread
+//
+// This module watches the directories of the serial ports declared in the configuration file (usually /dev)
+// with inotify, so that a closed serial port is reopened as soon as its device node appears (e.g. a USB
+// converter is plugged in), instead of being probed with access() and open() every second.
+// While the device node of a closed serial port is absent, the serial port is not probed at all.
+// If inotify is not available, or the directory of a serial port does not exist or is removed,
+// the serial port is probed once per second as before.
+
+#ifndef DEVICEWATCHER_H_
+#define DEVICEWATCHER_H_
+
+#include <inttypes.h>
+#include "rstlProtocolMaster.h"
+
+//.................................................................................................
+// Function prototypes
+//.................................................................................................
+
+// This function starts watching the device nodes of the serial ports; it returns false if inotify is not available.
+// It must be called before the first attempt to open the serial ports, so that no device node is missed.
+bool initializeDeviceWatcher( SerialBus* TableOfBuses, uint8_t NumberOfBuses );
+
+// This function reads the pending inotify events without waiting and notifies the serial ports whose device
+// nodes have appeared; it is called when the polling workers are idle
+void processDeviceEvents(void);
+
+#endif /* DEVICEWATCHER_H_ */
@@ -0,0 +1,72 @@
+// eventBus.cpp
+//
+// Threads: peripheral thread
+
+#include <assert.h>
+#include "eventBus.h"
+
+//...............................................................................................
+// Global variables
+//...............................................................................................
+
+EventBus PeripheralEventBus;
+
+//.................................................................................................
+// Function definitions
+//.................................................................................................
+
+EventBus::EventBus(){
+	NumberOfEvents = 0;
+	TypesInBatch = 0;
+	NumberOfSubscribers = 0;
+}
+
+bool EventBus::subscribe( uint32_t Mask, EventHandlerType Handler, void* ContextPtr ){
+	assert( nullptr != Handler );
+	if (NumberOfSubscribers >= EVENT_SUBSCRIBERS_MAX_NUMBER){
+		return false;
+	}
+	Subscribers[NumberOfSubscribers].mask = Mask & EVENT_MASK_ALL;
+	Subscribers[NumberOfSubscribers].handler = Handler;
+	Subscribers[NumberOfSubscribers].contextPtr = ContextPtr;
+	NumberOfSubscribers++;
+	return true;
+}
+
+void EventBus::post( EventTypeClass Type, uint8_t Channel, uint16_t Value, uint32_t Argument ){
+	assert( Type < EventTypeClass::TOTAL_NUMBER );
+	if (NumberOfEvents >= EVENT_BATCH_CAPACITY){
+		deliver();
+	}
+	EventStruct* EventPtr = &Batch[NumberOfEvents];
+	EventPtr->type = Type;
+	EventPtr->channel = Channel;
+	EventPtr->value = Value;
+	EventPtr->argument = Argument;
+	NumberOfEvents++;
+	TypesInBatch |= EVENT_MASK( Type );
+}
+
+// A subscriber gets the batch itself if it has subscribed to all the types in it; otherwise its events are selected
+void EventBus::deliver(void){
+	for (uint8_t J = 0; J < NumberOfSubscribers; J++){
+		const SubscriberStruct* SubscriberPtr = &Subscribers[J];
+		if (0 == (SubscriberPtr->mask & TypesInBatch)){
+			continue;
+		}
+		if (TypesInBatch == (SubscriberPtr->mask & TypesInBatch)){
+			SubscriberPtr->handler( Batch, NumberOfEvents, SubscriberPtr->contextPtr );
+			continue;
+		}
+		uint16_t NumberSelected = 0;
+		for (uint16_t K = 0; K < NumberOfEvents; K++){
+			if (0 != (SubscriberPtr->mask & EVENT_MASK( Batch[K].type ))){
+				Selected[NumberSelected] = Batch[K];
+				NumberSelected++;
+			}
+		}
+		SubscriberPtr->handler( Selected, NumberSelected, SubscriberPtr->contextPtr );
+	}
+	NumberOfEvents = 0;
+	TypesInBatch = 0;
+}
@@ -0,0 +1,83 @@
+// eventBus.h
+//
+// Threads: peripheral thread (the handlers are called in it too)
+//
+// This module passes the changes of the channels from the peripheral thread to the modules interested in them.
+// The events are detected during the synchronizations of a tick (see synchronizeDataAcrossThreads), collected
+// in a batch, and delivered at the end of the tick: each subscriber gets one call with the events of the types
+// it has subscribed to, in the order of posting. A subscriber that lives in another thread passes the batch on
+// by itself (e.g. GUI marks the channels to refresh and is woken once per refresh period, see noteEventsForGui).
+// The subscribers are registered before the first tick; the bus has no locks.
+
+#ifndef EVENTBUS_H_
+#define EVENTBUS_H_
+
+#include <inttypes.h>
+
+//.................................................................................................
+// Preprocessor directives
+//.................................................................................................
+
+// If the batch is full, it is delivered at once and the collecting starts again (nothing is lost)
+#define EVENT_BATCH_CAPACITY			1024
+#define EVENT_SUBSCRIBERS_MAX_NUMBER	8
+
+#define EVENT_MASK( Type )				(1u << (uint8_t)(Type))
+#define EVENT_MASK_ALL					(EVENT_MASK( EventTypeClass::TOTAL_NUMBER ) - 1u)
+
+//.................................................................................................
+// Definitions of types
+//.................................................................................................
+
+enum class EventTypeClass : uint8_t{
+	REGISTERS_CHANGED				= 0,	// any data of the channel has changed (see DataSharingInterface::getGeneration)
+	COMMUNICATION_STATE_CHANGED		= 1,
+	POWERING_DOWN_STATE_CHANGED		= 2,
+	ORDER_ACCEPTED					= 3,	// the order has been taken from the queue to be sent to the power supply unit
+	TOTAL_NUMBER					= 4
+};
+
+struct EventStruct{
+	EventTypeClass type;
+	uint8_t channel;
+	uint16_t value;			// *_STATE_CHANGED: the new state; ORDER_ACCEPTED: the order code
+	uint32_t argument;		// REGISTERS_CHANGED: the generation; *_STATE_CHANGED: the previous state; ORDER_ACCEPTED: the value
+};
+
+typedef void (*EventHandlerType)( const EventStruct* EventsPtr, uint16_t NumberOfEvents, void* ContextPtr );
+
+class EventBus{
+private:
+	struct SubscriberStruct{
+		uint32_t mask;
+		EventHandlerType handler;
+		void* contextPtr;
+	};
+
+	EventStruct Batch[EVENT_BATCH_CAPACITY];
+	EventStruct Selected[EVENT_BATCH_CAPACITY];		// the events of the batch passed to one subscriber
+	uint16_t NumberOfEvents;
+	uint32_t TypesInBatch;							// EVENT_MASK of the types in the batch
+	SubscriberStruct Subscribers[EVENT_SUBSCRIBERS_MAX_NUMBER];
+	uint8_t NumberOfSubscribers;
+
+public:
+	EventBus();
+
+	// This function registers a handler of the events whose EVENT_MASK is in Mask; it must be called before the ticks
+	// start; it returns false if there are too many subscribers
+	bool subscribe( uint32_t Mask, EventHandlerType Handler, void* ContextPtr );
+
+	void post( EventTypeClass Type, uint8_t Channel, uint16_t Value, uint32_t Argument );
+
+	// This function passes the batch to the subscribers and empties it; it is called once per tick
+	void deliver(void);
+};
+
+//...............................................................................................
+// Global variables
+//...............................................................................................
+
+extern EventBus PeripheralEventBus;
+
+#endif /* EVENTBUS_H_ */
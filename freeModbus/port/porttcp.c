@@ -46,6 +46,7 @@
 #include <time.h>
 
 #include "port.h"
+#include "wireCapture.h"
 
 /* ----------------------- Modbus includes ----------------------------------*/
 #include "mb.h"
@@ -285,6 +286,7 @@ xMBTCPPortGetRequest( UCHAR ** ppucMBTCPFrame, USHORT * usTCPLength )
 {
     *ppucMBTCPFrame = &aucTCPBuf[0];
     *usTCPLength = usTCPBufPos;
+    captureWireFrame( WIRE_CAPTURE_TCP_SLAVE_REQUEST, 0, 0xFF, 0, 0, aucTCPBuf, usTCPBufPos, 0 );
 
     /* Reset the buffer. */
     usTCPBufPos = 0;
@@ -301,6 +303,7 @@ xMBTCPPortSendResponse( const UCHAR * pucMBTCPFrame, USHORT usTCPLength )
     int             iBytesSent = 0;
     int             iTimeOut = MB_TCP_READ_TIMEOUT;
 
+    captureWireFrame( WIRE_CAPTURE_TCP_SLAVE_RESPONSE, 0, 0xFF, 0, 0, pucMBTCPFrame, usTCPLength, 0 );
     do
     {
         res = send( xClientSocket, &pucMBTCPFrame[iBytesSent], usTCPLength - iBytesSent, 0 );
@@ -0,0 +1,2 @@
+// File generated automatically by make
+const char TcpSlaveIdentifier[40] = "ID: git commit time 2026-10-17 04:23:31";
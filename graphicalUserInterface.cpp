@@ -4,6 +4,9 @@
 
 #include "graphicalUserInterface.h"
 #include "dataSharingInterface.h"
+#include "registerStore.h"
+#include "channelHistory.h"
+#include "orderQueue.h"
 #include <iostream>
 
 //.................................................................................................
@@ -58,6 +61,10 @@ static const char ModeRemote[]  = "Tryb zdalny ";
 
 static const int16_t RelativeIncreamentsTable[4] = { 328, 33, -33, -328 };
 
+// The names of the primitive orders in the diagnostics (the index is the order code)
+static const char* const PrimitiveOrderNames[RTU_PRIMITIVE_ORDER_TOTAL_NUMBER] =
+		{ "odczyt całości", "odczyt 1", "odczyt 2", "włączenie", "wyłączenie", "nastawa" };
+
 static const char TcpErrorText0[]	= " Łączenie z serwerem \n        (slave'em) Modbusa TCP      ";
 static const char TcpErrorText1[]	= "   internal error    \n                                    ";
 static const char TcpErrorText2[]	= "Błąd komunikacji TCP:\n               select()             ";
@@ -100,7 +107,7 @@ static const char* TableTcpErrorTexts[17] = {
 // Global variables
 //.................................................................................................
 
-ChannelGuiGroup* TableOfGroupsPtr[MAX_NUMBER_OF_SERIAL_PORTS];
+ChannelGuiGroup* TableOfGroupsPtr[MAX_NUMBER_OF_CHANNELS];
 
 Fl_Box* LargeErrorMessage;
 
@@ -155,6 +162,10 @@ static Fl_Box* ComputerLabelPtr;
 
 static Fl_Button* RemoteComputerControlButton;
 
+// The channels whose data has changed since the last refresh (bit J%32 of word J/32); they are marked
+// in the peripheral thread (see noteEventsForGui) and taken in the main FLTK thread (see refreshChangedChannels)
+static uint32_t ChannelsToRefresh[(MAX_NUMBER_OF_CHANNELS + 31) / 32];
+
 //.................................................................................................
 // Local function prototypes
 //.................................................................................................
@@ -248,14 +259,20 @@ void initializeWidgetsOfChannels(void){
 
     BlankRectanglePtr = new BlankRectangleWidget(0, 0, MAIN_WINDOW_WIDTH, 2*GROUPS_OF_WIDGETS_SPACING-1);
     BlankRectanglePtr->hide();
+}
 
-    for (int J = 0; J < MAX_NUMBER_OF_SERIAL_PORTS; J++) {
+// The groups are created for the channels known at the moment (see allocateChannelTables)
+void createChannelWidgets(void* Data){
+	(void)Data; // intentionally unused
+    for (int J = 0; J < NumberOfChannels; J++) {
+    	if (nullptr != TableOfGroupsPtr[J]){
+    		continue;
+    	}
     	TableOfGroupsPtr[J] = new ChannelGuiGroup(0, channelVerticalPosition(J), MAIN_WINDOW_WIDTH, GROUPS_OF_WIDGETS_SPACING-1);
     	TableOfGroupsPtr[J]->hide();
     	ApplicationWindow->add( TableOfGroupsPtr[J] );
     	TableOfGroupsPtr[J]->setGroupID(J);
     }
-
 }
 
 void StateMarkWidget::draw(){
@@ -395,6 +412,10 @@ ChannelGuiGroup::ChannelGuiGroup(int X, int Y, int W, int H, const char* L) : Fl
 
 	OldPowerDownState = PoweringDownStatesClass::INACTIVE;
 	OldControlFromGuiHere = 0;
+	DrawnWidgetsGeneration = 0;
+	DrawnSetPointEntryDialog = -1;
+	DrawnY = Y;
+	IsRefreshForced = true;
 
     // Add widgets to group
     this->end();
@@ -426,9 +447,9 @@ void ChannelGuiGroup::setLastAcceptedValueString( const char* Text ){
 }
 
 void ChannelGuiGroup::refreshNumericValues( CommunicationStatesClass StateOfTransmission, double NewValueOfCurrent, double NewValueOfSetpoint ){
-	static char ValueOfCurrentOutputText[MAX_NUMBER_OF_SERIAL_PORTS][10];
-	static char SetPointOutputText[MAX_NUMBER_OF_SERIAL_PORTS][10];
-	if(GroupID >= MAX_NUMBER_OF_SERIAL_PORTS){
+	static char ValueOfCurrentOutputText[MAX_NUMBER_OF_CHANNELS][10];
+	static char SetPointOutputText[MAX_NUMBER_OF_CHANNELS][10];
+	if(GroupID >= MAX_NUMBER_OF_CHANNELS){
 		return;
 	}
 	if ((CommunicationStatesClass::HEALTHY == StateOfTransmission) || (CommunicationStatesClass::TEMPORARY_ERRORS == StateOfTransmission)){
@@ -587,8 +608,8 @@ void ChannelGuiGroup::setDescriptionLabel(){
 }
 
 void ChannelGuiGroup::refreshPhysicalID( uint16_t PhysicalIdRegister ){
-	static char PhysicalIdText[MAX_NUMBER_OF_SERIAL_PORTS][8];
-	if(GroupID >= MAX_NUMBER_OF_SERIAL_PORTS){
+	static char PhysicalIdText[MAX_NUMBER_OF_CHANNELS][8];
+	if(GroupID >= MAX_NUMBER_OF_CHANNELS){
 		return;
 	}
 	snprintf( PhysicalIdText[GroupID], sizeof(PhysicalIdText[GroupID])-1, "%02X", PhysicalIdRegister );
@@ -645,6 +666,27 @@ void ChannelGuiGroup::restoreInitialState(){
 	this->position( 0, channelVerticalPosition(this->getGroupID()) );
 	this->setBottomLineVisibility();
 	this->selectiveActivate();
+	forceRefresh();
+}
+
+// The widgets have to be refreshed if the data displayed in them has changed, or if the state of GUI,
+// on which they depend, has changed (local/remote control, the set-point entry dialog, the position of the group)
+bool ChannelGuiGroup::isRefreshNeeded(){
+	return IsRefreshForced || (y() != DrawnY) ||
+			(TableOfSharedDataForGui[GroupID].getWidgetsGeneration() != DrawnWidgetsGeneration) ||
+			(ControlFromGuiHere != OldControlFromGuiHere) ||
+			(SetPointInputGroupPtr->getChannelDisplayingSetPointEntryDialog() != DrawnSetPointEntryDialog);
+}
+
+void ChannelGuiGroup::noteRefresh(){
+	DrawnWidgetsGeneration = TableOfSharedDataForGui[GroupID].getWidgetsGeneration();
+	DrawnSetPointEntryDialog = SetPointInputGroupPtr->getChannelDisplayingSetPointEntryDialog();
+	DrawnY = y();
+	IsRefreshForced = false;
+}
+
+void ChannelGuiGroup::forceRefresh(){
+	IsRefreshForced = true;
 }
 
 void ChannelGuiGroup::setWidgetsOnPowerDownWarningActive(){
@@ -758,10 +800,10 @@ SetPointInputGroup::SetPointInputGroup(int X, int Y, int W, int H, const char* L
 
 void SetPointInputGroup::setChannelDisplayingSetPointEntryDialog( int16_t NewValue ){
 	if ((0 <= NewValue) && (NewValue < NumberOfChannels)){
-		ChannelThatDisplaysInputValueDialog = NewValue;
+		__atomic_store_n( &ChannelThatDisplaysInputValueDialog, NewValue, __ATOMIC_RELAXED );
 	}
 	else{
-		ChannelThatDisplaysInputValueDialog = -1;
+		__atomic_store_n( &ChannelThatDisplaysInputValueDialog, (int16_t)-1, __ATOMIC_RELAXED );
 	}
 }
 
@@ -778,7 +820,7 @@ void SetPointInputGroup::openDialog( int X, int Y ){
 
 void SetPointInputGroup::closeDialog(){
 	if( -1 != ChannelThatDisplaysInputValueDialog){
-		ChannelThatDisplaysInputValueDialog = -1;
+		__atomic_store_n( &ChannelThatDisplaysInputValueDialog, (int16_t)-1, __ATOMIC_RELAXED );
 		this->hide();
 	}
 }
@@ -802,11 +844,8 @@ void SetPointInputGroup::resetMulticlick(){
 // however, if the user clicks faster, the function buffers the setpoint to keep up with the clicks;
 // when the user stops clicking, the buffered value is synchronized with the Modbus RTU register value.
 uint16_t SetPointInputGroup::getMulticlickProofSetpointValue( uint8_t ChannelIndex ){
-	DataSharingInterface* InterfaceDataPtr;
-
 	if (0 == MulticlickCounter){
-		InterfaceDataPtr = &TableOfSharedDataForGui[ChannelIndex];
-		OfflineSetpointValue = InterfaceDataPtr->getModbusRegister(MODBUS_ADDRES_REQUIRED_VALUE);
+		OfflineSetpointValue = RegisterStoreForGui.getRegister( MODBUS_ADDRES_REQUIRED_VALUE, ChannelIndex );
 	}
 	MulticlickCounter = 2;
 	return OfflineSetpointValue;
@@ -818,7 +857,10 @@ void SetPointInputGroup::setOfflineSetpointValue( uint16_t NewValue ){
 
 // This function transfers information about updating the Modbus RTU register containing the setpoint to GUI.
 // The information is needed in to protect against fast multiclicking of the buttons '+1A' '-0.1A' ... '-1A'
-void multiclickCountdown(void){
+void multiclickCountdown( uint8_t ChannelIndex ){
+	if (ChannelIndex != __atomic_load_n( &SetPointInputGroupPtr->ChannelThatDisplaysInputValueDialog, __ATOMIC_RELAXED )){
+		return;		// the readings of the other channels do not refresh the setpoint being edited
+	}
 	if (0 < SetPointInputGroupPtr->MulticlickCounter){
 		SetPointInputGroupPtr->MulticlickCounter--;
 	}
@@ -826,6 +868,7 @@ void multiclickCountdown(void){
 
 DiagnosticsGroup::DiagnosticsGroup(int X, int Y, int W, int H, const char* L) : Fl_Group(X, Y, W, H, L) {
 	ChannelThatDisplaysDiagnostics = -1;
+	DrawnGeneration = 0;
 
 	DiagnosticTextBoxPtr = new Fl_Box(X, Y, W, H, "tu powinny być dane diagnostyczne");
 	DiagnosticTextBoxPtr->labelfont( FL_COURIER );
@@ -839,7 +882,7 @@ DiagnosticsGroup::DiagnosticsGroup(int X, int Y, int W, int H, const char* L) :
 }
 
 void DiagnosticsGroup::updateDataAndWidgets(){
-	static char DiagnosticsText[400];
+	static char DiagnosticsText[1024];
 	char* LastErrorTextPtr;
 	CommunicationStatesClass CommunicationPerformance;
 
@@ -876,21 +919,38 @@ void DiagnosticsGroup::updateDataAndWidgets(){
 				"Napięcie   %7.2f  %7.2f  %7.2f  %7.2f  %7.2f  \n\n"
 				"Błędy transmisji Modbus RTU: %3d.%d%%     Najdłuższy ciąg %3d\n"
 				"Ostatni błąd Modbusa RTU: %s               ",
-				0.01*(double)TableOfSharedDataForGui[ChannelThatDisplaysDiagnostics].getModbusRegister(MODBUS_ADDRES_CURRENT_MEAN),
-				0.01*(double)TableOfSharedDataForGui[ChannelThatDisplaysDiagnostics].getModbusRegister(MODBUS_ADDRES_CURRENT_MEDIAN),
-				0.01*(double)TableOfSharedDataForGui[ChannelThatDisplaysDiagnostics].getModbusRegister(MODBUS_ADDRES_CURRENT_FILTERED),
-				0.01*(double)TableOfSharedDataForGui[ChannelThatDisplaysDiagnostics].getModbusRegister(MODBUS_ADDRES_CURRENT_PEAK_TO_PEAK),
-				0.01*(double)TableOfSharedDataForGui[ChannelThatDisplaysDiagnostics].getModbusRegister(MODBUS_ADDRES_CURRENT_STD_DEVIATION),
-
-				0.01*(double)TableOfSharedDataForGui[ChannelThatDisplaysDiagnostics].getModbusRegister(MODBUS_ADDRES_VOLTAGE_MEAN),
-				0.01*(double)TableOfSharedDataForGui[ChannelThatDisplaysDiagnostics].getModbusRegister(MODBUS_ADDRES_VOLTAGE_MEDIAN),
-				0.01*(double)TableOfSharedDataForGui[ChannelThatDisplaysDiagnostics].getModbusRegister(MODBUS_ADDRES_VOLTAGE_FILTERED),
-				0.01*(double)TableOfSharedDataForGui[ChannelThatDisplaysDiagnostics].getModbusRegister(MODBUS_ADDRES_VOLTAGE_PEAK_TO_PEAK),
-				0.01*(double)TableOfSharedDataForGui[ChannelThatDisplaysDiagnostics].getModbusRegister(MODBUS_ADDRES_VOLTAGE_STD_DEVIATION),
+				(double)RegisterStoreForGui.getQuantity( QUANTITY_CURRENT_MEAN, ChannelThatDisplaysDiagnostics ),
+				(double)RegisterStoreForGui.getQuantity( QUANTITY_CURRENT_MEDIAN, ChannelThatDisplaysDiagnostics ),
+				(double)RegisterStoreForGui.getQuantity( QUANTITY_CURRENT_FILTERED, ChannelThatDisplaysDiagnostics ),
+				(double)RegisterStoreForGui.getQuantity( QUANTITY_CURRENT_PEAK_TO_PEAK, ChannelThatDisplaysDiagnostics ),
+				(double)RegisterStoreForGui.getQuantity( QUANTITY_CURRENT_STD_DEVIATION, ChannelThatDisplaysDiagnostics ),
+
+				(double)RegisterStoreForGui.getQuantity( QUANTITY_VOLTAGE_MEAN, ChannelThatDisplaysDiagnostics ),
+				(double)RegisterStoreForGui.getQuantity( QUANTITY_VOLTAGE_MEDIAN, ChannelThatDisplaysDiagnostics ),
+				(double)RegisterStoreForGui.getQuantity( QUANTITY_VOLTAGE_FILTERED, ChannelThatDisplaysDiagnostics ),
+				(double)RegisterStoreForGui.getQuantity( QUANTITY_VOLTAGE_PEAK_TO_PEAK, ChannelThatDisplaysDiagnostics ),
+				(double)RegisterStoreForGui.getQuantity( QUANTITY_VOLTAGE_STD_DEVIATION, ChannelThatDisplaysDiagnostics ),
 				TableOfSharedDataForGui[ChannelThatDisplaysDiagnostics].getPerMilleError() / 10,
 				TableOfSharedDataForGui[ChannelThatDisplaysDiagnostics].getPerMilleError() % 10,
 				TableOfSharedDataForGui[ChannelThatDisplaysDiagnostics].getMaxErrorSequence(),
 				LastErrorTextPtr );
+
+		if (0 != IsModbusTcpSlave){
+			// the time from placing an order (GUI or Modbus TCP) to writing its frame to the serial port
+			size_t Length = strlen( DiagnosticsText );
+			snprintf( DiagnosticsText+Length, sizeof(DiagnosticsText)-1-Length,
+					"\nOpóźnienie rozkazu: ostatnie %5.1f ms, największe %5.1f ms  ",
+					0.001*(double)TableOfSharedDataForGui[ChannelThatDisplaysDiagnostics].getOrderToWireLatencyLast(),
+					0.001*(double)TableOfSharedDataForGui[ChannelThatDisplaysDiagnostics].getOrderToWireLatencyMax() );
+			// the orders merged with newer ones and the orders dropped because the queue was full
+			Length = strlen( DiagnosticsText );
+			snprintf( DiagnosticsText+Length, sizeof(DiagnosticsText)-1-Length,
+					"\nRozkazy scalone: %u, odrzucone: %u  ",
+					(unsigned)TableOfSharedDataForGui[ChannelThatDisplaysDiagnostics].getCoalescedOrders(),
+					(unsigned)TableOfSharedDataForGui[ChannelThatDisplaysDiagnostics].getDroppedOrders() );
+		}
+		appendRoundTripLatencies( DiagnosticsText, sizeof(DiagnosticsText) );
+		appendRecentHistory( DiagnosticsText, sizeof(DiagnosticsText) );
 	}
 	else if (CommunicationStatesClass::PERMANENT_ERRORS == CommunicationPerformance){
 		// display information about communication errors
@@ -921,8 +981,8 @@ void DiagnosticsGroup::updateDataAndWidgets(){
 				"Ostatni błąd Modbusa: %s                         ",
 				TableOfSharedDataForGui[ChannelThatDisplaysDiagnostics].getPowerSupplyUnitId(),
 				TableOfSharedDataForGui[ChannelThatDisplaysDiagnostics].getPowerSupplyUnitId(),
-				TableOfSharedDataForGui[ChannelThatDisplaysDiagnostics].getModbusRegister(MODBUS_ADDRES_POWER_SOURCE_ID),
-				TableOfSharedDataForGui[ChannelThatDisplaysDiagnostics].getModbusRegister(MODBUS_ADDRES_POWER_SOURCE_ID),
+				RegisterStoreForGui.getRegister( MODBUS_ADDRES_POWER_SOURCE_ID, ChannelThatDisplaysDiagnostics ),
+				RegisterStoreForGui.getRegister( MODBUS_ADDRES_POWER_SOURCE_ID, ChannelThatDisplaysDiagnostics ),
 				TableOfSharedDataForGui[ChannelThatDisplaysDiagnostics].getPerMilleError() / 10,
 				TableOfSharedDataForGui[ChannelThatDisplaysDiagnostics].getPerMilleError() % 10,
 				TableOfSharedDataForGui[ChannelThatDisplaysDiagnostics].getMaxErrorSequence(),
@@ -935,6 +995,84 @@ void DiagnosticsGroup::updateDataAndWidgets(){
 				(TableOfSharedDataForGui[ChannelThatDisplaysDiagnostics].getNameOfPortPtr())->c_str() );
 	}
 	DiagnosticTextBoxPtr->label( DiagnosticsText );
+	DrawnGeneration = TableOfSharedDataForGui[ChannelThatDisplaysDiagnostics].getGeneration();
+}
+
+// The text depends only on the data of the channel; it is prepared anew when the channel is selected
+bool DiagnosticsGroup::isRefreshNeeded(){
+	if (ChannelThatDisplaysDiagnostics < 0){
+		return false;
+	}
+	return TableOfSharedDataForGui[ChannelThatDisplaysDiagnostics].getGeneration() != DrawnGeneration;
+}
+
+// This function appends the round-trip latencies of Modbus RTU transactions to the diagnostics text:
+// the percentiles of all the orders and the 99th percentile of each order
+// (the latter are not available in 'remote computer' mode)
+void DiagnosticsGroup::appendRoundTripLatencies( char* TextPtr, size_t TextSize ){
+	LatencySummaryStruct Summary;
+	size_t Length;
+
+	Summary = TableOfSharedDataForGui[ChannelThatDisplaysDiagnostics].getRoundTripLatency( ROUND_TRIP_ALL_ORDERS );
+	if (0 == Summary.count){
+		return;
+	}
+	Length = strlen( TextPtr );
+	snprintf( TextPtr+Length, TextSize-1-Length,
+			"\nCzas odpowiedzi: p50 %5.1f  p90 %5.1f  p99 %5.1f  maks. %5.1f ms  ",
+			0.001*(double)Summary.p50, 0.001*(double)Summary.p90, 0.001*(double)Summary.p99, 0.001*(double)Summary.max );
+
+	if (0 == IsModbusTcpSlave){
+		return;
+	}
+	Length = strlen( TextPtr );
+	snprintf( TextPtr+Length, TextSize-1-Length, "\np99:" );
+	for (uint8_t Order = 0; Order < RTU_PRIMITIVE_ORDER_TOTAL_NUMBER; Order++){
+		Summary = TableOfSharedDataForGui[ChannelThatDisplaysDiagnostics].getRoundTripLatency( Order );
+		if (0 != Summary.count){
+			Length = strlen( TextPtr );
+			snprintf( TextPtr+Length, TextSize-1-Length, " %s %.1f ms ", PrimitiveOrderNames[Order], 0.001*(double)Summary.p99 );
+		}
+	}
+}
+
+// This function appends the minimum, the average and the maximum of the current and of the voltage
+// over the last minute, calculated from the aggregates of one second (see channelHistory.h)
+void DiagnosticsGroup::appendRecentHistory( char* TextPtr, size_t TextSize ){
+	static HistoryRecordStruct Records[60];
+	uint32_t Number;
+	uint64_t Now;
+	size_t Length;
+	float CurrentMin, CurrentMax, VoltageMin, VoltageMax;
+	double CurrentSum, VoltageSum;
+	uint32_t Samples;
+
+	Now = getMonotonicMicroseconds();
+	Number = TableOfChannelHistories[ChannelThatDisplaysDiagnostics].read( HISTORY_TIER_SECOND,
+			(Now > HISTORY_MINUTE_US)? Now - HISTORY_MINUTE_US : 0, Records, sizeof(Records)/sizeof(Records[0]) );
+	if (0 == Number){
+		return;
+	}
+	CurrentMin = Records[0].currentMin;
+	CurrentMax = Records[0].currentMax;
+	VoltageMin = Records[0].voltageMin;
+	VoltageMax = Records[0].voltageMax;
+	CurrentSum = VoltageSum = 0.0;
+	Samples = 0;
+	for (uint32_t J = 0; J < Number; J++){
+		CurrentMin = (Records[J].currentMin < CurrentMin)? Records[J].currentMin : CurrentMin;
+		CurrentMax = (Records[J].currentMax > CurrentMax)? Records[J].currentMax : CurrentMax;
+		VoltageMin = (Records[J].voltageMin < VoltageMin)? Records[J].voltageMin : VoltageMin;
+		VoltageMax = (Records[J].voltageMax > VoltageMax)? Records[J].voltageMax : VoltageMax;
+		CurrentSum += (double)Records[J].currentAverage * Records[J].samples;
+		VoltageSum += (double)Records[J].voltageAverage * Records[J].samples;
+		Samples += Records[J].samples;
+	}
+	Length = strlen( TextPtr );
+	snprintf( TextPtr+Length, TextSize-1-Length,
+			"\nOstatnia minuta (min/śr/maks): prąd %.2f/%.2f/%.2f A, napięcie %.2f/%.2f/%.2f V  ",
+			(double)CurrentMin, CurrentSum/Samples, (double)CurrentMax,
+			(double)VoltageMin, VoltageSum/Samples, (double)VoltageMax );
 }
 
 int16_t DiagnosticsGroup::getChannelDisplayingDiagnostics(){
@@ -974,7 +1112,7 @@ static void powerOnCallback(Fl_Widget* Widget, void* Data){
 	if ((TableOfSharedDataForGui[Channel].getStateOfCommunication() == CommunicationStatesClass::HEALTHY) ||
 			(TableOfSharedDataForGui[Channel].getStateOfCommunication() == CommunicationStatesClass::TEMPORARY_ERRORS))
 	{
-		TableOfSharedDataForGui[Channel].placeNewOrder( RTU_ORDER_POWER_ON, 0 );
+		(void) placeOrderInQueue( Channel, ORDER_SOURCE_GUI, RTU_ORDER_POWER_ON, 0 );
 	}
 }
 
@@ -988,10 +1126,10 @@ static void powerOffCallback(Fl_Widget* Widget, void* Data){
 	Channel = MyGroup->getGroupID();
 
 	if (PoweringDownStatesClass::TIMEOUT_EXCEEDED != TableOfSharedDataForGui[Channel].getPoweringDownState()){
-		TableOfSharedDataForGui[Channel].placeNewOrder( RTU_ORDER_DELAYED_POWER_OFF, 0 );
+		(void) placeOrderInQueue( Channel, ORDER_SOURCE_GUI, RTU_ORDER_DELAYED_POWER_OFF, 0 );
 	}
 	else{
-		TableOfSharedDataForGui[Channel].placeNewOrder( RTU_ORDER_POWER_OFF, 0 );
+		(void) placeOrderInQueue( Channel, ORDER_SOURCE_GUI, RTU_ORDER_POWER_OFF, 0 );
 	}
 
 #if DEBUG_POWERING_DOWN_STATE_MACHINE
@@ -1088,7 +1226,7 @@ static void acceptSetPointDialogCallback(Fl_Widget* Widget, void* Data){
 		NewValueUint16 = 0xFFFFu; // to avoid overflow
 	}
 
-	TableOfSharedDataForGui[Channel].placeNewOrder( RTU_ORDER_SET_VALUE, NewValueUint16 );
+	(void) placeOrderInQueue( Channel, ORDER_SOURCE_GUI, RTU_ORDER_SET_VALUE, NewValueUint16 );
 
 	SetPointInputGroupPtr->resetMulticlick();
 }
@@ -1181,7 +1319,7 @@ static void relativeChangeOfSetPointCallback(Fl_Widget* Widget, void* Data){
 		SetPointValue = 0;
 	}
 	SetPointInputGroupPtr->setOfflineSetpointValue( (uint16_t)SetPointValue );
-	TableOfSharedDataForGui[Channel].placeNewOrder( RTU_ORDER_SET_VALUE, (uint16_t)SetPointValue );
+	(void) placeOrderInQueue( Channel, ORDER_SOURCE_GUI, RTU_ORDER_SET_VALUE, (uint16_t)SetPointValue );
 }
 
 // Callback function called when the 'i' button is pressed
@@ -1319,52 +1457,60 @@ void updateChannelWidgets(void* Data) {
 	uint16_t Channel;
 	double FloatingPointValueOfCurrent, FloatingPointValueSetPoint;
 	DataSharingInterface* InterfaceDataPtr;
+	bool IsRefreshNeeded;
 
 	if (nullptr == Data){
 		return;
 	}
 	GroupPtr = (ChannelGuiGroup*)Data;
 	Channel = GroupPtr->getGroupID();
+	refreshSharedDataForGui( Channel );
 	InterfaceDataPtr = &TableOfSharedDataForGui[Channel];
+	IsRefreshNeeded = GroupPtr->isRefreshNeeded();
 
-	if (0 != GroupPtr->visible()){
+	if ((0 != GroupPtr->visible()) && IsRefreshNeeded){
 
 		GroupPtr->refreshPowerOnOffLabel( InterfaceDataPtr->getStateOfCommunication(), InterfaceDataPtr->getPowerSwitchState() );
 
 		// the calculation is described in the documentation
-		FloatingPointValueOfCurrent = 0.01 * (double)(InterfaceDataPtr->getModbusRegister(MODBUS_ADDRES_CURRENT_FILTERED));
+		FloatingPointValueOfCurrent = (double)RegisterStoreForGui.getQuantity( QUANTITY_CURRENT_FILTERED, Channel );
 
-		FloatingPointValueSetPoint = (200.0/65536.0) * (double)(InterfaceDataPtr->getModbusRegister(MODBUS_ADDRES_REQUIRED_VALUE));
+		FloatingPointValueSetPoint = (double)RegisterStoreForGui.getQuantity( QUANTITY_SETPOINT, Channel );
 
 		GroupPtr->refreshNumericValues( InterfaceDataPtr->getStateOfCommunication(), FloatingPointValueOfCurrent, FloatingPointValueSetPoint );
 
 		GroupPtr->refreshStatusLabels( InterfaceDataPtr->getStateOfCommunication(),
-				InterfaceDataPtr->getModbusRegister(MODBUS_ADDRES_SLAVE_STATUS) );
+				RegisterStoreForGui.getRegister( MODBUS_ADDRES_SLAVE_STATUS, Channel ) );
 
 		GroupPtr->refreshPhysicalID( InterfaceDataPtr->getPowerSupplyUnitId() );
 
 		GroupPtr->updateSettingsButtonsAndPowerDownWigets( InterfaceDataPtr->getStateOfCommunication(), InterfaceDataPtr->getPoweringDownState() );
-	}
-	else{
-		if (0 == Channel){
-			if (0 != LargeErrorMessage->visible()){
-				LargeErrorMessage->redraw();
-			}
-		}
+		GroupPtr->noteRefresh();
 	}
 
-	if (DiagnosticsGroupPtr->getChannelDisplayingDiagnostics() == Channel){
+	if ((DiagnosticsGroupPtr->getChannelDisplayingDiagnostics() == Channel) && DiagnosticsGroupPtr->isRefreshNeeded()){
 		if (0 != DiagnosticsGroupPtr->visible()){
 			DiagnosticsGroupPtr->updateDataAndWidgets();
 		}
 		DiagnosticsGroupPtr->redraw();
 	}
 
-	if (SetPointInputGroupPtr->getChannelDisplayingSetPointEntryDialog() == Channel){
-		SetPointInputGroupPtr->redraw();
+	if (IsRefreshNeeded){
+		if (SetPointInputGroupPtr->getChannelDisplayingSetPointEntryDialog() == Channel){
+			SetPointInputGroupPtr->redraw();
+		}
+		GroupPtr->redraw();
 	}
+}
 
-	GroupPtr->redraw();
+// Function called by Fl::awake() to refresh the widgets of the window that do not belong to any channel
+void updateWindowWidgets(void* Data) {
+	(void)Data; // intentionally unused
+	if ((nullptr == TableOfGroupsPtr[0]) || (0 == TableOfGroupsPtr[0]->visible())){
+		if (0 != LargeErrorMessage->visible()){
+			LargeErrorMessage->redraw();
+		}
+	}
 
 	if (UpdateConfigurableWidgets){
 		UpdateConfigurableWidgets = false;
@@ -1379,6 +1525,36 @@ void updateChannelWidgets(void* Data) {
 	}
 }
 
+// Threads: peripheral thread
+void noteEventsForGui( const EventStruct* EventsPtr, uint16_t NumberOfEvents, void* ContextPtr ){
+	(void)ContextPtr; // intentionally unused
+	for (uint16_t J = 0; J < NumberOfEvents; J++){
+		uint8_t Channel = EventsPtr[J].channel;
+		__atomic_fetch_or( &ChannelsToRefresh[Channel / 32], 1u << (Channel % 32), __ATOMIC_RELEASE );
+	}
+}
+
+// The channels which have not been marked are not read at all; their widgets are refreshed only if they depend on
+// the state of GUI (e.g. local/remote control) or if the diagnostics of the channel have just been opened
+void refreshChangedChannels(void* Data){
+	(void)Data; // intentionally unused
+	for (uint16_t Word = 0; Word < (NumberOfChannels + 31) / 32; Word++){
+		uint32_t Marked = __atomic_exchange_n( &ChannelsToRefresh[Word], 0, __ATOMIC_ACQUIRE );
+		for (uint16_t Channel = Word * 32; (Channel < NumberOfChannels) && (Channel < (Word + 1) * 32); Channel++){
+			ChannelGuiGroup* GroupPtr = TableOfGroupsPtr[Channel];
+			if (nullptr == GroupPtr){
+				continue;	// createChannelWidgets has not been called yet
+			}
+			if ((0 != (Marked & (1u << (Channel % 32)))) || GroupPtr->isRefreshNeeded() ||
+					((DiagnosticsGroupPtr->getChannelDisplayingDiagnostics() == Channel) && DiagnosticsGroupPtr->isRefreshNeeded()))
+			{
+				updateChannelWidgets( (void*)GroupPtr );
+			}
+		}
+	}
+	updateWindowWidgets( nullptr );
+}
+
 void displayConfigurationFileErrorMessage(void* Data){
 	(void)Data; // intentionally unused
 	LargeErrorMessage->show();
@@ -1393,8 +1569,11 @@ void displayTcpConnectionErrorMessage(void* Data){
 	LargeErrorMessage->redraw();
 }
 
+// Data is the index of the channel
 void displayChannelWidgets(void* Data){
-	ChannelGuiGroup* TemporaryGroupPtr = (ChannelGuiGroup*)Data;
+	ChannelGuiGroup* TemporaryGroupPtr = TableOfGroupsPtr[(uintptr_t)Data];
+	refreshSharedDataForGui( TemporaryGroupPtr->getGroupID() );
+	TemporaryGroupPtr->forceRefresh();
 	TemporaryGroupPtr->setDescriptionLabel();
 	TemporaryGroupPtr->truncateDescription();
 	TemporaryGroupPtr->show();
@@ -1402,20 +1581,20 @@ void displayChannelWidgets(void* Data){
 
 void restoreChannelWidgets(void* Data){
 	(void)Data; // intentionally unused
-	uint8_t J;
+	uint16_t J;
 	LargeErrorMessage->hide();
-	for (J = 0; J < NumberOfChannels; J++) {
+	for (J = 0; (J < NumberOfChannels) && (nullptr != TableOfGroupsPtr[J]); J++) {
 		TableOfGroupsPtr[J]->restoreInitialState();
 	}
-	for ( ; J < MAX_NUMBER_OF_SERIAL_PORTS; J++) {
+	for ( ; (J < MAX_NUMBER_OF_CHANNELS) && (nullptr != TableOfGroupsPtr[J]); J++) {
 		TableOfGroupsPtr[J]->hide();
 	}
 }
 
 void displayTcpConnectionErrorMessageAndHideChannelWidgets(void* Data){
-	uint8_t J;
+	uint16_t J;
 	uint8_t ErrorCode = *(uint8_t*)Data;
-	for (J = 0; J < MAX_NUMBER_OF_SERIAL_PORTS; J++) {
+	for (J = 0; (J < MAX_NUMBER_OF_CHANNELS) && (nullptr != TableOfGroupsPtr[J]); J++) {
 		if(0 != TableOfGroupsPtr[J]->visible()){
 			TableOfGroupsPtr[J]->hide();
 		}
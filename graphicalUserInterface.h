@@ -12,6 +12,7 @@
 #include <FL/Fl_Text_Display.H>
 #include <FL/Fl_Box.H>
 #include "rstlProtocolMaster.h"
+#include "eventBus.h"
 
 //.................................................................................................
 // Preprocessor directives
@@ -102,6 +103,10 @@ private:
     Fl_Box * OnPowerDownWarning2Ptr;
     PoweringDownStatesClass OldPowerDownState;
     uint8_t OldControlFromGuiHere;
+    uint32_t DrawnWidgetsGeneration;		// TableOfSharedDataForGui[GroupID].getWidgetsGeneration() when the widgets were refreshed
+    int16_t DrawnSetPointEntryDialog;		// SetPointInputGroupPtr->getChannelDisplayingSetPointEntryDialog() at that time
+    int DrawnY;								// the labels are placed relative to the position of the group
+    bool IsRefreshForced;
 public:
     ChannelGuiGroup(int X, int Y, int W, int H, const char* L = nullptr);
     void setGroupID( int NewValue );
@@ -123,6 +128,9 @@ public:
     void restoreInitialState();
     void setWidgetsOnPowerDownWarningActive();
     void setWidgetsOnPowerDownWarningInactive();
+    bool isRefreshNeeded();
+    void noteRefresh();
+    void forceRefresh();
 };
 
 // This is Esc-proof window
@@ -138,7 +146,7 @@ public:
 // There is to be only one object of this type
 class SetPointInputGroup : public Fl_Group {
 private:
-	int16_t ChannelThatDisplaysInputValueDialog;
+	int16_t ChannelThatDisplaysInputValueDialog;	// read also by the polling workers (see multiclickCountdown())
 	Fl_Float_Input* InputDialogPtr;
 	std::string* LastValidInputStringPtr;
 	Fl_Button* AcceptButtonPtr;
@@ -167,7 +175,7 @@ public:
 	uint16_t getMulticlickProofSetpointValue( uint8_t ChannelIndex );
 	void setOfflineSetpointValue( uint16_t NewValue );
 
-	friend void multiclickCountdown(void);
+	friend void multiclickCountdown( uint8_t ChannelIndex );
 };
 
 // This is a group of widgets related to diagnostics data
@@ -175,11 +183,15 @@ public:
 class DiagnosticsGroup : public Fl_Group {
 private:
 	int16_t ChannelThatDisplaysDiagnostics;
+	uint32_t DrawnGeneration;		// TableOfSharedDataForGui[ChannelThatDisplaysDiagnostics].getGeneration() when the text was prepared
 	Fl_Box* DiagnosticTextBoxPtr;
 	HorizontalLineWidget* BottomLinePtr;
+	void appendRoundTripLatencies( char* TextPtr, size_t TextSize );
+	void appendRecentHistory( char* TextPtr, size_t TextSize );
 public:
 	DiagnosticsGroup(int X, int Y, int W, int H, const char* L = nullptr);
 	void updateDataAndWidgets();
+	bool isRefreshNeeded();
 	int16_t getChannelDisplayingDiagnostics();
 	void setChannelDisplayingDiagnostics( int16_t NewValue );
 	void closeGroup();
@@ -194,7 +206,8 @@ public:
 extern bool ActiveModbusTcpServer;
 
 extern WindowEscProof* ApplicationWindow;
-extern ChannelGuiGroup* TableOfGroupsPtr[MAX_NUMBER_OF_SERIAL_PORTS];
+// The groups are created by createChannelWidgets; the pointers of the channels that do not exist are null
+extern ChannelGuiGroup* TableOfGroupsPtr[MAX_NUMBER_OF_CHANNELS];
 extern Fl_Box* LargeErrorMessage;
 extern bool UpdateConfigurableWidgets;
 
@@ -206,13 +219,28 @@ void initializeMainWindowWidgets(void);
 
 void initializeWidgetsOfChannels(void);
 
+// Function called by Fl::awake() to create the groups of widgets of NumberOfChannels channels
+void createChannelWidgets(void* Data);
+
 // The function is used for cyclic refreshing
 void updateChannelWidgets(void* Data);
 
+// The function is used for cyclic refreshing of the widgets that do not belong to any channel
+void updateWindowWidgets(void* Data);
+
+// The handler of the events subscribed by GUI (see PeripheralEventBus); it is called in the peripheral thread
+// and only marks the channels to refresh
+void noteEventsForGui( const EventStruct* EventsPtr, uint16_t NumberOfEvents, void* ContextPtr );
+
+// Function called by Fl::awake() once per refresh period; it refreshes the widgets of the channels marked
+// by noteEventsForGui, and of the channels whose widgets depend on a changed state of GUI
+void refreshChangedChannels(void* Data);
+
 void displayConfigurationFileErrorMessage(void* Data);
 
 void displayTcpConnectionErrorMessage(void* Data);
 
+// Data is the index of the channel
 void displayChannelWidgets(void* Data);
 
 void restoreChannelWidgets(void* Data);
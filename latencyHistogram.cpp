@@ -0,0 +1,103 @@
+// latencyHistogram.cpp
+//
+// Threads: see latencyHistogram.h
+
+#include "latencyHistogram.h"
+
+//.................................................................................................
+// Function definitions
+//.................................................................................................
+
+LatencyHistogram::LatencyHistogram(){
+	clear();
+}
+
+void LatencyHistogram::clear(void){
+	for (uint16_t J = 0; J < LATENCY_HISTOGRAM_BUCKETS; J++){
+		Buckets[J] = 0;
+	}
+	NumberOfSamples = 0;
+	MaxLatency = 0;
+}
+
+void LatencyHistogram::addSample( uint32_t Latency ){
+	if (NumberOfSamples >= LATENCY_HISTOGRAM_AGING_THRESHOLD){
+		NumberOfSamples = 0;
+		for (uint16_t J = 0; J < LATENCY_HISTOGRAM_BUCKETS; J++){
+			Buckets[J] /= 2;
+			NumberOfSamples += Buckets[J];
+		}
+	}
+	Buckets[bucketIndex( Latency )]++;
+	NumberOfSamples++;
+	if (Latency > MaxLatency){
+		MaxLatency = Latency;
+	}
+}
+
+// This function adds the samples of another histogram (it is used to summarize several histograms)
+void LatencyHistogram::merge( const LatencyHistogram& Other ){
+	for (uint16_t J = 0; J < LATENCY_HISTOGRAM_BUCKETS; J++){
+		Buckets[J] += Other.Buckets[J];
+	}
+	NumberOfSamples += Other.NumberOfSamples;
+	if (Other.MaxLatency > MaxLatency){
+		MaxLatency = Other.MaxLatency;
+	}
+}
+
+void LatencyHistogram::getSummary( LatencySummaryStruct* SummaryPtr ){
+	SummaryPtr->count = NumberOfSamples;
+	SummaryPtr->p50 = percentile( 500 );
+	SummaryPtr->p90 = percentile( 900 );
+	SummaryPtr->p99 = percentile( 990 );
+	SummaryPtr->max = MaxLatency;
+}
+
+// The upper bound of the bucket that contains the given part of the samples (it is not greater than the maximum)
+uint32_t LatencyHistogram::percentile( uint16_t PerMille ){
+	uint32_t Rank, Sum;
+	uint16_t J;
+
+	if (0 == NumberOfSamples){
+		return 0;
+	}
+	Rank = (uint32_t)(((uint64_t)NumberOfSamples * PerMille + 999) / 1000);
+	if (0 == Rank){
+		Rank = 1;
+	}
+	Sum = 0;
+	for (J = 0; J < LATENCY_HISTOGRAM_BUCKETS-1; J++){
+		Sum += Buckets[J];
+		if (Sum >= Rank){
+			break;
+		}
+	}
+	uint32_t UpperBound = bucketUpperBound( J );
+	return (UpperBound < MaxLatency)? UpperBound : MaxLatency;
+}
+
+uint16_t LatencyHistogram::bucketIndex( uint32_t Latency ){
+	uint16_t Octave;
+
+	if (Latency > LATENCY_HISTOGRAM_RANGE_US){
+		Latency = LATENCY_HISTOGRAM_RANGE_US;
+	}
+	if (Latency < LATENCY_HISTOGRAM_SUB_BUCKETS){
+		return (uint16_t)Latency;
+	}
+	// Octave 1 covers the latencies from 8 to 15 us, octave 2 from 16 to 31 us and so on
+	Octave = (uint16_t)(31 - __builtin_clz( Latency )) - LATENCY_HISTOGRAM_SUB_BUCKET_BITS + 1;
+	return (uint16_t)(Octave * LATENCY_HISTOGRAM_SUB_BUCKETS +
+			((Latency >> (Octave-1)) - LATENCY_HISTOGRAM_SUB_BUCKETS));
+}
+
+uint32_t LatencyHistogram::bucketUpperBound( uint16_t Index ){
+	uint16_t Octave = Index / LATENCY_HISTOGRAM_SUB_BUCKETS;
+	uint32_t SubBucket = Index % LATENCY_HISTOGRAM_SUB_BUCKETS;
+
+	if (0 == Octave){
+		return SubBucket;
+	}
+	return ((LATENCY_HISTOGRAM_SUB_BUCKETS + SubBucket + 1) << (Octave-1)) - 1;
+}
@@ -0,0 +1,58 @@
+// latencyHistogram.h
+//
+// Threads: the object is used by a single thread (a polling worker); the summaries are copied to other threads
+//
+// This module collects latencies (in microseconds) in a histogram of fixed size with log-linear buckets:
+// the buckets are 1 us wide below 8 us, and every octave above is divided into 8 buckets of equal width,
+// so the relative error of a percentile is below 12.5%. The latencies above LATENCY_HISTOGRAM_RANGE_US
+// are counted in the last bucket. When the number of samples reaches LATENCY_HISTOGRAM_AGING_THRESHOLD, all
+// the buckets are halved, so the percentiles follow the recent behavior of the power supply and its cable.
+
+#ifndef LATENCYHISTOGRAM_H_
+#define LATENCYHISTOGRAM_H_
+
+#include <inttypes.h>
+
+//.................................................................................................
+// Preprocessor directives
+//.................................................................................................
+
+#define LATENCY_HISTOGRAM_SUB_BUCKET_BITS		3
+#define LATENCY_HISTOGRAM_SUB_BUCKETS			(1u << LATENCY_HISTOGRAM_SUB_BUCKET_BITS)
+#define LATENCY_HISTOGRAM_OCTAVES				21		// from 8 us to 2^24 us
+#define LATENCY_HISTOGRAM_BUCKETS				(LATENCY_HISTOGRAM_SUB_BUCKETS * (LATENCY_HISTOGRAM_OCTAVES+1))
+#define LATENCY_HISTOGRAM_RANGE_US				((1ul << (LATENCY_HISTOGRAM_SUB_BUCKET_BITS+LATENCY_HISTOGRAM_OCTAVES)) - 1)
+
+#define LATENCY_HISTOGRAM_AGING_THRESHOLD		65536ul
+
+//.................................................................................................
+// Definitions of types
+//.................................................................................................
+
+// The percentiles of latencies in microseconds; all the fields are 0 if there are no samples
+struct LatencySummaryStruct{
+	uint32_t count;
+	uint32_t p50;
+	uint32_t p90;
+	uint32_t p99;
+	uint32_t max;				// the longest latency since the start of the program
+};
+
+class LatencyHistogram{
+private:
+	uint32_t Buckets[LATENCY_HISTOGRAM_BUCKETS];
+	uint32_t NumberOfSamples;
+	uint32_t MaxLatency;
+
+	static uint16_t bucketIndex( uint32_t Latency );
+	static uint32_t bucketUpperBound( uint16_t Index );
+	uint32_t percentile( uint16_t PerMille );
+public:
+	LatencyHistogram();
+	void clear(void);
+	void addSample( uint32_t Latency );
+	void merge( const LatencyHistogram& Other );
+	void getSummary( LatencySummaryStruct* SummaryPtr );
+};
+
+#endif /* LATENCYHISTOGRAM_H_ */
@@ -0,0 +1,148 @@
+// linkStatistics.h
+//
+// Threads: the object is used by a single thread
+//
+// This module calculates the statistics of transmission errors over a sliding window of the last WindowSize
+// transactions: the number of errors and the longest sequence of consecutive errors.
+// The statistics are updated incrementally, so the cost of a sample does not depend on the size of the window:
+//   - the number of errors is increased when an error enters the window and decreased when it leaves the window,
+//   - the sequences of errors (runs) present in the window are kept in a queue, oldest first; a new error extends
+//     the youngest run or starts a new one, an error leaving the window shortens the oldest run,
+//   - the longest run is taken from a second queue which holds the runs in the order of their age
+//     and with non-increasing lengths (a run that is not longer than a younger one can never be the longest again).
+// Each run enters and leaves the queues once, so the amortized cost of a sample is constant.
+
+#ifndef LINKSTATISTICS_H_
+#define LINKSTATISTICS_H_
+
+#include <inttypes.h>
+
+//.................................................................................................
+// Definitions of types
+//.................................................................................................
+
+template <uint32_t WindowSize>
+class SlidingErrorStatistics{
+private:
+	static_assert( (WindowSize >= 32) && (0 == (WindowSize & (WindowSize-1))), "assert: WindowSize must be a power of 2" );
+
+	static constexpr uint32_t HistoryElementBits = 32;
+	static constexpr uint32_t RunsCapacity = WindowSize/2 + 1;	// the runs are separated by at least one correct sample
+
+	uint32_t History[WindowSize/HistoryElementBits];	// This is a bit field, where '1' = transmission error, '0' = correct response
+	uint32_t SampleCounter;				// the number of the next sample; the history index is SampleCounter % WindowSize
+	uint32_t NumberOfErrors;
+
+	// The runs of errors in the window, oldest first (a circular buffer)
+	uint32_t RunStart[RunsCapacity];	// the number of the first sample of the run
+	uint32_t RunLength[RunsCapacity];
+	uint32_t OldestRun;
+	uint32_t NumberOfRuns;
+
+	// The indexes of the runs which can still be the longest one, oldest first; their lengths are non-increasing
+	uint32_t LongestRunCandidates[RunsCapacity];
+	uint32_t OldestCandidate;
+	uint32_t NumberOfCandidates;
+
+	static uint32_t nextIndex( uint32_t Index, uint32_t Step ){
+		Index += Step;
+		return (Index >= RunsCapacity)? Index - RunsCapacity : Index;
+	}
+
+	uint32_t youngestCandidate(void){
+		return LongestRunCandidates[nextIndex( OldestCandidate, NumberOfCandidates-1 )];
+	}
+
+	// The youngest run became longer; the younger candidates must be shorter than the older ones
+	void pushCandidate( uint32_t Run ){
+		while ((0 != NumberOfCandidates) && (RunLength[youngestCandidate()] <= RunLength[Run])){
+			NumberOfCandidates--;
+		}
+		LongestRunCandidates[nextIndex( OldestCandidate, NumberOfCandidates )] = Run;
+		NumberOfCandidates++;
+	}
+
+	// The oldest sample leaves the window
+	void removeOldestSample( bool WasError ){
+		if ( !WasError ){
+			return;
+		}
+		NumberOfErrors--;
+		RunStart[OldestRun]++;
+		RunLength[OldestRun]--;
+		if ((0 != NumberOfCandidates) && (LongestRunCandidates[OldestCandidate] == OldestRun)){
+			// the oldest run can only become shorter, so it is dropped as soon as a younger candidate is longer
+			if ((0 == RunLength[OldestRun]) || ((NumberOfCandidates > 1) &&
+					(RunLength[OldestRun] < RunLength[LongestRunCandidates[nextIndex( OldestCandidate, 1 )]])))
+			{
+				OldestCandidate = nextIndex( OldestCandidate, 1 );
+				NumberOfCandidates--;
+			}
+		}
+		if (0 == RunLength[OldestRun]){
+			OldestRun = nextIndex( OldestRun, 1 );
+			NumberOfRuns--;
+		}
+	}
+
+public:
+	SlidingErrorStatistics(){
+		reset();
+	}
+
+	void reset(void){
+		for (uint32_t J = 0; J < WindowSize/HistoryElementBits; J++){
+			History[J] = 0;
+		}
+		SampleCounter = 0;
+		NumberOfErrors = 0;
+		OldestRun = 0;
+		NumberOfRuns = 0;
+		OldestCandidate = 0;
+		NumberOfCandidates = 0;
+	}
+
+	void addSample( bool IsError ){
+		uint32_t BitIndex = SampleCounter & (WindowSize-1);
+		uint32_t* ElementPtr = &History[BitIndex/HistoryElementBits];
+		uint32_t Mask = (uint32_t)1 << (BitIndex % HistoryElementBits);
+
+		removeOldestSample( 0 != (*ElementPtr & Mask) );
+
+		if (IsError){
+			*ElementPtr |= Mask;
+			NumberOfErrors++;
+			uint32_t YoungestRun = nextIndex( OldestRun, NumberOfRuns-1 );
+			if ((0 != NumberOfRuns) && (RunStart[YoungestRun] + RunLength[YoungestRun] == SampleCounter)){
+				// the youngest run is extended; it is always the youngest candidate
+				RunLength[YoungestRun]++;
+				NumberOfCandidates--;
+			}
+			else{
+				YoungestRun = nextIndex( OldestRun, NumberOfRuns );
+				RunStart[YoungestRun] = SampleCounter;
+				RunLength[YoungestRun] = 1;
+				NumberOfRuns++;
+			}
+			pushCandidate( YoungestRun );
+		}
+		else{
+			*ElementPtr &= ~Mask;
+		}
+		SampleCounter++;
+	}
+
+	uint32_t getNumberOfErrors(void){
+		return NumberOfErrors;
+	}
+
+	uint32_t getLongestSequence(void){
+		return (0 != NumberOfCandidates)? RunLength[LongestRunCandidates[OldestCandidate]] : 0;
+	}
+
+	static constexpr uint32_t getWindowSize(void){
+		return WindowSize;
+	}
+};
+
+#endif // LINKSTATISTICS_H_
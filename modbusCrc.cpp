@@ -0,0 +1,152 @@
+// modbusCrc.cpp
+//
+// Threads: any (the functions are reentrant)
+//
+// The lookup tables are generated by the compiler. Table k contains the CRC of the byte i followed by k zero bytes,
+// which allows processing 4 or 8 bytes with independent lookups (slicing-by-4, slicing-by-8).
+
+#include "modbusCrc.h"
+
+//.................................................................................................
+// Preprocessor directives
+//.................................................................................................
+
+#define MODBUS_CRC_POLYNOMIAL				0xA001u
+#define MODBUS_CRC_SLICES					8
+
+//.................................................................................................
+// Definitions of types
+//.................................................................................................
+
+struct CrcTables{
+	uint16_t slice[MODBUS_CRC_SLICES][256];
+};
+
+//.................................................................................................
+// Local function prototypes
+//.................................................................................................
+
+static uint16_t crcBitwise( uint16_t Crc, const uint8_t *Buffer, size_t Length );
+
+static uint16_t crcTable( uint16_t Crc, const uint8_t *Buffer, size_t Length );
+
+static uint16_t crcSlicingBy4( uint16_t Crc, const uint8_t *Buffer, size_t Length );
+
+static uint16_t crcSlicingBy8( uint16_t Crc, const uint8_t *Buffer, size_t Length );
+
+//.................................................................................................
+// Local constants
+//.................................................................................................
+
+// This function is evaluated at compile time
+static constexpr CrcTables generateCrcTables(void){
+	CrcTables Result{};
+	uint16_t Crc = 0;
+
+	for (int J = 0; J < 256; J++){
+		Crc = (uint16_t)J;
+		for (int Bit = 0; Bit < 8; Bit++){
+			if ((Crc & 0x0001u) != 0u){
+				Crc = (uint16_t)((Crc >> 1) ^ MODBUS_CRC_POLYNOMIAL);
+			}
+			else{
+				Crc >>= 1;
+			}
+		}
+		Result.slice[0][J] = Crc;
+	}
+	for (int K = 1; K < MODBUS_CRC_SLICES; K++){
+		for (int J = 0; J < 256; J++){
+			Crc = Result.slice[K-1][J];
+			Result.slice[K][J] = (uint16_t)((Crc >> 8) ^ Result.slice[0][Crc & 0xFFu]);
+		}
+	}
+	return Result;
+}
+
+static constexpr CrcTables CrcTable = generateCrcTables();
+
+static_assert( CrcTable.slice[0][1] == 0xC0C1u, "CRC16 table generation error" );
+static_assert( CrcTable.slice[0][255] == 0x4040u, "CRC16 table generation error" );
+
+//.................................................................................................
+// Function definitions
+//.................................................................................................
+
+// This function calculates CRC16 of a given frame; slicing-by-8 is the fastest variant for all the frames
+// of the RTU master (8 ... 40 bytes, see tools/crcBenchmark.cpp)
+uint16_t modbusCrc16( const uint8_t *Buffer, size_t Length ){
+	return crcSlicingBy8( MODBUS_CRC_INITIAL_VALUE, Buffer, Length );
+}
+
+// This function updates the CRC with the next bytes of a frame; the calculation starts with MODBUS_CRC_INITIAL_VALUE
+uint16_t modbusCrcUpdate( uint16_t Crc, const uint8_t *Buffer, size_t Length ){
+	return crcSlicingBy8( Crc, Buffer, Length );
+}
+
+// This function updates the CRC with the use of a chosen variant of the algorithm (it is intended for benchmarks and tests)
+uint16_t modbusCrcUpdateVariant( enum ModbusCrcVariant Variant, uint16_t Crc, const uint8_t *Buffer, size_t Length ){
+	switch(Variant){
+	case MODBUS_CRC_BITWISE:
+		return crcBitwise( Crc, Buffer, Length );
+	case MODBUS_CRC_TABLE:
+		return crcTable( Crc, Buffer, Length );
+	case MODBUS_CRC_SLICING_BY_4:
+		return crcSlicingBy4( Crc, Buffer, Length );
+	case MODBUS_CRC_SLICING_BY_8:
+	default:
+		return crcSlicingBy8( Crc, Buffer, Length );
+	}
+}
+
+static uint16_t crcBitwise( uint16_t Crc, const uint8_t *Buffer, size_t Length ){
+	while (Length-- > 0){
+		Crc ^= (uint16_t)*Buffer++;
+		for (int Bit = 0; Bit < 8; Bit++){
+			if ((Crc & 0x0001u) != 0u){
+				Crc = (uint16_t)((Crc >> 1) ^ MODBUS_CRC_POLYNOMIAL);
+			}
+			else{
+				Crc >>= 1;
+			}
+		}
+	}
+	return Crc;
+}
+
+static uint16_t crcTable( uint16_t Crc, const uint8_t *Buffer, size_t Length ){
+	while (Length-- > 0){
+		Crc = (uint16_t)((Crc >> 8) ^ CrcTable.slice[0][(Crc ^ *Buffer++) & 0xFFu]);
+	}
+	return Crc;
+}
+
+static uint16_t crcSlicingBy4( uint16_t Crc, const uint8_t *Buffer, size_t Length ){
+	while (Length >= 4){
+		Crc = (uint16_t)(
+				CrcTable.slice[3][(Crc ^ Buffer[0]) & 0xFFu] ^
+				CrcTable.slice[2][((Crc >> 8) ^ Buffer[1]) & 0xFFu] ^
+				CrcTable.slice[1][Buffer[2]] ^
+				CrcTable.slice[0][Buffer[3]] );
+		Buffer += 4;
+		Length -= 4;
+	}
+	return crcTable( Crc, Buffer, Length );
+}
+
+static uint16_t crcSlicingBy8( uint16_t Crc, const uint8_t *Buffer, size_t Length ){
+	while (Length >= 8){
+		Crc = (uint16_t)(
+				CrcTable.slice[7][(Crc ^ Buffer[0]) & 0xFFu] ^
+				CrcTable.slice[6][((Crc >> 8) ^ Buffer[1]) & 0xFFu] ^
+				CrcTable.slice[5][Buffer[2]] ^
+				CrcTable.slice[4][Buffer[3]] ^
+				CrcTable.slice[3][Buffer[4]] ^
+				CrcTable.slice[2][Buffer[5]] ^
+				CrcTable.slice[1][Buffer[6]] ^
+				CrcTable.slice[0][Buffer[7]] );
+		Buffer += 8;
+		Length -= 8;
+	}
+	return crcTable( Crc, Buffer, Length );
+}
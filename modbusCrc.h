@@ -0,0 +1,57 @@
+// modbusCrc.h
+//
+// Threads: any (the functions are reentrant)
+//
+// This module calculates CRC16 of Modbus RTU frames (polynomial 0xA001, reflected, initial value 0xFFFF).
+// It is shared by the RTU master (C++) and the freeModbus library (C).
+// The CRC can be calculated for a whole frame or updated incrementally as the bytes of a frame arrive;
+// the CRC calculated over a whole frame including its two CRC bytes equals MODBUS_CRC_VALID_RESIDUE.
+
+#ifndef MODBUS_CRC_H_
+#define MODBUS_CRC_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+//.................................................................................................
+// Preprocessor directives
+//.................................................................................................
+
+#define MODBUS_CRC_INITIAL_VALUE			0xFFFFu
+#define MODBUS_CRC_VALID_RESIDUE			0x0000u
+
+//.................................................................................................
+// Definitions of types
+//.................................................................................................
+
+// The variants of the algorithm; the fastest one is used by modbusCrc16 and modbusCrcUpdate
+enum ModbusCrcVariant{
+	MODBUS_CRC_BITWISE		= 0,	// 8 iterations per byte
+	MODBUS_CRC_TABLE		= 1,	// one table lookup per byte
+	MODBUS_CRC_SLICING_BY_4	= 2,	// four table lookups per 4 bytes
+	MODBUS_CRC_SLICING_BY_8	= 3,	// eight table lookups per 8 bytes
+	MODBUS_CRC_VARIANTS_NUMBER
+};
+
+//.................................................................................................
+// Function prototypes
+//.................................................................................................
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// This function calculates CRC16 of a given frame
+uint16_t modbusCrc16( const uint8_t *Buffer, size_t Length );
+
+// This function updates the CRC with the next bytes of a frame; the calculation starts with MODBUS_CRC_INITIAL_VALUE
+uint16_t modbusCrcUpdate( uint16_t Crc, const uint8_t *Buffer, size_t Length );
+
+// This function updates the CRC with the use of a chosen variant of the algorithm (it is intended for benchmarks and tests)
+uint16_t modbusCrcUpdateVariant( enum ModbusCrcVariant Variant, uint16_t Crc, const uint8_t *Buffer, size_t Length );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MODBUS_CRC_H_ */
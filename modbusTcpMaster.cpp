@@ -12,6 +12,7 @@
 #include <assert.h>
 #include "dataSharingInterface.h"
 #include "modbusTcpSlave.h"
+#include "wireCapture.h"
 
 //.................................................................................................
 // Global variables
@@ -26,10 +27,13 @@ bool IsTcpServerIdentified;
 // Preprocessor directives
 //.................................................................................................
 
-#define READING_TCP_REGISTERS_NUMBER	22
-
 #define MODBUS_TCP_HEADER_SIZE			9
 
+// The sectors of several channels are read with one request (the extended address map, see modbusTcpSlave.h);
+// the response must fit in ResponseBuffer
+#define READING_TCP_SECTORS_NUMBER		4
+#define READING_TCP_REGISTERS_MAX		((sizeof(ResponseBuffer) - MODBUS_TCP_HEADER_SIZE) / 2)
+
 //.................................................................................................
 // Local variables
 //.................................................................................................
@@ -38,15 +42,19 @@ static int TcpSocket;
 
 static uint8_t ResponseBuffer[256];
 
+static_assert( (READING_TCP_SECTORS_NUMBER-1) * TCP_SERVER_EXTENDED_SECTOR_ADDRESS_STEP + MODBUS_TCP_SECTOR_SIZE <= READING_TCP_REGISTERS_MAX,
+		"assert: the sectors read with one request do not fit in ResponseBuffer" );
+
 static char* TextLoadedViaModbusTcp = (char*)&(ResponseBuffer[MODBUS_TCP_HEADER_SIZE]);
 
 static uint8_t ChannelDescriptionTextRunUp;
 
-static uint16_t ChannelDescriptionTextLengths[MAX_NUMBER_OF_SERIAL_PORTS];
+// NumberOfChannels entries; the arrays are allocated when the server is identified
+static uint16_t* ChannelDescriptionTextLengths;
 
 // This array is used in the main FLTK thread
 // It is set only once in the peripheral thread
-static std::string DescriptionTextCopies[MAX_NUMBER_OF_SERIAL_PORTS];
+static std::string* DescriptionTextCopies;
 
 //.................................................................................................
 // Local function prototypes
@@ -67,13 +75,18 @@ static int receiveResponseFrameForWriteRequest( uint16_t RegisterAddress, uint16
 
 static int loadPrimitiveDataFromServer( uint16_t StartAddress, uint8_t NumberOfRegisters );
 
-static int loadSectorFromServer( uint8_t Sector );
+// The sectors are read from the extended address map; the data of sector FirstSector+K starts
+// at register K*TCP_SERVER_EXTENDED_SECTOR_ADDRESS_STEP of the response
+static int loadSectorsFromServer( uint16_t FirstSector, uint8_t NumberOfSectors );
 
 static int sendPrimitiveDataToServer( uint16_t RegisterAddress, uint16_t RegisterNewValue );
 
+// This function sends the new order of the channel (if there is one) to the 'local computer'
+static int sendOrderToServer( uint16_t Channel );
+
 static inline uint8_t getLoadedDataUInt8( uint8_t Offset );
 
-static inline uint8_t getLoadedDataUInt16( uint8_t Offset );
+static inline uint16_t getLoadedDataUInt16( uint16_t Offset );
 
 //.................................................................................................
 // Function definitions
@@ -120,7 +133,7 @@ bool communicateTcpServer(void){
 	}
 	assert( 0 < TcpSocket );
 	//--- Activities related to the zero sector ---
-	Result = loadSectorFromServer( 0 );
+	Result = loadSectorsFromServer( 0, 1 );
 	if (Result != 0){
 		return ReturnValue;
 	}
@@ -141,10 +154,9 @@ bool communicateTcpServer(void){
 #if 0 // debugging
 		printf("Pierwsza identyfikacja serwera TCP [%s]\n", TcpSlaveIdentifier );
 #endif
-		IsTcpServerIdentified = true;
 		assert( 0 == NumberOfChannels );
-		NumberOfChannels = getLoadedDataUInt8( BYTE_OFFSET_LSB_NUMBER_OF_CHANNELS );
-		if ((0 == NumberOfChannels) || (NumberOfChannels > MAX_NUMBER_OF_SERIAL_PORTS) || (0 != getLoadedDataUInt8( BYTE_OFFSET_MSB_NUMBER_OF_CHANNELS ))){
+		uint16_t ReportedNumberOfChannels = getLoadedDataUInt16( BYTE_OFFSET_MSB_NUMBER_OF_CHANNELS );
+		if ((0 == ReportedNumberOfChannels) || (ReportedNumberOfChannels > MAX_NUMBER_OF_CHANNELS)){
 	        close(TcpSocket);
 	    	TcpSocket = -1;
 
@@ -152,10 +164,14 @@ bool communicateTcpServer(void){
 			NewStateOfModbusTcpInterface = true;
 	    	return ReturnValue;
 		}
+		IsTcpServerIdentified = true;
+		ChannelDescriptionTextLengths = new uint16_t[ReportedNumberOfChannels];
+		DescriptionTextCopies = new std::string[ReportedNumberOfChannels];
+		allocateChannelTables( ReportedNumberOfChannels );
 	}
 	else{
 		// Checking NumberOfChannels
-		if ((NumberOfChannels != getLoadedDataUInt8( BYTE_OFFSET_LSB_NUMBER_OF_CHANNELS )) || (0 != getLoadedDataUInt8( BYTE_OFFSET_MSB_NUMBER_OF_CHANNELS ))){
+		if (NumberOfChannels != getLoadedDataUInt16( BYTE_OFFSET_MSB_NUMBER_OF_CHANNELS )){
 	        close(TcpSocket);
 	    	TcpSocket = -1;
 
@@ -184,37 +200,37 @@ bool communicateTcpServer(void){
 	//--- Activities related to the following sectors ---
 	if (0 == ChannelDescriptionTextRunUp){
 		// run-up actions
-		Result = loadPrimitiveDataFromServer( TCP_SERVER_DESCRIPTION_LENGTHS_ADDRESS, MAX_NUMBER_OF_SERIAL_PORTS );
-		if (Result != 0){
-			return ReturnValue;
-		}
-		for(int M = 0; M < MAX_NUMBER_OF_SERIAL_PORTS; M++ ){
-			ChannelDescriptionTextLengths[M] = getLoadedDataUInt16( 2*M );
+		for(int M = 0; M < NumberOfChannels; M += READING_TCP_REGISTERS_MAX ){
+			uint8_t Number = (NumberOfChannels - M < (int)READING_TCP_REGISTERS_MAX)? NumberOfChannels - M : READING_TCP_REGISTERS_MAX;
+			Result = loadPrimitiveDataFromServer( TCP_SERVER_EXTENDED_DESCRIPTION_LENGTHS_ADDRESS + M, Number );
+			if (Result != 0){
+				return ReturnValue;
+			}
+			for(int K = 0; K < Number; K++ ){
+				ChannelDescriptionTextLengths[M+K] = getLoadedDataUInt16( 2*K );
+			}
 		}
 #if 0 // debugging
 		printf("\nText lengths of descriptions ");
-		for(int M = 0; M < MAX_NUMBER_OF_SERIAL_PORTS; M++ ){
+		for(int M = 0; M < NumberOfChannels; M++ ){
 			printf( "%2d ", ChannelDescriptionTextLengths[M] );
 		}
 		printf("\n");
 #endif
-		for(int M = 0; M < MAX_NUMBER_OF_SERIAL_PORTS; M++ ){
+		for(int M = 0; M < NumberOfChannels; M++ ){
 			if (0 != ChannelDescriptionTextLengths[M]){
 				if (CHANNEL_DESCRIPTION_MAX_LENGTH > ChannelDescriptionTextLengths[M]){		// checking that the length of the text is correct
 					Result = loadPrimitiveDataFromServer(
-							TCP_SERVER_DESCRIPTION_LENGTHS_ADDRESS+(M+1)*TCP_SERVER_DESCRIPTION_ADDRESS_STEP,
+							TCP_SERVER_EXTENDED_DESCRIPTION_TEXTS_ADDRESS+M*TCP_SERVER_EXTENDED_DESCRIPTION_ADDRESS_STEP,
 							ChannelDescriptionTextLengths[M]/2 );
 					if (Result != 0){
 						return ReturnValue;
 					}
 					if (0 == TextLoadedViaModbusTcp[ ChannelDescriptionTextLengths[M]-1 ]){ // checking that the text is properly terminated
 
-						pthread_mutex_t MutexLock = PTHREAD_MUTEX_INITIALIZER;
-						pthread_mutex_lock( &MutexLock );
+						// GUI gets the description with the next snapshot of the channel
 						DescriptionTextCopies[M] = TextLoadedViaModbusTcp;
 						TableOfSharedDataForLowLevel[M].setDescription( &DescriptionTextCopies[M] );
-						TableOfSharedDataForGui[M].setDescription( &DescriptionTextCopies[M] );
-						pthread_mutex_unlock( &MutexLock );
 
 						ReturnValue = true;
 #if 0 // debugging
@@ -229,40 +245,22 @@ bool communicateTcpServer(void){
 	else{
 		// run-time actions
 
-		for (uint8_t J = 0; J < NumberOfChannels; J++ ){
-			Result = loadSectorFromServer( J+1 );
+		for (uint16_t FirstChannel = 0; FirstChannel < NumberOfChannels; FirstChannel += READING_TCP_SECTORS_NUMBER ){
+			uint8_t NumberOfSectors = (NumberOfChannels - FirstChannel < READING_TCP_SECTORS_NUMBER)?
+					NumberOfChannels - FirstChannel : READING_TCP_SECTORS_NUMBER;
+			Result = loadSectorsFromServer( FirstChannel+1, NumberOfSectors );
 			if (Result != 0){
 				return ReturnValue;
 			}
-			TableOfSharedDataForLowLevel[J].loadModbusTcpData( &ResponseBuffer[MODBUS_TCP_HEADER_SIZE] );
-
-			if (TableOfSharedDataForLowLevel[J].isNewOrder()){
-				uint16_t TemporaryValue;
-				uint8_t TemporaryOrder = TableOfSharedDataForLowLevel[J].takeOrder( &TemporaryValue );
-#if 0
-				std::cout << " communicateTcpServer; new order= " << (int)TemporaryOrder << std::endl;
-#endif
-				if ((RTU_ORDER_POWER_ON == TemporaryOrder) ||
-						(RTU_ORDER_POWER_OFF == TemporaryOrder) ||
-						(RTU_ORDER_DELAYED_POWER_OFF == TemporaryOrder) ||
-						(RTU_ORDER_CANCEL_DELAYED_POWER_OFF == TemporaryOrder))
-				{
-					Result = sendPrimitiveDataToServer(
-							TCP_SERVER_START_ADDRESS+(J+1)*TCP_SERVER_SECTOR_ADDRESS_STEP+MODBUS_TCP_ADDRESS_ORDER_CODE,
-							TemporaryOrder );
-					if (Result != 0){
-						return ReturnValue;
-					}
-				}
-				if (RTU_ORDER_SET_VALUE == TemporaryOrder){
-	   				// Modbus TCP command to write the set-point value is treated as an order for the lower layer
-	   				// to set the set-point
-					Result = sendPrimitiveDataToServer(
-							TCP_SERVER_START_ADDRESS+(J+1)*TCP_SERVER_SECTOR_ADDRESS_STEP+MODBUS_TCP_ADDRESS_ORDER_VALUE,
-							TemporaryValue );
-					if (Result != 0){
-						return ReturnValue;
-					}
+			// all the sectors are taken from ResponseBuffer before any order is sent
+			for (uint16_t J = FirstChannel; J < FirstChannel + NumberOfSectors; J++ ){
+				TableOfSharedDataForLowLevel[J].loadModbusTcpData(
+						&ResponseBuffer[MODBUS_TCP_HEADER_SIZE + 2*(J-FirstChannel)*TCP_SERVER_EXTENDED_SECTOR_ADDRESS_STEP] );
+			}
+			for (uint16_t J = FirstChannel; J < FirstChannel + NumberOfSectors; J++ ){
+				Result = sendOrderToServer( J );
+				if (Result != 0){
+					return ReturnValue;
 				}
 			}
 		}
@@ -277,6 +275,33 @@ bool communicateTcpServer(void){
 	return ReturnValue;
 }
 
+// The orders are written to the sector of the channel in the extended address map
+static int sendOrderToServer( uint16_t Channel ){
+	int Result = 0;
+
+	if (TableOfSharedDataForLowLevel[Channel].isNewOrder()){
+		uint16_t TemporaryValue;
+		uint8_t TemporaryOrder = TableOfSharedDataForLowLevel[Channel].takeOrder( &TemporaryValue );
+#if 0
+		std::cout << " communicateTcpServer; new order= " << (int)TemporaryOrder << std::endl;
+#endif
+		uint16_t SectorAddress = TCP_SERVER_EXTENDED_START_ADDRESS + (Channel+1)*TCP_SERVER_EXTENDED_SECTOR_ADDRESS_STEP;
+		if ((RTU_ORDER_POWER_ON == TemporaryOrder) ||
+				(RTU_ORDER_POWER_OFF == TemporaryOrder) ||
+				(RTU_ORDER_DELAYED_POWER_OFF == TemporaryOrder) ||
+				(RTU_ORDER_CANCEL_DELAYED_POWER_OFF == TemporaryOrder))
+		{
+			Result = sendPrimitiveDataToServer( SectorAddress+MODBUS_TCP_ADDRESS_ORDER_CODE, TemporaryOrder );
+		}
+		if (RTU_ORDER_SET_VALUE == TemporaryOrder){
+			// Modbus TCP command to write the set-point value is treated as an order for the lower layer
+			// to set the set-point
+			Result = sendPrimitiveDataToServer( SectorAddress+MODBUS_TCP_ADDRESS_ORDER_VALUE, TemporaryValue );
+		}
+	}
+	return Result;
+}
+
 // This function implements timeout
 static bool waitForResponse(int Socket, int TimeoutInSeconds) {
     fd_set ReadFileDescriptors;
@@ -360,6 +385,7 @@ static int sendDataReadRequestFrame( uint16_t StartAddress, uint8_t NumberOfRegi
     	TcpSocket = -1;
         return -1;
     }
+    captureWireFrame( WIRE_CAPTURE_TCP_MASTER_REQUEST, 0, 0xFF, RequestFrame[6], 0, RequestFrame, sizeof(RequestFrame), 0 );
     return 0;
 }
 
@@ -390,6 +416,7 @@ static int sendDataWriteRequestFrame( uint16_t RegisterAddress, uint16_t Registe
     	TcpSocket = -1;
         return -1;
     }
+    captureWireFrame( WIRE_CAPTURE_TCP_MASTER_REQUEST, 0, 0xFF, RequestFrame[6], 0, RequestFrame, sizeof(RequestFrame), 0 );
     return 0;
 }
 
@@ -402,6 +429,8 @@ static int receiveResponseFrameForReadRequest( uint8_t ExpectedNumberOfRegisters
     }
 
     int BytesReceived = recv(TcpSocket, ResponseBuffer, sizeof(ResponseBuffer), 0);
+    captureWireFrame( WIRE_CAPTURE_TCP_MASTER_RESPONSE, 0, 0xFF, ResponseBuffer[6], (BytesReceived < 0)? WIRE_CAPTURE_FLAG_PORT_ERROR : 0,
+    		ResponseBuffer, (BytesReceived > 0)? (uint16_t)BytesReceived : 0, 0 );
     if (BytesReceived <= 0) {
     	ModbusTcpCommunicationState = ModbusTcpClientStateClass::ERROR_RECEIVING_FRAME;
         close(TcpSocket);
@@ -443,6 +472,8 @@ static int receiveResponseFrameForWriteRequest( uint16_t RegisterAddress, uint16
     }
 
     int BytesReceived = recv(TcpSocket, ResponseBuffer, sizeof(ResponseBuffer), 0);
+    captureWireFrame( WIRE_CAPTURE_TCP_MASTER_RESPONSE, 0, 0xFF, ResponseBuffer[6], (BytesReceived < 0)? WIRE_CAPTURE_FLAG_PORT_ERROR : 0,
+    		ResponseBuffer, (BytesReceived > 0)? (uint16_t)BytesReceived : 0, 0 );
     if (BytesReceived <= 0) {
     	ModbusTcpCommunicationState = ModbusTcpClientStateClass::ERROR_RECEIVING_FRAME;
         close(TcpSocket);
@@ -512,33 +543,12 @@ static int loadPrimitiveDataFromServer( uint16_t StartAddress, uint8_t NumberOfR
 	return 0;
 }
 
-static int loadSectorFromServer( uint8_t Sector ){
-	int Result;
-
-	Result = sendDataReadRequestFrame(
-			(uint16_t)Sector * TCP_SERVER_SECTOR_ADDRESS_STEP + TCP_SERVER_START_ADDRESS,
-			READING_TCP_REGISTERS_NUMBER );
-	if (Result < 0){
-		NewStateOfModbusTcpInterface = true;
-		if (TcpSocket != -1){
-	        close(TcpSocket);
-	    	TcpSocket = -1;
-		}
-		return -1;
-	}
-
-	assert( 0 < TcpSocket );
+static int loadSectorsFromServer( uint16_t FirstSector, uint8_t NumberOfSectors ){
+	assert( (0 < NumberOfSectors) && (NumberOfSectors <= READING_TCP_SECTORS_NUMBER) );
 
-	Result = receiveResponseFrameForReadRequest( READING_TCP_REGISTERS_NUMBER );
-	if (Result < 0){
-		NewStateOfModbusTcpInterface = true;
-		if (TcpSocket != -1){
-	        close(TcpSocket);
-	    	TcpSocket = -1;
-		}
-		return -1;
-	}
-	return 0;
+	return loadPrimitiveDataFromServer(
+			TCP_SERVER_EXTENDED_START_ADDRESS + FirstSector * TCP_SERVER_EXTENDED_SECTOR_ADDRESS_STEP,
+			(NumberOfSectors-1) * TCP_SERVER_EXTENDED_SECTOR_ADDRESS_STEP + MODBUS_TCP_SECTOR_SIZE );
 }
 
 static int sendPrimitiveDataToServer( uint16_t RegisterAddress, uint16_t RegisterNewValue ){
@@ -572,6 +582,6 @@ static inline uint8_t getLoadedDataUInt8( uint8_t Offset ){
 	return ResponseBuffer[MODBUS_TCP_HEADER_SIZE + Offset];
 }
 
-static inline uint8_t getLoadedDataUInt16( uint8_t Offset ){
+static inline uint16_t getLoadedDataUInt16( uint16_t Offset ){
 	return (((uint16_t)ResponseBuffer[MODBUS_TCP_HEADER_SIZE + Offset]) << 8) + (uint16_t)ResponseBuffer[MODBUS_TCP_HEADER_SIZE + Offset+1];
 }
@@ -28,6 +28,7 @@
 // The file has been modified by K.O.
 
 #include "modbusTcpSlave.h"
+#include "orderQueue.h"
 
 #include <stdio.h>
 #include <string.h>
@@ -45,13 +46,13 @@
 
 // This is a table of Modbus registers containing the description lengths of each power supply unit.
 // These registers occupy addresses from TCP_SERVER_DESCRIPTION_LENGTHS_ADDRESS
-// These registers are initialized once, at program startup, and remain constant thereafter
+// These registers are initialized once, at program startup, and remain constant thereafter (NumberOfChannels entries)
 // View comments on ChannelDescriptionTextsPtr
-uint16_t ChannelDescriptionLength[MAX_NUMBER_OF_SERIAL_PORTS];
+uint16_t* ChannelDescriptionLength;
 
 // This is a table of pointers to texts that are the description of channels
 // View comments on ChannelDescriptionTextsPtr
-char* ChannelDescriptionTextsPtr[MAX_NUMBER_OF_SERIAL_PORTS];
+char** ChannelDescriptionTextsPtr;
 
 // ChannelDescriptionPlainTextsPtr is a pointer to the allocated memory area used for the description of channels.
 // Example
@@ -103,6 +104,16 @@ static void eSetPollingThreadState( enum ThreadState eNewState );
 // @brief This function is run as an additional thread (K.O. comment)
 static void* pvPollingThread( void *pvParameter );
 
+// This function serves the sectors of one address map (the legacy or the extended one); usAddress is relative
+// to the start of the map; the map holds NumberOfMappedChannels channels
+static eMBErrorCode accessSectors( UCHAR* pucRegBuffer, USHORT usAddress, USHORT usNRegs, eMBRegisterMode eMode,
+		uint16_t SectorStep, uint16_t NumberOfMappedChannels );
+
+// This function serves the descriptions of the channels of one address map (read-only data): the lengths
+// from LengthsAddress (LengthsNumber registers) and the texts from TextsAddress (TextStep registers per channel)
+static eMBErrorCode readDescriptions( UCHAR* pucRegBuffer, USHORT usAddress, USHORT usNRegs, eMBRegisterMode eMode,
+		uint16_t LengthsAddress, uint16_t LengthsNumber, uint16_t TextsAddress, uint16_t TextStep, uint16_t NumberOfMappedChannels );
+
 // ----------------------- Start implementation -----------------------------
 
 // This function initializes TCP socket and starts additional thread for the Modbus TCP slave
@@ -111,14 +122,14 @@ char initializeModbusTcpSlave( void ){
 	pthread_t       xThread;
 	uint16_t		J;
 
-	assert( sizeof(TcpSlaveIdentifier)+2*sizeof(uint16_t) == MODBUS_TCP_SECTOR_SIZE * sizeof(uint16_t) );
+	assert( sizeof(TcpSlaveIdentifier)+2*sizeof(uint16_t) <= MODBUS_TCP_SECTOR_SIZE * sizeof(uint16_t) );
 
 	// The registers:
 	// TableOfSharedDataForTcpServer[0][TCP_SERVER_ADDRESS_IS_REMOTE_CONTROL]
 	// TableOfSharedDataForTcpServer[0][TCP_SERVER_ADDRESS_NUMBER_OF_CHANNELS]
 	// are set in the function configurationFileParsing()
 
-	for (J = TCP_SERVER_ADDRESS_IDENTIFICATION_LABEL; J < MODBUS_TCP_SECTOR_SIZE; J++){
+	for (J = TCP_SERVER_ADDRESS_IDENTIFICATION_LABEL; J < TCP_SERVER_ADDRESS_IDENTIFICATION_LABEL+sizeof(TcpSlaveIdentifier)/2; J++){
 		TableOfSharedDataForTcpServer[0][J] = (TcpSlaveIdentifier[2*(J-TCP_SERVER_ADDRESS_IDENTIFICATION_LABEL)] << 8)
 				+ TcpSlaveIdentifier[2*(J-TCP_SERVER_ADDRESS_IDENTIFICATION_LABEL)+1];
 	}
@@ -186,143 +197,178 @@ static void eSetPollingThreadState( enum ThreadState eNewState )
 eMBErrorCode
 eMBRegHoldingCB( UCHAR * pucRegBuffer, USHORT usAddress, USHORT usNRegs, eMBRegisterMode eMode )
 {
-    int             iRegIndex;
-    int				Sector, Offset;
+    uint16_t		LegacyChannels;
 
     usAddress--;
 
-    if (usAddress < TCP_SERVER_START_ADDRESS){
-    	// usAddress is below the address space range
-    	return MB_ENOREG;
+    // the channels beyond TCP_SERVER_LEGACY_CHANNELS_NUMBER are available in the extended map only
+    LegacyChannels = (NumberOfChannels < TCP_SERVER_LEGACY_CHANNELS_NUMBER)? NumberOfChannels : TCP_SERVER_LEGACY_CHANNELS_NUMBER;
+
+    if (usAddress >= TCP_SERVER_EXTENDED_DESCRIPTION_LENGTHS_ADDRESS){
+    	return readDescriptions( pucRegBuffer, usAddress, usNRegs, eMode,
+    			TCP_SERVER_EXTENDED_DESCRIPTION_LENGTHS_ADDRESS, MAX_NUMBER_OF_CHANNELS,
+				TCP_SERVER_EXTENDED_DESCRIPTION_TEXTS_ADDRESS, TCP_SERVER_EXTENDED_DESCRIPTION_ADDRESS_STEP, NumberOfChannels );
     }
-    if (usAddress < TCP_SERVER_START_ADDRESS
-    		+ TableOfSharedDataForTcpServer[0][TCP_SERVER_ADDRESS_NUMBER_OF_CHANNELS] * TCP_SERVER_SECTOR_ADDRESS_STEP
-			+ MODBUS_TCP_SECTOR_SIZE )
-    {
-    	// usAddress is located in the address space range, which contains (NumberOfChannels+1) sectors
+    if (usAddress >= TCP_SERVER_EXTENDED_START_ADDRESS){
+    	return accessSectors( pucRegBuffer, usAddress - TCP_SERVER_EXTENDED_START_ADDRESS, usNRegs, eMode,
+    			TCP_SERVER_EXTENDED_SECTOR_ADDRESS_STEP, NumberOfChannels );
+    }
+    if (usAddress >= TCP_SERVER_DESCRIPTION_LENGTHS_ADDRESS){
+    	return readDescriptions( pucRegBuffer, usAddress, usNRegs, eMode,
+    			TCP_SERVER_DESCRIPTION_LENGTHS_ADDRESS, TCP_SERVER_LEGACY_CHANNELS_NUMBER,
+				TCP_SERVER_DESCRIPTION_LENGTHS_ADDRESS + TCP_SERVER_DESCRIPTION_ADDRESS_STEP, TCP_SERVER_DESCRIPTION_ADDRESS_STEP, LegacyChannels );
+    }
+    if (usAddress >= TCP_SERVER_START_ADDRESS){
+    	return accessSectors( pucRegBuffer, usAddress - TCP_SERVER_START_ADDRESS, usNRegs, eMode,
+    			TCP_SERVER_SECTOR_ADDRESS_STEP, LegacyChannels );
+    }
+	// usAddress is below the address space range
+    return MB_ENOREG;
+}
+
+static eMBErrorCode accessSectors( UCHAR* pucRegBuffer, USHORT usAddress, USHORT usNRegs, eMBRegisterMode eMode,
+		uint16_t SectorStep, uint16_t NumberOfMappedChannels )
+{
+    int             iRegIndex;
+    int				Sector, Offset, Number, NumberInSector;
+    uint16_t		Value;
+    uint8_t			Order;
+
+    Sector = usAddress / SectorStep;
+    Offset = usAddress - Sector * SectorStep;
 
-        usAddress -= TCP_SERVER_START_ADDRESS;
-        Sector = usAddress / TCP_SERVER_SECTOR_ADDRESS_STEP;
-        Offset = usAddress - Sector * TCP_SERVER_SECTOR_ADDRESS_STEP;
+    if ((Sector > NumberOfMappedChannels) || (Offset >= MODBUS_TCP_SECTOR_SIZE)){
+    	return MB_ENOREG;
+    }
 
-        if (Offset >= MODBUS_TCP_SECTOR_SIZE){
+    if (MB_REG_READ == eMode){
+    	// a request may span several sectors only in the extended map (the sectors of the legacy map are far apart)
+        if ((TCP_SERVER_EXTENDED_SECTOR_ADDRESS_STEP != SectorStep) && (Offset + usNRegs > MODBUS_TCP_SECTOR_SIZE)){
         	return MB_ENOREG;
         }
-        if (usNRegs > Offset + MODBUS_TCP_SECTOR_SIZE){
+        if ((usAddress + usNRegs - 1) / SectorStep > NumberOfMappedChannels){
         	return MB_ENOREG;
         }
+        while (usNRegs > 0){
+        	Number = SectorStep - Offset;
+        	if (Number > usNRegs){
+        		Number = usNRegs;
+        	}
+        	NumberInSector = (Offset + Number <= MODBUS_TCP_SECTOR_SIZE)? Number : MODBUS_TCP_SECTOR_SIZE - Offset;
+        	if (NumberInSector <= 0){
+        		NumberInSector = 0;
+        	}
+        	else if (0 != Sector){
+        		// This Modbus command is a valid request to read the data of a channel;
+        		// the data of all the registers comes from the same tick
+        		readPublishedRegisters( (uint8_t)(Sector-1), (uint8_t)Offset, (uint8_t)NumberInSector, pucRegBuffer );
+        	}
+        	else{
+        		// This Modbus command is a valid request to read data from TableOfSharedDataForTcpServer
+        		for (iRegIndex = 0; iRegIndex < NumberInSector; iRegIndex++){
+        			pucRegBuffer[2*iRegIndex]   = ( UCHAR ) ( TableOfSharedDataForTcpServer[0][Offset+iRegIndex] >> 8 );
+        			pucRegBuffer[2*iRegIndex+1] = ( UCHAR ) ( TableOfSharedDataForTcpServer[0][Offset+iRegIndex] & 0xFF );
+        		}
+        	}
+        	// the registers between the sectors
+        	memset( &pucRegBuffer[2*NumberInSector], 0, 2*(Number - NumberInSector) );
 
-        if (MB_REG_READ == eMode){
-        	// This Modbus command is a valid request to read data from TableOfSharedDataForTcpServer
-
-        	iRegIndex = 0;
-    		while( usNRegs > 0 ){
-    			*pucRegBuffer = ( UCHAR ) ( TableOfSharedDataForTcpServer[Sector][Offset+iRegIndex] >> 8 );
-    			pucRegBuffer++;
-    			*pucRegBuffer = ( UCHAR ) ( TableOfSharedDataForTcpServer[Sector][Offset+iRegIndex] & 0xFF );
-    			pucRegBuffer++;
-    			iRegIndex++;
-    			usNRegs--;
-    		}
-    		return MB_ENOERR;
+        	pucRegBuffer += 2*Number;
+        	usNRegs -= Number;
+        	Sector++;
+        	Offset = 0;
         }
-        if (MB_REG_WRITE == eMode){
+		return MB_ENOERR;
+    }
+    if (MB_REG_WRITE == eMode){
 
 #if 0
-			printf(" eMBRegHoldingCB; sect=%u; offs=%u; N= %u; D=%02X %02X\n", (unsigned)Sector, (unsigned)Offset,
-					(unsigned)usNRegs, (unsigned)pucRegBuffer[0], (unsigned)pucRegBuffer[1] );
+		printf(" eMBRegHoldingCB; sect=%u; offs=%u; N= %u; D=%02X %02X\n", (unsigned)Sector, (unsigned)Offset,
+				(unsigned)usNRegs, (unsigned)pucRegBuffer[0], (unsigned)pucRegBuffer[1] );
 #endif
 
-        	if (1 != usNRegs){
-        		// the only write command supported is the single register write command;
-        		// this should never happen
-                return MB_ENOREG;
-        	}
-        	if (0 == Sector){
-                return MB_ENOREG;
-        	}
-        	if ((MODBUS_TCP_ADDRESS_ORDER_CODE != Offset) && (MODBUS_TCP_ADDRESS_ORDER_VALUE != Offset)){
-        		// There are only two read/write registers for each channel
-                return MB_ENOREG;
-        	}
-        	// This Modbus command is a valid request to write data to TableOfSharedDataForTcpServer
-   			TableOfSharedDataForTcpServer[Sector][Offset] = *pucRegBuffer << 8;
-   			pucRegBuffer++;
-   			TableOfSharedDataForTcpServer[Sector][Offset] |= *pucRegBuffer;
-
-   			if (MODBUS_TCP_ADDRESS_ORDER_VALUE == Offset){
-   				// Modbus TCP command to write the set-point value register is treated as an order for the lower layer
-   				// to set the set-point
-   				TableOfSharedDataForTcpServer[Sector][MODBUS_TCP_ADDRESS_ORDER_CODE] = RTU_ORDER_SET_VALUE;
-   			}
-    		return MB_ENOERR;
-        }
-        return MB_ENOREG;
+    	if (1 != usNRegs){
+    		// the only write command supported is the single register write command;
+    		// this should never happen
+            return MB_ENOREG;
+    	}
+    	if (0 == Sector){
+            return MB_ENOREG;
+    	}
+    	if ((MODBUS_TCP_ADDRESS_ORDER_CODE != Offset) && (MODBUS_TCP_ADDRESS_ORDER_VALUE != Offset)){
+    		// There are only two read/write registers for each channel
+            return MB_ENOREG;
+    	}
+    	// This Modbus command is a valid request to write data to TableOfSharedDataForTcpServer;
+    	// the order is built from the written register, because the registers are read by other threads
+		Value = (uint16_t)((pucRegBuffer[0] << 8) | pucRegBuffer[1]);
+		if (MODBUS_TCP_ADDRESS_ORDER_VALUE == Offset){
+			// Modbus TCP command to write the set-point value register is treated as an order for the lower layer
+			// to set the set-point
+			Order = RTU_ORDER_SET_VALUE;
+		}
+		else{
+			Order = (uint8_t)Value;
+			Value = __atomic_load_n( &TableOfSharedDataForTcpServer[Sector][MODBUS_TCP_ADDRESS_ORDER_VALUE], __ATOMIC_RELAXED );
+		}
+		__atomic_store_n( &TableOfSharedDataForTcpServer[Sector][MODBUS_TCP_ADDRESS_ORDER_CODE], Order, __ATOMIC_RELAXED );
+		__atomic_store_n( &TableOfSharedDataForTcpServer[Sector][MODBUS_TCP_ADDRESS_ORDER_VALUE], Value, __ATOMIC_RELAXED );
+		if (0 == ControlFromGuiHere){
+			// the order is placed in the queue of the channel, so that the orders written within one tick are not lost
+			(void) placeOrderInQueue( (uint8_t)(Sector-1), ORDER_SOURCE_MODBUS_TCP, Order, Value );
+		}
+		return MB_ENOERR;
     }
-    else{
-    	// usAddress is in a range where there can only be data structures related to power supply
-    	// units descriptions;  this is read-only data
+    return MB_ENOREG;
+}
 
-        if (MB_REG_READ != eMode){
-        	return MB_ENOREG;
-        }
-        if (usAddress < TCP_SERVER_DESCRIPTION_LENGTHS_ADDRESS){
+static eMBErrorCode readDescriptions( UCHAR* pucRegBuffer, USHORT usAddress, USHORT usNRegs, eMBRegisterMode eMode,
+		uint16_t LengthsAddress, uint16_t LengthsNumber, uint16_t TextsAddress, uint16_t TextStep, uint16_t NumberOfMappedChannels )
+{
+    int             iRegIndex;
+    int				Channel, Offset;
+    uint16_t		Length;
+
+	// usAddress is in a range where there can only be data structures related to power supply
+	// units descriptions;  this is read-only data
+    if (MB_REG_READ != eMode){
+    	return MB_ENOREG;
+    }
+    if (usAddress < TextsAddress){
+    	if (usAddress + usNRegs > LengthsAddress + LengthsNumber){
         	return MB_ENOREG;
     	}
-    	if (usAddress+usNRegs <= TCP_SERVER_DESCRIPTION_LENGTHS_ADDRESS + MAX_NUMBER_OF_SERIAL_PORTS){
-           	// This Modbus command is a valid request to read data from ChannelDescriptionLength
-            usAddress -= TCP_SERVER_DESCRIPTION_LENGTHS_ADDRESS;
-
-        	iRegIndex = 0;
-    		while( usNRegs > 0 ){
-    			*pucRegBuffer = ( UCHAR ) ( ChannelDescriptionLength[iRegIndex] >> 8 );
-    			pucRegBuffer++;
-    			*pucRegBuffer = ( UCHAR ) ( ChannelDescriptionLength[iRegIndex] & 0xFF );
-    			pucRegBuffer++;
-    			iRegIndex++;
-    			usNRegs--;
-    		}
-
-    		return MB_ENOERR;
-    	}
-    	else{
-    		// usAddress is in a range where there can only be texts of specific lengths
+       	// This Modbus command is a valid request to read data from ChannelDescriptionLength;
+    	// the channels that do not exist have no description
+    	Channel = usAddress - LengthsAddress;
+		for (iRegIndex = 0; iRegIndex < usNRegs; iRegIndex++, Channel++){
+			Length = (Channel < NumberOfMappedChannels)? ChannelDescriptionLength[Channel] : 0;
+			pucRegBuffer[2*iRegIndex]   = ( UCHAR ) ( Length >> 8 );
+			pucRegBuffer[2*iRegIndex+1] = ( UCHAR ) ( Length & 0xFF );
+		}
+		return MB_ENOERR;
+    }
 
-            if (usAddress < TCP_SERVER_DESCRIPTION_LENGTHS_ADDRESS + TCP_SERVER_DESCRIPTION_ADDRESS_STEP){
-            	return MB_ENOREG;
-        	}
-            if (usAddress > TCP_SERVER_DESCRIPTION_LENGTHS_ADDRESS + TCP_SERVER_DESCRIPTION_ADDRESS_STEP * (MAX_NUMBER_OF_SERIAL_PORTS + 1)){
-            	// rough check
-            	return MB_ENOREG;
-        	}
-            usAddress -= TCP_SERVER_DESCRIPTION_LENGTHS_ADDRESS + TCP_SERVER_DESCRIPTION_ADDRESS_STEP;
-            Sector = usAddress / TCP_SERVER_DESCRIPTION_ADDRESS_STEP;
-            Offset = usAddress - Sector * TCP_SERVER_DESCRIPTION_ADDRESS_STEP;
-            if (Sector >= MAX_NUMBER_OF_SERIAL_PORTS){
-            	return MB_ENOREG;
-            }
-            if ( 2*(Offset + usNRegs) > ChannelDescriptionLength[Sector] ){
-            	return MB_ENOREG;
-            }
-            if (NULL == ChannelDescriptionTextsPtr[Sector]){
-            	// assertion; it should never happen
-            	return MB_ENOREG;
-            }
-            // This Modbus command is a valid request to read a text
-        	iRegIndex = 0;
-    		while( usNRegs > 0 ){
-    			*pucRegBuffer = ( UCHAR ) ((ChannelDescriptionTextsPtr[Sector])[2*iRegIndex]  );
-    			pucRegBuffer++;
-    			*pucRegBuffer = ( UCHAR ) ((ChannelDescriptionTextsPtr[Sector])[2*iRegIndex+1]);
-    			pucRegBuffer++;
-    			iRegIndex++;
-    			usNRegs--;
-    		}
-
-    		return MB_ENOERR;
-    	}
+	// usAddress is in a range where there can only be texts of specific lengths
+    usAddress -= TextsAddress;
+    Channel = usAddress / TextStep;
+    Offset = usAddress - Channel * TextStep;
+    if (Channel >= NumberOfMappedChannels){
+    	return MB_ENOREG;
     }
-    return MB_ENOREG;
+    if ( 2*(Offset + usNRegs) > ChannelDescriptionLength[Channel] ){
+    	return MB_ENOREG;
+    }
+    if (NULL == ChannelDescriptionTextsPtr[Channel]){
+    	// assertion; it should never happen
+    	return MB_ENOREG;
+    }
+    // This Modbus command is a valid request to read a text
+	for (iRegIndex = 0; iRegIndex < usNRegs; iRegIndex++){
+		pucRegBuffer[2*iRegIndex]   = ( UCHAR ) ((ChannelDescriptionTextsPtr[Channel])[2*(Offset+iRegIndex)]  );
+		pucRegBuffer[2*iRegIndex+1] = ( UCHAR ) ((ChannelDescriptionTextsPtr[Channel])[2*(Offset+iRegIndex)+1]);
+	}
+	return MB_ENOERR;
 }
 
 // This function closes the open socket
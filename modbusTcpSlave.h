@@ -11,6 +11,14 @@
 
 #define MAX_NUMBER_OF_SERIAL_PORTS				16
 
+// The channels are numbered with uint8_t (in the events, the telemetry archive, the register store ...);
+// several channels may share a serial port (see SERIAL_BUS_MEMBERS_MAX_NUMBER)
+#define MAX_NUMBER_OF_CHANNELS					256
+
+// The objects of the tables of the channels that are written by different threads at the same time
+// (the polling workers) are aligned to the cache lines, so that the threads do not share any line
+#define CACHE_LINE_SIZE							64
+
 #define MODBUS_RTU_REGISTERS_AREA				14
 
 #define MODBUS_TCP_ADDRESS_PERMILLE_ERROR		(MODBUS_RTU_REGISTERS_AREA)
@@ -19,11 +27,17 @@
 #define MODBUS_TCP_ADDRESS_IS_POWER_ON			(MODBUS_RTU_REGISTERS_AREA+3)	// MSB = IsPowerSwitchOn; LSB = IsPsuPhysicalIdCompatibile
 #define MODBUS_TCP_ADDRESS_LAST_FRAME_ERROR		(MODBUS_RTU_REGISTERS_AREA+4)
 #define MODBUS_TCP_ADDRESS_EXPECTED_ID			(MODBUS_RTU_REGISTERS_AREA+5)
-#define MODBUS_TCP_ADDRESS_ORDER_CODE			(MODBUS_RTU_REGISTERS_AREA+6)	// Order code and Order value must be at the end
-#define MODBUS_TCP_ADDRESS_ORDER_VALUE			(MODBUS_RTU_REGISTERS_AREA+7)	// of Modbus TCP area for a given channel
+#define MODBUS_TCP_ADDRESS_ORDER_CODE			(MODBUS_RTU_REGISTERS_AREA+6)	// Order code and Order value are the only registers
+#define MODBUS_TCP_ADDRESS_ORDER_VALUE			(MODBUS_RTU_REGISTERS_AREA+7)	// written by the clients; their addresses must not change
+#define MODBUS_TCP_ADDRESS_ROUND_TRIP_P50		(MODBUS_RTU_REGISTERS_AREA+8)	// The round-trip latency of Modbus RTU transactions
+#define MODBUS_TCP_ADDRESS_ROUND_TRIP_P90		(MODBUS_RTU_REGISTERS_AREA+9)	// (percentiles and maximum) in units of 0.1 ms;
+#define MODBUS_TCP_ADDRESS_ROUND_TRIP_P99		(MODBUS_RTU_REGISTERS_AREA+10)	// 0 means no data
+#define MODBUS_TCP_ADDRESS_ROUND_TRIP_MAX		(MODBUS_RTU_REGISTERS_AREA+11)
+
+#define MODBUS_TCP_SECTOR_SIZE					(MODBUS_RTU_REGISTERS_AREA+12)
 
-#define MODBUS_TCP_SECTOR_SIZE					(MODBUS_RTU_REGISTERS_AREA+8)
-#define MODBUS_TCP_SECTOR_READING_SIZE			MODBUS_TCP_ADDRESS_ORDER_CODE
+// The number of the registers of a sector published by the peripheral thread (all of them except the order registers)
+#define MODBUS_TCP_SECTOR_READING_SIZE			(MODBUS_TCP_SECTOR_SIZE-2)
 
 #define RTU_ORDER_READING_ALL					0		// primitive order
 #define RTU_ORDER_READING_FIRST					1		// primitive order
@@ -58,6 +72,17 @@
 #define TCP_SERVER_DESCRIPTION_LENGTHS_ADDRESS	4000
 #define TCP_SERVER_DESCRIPTION_ADDRESS_STEP		100
 
+// The address map above (the legacy map) holds only the first TCP_SERVER_LEGACY_CHANNELS_NUMBER channels.
+// The extended map holds all the channels: the sectors are packed densely (sector 0 is the same as in the legacy map,
+// sector N+1 belongs to channel N), so that one request can read several channels; the registers between the sectors
+// are read as 0. The remote computer uses the extended map only.
+#define TCP_SERVER_LEGACY_CHANNELS_NUMBER				16
+#define TCP_SERVER_EXTENDED_START_ADDRESS				10000
+#define TCP_SERVER_EXTENDED_SECTOR_ADDRESS_STEP			32
+#define TCP_SERVER_EXTENDED_DESCRIPTION_LENGTHS_ADDRESS	20000	// one register per channel
+#define TCP_SERVER_EXTENDED_DESCRIPTION_TEXTS_ADDRESS	21000	// the text of channel N starts at N * STEP
+#define TCP_SERVER_EXTENDED_DESCRIPTION_ADDRESS_STEP	64
+
 //...............................................................................................
 // Global constants
 //...............................................................................................
@@ -70,8 +95,9 @@ extern const char TcpSlaveIdentifier[40];
 // Global variables
 //...............................................................................................
 
-// Number of serial ports declared in the configuration file
-extern uint8_t NumberOfChannels;
+// Number of power supply units declared in the configuration file (or reported by the 'local computer');
+// the tables of the channels are allocated for this number (see allocateChannelTables)
+extern uint16_t NumberOfChannels;
 
 // This variable is initialized while the configuration file is read
 // IsModbusTcpSlave equals 1: Modbus TCP slave and Modbus RTU master are active
@@ -102,18 +128,18 @@ extern uint8_t ControlFromGuiHere;
 //   - whether the local computer has taken control, or has passed control to a remote PC;
 //   - how many Modbus RTU channels there are;
 //   - Modbus TCP server identification label
-// the remaining sectors contain information about individual power supplies
-extern uint16_t TableOfSharedDataForTcpServer[MAX_NUMBER_OF_SERIAL_PORTS+1][MODBUS_TCP_SECTOR_SIZE];
+// the remaining NumberOfChannels sectors contain information about individual power supplies
+extern uint16_t (*TableOfSharedDataForTcpServer)[MODBUS_TCP_SECTOR_SIZE];
 
 // This is a table of Modbus registers containing the description lengths of each power supply unit.
 // These registers occupy addresses from TCP_SERVER_DESCRIPTION_LENGTHS_ADDRESS
-// These registers are initialized once, at program startup, and remain constant thereafter
+// These registers are initialized once, at program startup, and remain constant thereafter (NumberOfChannels entries)
 // View comments on ChannelDescriptionTextsPtr
-extern uint16_t ChannelDescriptionLength[MAX_NUMBER_OF_SERIAL_PORTS];
+extern uint16_t* ChannelDescriptionLength;
 
 // This is a table of pointers to texts that are the description of channels
 // View comments on ChannelDescriptionTextsPtr
-extern char* ChannelDescriptionTextsPtr[MAX_NUMBER_OF_SERIAL_PORTS];
+extern char** ChannelDescriptionTextsPtr;
 
 // ChannelDescriptionPlainTextsPtr is a pointer to the allocated memory area used for the description of channels.
 // Example
@@ -137,6 +163,7 @@ extern char* ChannelDescriptionTextsPtr[MAX_NUMBER_OF_SERIAL_PORTS];
 // For instance, in order to get description of the 3rd PSU (that is 'Magnes 3'),
 // TCP client should send a request for 5 registers (that is ChannelDescriptionLength[2]/2)
 // from address TCP_SERVER_DESCRIPTION_LENGTHS_ADDRESS + 3 * TCP_SERVER_DESCRIPTION_ADDRESS_STEP
+// (or from TCP_SERVER_EXTENDED_DESCRIPTION_TEXTS_ADDRESS + 2 * TCP_SERVER_EXTENDED_DESCRIPTION_ADDRESS_STEP)
 extern char* ChannelDescriptionPlainTextsPtr;
 
 //.................................................................................................
@@ -153,6 +180,10 @@ char initializeModbusTcpSlave( void );
 // This function closes the open socket
 void closeModbusTcpSlave( void );
 
+// This function copies the registers of a given channel (from Offset) to a buffer in the order of a Modbus frame;
+// the registers come from the last snapshot published by the peripheral thread (see SharedDataSnapshot)
+void readPublishedRegisters( uint8_t Channel, uint8_t Offset, uint8_t Number, uint8_t* BufferPtr );
+
 #ifdef __cplusplus
 }
 #endif
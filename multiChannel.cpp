@@ -18,10 +18,21 @@
 #include <ctype.h>
 #include <math.h>
 #include <thread>
+#include <vector>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
 #include <FL/Fl.H>
 #include "rstlProtocolMaster.h"
 #include "multiChannel.h"
 #include "dataSharingInterface.h"
+#include "registerStore.h"
+#include "channelHistory.h"
+#include "telemetryArchive.h"
+#include "eventBus.h"
+#include "orderQueue.h"
+#include "deviceWatcher.h"
+#include "tickScheduler.h"
 #include "graphicalUserInterface.h"
 #include "modbusTcpMaster.h"
 
@@ -29,15 +40,38 @@
 // Preprocessor directives
 //.................................................................................................
 
-#if TIME_SYNCHRONIZATION_FREQUENCY == 4
-#define TIME_SYNCHRONIZATION_SHIFT		24
-#endif
-#if TIME_SYNCHRONIZATION_FREQUENCY == 8
-#define TIME_SYNCHRONIZATION_SHIFT		23
-#endif
-#if TIME_SYNCHRONIZATION_FREQUENCY == 16
-#define TIME_SYNCHRONIZATION_SHIFT		22
-#endif
+// In verbose mode the statistics of the ticks are displayed with this period and after every overrun
+#define TICK_STATISTICS_REPORT_PERIOD_IN_SECONDS	60
+
+// Maximum number of threads polling the serial ports; if there are fewer serial ports than this,
+// each serial port gets its own worker, otherwise the worker with index W serves serial ports W, W+N, W+2N ...
+#define POLLING_WORKERS_MAX_NUMBER		MAX_NUMBER_OF_SERIAL_PORTS
+
+// The tag of the timer in the epoll set of the overlapped mode (the serial ports are tagged with their indexes)
+#define OVERLAPPED_TIMER_TAG			0xFFFFFFFFu
+
+//...............................................................................................
+// Definitions of types
+//...............................................................................................
+
+// The state of the bus scheduler within a pass (see communicateSerialBus)
+struct BusRoundStruct{
+	bool isMemberActive[SERIAL_BUS_MEMBERS_MAX_NUMBER];
+	uint8_t activeMembers;
+	uint8_t nextReadingMember;
+	uint8_t presentMember;		// overlapped mode: the member whose response is awaited; NumberOfMembers if none
+	bool isFinished;			// overlapped mode: no more transactions on this bus in this pass
+	bool isPortError;			// overlapped mode: the serial port has reported an error during the reception
+};
+
+// A power supply declared in the configuration file; the channels are created when the whole file has been read,
+// so that their tables can be allocated for the number of the power supplies
+struct ChannelDeclarationStruct{
+	uint16_t expectedId;
+	uint8_t indexOfBus;
+	uint8_t slaveAddress;
+	std::string description;
+};
 
 //...............................................................................................
 // Global variables
@@ -46,8 +80,13 @@
 // This variable is used for time synchronization
 uint8_t FractionOfSecond;
 
-// Number of serial ports declared in the configuration file
-uint8_t NumberOfChannels;
+uint8_t TickFrequency = TIME_SYNCHRONIZATION_FREQUENCY;
+
+// This variable is set if there is argument "-o" or "--overlapped" (see communicateAllBusesOverlapped)
+bool IsOverlappedPolling;
+
+// Number of power supply units declared in the configuration file (or reported by the 'local computer')
+uint16_t NumberOfChannels;
 
 #if 0
 uint8_t ExitingCounter;
@@ -56,17 +95,38 @@ uint8_t ExitingCounter;
 bool IsExiting;
 
 //...............................................................................................
-// Local constants
+// Local variables
 //...............................................................................................
 
-static uint8_t FractionOfSecond_Old;
-static struct timespec TimeSpecification;
+// NumberOfChannels objects; they are allocated when the configuration file has been read
+static TransmissionChannel* TableOfTransmissionChannel;
 
-//...............................................................................................
-// Local variables
-//...............................................................................................
+static TickScheduler PeripheralTicks;
+static uint32_t ReportedOverruns;
 
-static TransmissionChannel TableOfTransmissionChannel[MAX_NUMBER_OF_SERIAL_PORTS];
+// Serial ports declared in the configuration file; several channels may share one serial port (RS-485 multi-drop)
+static SerialBus TableOfSerialBuses[MAX_NUMBER_OF_SERIAL_PORTS];
+static uint8_t NumberOfSerialBuses;
+
+// The polling workers are synchronized with the peripheral thread once per tick:
+// the peripheral thread increments PollingTickCounter and waits until PollingWorkersBusy drops to zero,
+// so that synchronizeDataAcrossThreads() always sees one consistent snapshot of all channels
+static pthread_mutex_t PollingMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t PollingTickCondition = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t PollingDoneCondition = PTHREAD_COND_INITIALIZER;
+static uint32_t PollingTickCounter;
+static uint8_t PollingWorkersBusy;
+static uint8_t NumberOfPollingWorkers;
+
+// The end of the time budget for Modbus RTU transactions in the current tick (CLOCK_MONOTONIC)
+static struct timespec PollingTickDeadline;
+
+// It is set for the additional pass at the end of the tick, in which only the pending orders are sent
+static bool PollingOrdersOnly;
+
+// The states of the channels at the last synchronization; the events are posted when they change
+static CommunicationStatesClass ReportedCommunicationStates[MAX_NUMBER_OF_CHANNELS];
+static PoweringDownStatesClass ReportedPoweringDownStates[MAX_NUMBER_OF_CHANNELS];
 
 //.................................................................................................
 // Local function prototypes
@@ -74,6 +134,39 @@ static TransmissionChannel TableOfTransmissionChannel[MAX_NUMBER_OF_SERIAL_PORTS
 
 static bool possibilityOfPsuShuttingdown(uint8_t IndexOfChannel);
 
+// Adding the current sample of each channel to its history (once per tick)
+static void recordHistoryOfAllChannels(void);
+
+// Appending the registers of each channel to the telemetry archive (once per tick; 'local computer' mode)
+static void archiveAllChannels(void);
+
+// Posting the events of a channel whose data has changed since the last synchronization
+static void postEventsOfChannel(uint8_t Channel);
+
+// The handler of the events subscribed in verbose mode: the changes of the states of the channels are displayed
+static void reportEvents( const EventStruct* EventsPtr, uint16_t NumberOfEvents, void* ContextPtr );
+
+// Thread function of a polling worker; the worker serves every NumberOfPollingWorkers-th serial port
+static void pollingWorkerThread(uint8_t WorkerIndex);
+
+// Modbus RTU communication with the power supply units connected to a single serial port (the bus scheduler)
+static void communicateSerialBus(uint8_t IndexOfBus);
+
+// The steps of the bus scheduler, shared by communicateSerialBus and communicateAllBusesOverlapped
+static bool beginBusRound(uint8_t IndexOfBus, BusRoundStruct* RoundPtr);
+static uint8_t chooseNextMember(uint8_t IndexOfBus, BusRoundStruct* RoundPtr);
+static bool noteTransactionResult(BusRoundStruct* RoundPtr, uint8_t MemberIndex, TransactionResultClass Result);
+
+#if RTU_RESPONSE_DRIVEN_TRANSACTIONS
+// Modbus RTU communication with all the serial ports at the same time, in the peripheral thread
+static void communicateAllBusesOverlapped(void);
+
+// This function ends the pass of the bus in the overlapped mode and removes its serial port from the epoll set
+static void finishOverlappedRound(int EpollHandler, BusRoundStruct* RoundPtr, int* RegisteredHandlerPtr, uint8_t* BusesInProgressPtr);
+
+// This function returns true if *Time1Ptr is later than *Time2Ptr
+#endif
+
 //.................................................................................................
 // Global function definitions
 //.................................................................................................
@@ -81,7 +174,8 @@ static bool possibilityOfPsuShuttingdown(uint8_t IndexOfChannel);
 // Peripheral communication thread function
 void peripheralThread(void) {
     struct timespec TimeSpecification0, TimeSpecification1;
-    uint8_t J, TimeDivider, TemporaryControlFromGuiHere;
+    uint16_t J;
+    uint8_t TimeDivider, TemporaryControlFromGuiHere;
 	pthread_mutex_t MutexLock = PTHREAD_MUTEX_INITIALIZER;
 
     TimeDivider = 0;
@@ -106,6 +200,12 @@ void peripheralThread(void) {
 	    	pthread_mutex_lock( &MutexLock );
 	    	ActiveModbusTcpServer = true;
 	    	pthread_mutex_unlock( &MutexLock );
+
+	    	// The serial ports are reopened when their device nodes appear
+	    	(void)initializeDeviceWatcher( TableOfSerialBuses, NumberOfSerialBuses );
+
+	    	// Start the threads that communicate with the power supply units
+	    	startPollingWorkers();
 	    }
 	    else{
 	    	Fl::awake( displayTcpConnectionErrorMessage, nullptr );
@@ -116,15 +216,23 @@ void peripheralThread(void) {
 		initializeTcpClientVariables();
 	}
 
+	(void)PeripheralEventBus.subscribe( EVENT_MASK( EventTypeClass::REGISTERS_CHANGED ), noteEventsForGui, nullptr );
+	if (VerboseMode){
+		(void)PeripheralEventBus.subscribe( EVENT_MASK( EventTypeClass::COMMUNICATION_STATE_CHANGED ) |
+				EVENT_MASK( EventTypeClass::POWERING_DOWN_STATE_CHANGED ) | EVENT_MASK( EventTypeClass::ORDER_ACCEPTED ),
+				reportEvents, nullptr );
+	}
+
 	clock_gettime(CLOCK_REALTIME, &TimeSpecification0);
 
 	// Displays GUI for the channels specified in the configuration file
     for (J = 0; J < NumberOfChannels; J++) {
-    	Fl::awake( displayChannelWidgets, (void*)TableOfGroupsPtr[J] );
+    	Fl::awake( displayChannelWidgets, (void*)(uintptr_t)J );
     }
 
     std::this_thread::sleep_for(std::chrono::milliseconds(100));
 
+    PeripheralTicks.start( TickFrequency );
     while (true) {
 		clock_gettime(CLOCK_REALTIME, &TimeSpecification1);
 		waitForSynchronization();
@@ -137,12 +245,16 @@ void peripheralThread(void) {
 #endif
 
 		synchronizeDataAcrossThreads();
+		recordHistoryOfAllChannels();
+		if (IsModbusTcpSlave){
+			archiveAllChannels();
+		}
 
 		if (IsModbusTcpSlave){
 			// support for the process of shutting down power supply units for multiple channels
 			poweringDownTimingForAll();
 			// Communication with the power supply units
-			communicateAllPowerSources();
+			communicateAllPowerSources( false );
 		}
 		else{
 			if (0 == TimeDivider){
@@ -150,9 +262,11 @@ void peripheralThread(void) {
 				// and communicates with a 'local computer' working as a Modbus TCP slave
 				bool RefreshDescriptions = communicateTcpServer();
 				if (RefreshDescriptions){
+					// the new descriptions are published before GUI displays them
+					synchronizeDataAcrossThreads();
 					Fl::awake( updateMainApplicationLabel, nullptr );
 				    for (J = 0; J < NumberOfChannels; J++) {
-				    	Fl::awake( displayChannelWidgets, (void*)TableOfGroupsPtr[J] );
+				    	Fl::awake( displayChannelWidgets, (void*)(uintptr_t)J );
 				    }
 
 					pthread_mutex_lock( &MutexLock );
@@ -173,32 +287,63 @@ void peripheralThread(void) {
 						Fl::awake( displayTcpConnectionErrorMessageAndHideChannelWidgets, (void*)&ErrorCode );
 
 						// to redraw ConfigurationFileErrorMessage and so on, especially when NumberOfChannels==0
-						Fl::awake(updateChannelWidgets, (void*)TableOfGroupsPtr[0]);
+						Fl::awake( updateWindowWidgets, nullptr );
 					}
 				}
 			}
 		}
 		synchronizeDataAcrossThreads();
 
+		if (IsModbusTcpSlave){
+			// the orders which came during the tick are sent at once (the serial lines are idle now),
+			// instead of waiting for the next tick
+			communicateAllPowerSources( true );
+		}
+
+		// the events of the tick are passed to the subscribers (GUI only marks the changed channels)
+		PeripheralEventBus.deliver();
+
 		if (0 == TimeDivider){
-			// Sending a message to the main FLTK thread (to refresh GUI widgets)
-			for( uint16_t ChannelIndex = 0; ChannelIndex < NumberOfChannels; ChannelIndex++ ){
-				Fl::awake(updateChannelWidgets, (void*)TableOfGroupsPtr[ChannelIndex]);
-			}
+			// Sending a message to the main FLTK thread (to refresh the widgets of the changed channels)
+			Fl::awake( refreshChangedChannels, nullptr );
 		}
 
 		if (0 == TimeDivider){
-			TimeDivider = 2;
+			// the GUI and the Modbus TCP client are refreshed about twice per second, whatever the tick frequency is
+			TimeDivider = (TickFrequency + 1) / 2;
 		}
 		TimeDivider--;
     }
 }
 
-void intializeSharedData(void){
-    for (int J = 0; J < MAX_NUMBER_OF_SERIAL_PORTS; J++) {
+void allocateChannelTables( uint16_t Number ){
+	assert( (0 == NumberOfChannels) && (0 < Number) && (Number <= MAX_NUMBER_OF_CHANNELS) );
+
+	TableOfSharedDataForLowLevel = new DataSharingInterface[Number];
+	TableOfSharedDataForGui = new DataSharingInterface[Number];
+	TableOfPublishedData = new SharedDataSnapshot[Number];
+	TableOfOrderQueues = new OrderQueue[Number];
+	TableOfChannelHistories = new ChannelHistory[Number];
+    for (uint16_t J = 0; J < Number; J++) {
     	TableOfSharedDataForLowLevel[J].initialize();
     	TableOfSharedDataForGui[J].initialize();
+    	TableOfOrderQueues[J].initialize();
+    	TableOfChannelHistories[J].initialize();
     }
+
+    // sector 0 and a sector for each channel
+    TableOfSharedDataForTcpServer = new uint16_t[Number+1][MODBUS_TCP_SECTOR_SIZE];
+    memset( TableOfSharedDataForTcpServer, 0, (Number+1) * sizeof(TableOfSharedDataForTcpServer[0]) );
+    TableOfSharedDataForTcpServer[0][TCP_SERVER_ADDRESS_IS_REMOTE_CONTROL] = 0;
+	TableOfSharedDataForTcpServer[0][TCP_SERVER_ADDRESS_NUMBER_OF_CHANNELS] = Number;
+	for (uint16_t J = 1; J <= Number; J++) {
+		TableOfSharedDataForTcpServer[J][MODBUS_TCP_ADDRESS_ORDER_CODE] = RTU_ORDER_NONE;
+	}
+
+	NumberOfChannels = Number;
+
+	// GUI creates the widgets of the channels before it displays any of them
+	Fl::awake( createChannelWidgets, nullptr );
 }
 
 // This function loads the configuration file and allocates an array of objects of type TransmissionChannel
@@ -273,8 +418,6 @@ uint8_t configurationFileParsing(void) {
     ControlFromGuiHere = IsModbusTcpSlave; // the default value
 	pthread_mutex_unlock( &MutexLock );
 
-    TableOfSharedDataForTcpServer[0][TCP_SERVER_ADDRESS_IS_REMOTE_CONTROL] = 0;
-
     // Looking in the configuration file for information on which port to use for Modbus TCP
     std::regex PatternTcpPortNumber(R"([Nn]umer_portu_[Tt][Cc][Pp]\s*=\s*(\d+)\s*(?:#.*)?)");;
     std::string TcpPortText;
@@ -316,11 +459,18 @@ uint8_t configurationFileParsing(void) {
     // Further parsing depends on what mode the application is running in
     if (MatchesTcpSlave){
 
-        // Looking in the configuration file for information on power supply units and the interfaces they use
-        std::regex PatternWithDecimalId(R"([Ii][Dd]=(\d+)\s+[Pp]ort='([^']*)'\s+[Oo]pis='([^']*)'\s*(?:#.*)?)");;
-        std::regex PatternWithHexId(R"([Ii][Dd]=0x([0-9a-fA-F]+)\s+[Pp]ort='([^']*)'\s+[Oo]pis='([^']*)'\s*(?:#.*)?)");;
-        std::string PhysicalIdText;
+        // Looking in the configuration file for information on power supply units and the interfaces they use;
+        // the Modbus slave address ('adres') is optional; several power supplies with different addresses may share a serial port;
+        // the margin of the silent intervals ('margines', microseconds) is optional too and refers to the serial port
+        std::regex PatternWithDecimalId(R"([Ii][Dd]=(\d+)\s+[Pp]ort='([^']*)'(?:\s+[Aa]dres=(\d+))?(?:\s+[Mm]argines=(\d+))?\s+[Oo]pis='([^']*)'\s*(?:#.*)?)");;
+        std::regex PatternWithHexId(R"([Ii][Dd]=0x([0-9a-fA-F]+)\s+[Pp]ort='([^']*)'(?:\s+[Aa]dres=(\d+))?(?:\s+[Mm]argines=(\d+))?\s+[Oo]pis='([^']*)'\s*(?:#.*)?)");;
+        std::string PhysicalIdText, SlaveAddressText, SilenceMarginText;
+        uint32_t SilenceMarginUs;
         bool MatchesDecimalPattern, MatchesHexPattern;
+        uint8_t SlaveAddress, IndexOfBus;
+        ChannelDeclarationStruct Declaration;
+        std::vector<ChannelDeclarationStruct> Declarations;
+        NumberOfSerialBuses = 0;
         while (std::getline(File, Line)) {
             if (VerboseMode){
             	std::cout << "Linijka " << LineNumber << std::endl;
@@ -338,7 +488,15 @@ uint8_t configurationFileParsing(void) {
     			// matches[0] includes all matching text
                 // matches[1] includes value of 'id'
                 // matches[2] includes value of 'port'
-                // matches[3] includes value of 'opis'
+                // matches[3] includes value of 'adres' (it may be empty)
+                // matches[4] includes value of 'margines' (it may be empty)
+                // matches[5] includes value of 'opis'
+            	if (Declarations.size() >= MAX_NUMBER_OF_CHANNELS){
+                	std::cout << " Za dużo zasilaczy w pliku konfiguracyjnym (maksymalnie " << MAX_NUMBER_OF_CHANNELS << ") " << std::endl;
+                    File.close();
+                	return 0;
+            	}
+
             	PhysicalIdText = Matches[1];
             	TemporaryLongInteger = strtoul( PhysicalIdText.c_str(), &TemporaryEndPtr, MatchesDecimalPattern? 10 : 16 );
             	if (TemporaryLongInteger > 0xFFu){
@@ -346,33 +504,109 @@ uint8_t configurationFileParsing(void) {
                     File.close();
                 	return 0;
             	}
-            	TableOfTransmissionChannel[NumberOfChannels].PowerSupplyExpectedId = TemporaryLongInteger;
+            	Declaration.expectedId = (uint16_t)TemporaryLongInteger;
+
+            	SlaveAddressText = Matches[3];
+            	if (SlaveAddressText.empty()){
+            		SlaveAddress = RTU_DEFAULT_SLAVE_ADDRESS;
+            	}
+            	else{
+                	TemporaryLongInteger = strtoul( SlaveAddressText.c_str(), &TemporaryEndPtr, 10 );
+                	if ((TemporaryLongInteger < RTU_SLAVE_ADDRESS_MIN) || (TemporaryLongInteger > RTU_SLAVE_ADDRESS_MAX)){
+                    	std::cout << " Nieprawidłowy adres Modbus zasilacza (dozwolone " << RTU_SLAVE_ADDRESS_MIN << "..." <<
+                    			RTU_SLAVE_ADDRESS_MAX << ") w linii: " << Line << std::endl;
+                        File.close();
+                    	return 0;
+                	}
+                	SlaveAddress = (uint8_t)TemporaryLongInteger;
+            	}
+
+            	SilenceMarginText = Matches[4];
+            	SilenceMarginUs = SILENCE_MARGIN_AUTOMATIC;
+            	if (!SilenceMarginText.empty()){
+                	TemporaryLongInteger = strtoul( SilenceMarginText.c_str(), &TemporaryEndPtr, 10 );
+                	if (TemporaryLongInteger > SILENCE_MARGIN_MAX_US){
+                    	std::cout << " Nieprawidłowy margines ciszy (dozwolone 0..." << SILENCE_MARGIN_MAX_US << " us) w linii: " << Line << std::endl;
+                        File.close();
+                    	return 0;
+                	}
+                	SilenceMarginUs = (uint32_t)TemporaryLongInteger;
+            	}
 
-                TableOfTransmissionChannel[NumberOfChannels].PortName = Matches[2];
+            	// the power supplies declared with the same port name share the serial port
+            	for (IndexOfBus = 0; IndexOfBus < NumberOfSerialBuses; IndexOfBus++){
+            		if (TableOfSerialBuses[IndexOfBus].PortName == Matches[2]){
+            			break;
+            		}
+            	}
+            	if (IndexOfBus == NumberOfSerialBuses){
+            		if (NumberOfSerialBuses >= MAX_NUMBER_OF_SERIAL_PORTS){
+                    	std::cout << " Za dużo portów szeregowych w pliku konfiguracyjnym (maksymalnie " << MAX_NUMBER_OF_SERIAL_PORTS << ") " << std::endl;
+                        File.close();
+                    	return 0;
+            		}
+            		NumberOfSerialBuses++;
+            		TableOfSerialBuses[IndexOfBus].PortName = Matches[2];
+            	}
+            	SerialBus* BusPtr = &TableOfSerialBuses[IndexOfBus];
+            	if (SILENCE_MARGIN_AUTOMATIC != SilenceMarginUs){
+            		if ((SILENCE_MARGIN_AUTOMATIC != BusPtr->ConfiguredSilenceMarginUs) && (BusPtr->ConfiguredSilenceMarginUs != SilenceMarginUs)){
+                    	std::cout << " Różne marginesy ciszy dla portu " << BusPtr->PortName << " w linii: " << Line << std::endl;
+                        File.close();
+                    	return 0;
+            		}
+            		BusPtr->ConfiguredSilenceMarginUs = SilenceMarginUs;
+            	}
+            	for (uint8_t J = 0; J < BusPtr->NumberOfMembers; J++){
+            		if (Declarations[BusPtr->MemberChannels[J]].slaveAddress == SlaveAddress){
+                    	std::cout << " Powtórzony adres Modbus zasilacza na porcie " << BusPtr->PortName << " w linii: " << Line << std::endl;
+                        File.close();
+                    	return 0;
+            		}
+            	}
+#if !RTU_RESPONSE_DRIVEN_TRANSACTIONS
+            	if (0 != BusPtr->NumberOfMembers){
+                	std::cout << " Kilka zasilaczy na jednym porcie wymaga RTU_RESPONSE_DRIVEN_TRANSACTIONS; linia: " << Line << std::endl;
+                    File.close();
+                	return 0;
+            	}
+#endif
+            	if (BusPtr->NumberOfMembers >= SERIAL_BUS_MEMBERS_MAX_NUMBER){
+                	std::cout << " Za dużo zasilaczy na porcie " << BusPtr->PortName << " (maksymalnie " <<
+                			SERIAL_BUS_MEMBERS_MAX_NUMBER << ") w linii: " << Line << std::endl;
+                    File.close();
+                	return 0;
+            	}
+            	Declaration.indexOfBus = IndexOfBus;
+            	Declaration.slaveAddress = SlaveAddress;
 
-                TableOfTransmissionChannel[NumberOfChannels].Descriptor = Matches[3];
-    			if (TableOfTransmissionChannel[NumberOfChannels].Descriptor.length() > CHANNEL_DESCRIPTION_MAX_LENGTH){ // too many anyway
-    				TableOfTransmissionChannel[NumberOfChannels].Descriptor.resize( CHANNEL_DESCRIPTION_MAX_LENGTH );
+                Declaration.description = Matches[5];
+    			if (Declaration.description.length() > CHANNEL_DESCRIPTION_MAX_LENGTH){ // too many anyway
+    				Declaration.description.resize( CHANNEL_DESCRIPTION_MAX_LENGTH );
     			}
 
-    			if ((TableOfTransmissionChannel[NumberOfChannels].PowerSupplyExpectedId > 0) &&
-    					(TableOfTransmissionChannel[NumberOfChannels].PowerSupplyExpectedId < 256))
+    			if ((Declaration.expectedId > 0) && (Declaration.expectedId < 256))
     			{
-    	            TableOfSharedDataForLowLevel[NumberOfChannels].setNameOfPortPtr( &TableOfTransmissionChannel[NumberOfChannels].PortName );
-    				TableOfSharedDataForLowLevel[NumberOfChannels].setDescription( &TableOfTransmissionChannel[NumberOfChannels].Descriptor );
-    				TableOfSharedDataForLowLevel[NumberOfChannels].setPowerSupplyUnitId( TableOfTransmissionChannel[NumberOfChannels].PowerSupplyExpectedId );
+    				BusPtr->MemberChannels[BusPtr->NumberOfMembers] = (uint8_t)Declarations.size();
+    				BusPtr->NumberOfMembers++;
 
     	            if (VerboseMode){
     	                char TemporaryHexadecimalText[12];
-    	                snprintf( TemporaryHexadecimalText, sizeof(TemporaryHexadecimalText)-1, " = 0x%02X",
-    	                		TableOfTransmissionChannel[NumberOfChannels].PowerSupplyExpectedId );
-    					std::cout << " Id: "   << TableOfTransmissionChannel[NumberOfChannels].PowerSupplyExpectedId << TemporaryHexadecimalText << std::endl;
-    					std::cout << " Port: " << TableOfTransmissionChannel[NumberOfChannels].PortName << std::endl;
-    					std::cout << " Opis: " << TableOfTransmissionChannel[NumberOfChannels].Descriptor << std::endl;
+    	                snprintf( TemporaryHexadecimalText, sizeof(TemporaryHexadecimalText)-1, " = 0x%02X", Declaration.expectedId );
+    					std::cout << " Id: "   << Declaration.expectedId << TemporaryHexadecimalText << std::endl;
+    					std::cout << " Port: " << BusPtr->PortName << std::endl;
+    					std::cout << " Adres: " << (int)SlaveAddress << std::endl;
+    					if (SILENCE_MARGIN_AUTOMATIC != SilenceMarginUs){
+    						std::cout << " Margines ciszy: " << SilenceMarginUs << " us" << std::endl;
+    					}
+    					std::cout << " Opis: " << Declaration.description << std::endl;
     	            }
-    				NumberOfChannels++;
+    	            Declarations.push_back( Declaration );
     			}
     			else{
+    				if (0 == BusPtr->NumberOfMembers){
+    					NumberOfSerialBuses--;	// the serial port has been added for this line only
+    				}
     				std::cout << " Nieprawidłowy numer ID zasilacza w linii: " << Line << std::endl;
     			}
             }
@@ -384,25 +618,37 @@ uint8_t configurationFileParsing(void) {
             LineNumber++;
         }
 
-    	TableOfSharedDataForTcpServer[0][TCP_SERVER_ADDRESS_NUMBER_OF_CHANNELS] = NumberOfChannels;
-
         // Summary of the configuration file parsing
         if (VerboseMode){
-        	std::cout << "Liczba zapamiętanych pozycji: " << (int)NumberOfChannels << std::endl;
+        	std::cout << "Liczba zapamiętanych pozycji: " << Declarations.size() << std::endl;
+        	std::cout << "Liczba portów szeregowych: " << (int)NumberOfSerialBuses << std::endl;
         }
-        if (0 == NumberOfChannels){
+        if (Declarations.empty()){
         	std::cout << " Brak prawidłowych danych w pliku konfiguracyjnym (opis portu szeregowego) " << std::endl;
             File.close();
         	return 0;
         }
 
-        for (uint8_t J=0; J < MAX_NUMBER_OF_SERIAL_PORTS; J++ ){
-        	ChannelDescriptionLength[J] = 0;
-        	ChannelDescriptionTextsPtr[J] = nullptr;
+        TableOfTransmissionChannel = new TransmissionChannel[Declarations.size()];
+        allocateChannelTables( (uint16_t)Declarations.size() );
+        for (uint16_t J = 0; J < NumberOfChannels; J++){
+        	const ChannelDeclarationStruct* DeclarationPtr = &Declarations[J];
+        	SerialBus* BusPtr = &TableOfSerialBuses[DeclarationPtr->indexOfBus];
+
+        	TableOfTransmissionChannel[J].PowerSupplyExpectedId = DeclarationPtr->expectedId;
+        	TableOfTransmissionChannel[J].assignSerialBus( BusPtr, DeclarationPtr->slaveAddress );
+        	TableOfTransmissionChannel[J].Descriptor = DeclarationPtr->description;
+
+            TableOfSharedDataForLowLevel[J].setNameOfPortPtr( BusPtr->getPortNamePtr() );
+			TableOfSharedDataForLowLevel[J].setDescription( &TableOfTransmissionChannel[J].Descriptor );
+			TableOfSharedDataForLowLevel[J].setPowerSupplyUnitId( TableOfTransmissionChannel[J].PowerSupplyExpectedId );
         }
 
+        ChannelDescriptionLength = new uint16_t[NumberOfChannels];
+        ChannelDescriptionTextsPtr = new char*[NumberOfChannels];
+
         uint16_t SumOfLengths = 0;
-        for (uint8_t J=0; J < MAX_NUMBER_OF_SERIAL_PORTS; J++ ){
+        for (uint16_t J=0; J < NumberOfChannels; J++ ){
         	ChannelDescriptionLength[J] = (uint16_t)TableOfTransmissionChannel[J].Descriptor.length();
         	if (ChannelDescriptionLength[J] != 0){
         		ChannelDescriptionLength[J]++;	// space for null (termination mark)
@@ -416,7 +662,7 @@ uint8_t configurationFileParsing(void) {
         memset( ChannelDescriptionPlainTextsPtr, 0, SumOfLengths );
 
         uint16_t N = 0;
-        for (uint8_t J=0; J < MAX_NUMBER_OF_SERIAL_PORTS; J++ ){
+        for (uint16_t J=0; J < NumberOfChannels; J++ ){
         	if (ChannelDescriptionLength[J] != 0){
             	ChannelDescriptionTextsPtr[J] = &ChannelDescriptionPlainTextsPtr[N];
             	N += ChannelDescriptionLength[J];
@@ -482,21 +728,70 @@ uint8_t configurationFileParsing(void) {
 	return 1;
 }
 
+// This function starts the polling workers; it is called once, after the configuration file has been parsed
+void startPollingWorkers(void){
+	uint8_t J;
+
+	assert( 0 == NumberOfPollingWorkers );
+
+#if RTU_RESPONSE_DRIVEN_TRANSACTIONS
+	if (IsOverlappedPolling){
+		if (VerboseMode){
+			std::cout << " Komunikacja z zasilaczami w wątku peryferyjnym (transakcje nakładane na wszystkich portach)" << std::endl;
+		}
+		return;
+	}
+#endif
+	NumberOfPollingWorkers = (NumberOfSerialBuses < POLLING_WORKERS_MAX_NUMBER)? NumberOfSerialBuses : POLLING_WORKERS_MAX_NUMBER;
+	for (J = 0; J < NumberOfPollingWorkers; J++){
+		std::thread(pollingWorkerThread, J).detach();
+	}
+	if (VerboseMode){
+		std::cout << " Liczba wątków komunikacji z zasilaczami: " << (int)NumberOfPollingWorkers << std::endl;
+	}
+}
+
 // This function is designed to be called several times per second to read information
 // about the status of the power supply unit and write a possible write command;
-// the function works as a Modbus RTU master
-void communicateAllPowerSources( void ){
-	uint8_t CurrentChannel;
-	for( CurrentChannel=0; CurrentChannel<NumberOfChannels; CurrentChannel++ ){
-		if(TableOfTransmissionChannel[CurrentChannel].isOpen()){
-			TableOfTransmissionChannel[CurrentChannel].singleInquiryOfSlave( CurrentChannel );
-		}
-		else{
-			if(0 == FractionOfSecond){
-				TableOfTransmissionChannel[CurrentChannel].open( CurrentChannel );
-			}
+// the function works as a Modbus RTU master.
+// The serial ports are served in parallel by the polling workers (or by this function itself in the overlapped mode);
+// the function returns when all the serial ports have finished their work for the current tick.
+// If OrdersOnly is true, only the orders waiting in the priority lanes are sent (no readings)
+void communicateAllPowerSources( bool OrdersOnly ){
+	uint8_t CurrentBus;
+	uint64_t Nanoseconds;
+
+	PollingOrdersOnly = OrdersOnly;
+	processDeviceEvents();
+	clock_gettime(CLOCK_MONOTONIC, &PollingTickDeadline);
+	Nanoseconds = (uint64_t)PollingTickDeadline.tv_nsec + (1000000000ull / TickFrequency) *
+			(OrdersOnly? RTU_ORDERS_PASS_TIME_BUDGET_PERCENT : RTU_TRANSACTIONS_TIME_BUDGET_PERCENT) / 100;
+	PollingTickDeadline.tv_sec += (time_t)(Nanoseconds / 1000000000ull);
+	PollingTickDeadline.tv_nsec = (long)(Nanoseconds % 1000000000ull);
+
+#if RTU_RESPONSE_DRIVEN_TRANSACTIONS
+	if (IsOverlappedPolling){
+		communicateAllBusesOverlapped();
+		return;
+	}
+#endif
+
+	if (0 == NumberOfPollingWorkers){
+		// the workers have not been started; the serial ports are served one after another
+		for( CurrentBus=0; CurrentBus<NumberOfSerialBuses; CurrentBus++ ){
+			communicateSerialBus( CurrentBus );
 		}
+		return;
+	}
+
+	pthread_mutex_lock( &PollingMutex );
+	PollingWorkersBusy = NumberOfPollingWorkers;
+	PollingTickCounter++;
+	pthread_cond_broadcast( &PollingTickCondition );
+	while (0 != PollingWorkersBusy){
+		pthread_cond_wait( &PollingDoneCondition, &PollingMutex );
 	}
+	pthread_mutex_unlock( &PollingMutex );
 }
 
 // This function supports the process of shutting down power supply units for multiple channels simultaneously.
@@ -506,13 +801,14 @@ void communicateAllPowerSources( void ){
 // If the user decides to turn off, or the current drops to a low enough value while waiting for the user's
 // response, then it turns off the power switch.
 void poweringDownTimingForAll( void ){
-	uint8_t CurrentChannel;
+	uint16_t CurrentChannel;
 	for( CurrentChannel=0; CurrentChannel<NumberOfChannels; CurrentChannel++ ){
 		PoweringDownStatesClass TemporaryPoweringDownState;
 		PoweringDownActionsClass NewPoweringDownAction = TableOfTransmissionChannel[CurrentChannel].drivePoweringDownStateMachine(
 				&TemporaryPoweringDownState,
 				possibilityOfPsuShuttingdown(CurrentChannel),
-				TableOfSharedDataForLowLevel[CurrentChannel].previewOrder() );
+				TableOfSharedDataForLowLevel[CurrentChannel].previewOrder(),
+				RegisterStoreForLowLevel.getRegister( MODBUS_ADDRES_CURRENT_FILTERED, CurrentChannel ) );
 		if (PoweringDownActionsClass::NO_ACTION != NewPoweringDownAction){
 
 #if DEBUG_POWERING_DOWN_STATE_MACHINE
@@ -535,6 +831,15 @@ void poweringDownTimingForAll( void ){
 		if (PoweringDownActionsClass::NEW_STATE_PLACE_POWER_OFF == NewPoweringDownAction){
 			TableOfSharedDataForLowLevel[CurrentChannel].placeNewOrder( RTU_ORDER_POWER_OFF, 0 );
 		}
+		uint8_t RemainingOrder = TableOfSharedDataForLowLevel[CurrentChannel].previewOrder();
+		if (((RTU_ORDER_DELAYED_POWER_OFF == RemainingOrder) || (RTU_ORDER_CANCEL_DELAYED_POWER_OFF == RemainingOrder)) &&
+				TableOfOrderQueues[CurrentChannel].isOrderWaiting())
+		{
+			// the virtual order has not been used by the state machine and there is a newer order in the queue
+			uint16_t TemporaryUint16;
+			(void) TableOfSharedDataForLowLevel[CurrentChannel].takeOrder( &TemporaryUint16 );
+			TableOfOrderQueues[CurrentChannel].noteCoalescedOrder();
+		}
 	}
 }
 
@@ -542,8 +847,8 @@ bool possibilityOfPsuShuttingdown(uint8_t IndexOfChannel){
 
 #if DEBUG_POWERING_DOWN_STATE_MACHINE
 	printf( "possibilityOfPsuShuttingdown( I=%06.2f; status=%04X ) ",
-			0.01*(double)TableOfSharedDataForLowLevel[IndexOfChannel].getModbusRegister(MODBUS_ADDRES_CURRENT_FILTERED),
-			TableOfSharedDataForLowLevel[IndexOfChannel].getModbusRegister(MODBUS_ADDRES_SLAVE_STATUS) );
+			(double)RegisterStoreForLowLevel.getQuantity( QUANTITY_CURRENT_FILTERED, IndexOfChannel ),
+			RegisterStoreForLowLevel.getRegister( MODBUS_ADDRES_SLAVE_STATUS, IndexOfChannel ) );
 #endif
 
 	if((CommunicationStatesClass::HEALTHY != TableOfSharedDataForLowLevel[IndexOfChannel].getStateOfCommunication()) &&
@@ -562,64 +867,493 @@ bool possibilityOfPsuShuttingdown(uint8_t IndexOfChannel){
 	return true;
 }
 
-// This function implements something like time ticks; see definition of TIME_SYNCHRONIZATION_FREQUENCY
+// This function implements the time ticks (see tickScheduler.h)
 void waitForSynchronization(void){
-	do{
-		// 3ms; delay so as not to overload the processor core;  1/3ms = 333Hz
-		usleep(3000);
-		clock_gettime(CLOCK_REALTIME, &TimeSpecification);
-		FractionOfSecond = (uint8_t)(TimeSpecification.tv_nsec >> TIME_SYNCHRONIZATION_SHIFT);
-		FractionOfSecond = (FractionOfSecond+1) / 15;
-		if(FractionOfSecond >= TIME_SYNCHRONIZATION_FREQUENCY){
-			FractionOfSecond = 0;
-		}
-	}while(FractionOfSecond == FractionOfSecond_Old);
-	FractionOfSecond_Old = FractionOfSecond;
+	TickStatisticsStruct Statistics;
+
+	FractionOfSecond = PeripheralTicks.waitForNextTick();
+
+	if (VerboseMode){
+		PeripheralTicks.getStatistics( &Statistics );
+		if ((Statistics.overruns != ReportedOverruns) ||
+				(0 == Statistics.ticks % ((uint64_t)TICK_STATISTICS_REPORT_PERIOD_IN_SECONDS * TickFrequency)))
+		{
+			ReportedOverruns = Statistics.overruns;
+			printf( "Takt %u Hz: %" PRIu64 " taktów, przekroczenia %u (pominięte takty %" PRIu64 "), "
+					"opóźnienie wybudzenia p50 %u us, p99 %u us, maks. %u us\n",
+					Statistics.frequency, Statistics.ticks, Statistics.overruns, Statistics.skippedTicks,
+					Statistics.lateness.p50, Statistics.lateness.p99, Statistics.lateness.max );
+		}
+	}
+}
+
+// This function returns the time of CLOCK_MONOTONIC in microseconds (used to measure latencies)
+uint64_t getMonotonicMicroseconds(void){
+	struct timespec Now;
+	clock_gettime(CLOCK_MONOTONIC, &Now);
+	return (uint64_t)Now.tv_sec * 1000000ull + (uint64_t)Now.tv_nsec / 1000ull;
 }
 
 // This function synchronizes data between:
 // TableOfSharedDataForLowLevel
-// TableOfSharedDataForGui
-// TableOfSharedDataForTcpServer
+// RegisterStoreForLowLevel, PublishedRegisterStore (read by the main FLTK thread and the Modbus TCP slave thread)
+// TableOfPublishedData (read by the main FLTK thread)
+// TableOfSharedDataForTcpServer (the registers of the orders)
 void synchronizeDataAcrossThreads(void){
+	bool IsRegisterStoreChanged = false;
+
     for ( int J = 0; J < NumberOfChannels; J++) {
-    	// Data synchronization between TableOfSharedDataForLowLevel and TableOfSharedDataForGui
-    	pthread_mutex_t MutexLock = PTHREAD_MUTEX_INITIALIZER;
-    	pthread_mutex_lock( &MutexLock );
-    	if (0 != ControlFromGuiHere){
-    		// Checking if there is a new order from the user to the power supply unit
-    		if (TableOfSharedDataForGui[J].isNewOrder()){
-    			uint16_t TemporaryValue;
-    			uint8_t TemporaryOrder = TableOfSharedDataForGui[J].takeOrder( &TemporaryValue );
-    			TableOfSharedDataForLowLevel[J].placeNewOrder( TemporaryOrder, TemporaryValue );
+    	// Taking the next order of the user (GUI or Modbus TCP) to the power supply unit;
+    	// the order waits in the queue until the lower layer has taken the previous one
+    	if (RTU_ORDER_NONE == TableOfSharedDataForLowLevel[J].previewOrder()){
+    		uint8_t TemporaryOrder;
+    		uint16_t TemporaryValue;
+    		uint64_t TemporaryPlacementTime;
+    		if (TableOfOrderQueues[J].takeOrder( &TemporaryOrder, &TemporaryValue, &TemporaryPlacementTime )){
+    			// the time of placing the order is kept, so that the order-to-wire latency includes the waiting for the tick
+    			TableOfSharedDataForLowLevel[J].placeNewOrder( TemporaryOrder, TemporaryValue, TemporaryPlacementTime );
+    			PeripheralEventBus.post( EventTypeClass::ORDER_ACCEPTED, (uint8_t)J, TemporaryOrder, TemporaryValue );
     		}
     	}
-    	// copying data to GUI
-    	memcpy( &(TableOfSharedDataForGui[J]), &(TableOfSharedDataForLowLevel[J]), sizeof(DataSharingInterface) );
-    	TableOfSharedDataForGui[J].resetOrderCode(); // because memcpy overwrote TableOfSharedDataForGui[J].OrderCode with a wrong value
-    	pthread_mutex_unlock( &MutexLock );
-
+    	TableOfSharedDataForLowLevel[J].loadOrderQueueCounters(
+    			TableOfOrderQueues[J].getDroppedOrders(), TableOfOrderQueues[J].getCoalescedOrders() );
     	if (0 != IsModbusTcpSlave){
-    		// the TCP server is active
-        	// Data synchronization between TableOfSharedDataForLowLevel and TableOfSharedDataForTcpServer
-        	pthread_mutex_lock( &MutexLock );
-        	if (0 == ControlFromGuiHere){
-        		// Remote control via Modbus TCP is active.
-        		// Checking if there is a new order from the remote computer
-        		if (RTU_ORDER_NONE != (uint8_t)(TableOfSharedDataForTcpServer[J+1][MODBUS_TCP_ADDRESS_ORDER_CODE])){
-        			TableOfSharedDataForLowLevel[J].placeNewOrder(
-        					(uint8_t)(TableOfSharedDataForTcpServer[J+1][MODBUS_TCP_ADDRESS_ORDER_CODE]),
-							TableOfSharedDataForTcpServer[J+1][MODBUS_TCP_ADDRESS_ORDER_VALUE] );
-        		}
-        	}
-        	// copying data to the remote computer
-        	TableOfSharedDataForLowLevel[J].exportModbusRegisters( &TableOfSharedDataForTcpServer[J+1][0] );
-    		TableOfSharedDataForTcpServer[J+1][MODBUS_TCP_ADDRESS_ORDER_CODE] = RTU_ORDER_NONE;
-    		TableOfSharedDataForTcpServer[J+1][MODBUS_TCP_ADDRESS_ORDER_VALUE] = 0;
-        	pthread_mutex_unlock( &MutexLock );
+    		// the polling workers are idle during the synchronization, so their histograms can be read
+    		TableOfTransmissionChannel[J].exportRoundTripStatistics( J );
+    	}
+    	if (TableOfPublishedData[J].isOutOfDate( &TableOfSharedDataForLowLevel[J] )){
+    		RegisterStoreForLowLevel.loadChannel( J, TableOfSharedDataForLowLevel[J].getModbusRegisters() );
+    		IsRegisterStoreChanged = true;
+    		postEventsOfChannel( (uint8_t)J );
     	}
     }
+    if (IsRegisterStoreChanged){
+    	// the store is published before the snapshots of the channels (see refreshSharedDataForGui)
+    	RegisterStoreForLowLevel.convertToPhysicalUnits( NumberOfChannels );
+    	PublishedRegisterStore.publish( &RegisterStoreForLowLevel );
+    }
+
+    // the orders of the remote computer are placed in the queues by the Modbus TCP slave thread itself,
+    // so the registers of the order are not touched here (they hold the last order written)
+    for ( int J = 0; J < NumberOfChannels; J++) {
+    	// publishing the data for GUI
+    	TableOfPublishedData[J].publish( &TableOfSharedDataForLowLevel[J] );
+    }
 }
 
-//...............................................................................................
+// The channels without valid data (no communication) have gaps in their histories
+static void recordHistoryOfAllChannels(void){
+	uint64_t Now = getMonotonicMicroseconds();
+
+	for (uint16_t J = 0; J < NumberOfChannels; J++){
+		CommunicationStatesClass State = TableOfSharedDataForLowLevel[J].getStateOfCommunication();
+		if ((CommunicationStatesClass::HEALTHY == State) || (CommunicationStatesClass::TEMPORARY_ERRORS == State)){
+			TableOfChannelHistories[J].addSample( Now,
+					RegisterStoreForLowLevel.getQuantity( QUANTITY_CURRENT_FILTERED, J ),
+					RegisterStoreForLowLevel.getQuantity( QUANTITY_VOLTAGE_FILTERED, J ),
+					RegisterStoreForLowLevel.getQuantity( QUANTITY_SETPOINT, J ),
+					RegisterStoreForLowLevel.getRegister( MODBUS_ADDRES_SLAVE_STATUS, J ) );
+		}
+	}
+}
+
+// The synchronization has collected the results of all the readings of the previous tick (loadRstlProtocolData),
+// so each channel is archived once per reading; the channels without communication are archived too (with their state)
+static void archiveAllChannels(void){
+	uint64_t Now = getMonotonicMicroseconds();
+
+	for (uint16_t J = 0; J < NumberOfChannels; J++){
+		appendTelemetryRecord( J, TableOfSharedDataForLowLevel[J].getModbusRegisters(), Now );
+	}
+}
+
+// The states are changed only together with the generation of the data, so only the changed channels are compared
+static void postEventsOfChannel(uint8_t Channel){
+	DataSharingInterface* InterfacePtr = &TableOfSharedDataForLowLevel[Channel];
+
+	PeripheralEventBus.post( EventTypeClass::REGISTERS_CHANGED, Channel, 0, InterfacePtr->getGeneration() );
+
+	CommunicationStatesClass CommunicationState = InterfacePtr->getStateOfCommunication();
+	if (CommunicationState != ReportedCommunicationStates[Channel]){
+		PeripheralEventBus.post( EventTypeClass::COMMUNICATION_STATE_CHANGED, Channel,
+				(uint16_t)CommunicationState, (uint32_t)ReportedCommunicationStates[Channel] );
+		ReportedCommunicationStates[Channel] = CommunicationState;
+	}
+	PoweringDownStatesClass PoweringDownState = InterfacePtr->getPoweringDownState();
+	if (PoweringDownState != ReportedPoweringDownStates[Channel]){
+		PeripheralEventBus.post( EventTypeClass::POWERING_DOWN_STATE_CHANGED, Channel,
+				(uint16_t)PoweringDownState, (uint32_t)ReportedPoweringDownStates[Channel] );
+		ReportedPoweringDownStates[Channel] = PoweringDownState;
+	}
+}
+
+static void reportEvents( const EventStruct* EventsPtr, uint16_t NumberOfEvents, void* ContextPtr ){
+	static const char* const CommunicationStateNames[] = { "port nieotwarty", "niezgodne ID", "błędy trwałe", "błędy przejściowe", "poprawny" };
+	static const char* const PoweringDownStateNames[] = { "nieaktywne", "zmniejszanie prądu", "przekroczony czas" };
+	(void)ContextPtr; // intentionally unused
+
+	for (uint16_t J = 0; J < NumberOfEvents; J++){
+		const EventStruct* EventPtr = &EventsPtr[J];
+		switch (EventPtr->type){
+		case EventTypeClass::COMMUNICATION_STATE_CHANGED:
+			printf( "Kanał %u: stan komunikacji %s -> %s\n", EventPtr->channel,
+					CommunicationStateNames[EventPtr->argument], CommunicationStateNames[EventPtr->value] );
+			break;
+		case EventTypeClass::POWERING_DOWN_STATE_CHANGED:
+			printf( "Kanał %u: wyłączanie %s -> %s\n", EventPtr->channel,
+					PoweringDownStateNames[EventPtr->argument], PoweringDownStateNames[EventPtr->value] );
+			break;
+		case EventTypeClass::ORDER_ACCEPTED:
+			printf( "Kanał %u: przyjęto polecenie %u (wartość %u)\n", EventPtr->channel, EventPtr->value, EventPtr->argument );
+			break;
+		default:
+			break;
+		}
+	}
+}
 
+// Thread function of a polling worker; the worker serves every NumberOfPollingWorkers-th serial port
+static void pollingWorkerThread(uint8_t WorkerIndex){
+	uint32_t LastTick = 0;
+	uint8_t CurrentBus;
+
+	while (true){
+		pthread_mutex_lock( &PollingMutex );
+		while (PollingTickCounter == LastTick){
+			pthread_cond_wait( &PollingTickCondition, &PollingMutex );
+		}
+		LastTick = PollingTickCounter;
+		pthread_mutex_unlock( &PollingMutex );
+
+		for( CurrentBus=WorkerIndex; CurrentBus<NumberOfSerialBuses; CurrentBus+=NumberOfPollingWorkers ){
+			communicateSerialBus( CurrentBus );
+		}
+
+		pthread_mutex_lock( &PollingMutex );
+		assert( 0 < PollingWorkersBusy );
+		PollingWorkersBusy--;
+		if (0 == PollingWorkersBusy){
+			pthread_cond_signal( &PollingDoneCondition );
+		}
+		pthread_mutex_unlock( &PollingMutex );
+	}
+}
+
+// Modbus RTU communication with the power supply units connected to a single serial port (the bus scheduler).
+// Before every transaction the scheduler looks at the priority lanes of all the power supplies on the line:
+// safety orders are sent first, then setpoints, and the status readings fill the remaining time of the tick.
+// The readings are interleaved one by one (round robin); the power supply which starts the round rotates every tick.
+// A power supply which fails a transaction is not asked again in this tick, and a power supply which has been silent
+// for a long time is asked only once a second (unless it has a pending order), so that a slow or missing unit
+// cannot take the line from the others
+static void communicateSerialBus(uint8_t IndexOfBus){
+	BusRoundStruct Round;
+
+	if(!beginBusRound( IndexOfBus, &Round )){
+		return;
+	}
+
+#if RTU_RESPONSE_DRIVEN_TRANSACTIONS
+	SerialBus* BusPtr = &TableOfSerialBuses[IndexOfBus];
+	uint8_t MemberIndex, CurrentChannel;
+	TransactionResultClass Result;
+
+	while(true){
+		MemberIndex = chooseNextMember( IndexOfBus, &Round );
+		if(MemberIndex >= BusPtr->getNumberOfMembers()){
+			return;
+		}
+		CurrentChannel = BusPtr->getMemberChannel( MemberIndex );
+		Result = TableOfTransmissionChannel[CurrentChannel].transactionWithSlave( CurrentChannel, &PollingTickDeadline );
+		if(!noteTransactionResult( &Round, MemberIndex, Result )){
+			return;
+		}
+	}
+#else
+	// in the tick-driven mode the response is read in the next tick, so the serial port cannot be shared
+	// (and the orders wait for the next tick)
+	if(PollingOrdersOnly){
+		return;
+	}
+	assert(1 == TableOfSerialBuses[IndexOfBus].getNumberOfMembers());
+	uint8_t CurrentChannel = TableOfSerialBuses[IndexOfBus].getMemberChannel( 0 );
+	TableOfTransmissionChannel[CurrentChannel].singleInquiryOfSlave( CurrentChannel );
+#endif
+}
+
+// This function opens the serial port if needed, moves the new orders into the priority lanes
+// and selects the power supplies to be asked in this pass; it returns false if the serial port is closed
+static bool beginBusRound(uint8_t IndexOfBus, BusRoundStruct* RoundPtr){
+	SerialBus* BusPtr = &TableOfSerialBuses[IndexOfBus];
+	uint8_t NumberOfMembers, J, CurrentChannel;
+
+	NumberOfMembers = BusPtr->getNumberOfMembers();
+	if(!BusPtr->isOpen()){
+		if(BusPtr->isReopeningDue( (0 == FractionOfSecond) && !PollingOrdersOnly )){
+			for( J=0; J<NumberOfMembers; J++ ){
+				CurrentChannel = BusPtr->getMemberChannel( J );
+				TableOfTransmissionChannel[CurrentChannel].open( CurrentChannel );
+			}
+			if(VerboseMode && BusPtr->isOpen() && (LowLatencyStateClass::SET != BusPtr->getLowLatencyState())){
+				std::cout << " Port " << *BusPtr->getPortNamePtr() <<
+						((LowLatencyStateClass::REFUSED == BusPtr->getLowLatencyState())? ": sterownik odrzucił" : ": brak") <<
+						" trybu małych opóźnień; margines ciszy " << BusPtr->getSilenceMargin() << " us" << std::endl;
+			}
+		}
+		if(!BusPtr->isOpen()){
+			return false;
+		}
+	}
+
+	for( J=0; J<NumberOfMembers; J++ ){
+		CurrentChannel = BusPtr->getMemberChannel( J );
+		TableOfTransmissionChannel[CurrentChannel].acceptNewOrder( CurrentChannel );
+	}
+
+	RoundPtr->activeMembers = 0;
+	for( J=0; J<NumberOfMembers; J++ ){
+		CurrentChannel = BusPtr->getMemberChannel( J );
+		if(PollingOrdersOnly){
+			RoundPtr->isMemberActive[J] =
+					(OrderPriorityClass::STATUS_READING != TableOfTransmissionChannel[CurrentChannel].getPendingPriority());
+		}
+		else{
+			RoundPtr->isMemberActive[J] = (1 == NumberOfMembers) || (0 == FractionOfSecond) ||
+					!TableOfTransmissionChannel[CurrentChannel].isSilentPermanently() ||
+					(OrderPriorityClass::STATUS_READING != TableOfTransmissionChannel[CurrentChannel].getPendingPriority());
+		}
+		if(RoundPtr->isMemberActive[J]){
+			RoundPtr->activeMembers++;
+		}
+	}
+	RoundPtr->nextReadingMember = BusPtr->takeFirstMemberOfRound();
+	RoundPtr->presentMember = NumberOfMembers;
+	RoundPtr->isFinished = false;
+	RoundPtr->isPortError = false;
+	return true;
+}
+
+// This function chooses the power supply for the next transaction: the most important pending order first,
+// otherwise the next reading of the round; it returns the number of members if the pass is over
+static uint8_t chooseNextMember(uint8_t IndexOfBus, BusRoundStruct* RoundPtr){
+	SerialBus* BusPtr = &TableOfSerialBuses[IndexOfBus];
+	uint8_t NumberOfMembers, MemberIndex, J;
+	OrderPriorityClass Priority, HighestPriority;
+
+	NumberOfMembers = BusPtr->getNumberOfMembers();
+	if(0 == RoundPtr->activeMembers){
+		return NumberOfMembers;
+	}
+	MemberIndex = NumberOfMembers;
+	HighestPriority = OrderPriorityClass::NUMBER_OF_CLASSES;
+	for( J=0; J<NumberOfMembers; J++ ){
+		uint8_t Candidate = (uint8_t)((RoundPtr->nextReadingMember + J) % NumberOfMembers);
+		if(!RoundPtr->isMemberActive[Candidate]){
+			continue;
+		}
+		Priority = TableOfTransmissionChannel[BusPtr->getMemberChannel( Candidate )].getPendingPriority();
+		if(Priority < HighestPriority){
+			HighestPriority = Priority;
+			MemberIndex = Candidate;
+		}
+	}
+	assert(MemberIndex < NumberOfMembers);
+	if(OrderPriorityClass::STATUS_READING == HighestPriority){
+		if(PollingOrdersOnly){
+			return NumberOfMembers;		// all the orders have been sent
+		}
+		RoundPtr->nextReadingMember = (uint8_t)((MemberIndex + 1) % NumberOfMembers);
+	}
+	return MemberIndex;
+}
+
+// This function returns false if there will be no more transactions on the bus in this pass
+static bool noteTransactionResult(BusRoundStruct* RoundPtr, uint8_t MemberIndex, TransactionResultClass Result){
+	if((TransactionResultClass::NO_TIME == Result) || (TransactionResultClass::PORT_CLOSED == Result)){
+		return false;
+	}
+	if(TransactionResultClass::FAILED == Result){
+		RoundPtr->isMemberActive[MemberIndex] = false;
+		RoundPtr->activeMembers--;
+	}
+	return true;
+}
+
+#if RTU_RESPONSE_DRIVEN_TRANSACTIONS
+// The serial ports are served by the peripheral thread itself (option "-o"), without the polling workers.
+// A transaction is started on every bus as soon as its line is silent (t3.5), and then the responses of all
+// the buses are awaited with a single epoll set and a timer armed at the nearest deadline of the receptions,
+// so that the time of a pass is determined by the slowest serial port rather than by the sum of all of them.
+// The order of the transactions on each bus is the same as in communicateSerialBus
+static void communicateAllBusesOverlapped(void){
+	static int EpollHandler = -1;
+	static int TimerHandler = -1;
+	BusRoundStruct Rounds[MAX_NUMBER_OF_SERIAL_PORTS];
+	int RegisteredHandlers[MAX_NUMBER_OF_SERIAL_PORTS];
+	struct epoll_event Events[MAX_NUMBER_OF_SERIAL_PORTS+1];
+	struct epoll_event Event;
+	struct itimerspec TimerSetting;
+	struct timespec Now, Deadline;
+	uint8_t IndexOfBus, NumberOfMembers, MemberIndex, CurrentChannel, BusesInProgress;
+	uint8_t DiscardedBytes[MODBUS_FRAME_SIZE_MAX];
+	uint64_t Expirations;
+	TransactionResultClass Result;
+	int NumberOfEvents, TimeoutMs, J;
+	static bool IsTimerFailureReported = false;
+
+	if (-1 == EpollHandler){
+		EpollHandler = epoll_create1( EPOLL_CLOEXEC );
+		TimerHandler = timerfd_create( CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC );
+		Event.events = EPOLLIN;
+		Event.data.u32 = OVERLAPPED_TIMER_TAG;
+		if ((-1 == EpollHandler) || (-1 == TimerHandler) || (0 != epoll_ctl( EpollHandler, EPOLL_CTL_ADD, TimerHandler, &Event ))){
+			if (VerboseMode){
+				std::cout << " Nie udało się utworzyć zbioru epoll; porty są obsługiwane kolejno" << std::endl;
+			}
+			IsOverlappedPolling = false;
+			for( IndexOfBus=0; IndexOfBus<NumberOfSerialBuses; IndexOfBus++ ){
+				communicateSerialBus( IndexOfBus );
+			}
+			return;
+		}
+	}
+
+	BusesInProgress = 0;
+	for( IndexOfBus=0; IndexOfBus<NumberOfSerialBuses; IndexOfBus++ ){
+		RegisteredHandlers[IndexOfBus] = -1;
+		if (!beginBusRound( IndexOfBus, &Rounds[IndexOfBus] )){
+			Rounds[IndexOfBus].isFinished = true;
+			continue;
+		}
+		Event.events = EPOLLIN;
+		Event.data.u32 = IndexOfBus;
+		if (0 == epoll_ctl( EpollHandler, EPOLL_CTL_ADD, TableOfSerialBuses[IndexOfBus].getHandler(), &Event )){
+			RegisteredHandlers[IndexOfBus] = TableOfSerialBuses[IndexOfBus].getHandler();
+			BusesInProgress++;
+		}
+		else{
+			Rounds[IndexOfBus].isFinished = true;
+		}
+	}
+
+	while (0 != BusesInProgress){
+		// starting the transactions on the silent lines; the timer is armed at the nearest deadline
+		clock_gettime( CLOCK_MONOTONIC, &Now );
+		Deadline = PollingTickDeadline;
+		for( IndexOfBus=0; IndexOfBus<NumberOfSerialBuses; IndexOfBus++ ){
+			BusRoundStruct* RoundPtr = &Rounds[IndexOfBus];
+			SerialBus* BusPtr = &TableOfSerialBuses[IndexOfBus];
+			struct timespec BusDeadline;
+
+			if (RoundPtr->isFinished){
+				continue;
+			}
+			NumberOfMembers = BusPtr->getNumberOfMembers();
+			if (RoundPtr->presentMember >= NumberOfMembers){
+				if (isLater( BusPtr->getSilenceEnd(), &Now )){
+					BusDeadline = *BusPtr->getSilenceEnd();
+				}
+				else{
+					MemberIndex = chooseNextMember( IndexOfBus, RoundPtr );
+					Result = TransactionResultClass::NO_TIME;
+					if (MemberIndex < NumberOfMembers){
+						CurrentChannel = BusPtr->getMemberChannel( MemberIndex );
+						Result = TableOfTransmissionChannel[CurrentChannel].beginTransaction( CurrentChannel, &PollingTickDeadline, false );
+					}
+					if (TransactionResultClass::STARTED != Result){
+						finishOverlappedRound( EpollHandler, RoundPtr, &RegisteredHandlers[IndexOfBus], &BusesInProgress );
+						continue;
+					}
+					RoundPtr->presentMember = MemberIndex;
+					TableOfTransmissionChannel[CurrentChannel].getReceptionDeadline( &BusDeadline );
+				}
+			}
+			else{
+				TableOfTransmissionChannel[BusPtr->getMemberChannel( RoundPtr->presentMember )].getReceptionDeadline( &BusDeadline );
+			}
+			if (isLater( &Deadline, &BusDeadline )){
+				Deadline = BusDeadline;
+			}
+		}
+		if (0 == BusesInProgress){
+			break;
+		}
+
+		TimerSetting.it_interval.tv_sec = 0;
+		TimerSetting.it_interval.tv_nsec = 0;
+		TimerSetting.it_value = Deadline;
+		if ((0 == TimerSetting.it_value.tv_sec) && (0 == TimerSetting.it_value.tv_nsec)){
+			TimerSetting.it_value.tv_nsec = 1;		// a zero value would disarm the timer
+		}
+		// the timeout of epoll_wait (rounded up to 1 ms) keeps the deadline even if the timer has not been armed
+		clock_gettime( CLOCK_MONOTONIC, &Now );
+		TimeoutMs = (int)((microsecondsUntil( &Now, &Deadline ) + 999ul) / 1000ul);
+		if ((0 != timerfd_settime( TimerHandler, TFD_TIMER_ABSTIME, &TimerSetting, nullptr )) && !IsTimerFailureReported){
+			IsTimerFailureReported = true;
+			if (VerboseMode){
+				std::cout << " Nie udało się nastawić zegara timerfd; terminy transakcji są odmierzane z dokładnością 1 ms" << std::endl;
+			}
+		}
+		NumberOfEvents = epoll_wait( EpollHandler, Events, NumberOfSerialBuses+1, TimeoutMs );
+
+		// receiving the portions of the responses
+		for( J=0; J<NumberOfEvents; J++ ){
+			if (OVERLAPPED_TIMER_TAG == Events[J].data.u32){
+				(void)read( TimerHandler, &Expirations, sizeof(Expirations) );
+				continue;
+			}
+			IndexOfBus = (uint8_t)Events[J].data.u32;
+			BusRoundStruct* RoundPtr = &Rounds[IndexOfBus];
+			SerialBus* BusPtr = &TableOfSerialBuses[IndexOfBus];
+			if (RoundPtr->isFinished || !BusPtr->isOpen()){
+				continue;
+			}
+			if (RoundPtr->presentMember >= BusPtr->getNumberOfMembers()){
+				(void)read( BusPtr->getHandler(), DiscardedBytes, sizeof(DiscardedBytes) );	// late bytes of an earlier frame
+				continue;
+			}
+			if ((0 != (Events[J].events & (EPOLLERR | EPOLLHUP))) ||
+					!TableOfTransmissionChannel[BusPtr->getMemberChannel( RoundPtr->presentMember )].continueReception())
+			{
+				RoundPtr->isPortError = true;	// e.g. USB adapter unplugged
+			}
+		}
+
+		// completing the transactions whose responses have ended
+		clock_gettime( CLOCK_MONOTONIC, &Now );
+		for( IndexOfBus=0; IndexOfBus<NumberOfSerialBuses; IndexOfBus++ ){
+			BusRoundStruct* RoundPtr = &Rounds[IndexOfBus];
+			SerialBus* BusPtr = &TableOfSerialBuses[IndexOfBus];
+
+			if (RoundPtr->isFinished || (RoundPtr->presentMember >= BusPtr->getNumberOfMembers())){
+				continue;
+			}
+			CurrentChannel = BusPtr->getMemberChannel( RoundPtr->presentMember );
+			TableOfTransmissionChannel[CurrentChannel].getReceptionDeadline( &Deadline );
+			if (!RoundPtr->isPortError && isLater( &Deadline, &Now )){
+				continue;
+			}
+			Result = TableOfTransmissionChannel[CurrentChannel].completeTransaction( CurrentChannel, RoundPtr->isPortError );
+			MemberIndex = RoundPtr->presentMember;
+			RoundPtr->presentMember = BusPtr->getNumberOfMembers();
+			RoundPtr->isPortError = false;
+			if (!noteTransactionResult( RoundPtr, MemberIndex, Result )){
+				finishOverlappedRound( EpollHandler, RoundPtr, &RegisteredHandlers[IndexOfBus], &BusesInProgress );
+			}
+		}
+	}
+}
+
+// The serial port leaves the epoll set at once: the set is level-triggered, so stray bytes on the line of a finished bus
+// would wake epoll_wait again and again until the end of the pass (a closed serial port has left the set by itself)
+static void finishOverlappedRound(int EpollHandler, BusRoundStruct* RoundPtr, int* RegisteredHandlerPtr, uint8_t* BusesInProgressPtr){
+	RoundPtr->isFinished = true;
+	(*BusesInProgressPtr)--;
+	if (-1 != *RegisteredHandlerPtr){
+		(void)epoll_ctl( EpollHandler, EPOLL_CTL_DEL, *RegisteredHandlerPtr, nullptr );
+		*RegisteredHandlerPtr = -1;
+	}
+}
+#endif
+
+//...............................................................................................
@@ -24,6 +24,13 @@
 // This variable is used for time synchronization
 extern uint8_t FractionOfSecond;
 
+// The frequency of the ticks of the peripheral thread (Hz); TIME_SYNCHRONIZATION_FREQUENCY or option "-f"
+extern uint8_t TickFrequency;
+
+// This variable is set if there is argument "-o" or "--overlapped": the serial ports are served by the peripheral thread,
+// with the transactions on all of them overlapped, instead of the polling workers
+extern bool IsOverlappedPolling;
+
 extern bool IsExiting;
 
 // This variable is used to locate the configuration file
@@ -39,16 +46,25 @@ extern bool VerboseMode;
 // Peripheral communication thread function
 void peripheralThread(void);
 
-void intializeSharedData(void);
+// This function allocates and initializes the tables of the channels (the shared data, the queues of orders,
+// the histories, the Modbus TCP sectors) and then sets NumberOfChannels; it is called once, in the peripheral thread:
+// after the configuration file has been parsed or when the 'local computer' has been identified
+void allocateChannelTables( uint16_t Number );
 
 // This function loads the configuration file and allocates an array of objects of type TransmissionChannel
 // It returns 1 on success, and 0 on failure
 uint8_t configurationFileParsing(void);
 
+// This function starts the polling workers; it is called once, after the configuration file has been parsed
+void startPollingWorkers(void);
+
 // This function is designed to be called several times per second to read information
 // about the status of the power supply unit and write a possible write command;
-// the function works as a Modbus RTU master
-void communicateAllPowerSources( void );
+// the function works as a Modbus RTU master.
+// The serial ports are served in parallel by the polling workers (or by this function itself in the overlapped mode);
+// the function returns when all the serial ports have finished their work for the current tick.
+// If OrdersOnly is true, only the orders waiting in the priority lanes are sent (no readings)
+void communicateAllPowerSources( bool OrdersOnly );
 
 // This function supports the process of shutting down power supplies for multiple channels simultaneously.
 // If a power down order comes in from the user, this function transmits a current zeroing order
@@ -58,13 +74,18 @@ void communicateAllPowerSources( void );
 // response, then it turns off the power switch.
 void poweringDownTimingForAll( void );
 
-// This function implements something like time ticks; see definition of TIME_SYNCHRONIZATION_FREQUENCY
+// This function implements the time ticks (TickFrequency per second); it sets FractionOfSecond
 void waitForSynchronization(void);
 
+// This function returns the time of CLOCK_MONOTONIC in microseconds (used to measure latencies)
+uint64_t getMonotonicMicroseconds(void);
+
 // This function synchronizes data between:
 // TableOfSharedDataForLowLevel
-// TableOfSharedDataForGui
-// TableOfSharedDataForTcpServer
+// RegisterStoreForLowLevel, PublishedRegisterStore (read by the main FLTK thread and the Modbus TCP slave thread)
+// TableOfPublishedData (read by the main FLTK thread)
+// TableOfSharedDataForTcpServer (the registers of the orders)
+// and posts the events of the changed channels to PeripheralEventBus (delivered at the end of the tick)
 void synchronizeDataAcrossThreads(void);
 
 #endif // MULTICHANNEL_H_
@@ -0,0 +1,246 @@
+// orderQueue.cpp
+//
+// Threads: multi-thread (see orderQueue.h)
+
+#include <assert.h>
+#include "orderQueue.h"
+#include "multiChannel.h"
+
+//.................................................................................................
+// Preprocessor directives
+//.................................................................................................
+
+#define ORDER_QUEUE_INDEX_MASK			(ORDER_QUEUE_CAPACITY-1)
+
+static_assert( 0 == (ORDER_QUEUE_CAPACITY & ORDER_QUEUE_INDEX_MASK), "assert: ORDER_QUEUE_CAPACITY must be a power of 2" );
+static_assert( MAX_NUMBER_OF_RESERVED_ORDERS < ORDER_QUEUE_CAPACITY, "assert: too many reserved places" );
+
+//.................................................................................................
+// Global variables
+//.................................................................................................
+
+OrderQueue* TableOfOrderQueues;
+
+//.................................................................................................
+// Local function prototypes
+//.................................................................................................
+
+static bool isSafetyOrder( uint8_t Order, uint16_t Value );
+static bool isPowerSwitchOrder( uint8_t Order );
+static bool isSourceInControl( uint8_t Source );
+
+//.................................................................................................
+// Function definitions
+//.................................................................................................
+
+void OrderQueue::initialize(){
+	for (uint32_t J = 0; J < ORDER_QUEUE_CAPACITY; J++){
+		Ring[J].sequence.store( J, std::memory_order_relaxed );
+	}
+	EnqueuePosition.store( 0, std::memory_order_relaxed );
+	DequeuePosition.store( 0, std::memory_order_relaxed );
+	LatchedPowerOff.store( 0, std::memory_order_relaxed );
+	DroppedOrders.store( 0, std::memory_order_relaxed );
+	CoalescedOrders.store( 0, std::memory_order_relaxed );
+	NumberOfWaitingOrders = 0;
+	std::atomic_thread_fence( std::memory_order_release );
+}
+
+// This function places a new order in the ring (any thread); it returns false if the order is dropped
+bool OrderQueue::placeOrder( uint8_t Source, uint8_t Order, uint16_t Value ){
+	uint64_t PlacementTime = getMonotonicMicroseconds();
+	bool IsSafetyOrder = isSafetyOrder( Order, Value );
+	uint32_t Position = EnqueuePosition.load( std::memory_order_relaxed );
+
+	while (true){
+		RingCellStruct* CellPtr = &Ring[Position & ORDER_QUEUE_INDEX_MASK];
+		uint32_t Sequence = CellPtr->sequence.load( std::memory_order_acquire );
+		int32_t Difference = (int32_t)(Sequence - Position);
+
+		if (0 == Difference){
+			uint32_t Occupancy = Position - DequeuePosition.load( std::memory_order_relaxed );
+			if ((!IsSafetyOrder) && (Occupancy >= ORDER_QUEUE_CAPACITY-MAX_NUMBER_OF_RESERVED_ORDERS)){
+				break;	// the rest of the ring is reserved for the safety orders
+			}
+			if (EnqueuePosition.compare_exchange_weak( Position, Position+1, std::memory_order_relaxed )){
+				CellPtr->entry.order = Order;
+				CellPtr->entry.source = Source;
+				CellPtr->entry.value = Value;
+				CellPtr->entry.placementTime = PlacementTime;
+				CellPtr->sequence.store( Position+1, std::memory_order_release );
+				return true;
+			}
+			// another producer has taken the cell; Position has been reloaded
+		}
+		else if (Difference < 0){
+			break;	// the ring is full
+		}
+		else{
+			Position = EnqueuePosition.load( std::memory_order_relaxed );
+		}
+	}
+
+	if (RTU_ORDER_POWER_OFF == Order){
+		// the power off order is latched, so that it is not lost
+		LatchedPowerOff.store( (PlacementTime << 1) | (uint64_t)(Source & 1), std::memory_order_release );
+		return true;
+	}
+	DroppedOrders.fetch_add( 1, std::memory_order_relaxed );
+	return false;
+}
+
+// This function (peripheral thread) takes the oldest waiting order; it returns false if there is no order
+bool OrderQueue::takeOrder( uint8_t* OrderPtr, uint16_t* ValuePtr, uint64_t* PlacementTimePtr ){
+	QueuedOrderStruct Entry;
+
+	// one place is left for the latched power off order
+	while (NumberOfWaitingOrders < ORDER_QUEUE_CAPACITY-1){
+		if ( !popFromRing( &Entry )){
+			break;
+		}
+		mergeLatchedPowerOff( Entry.placementTime );
+		if (isSourceInControl( Entry.source )){
+			mergeWaitingOrder( Entry );
+		}
+	}
+	if (NumberOfWaitingOrders < ORDER_QUEUE_CAPACITY){
+		mergeLatchedPowerOff( UINT64_MAX );
+	}
+
+	if (0 == NumberOfWaitingOrders){
+		return false;
+	}
+	*OrderPtr = WaitingOrders[0].order;
+	*ValuePtr = WaitingOrders[0].value;
+	*PlacementTimePtr = WaitingOrders[0].placementTime;
+	removeWaitingOrder( 0 );
+	return true;
+}
+
+// This function (peripheral thread) checks if there is any order to take
+bool OrderQueue::isOrderWaiting(){
+	if (0 != NumberOfWaitingOrders){
+		return true;
+	}
+	if (0 != LatchedPowerOff.load( std::memory_order_relaxed )){
+		return true;
+	}
+	uint32_t Position = DequeuePosition.load( std::memory_order_relaxed );
+	return (Ring[Position & ORDER_QUEUE_INDEX_MASK].sequence.load( std::memory_order_acquire ) == Position+1);
+}
+
+// This function is called by the lower layer when it merges an order with another one
+void OrderQueue::noteCoalescedOrder(){
+	CoalescedOrders.fetch_add( 1, std::memory_order_relaxed );
+}
+
+uint32_t OrderQueue::getDroppedOrders(){
+	return DroppedOrders.load( std::memory_order_relaxed );
+}
+
+uint32_t OrderQueue::getCoalescedOrders(){
+	return CoalescedOrders.load( std::memory_order_relaxed );
+}
+
+// This function takes the oldest entry from the ring (consumer only)
+bool OrderQueue::popFromRing( QueuedOrderStruct* EntryPtr ){
+	uint32_t Position = DequeuePosition.load( std::memory_order_relaxed );
+	RingCellStruct* CellPtr = &Ring[Position & ORDER_QUEUE_INDEX_MASK];
+
+	if (CellPtr->sequence.load( std::memory_order_acquire ) != Position+1){
+		return false;
+	}
+	*EntryPtr = CellPtr->entry;
+	CellPtr->sequence.store( Position+ORDER_QUEUE_CAPACITY, std::memory_order_release );
+	DequeuePosition.store( Position+1, std::memory_order_relaxed );
+	return true;
+}
+
+// This function appends an order to the waiting orders according to the merging rules (see orderQueue.h)
+void OrderQueue::mergeWaitingOrder( const QueuedOrderStruct& NewEntry ){
+	QueuedOrderStruct* LastPtr = (0 != NumberOfWaitingOrders)? &WaitingOrders[NumberOfWaitingOrders-1] : nullptr;
+
+	if ((nullptr != LastPtr) && (LastPtr->order == NewEntry.order)){
+		// a duplicate; the last setpoint wins, the placement time of the older order is kept (it is used to measure the latency)
+		LastPtr->value = NewEntry.value;
+		CoalescedOrders.fetch_add( 1, std::memory_order_relaxed );
+		return;
+	}
+	if (RTU_ORDER_POWER_OFF == NewEntry.order){
+		uint8_t J = 0;
+		while (J < NumberOfWaitingOrders){
+			if (isPowerSwitchOrder( WaitingOrders[J].order )){
+				removeWaitingOrder( J );
+				CoalescedOrders.fetch_add( 1, std::memory_order_relaxed );
+			}
+			else{
+				J++;
+			}
+		}
+	}
+	assert( NumberOfWaitingOrders < ORDER_QUEUE_CAPACITY );
+	WaitingOrders[NumberOfWaitingOrders] = NewEntry;
+	NumberOfWaitingOrders++;
+}
+
+// This function merges the latched power off order if it has been placed before NextPlacementTime (consumer only);
+// a newer latched order replaces the older one, so the latch is taken only if it has not changed in the meantime
+void OrderQueue::mergeLatchedPowerOff( uint64_t NextPlacementTime ){
+	QueuedOrderStruct Entry;
+	uint64_t Latched = LatchedPowerOff.load( std::memory_order_acquire );
+
+	while ((0 != Latched) && ((Latched >> 1) < NextPlacementTime)){
+		if (LatchedPowerOff.compare_exchange_weak( Latched, 0, std::memory_order_acquire, std::memory_order_acquire )){
+			Entry.order = RTU_ORDER_POWER_OFF;
+			Entry.value = 0;
+			Entry.source = (uint8_t)(Latched & 1);
+			Entry.placementTime = Latched >> 1;
+			if (isSourceInControl( Entry.source )){
+				mergeWaitingOrder( Entry );
+			}
+			return;
+		}
+	}
+}
+
+void OrderQueue::removeWaitingOrder( uint8_t Index ){
+	assert( Index < NumberOfWaitingOrders );
+	for (uint8_t J = Index+1; J < NumberOfWaitingOrders; J++){
+		WaitingOrders[J-1] = WaitingOrders[J];
+	}
+	NumberOfWaitingOrders--;
+}
+
+char placeOrderInQueue( uint8_t Channel, uint8_t Source, uint8_t Order, uint16_t Value ){
+	if ((Channel >= NumberOfChannels) ||
+			((RTU_ORDER_POWER_ON != Order) && (RTU_ORDER_POWER_OFF != Order) && (RTU_ORDER_SET_VALUE != Order) &&
+			(RTU_ORDER_DELAYED_POWER_OFF != Order) && (RTU_ORDER_CANCEL_DELAYED_POWER_OFF != Order)))
+	{
+		return 0;	// the readings are not ordered by the user
+	}
+	return TableOfOrderQueues[Channel].placeOrder( Source, Order, Value )? 1 : 0;
+}
+
+//.................................................................................................
+// Local function definitions
+//.................................................................................................
+
+// The safety orders can use the reserved places of the ring
+static bool isSafetyOrder( uint8_t Order, uint16_t Value ){
+	return (RTU_ORDER_POWER_OFF == Order) || (RTU_ORDER_DELAYED_POWER_OFF == Order) ||
+			((RTU_ORDER_SET_VALUE == Order) && (0 == Value));
+}
+
+// The orders that are superseded by a power off order
+static bool isPowerSwitchOrder( uint8_t Order ){
+	return (RTU_ORDER_POWER_ON == Order) || (RTU_ORDER_POWER_OFF == Order) ||
+			(RTU_ORDER_DELAYED_POWER_OFF == Order) || (RTU_ORDER_CANCEL_DELAYED_POWER_OFF == Order);
+}
+
+// The orders of the GUI are valid if the control is here; the orders of the Modbus TCP slave are valid otherwise
+static bool isSourceInControl( uint8_t Source ){
+	if (ORDER_SOURCE_GUI == Source){
+		return (0 != ControlFromGuiHere);
+	}
+	return (0 == ControlFromGuiHere) && (0 != IsModbusTcpSlave);
+}
@@ -0,0 +1,113 @@
+// orderQueue.h
+//
+// Threads: producers - main thread (GUI) and the Modbus TCP slave thread; consumer - peripheral thread
+//
+// This module passes the orders of the user (power on, power off, setpoint ...) to the lower layer.
+// Each channel has a bounded lock-free ring of orders; several threads can place orders in the ring,
+// only the peripheral thread takes them. The orders taken from the ring are merged according to the rules below,
+// so that a burst of orders placed within one time tick is neither lost nor sent to the power supply one by one:
+//   - the last of consecutive setpoints wins,
+//   - a power off order supersedes the waiting power on orders and the waiting virtual orders,
+//   - the duplicates of the last waiting order are merged.
+// The last MAX_NUMBER_OF_RESERVED_ORDERS places of the ring are reserved for the safety orders (power off,
+// current zeroing, delayed power off); a power off order that does not fit in the ring anyway is latched, so a power off
+// order is never dropped. The latched order is merged at its place in time: after the orders of the ring placed before it
+// and before the ones placed after it, so it does not supersede a newer power on order.
+
+#ifndef ORDERQUEUE_H_
+#define ORDERQUEUE_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+#include <atomic>
+#endif
+
+#include "modbusTcpSlave.h"
+
+//.................................................................................................
+// Preprocessor directives
+//.................................................................................................
+
+#define ORDER_QUEUE_CAPACITY				16		// must be a power of 2
+#define MAX_NUMBER_OF_RESERVED_ORDERS		4
+
+// The sources of orders; the orders of the source that has no control over the power supplies are rejected
+#define ORDER_SOURCE_GUI					0
+#define ORDER_SOURCE_MODBUS_TCP				1
+
+//.................................................................................................
+// Definitions of types
+//.................................................................................................
+
+#ifdef __cplusplus
+
+struct QueuedOrderStruct{
+	uint8_t order;
+	uint8_t source;
+	uint16_t value;
+	uint64_t placementTime;		// CLOCK_MONOTONIC in microseconds
+};
+
+class OrderQueue{
+private:
+	struct RingCellStruct{
+		std::atomic<uint32_t> sequence;		// the position in the ring that the cell is ready for
+		QueuedOrderStruct entry;
+	};
+
+	// The shared part (lock-free)
+	RingCellStruct Ring[ORDER_QUEUE_CAPACITY];
+	std::atomic<uint32_t> EnqueuePosition;
+	std::atomic<uint32_t> DequeuePosition;	// modified only by the consumer
+	std::atomic<uint64_t> LatchedPowerOff;		// (placement time << 1) | source; 0 when there is no latched power off order
+	std::atomic<uint32_t> DroppedOrders;
+	std::atomic<uint32_t> CoalescedOrders;
+
+	// The part of the consumer: the orders taken from the ring and merged, waiting for the lower layer
+	QueuedOrderStruct WaitingOrders[ORDER_QUEUE_CAPACITY];
+	uint8_t NumberOfWaitingOrders;
+
+	bool popFromRing( QueuedOrderStruct* EntryPtr );
+	void mergeWaitingOrder( const QueuedOrderStruct& NewEntry );
+	void mergeLatchedPowerOff( uint64_t NextPlacementTime );
+	void removeWaitingOrder( uint8_t Index );
+
+public:
+	void initialize();
+	bool placeOrder( uint8_t Source, uint8_t Order, uint16_t Value );
+	bool takeOrder( uint8_t* OrderPtr, uint16_t* ValuePtr, uint64_t* PlacementTimePtr );
+	bool isOrderWaiting();
+	void noteCoalescedOrder();
+	uint32_t getDroppedOrders();
+	uint32_t getCoalescedOrders();
+};
+
+#endif
+
+//...............................................................................................
+// Global variables
+//...............................................................................................
+
+#ifdef __cplusplus
+// The queues of orders; the index is the channel (NumberOfChannels queues, see allocateChannelTables)
+extern OrderQueue* TableOfOrderQueues;
+#endif
+
+//.................................................................................................
+// Global function prototypes
+//.................................................................................................
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// This function places a new order in the queue of a given channel;
+// it returns 0 if the order is not valid or the queue is full
+char placeOrderInQueue( uint8_t Channel, uint8_t Source, uint8_t Order, uint16_t Value );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ORDERQUEUE_H_ */
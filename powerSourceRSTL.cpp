@@ -29,6 +29,9 @@
 #include "dataSharingInterface.h"
 #include "modbusTcpMaster.h"
 #include "modbusTcpSlave.h"
+#include "tickScheduler.h"
+#include "wireCapture.h"
+#include "telemetryArchive.h"
 
 //.................................................................................................
 // Global variables
@@ -77,6 +80,19 @@ int main(int argc, char** argv) {
         	VerboseMode = true;
         	std::cout << "Tryb \"verbose\"" << std::endl;
         }
+        else if ((Argument == "-f" || Argument == "--frequency") && (J+1 < argc)) {
+        	// the frequency of the ticks of the peripheral thread (Hz)
+        	unsigned long Frequency = strtoul( argv[++J], nullptr, 10 );
+        	if ((Frequency < TICK_FREQUENCY_MIN) || (Frequency > TICK_FREQUENCY_MAX)){
+        		std::cout << "Nieprawidłowa częstotliwość (dozwolone " << TICK_FREQUENCY_MIN << "..." << TICK_FREQUENCY_MAX << " Hz)" << std::endl;
+        		return -1;
+        	}
+        	TickFrequency = (uint8_t)Frequency;
+        }
+        else if (Argument == "-o" || Argument == "--overlapped") {
+        	// the serial ports are served by a single thread, with the transactions on all of them overlapped
+        	IsOverlappedPolling = true;
+        }
         else {
             std::cout << "Nieznany argument: " << Argument << std::endl;
             return -1;
@@ -86,6 +102,16 @@ int main(int argc, char** argv) {
 	if (0 != determineApplicationPath( argv[0] )){
 		return -1;
 	}
+	if (!initializeWireCapture( (*ConfigurationFilePathPtr + "/" WIRE_CAPTURE_FILE_NAME).c_str() )){
+		if (VerboseMode){
+			std::cout << " Nie udało się utworzyć pliku zapisu ramek " WIRE_CAPTURE_FILE_NAME << std::endl;
+		}
+	}
+	if (!initializeTelemetryArchive( (*ConfigurationFilePathPtr + "/" TELEMETRY_ARCHIVE_DIRECTORY).c_str() )){
+		if (VerboseMode){
+			std::cout << " Nie udało się otworzyć katalogu archiwum " TELEMETRY_ARCHIVE_DIRECTORY << std::endl;
+		}
+	}
 
 	if (VerboseMode){
     	std::cout << " Wersja   " << TcpSlaveIdentifier << std::endl;
@@ -99,7 +125,6 @@ int main(int argc, char** argv) {
     updateMainApplicationLabel( nullptr );
 
     initializeMainWindowWidgets();
-    intializeSharedData();
     initializeWidgetsOfChannels();
 
     ApplicationWindow->end();
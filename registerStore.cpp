@@ -0,0 +1,74 @@
+// registerStore.cpp
+//
+// Threads: see registerStore.h
+
+#include <assert.h>
+#include "registerStore.h"
+
+//.................................................................................................
+// Preprocessor directives
+//.................................................................................................
+
+static_assert( FIRST_MEASURED_QUANTITY + MODBUS_ADDRES_VOLTAGE_STD_DEVIATION - FIRST_MEASURED_REGISTER == QUANTITY_VOLTAGE_STD_DEVIATION,
+		"assert: the measured quantities must follow their registers" );
+
+//.................................................................................................
+// Global variables
+//.................................................................................................
+
+RegisterStore RegisterStoreForLowLevel;
+
+SeqlockSnapshot<RegisterStore> PublishedRegisterStore;
+
+RegisterStore RegisterStoreForGui;
+
+//.................................................................................................
+// Function definitions
+//.................................................................................................
+
+// This function places the registers of one channel (the layout of a Modbus TCP sector) in the columns
+void RegisterStore::loadChannel( uint8_t Channel, const uint16_t* RowPtr ){
+	assert( Channel < MAX_NUMBER_OF_CHANNELS );
+	for (uint8_t Offset = 0; Offset < MODBUS_TCP_SECTOR_SIZE; Offset++){
+		Registers[Offset][Channel] = RowPtr[Offset];
+	}
+}
+
+// All the channels are converted in one pass; each column is a loop without branches over contiguous arrays
+void RegisterStore::convertToPhysicalUnits( uint16_t NewNumberOfChannels ){
+	assert( NewNumberOfChannels <= MAX_NUMBER_OF_CHANNELS );
+	NumberOfChannels = NewNumberOfChannels;
+
+	const uint16_t* SourcePtr = Registers[MODBUS_ADDRES_REQUIRED_VALUE];
+	float* DestinationPtr = Quantities[QUANTITY_SETPOINT];
+	for (uint16_t J = 0; J < NumberOfChannels; J++){
+		DestinationPtr[J] = SETPOINT_REGISTER_UNIT * (float)SourcePtr[J];
+	}
+	for (uint8_t Quantity = FIRST_MEASURED_QUANTITY; Quantity < PHYSICAL_QUANTITIES_NUMBER; Quantity++){
+		SourcePtr = Registers[FIRST_MEASURED_REGISTER + Quantity - FIRST_MEASURED_QUANTITY];
+		DestinationPtr = Quantities[Quantity];
+		for (uint16_t J = 0; J < NumberOfChannels; J++){
+			DestinationPtr[J] = MEASUREMENT_REGISTER_UNIT * (float)SourcePtr[J];
+		}
+	}
+}
+
+uint16_t RegisterStore::getRegister( uint8_t Offset, uint8_t Channel ) const{
+	assert( (Offset < MODBUS_TCP_SECTOR_SIZE) && (Channel < MAX_NUMBER_OF_CHANNELS) );
+	return Registers[Offset][Channel];
+}
+
+float RegisterStore::getQuantity( uint8_t Quantity, uint8_t Channel ) const{
+	assert( (Quantity < PHYSICAL_QUANTITIES_NUMBER) && (Channel < MAX_NUMBER_OF_CHANNELS) );
+	return Quantities[Quantity][Channel];
+}
+
+// This function copies the registers of a channel as they are sent in a Modbus TCP response (big-endian)
+void RegisterStore::exportModbusRegisters( uint8_t Channel, uint8_t Offset, uint8_t Number, uint8_t* BufferPtr ) const{
+	assert( (Offset + Number <= MODBUS_TCP_SECTOR_SIZE) && (Channel < MAX_NUMBER_OF_CHANNELS) );
+	for (uint8_t J = 0; J < Number; J++){
+		uint16_t Register = Registers[Offset+J][Channel];
+		BufferPtr[2*J] = (uint8_t)(Register >> 8);
+		BufferPtr[2*J+1] = (uint8_t)(Register & 0xFFu);
+	}
+}
@@ -0,0 +1,81 @@
+// registerStore.h
+//
+// Threads: each object is used by one thread; the objects are passed between the threads by SeqlockSnapshot
+//
+// This module keeps the registers of all the channels in columns: one contiguous array per register,
+// indexed by the channel. The registers that are physical quantities (the setpoint, the statistics of the current
+// and of the voltage) are converted to amperes and volts for all the channels at once, one column after another,
+// so the conversion is a simple loop over contiguous arrays that the compiler can vectorize.
+// The peripheral thread fills RegisterStoreForLowLevel at each synchronization and publishes it;
+// GUI, the Modbus TCP slave and the powering down state machine read the registers and the quantities from the store
+// instead of decoding the registers of each channel separately.
+
+#ifndef REGISTERSTORE_H_
+#define REGISTERSTORE_H_
+
+#include <inttypes.h>
+#include "modbusTcpSlave.h"
+#include "rstlProtocolMaster.h"
+#include "seqlockSnapshot.h"
+
+//.................................................................................................
+// Preprocessor directives
+//.................................................................................................
+
+// The physical quantities calculated from the registers (the columns of RegisterStore::Quantities);
+// the statistics of the current and of the voltage are in the same order as their registers
+#define QUANTITY_SETPOINT					0		// A
+#define QUANTITY_CURRENT_MEAN				1		// A; MODBUS_ADDRES_CURRENT_MEAN ...
+#define QUANTITY_CURRENT_MEDIAN				2
+#define QUANTITY_CURRENT_FILTERED			3
+#define QUANTITY_CURRENT_PEAK_TO_PEAK		4
+#define QUANTITY_CURRENT_STD_DEVIATION		5
+#define QUANTITY_VOLTAGE_MEAN				6		// V
+#define QUANTITY_VOLTAGE_MEDIAN				7
+#define QUANTITY_VOLTAGE_FILTERED			8
+#define QUANTITY_VOLTAGE_PEAK_TO_PEAK		9
+#define QUANTITY_VOLTAGE_STD_DEVIATION		10		// ... MODBUS_ADDRES_VOLTAGE_STD_DEVIATION
+#define PHYSICAL_QUANTITIES_NUMBER			11
+
+#define FIRST_MEASURED_QUANTITY				QUANTITY_CURRENT_MEAN
+#define FIRST_MEASURED_REGISTER				MODBUS_ADDRES_CURRENT_MEAN
+
+// The units of the registers (see the documentation of the power supply interface)
+#define SETPOINT_REGISTER_UNIT				(200.0f/65536.0f)	// A
+#define MEASUREMENT_REGISTER_UNIT			0.01f				// A or V
+
+//.................................................................................................
+// Definitions of types
+//.................................................................................................
+
+class RegisterStore{
+private:
+	// the registers of each channel (the layout of a Modbus TCP sector; the registers of the order are not used)
+	// the columns have a fixed capacity, so that the store can be copied as a whole (see SeqlockSnapshot)
+	uint16_t Registers[MODBUS_TCP_SECTOR_SIZE][MAX_NUMBER_OF_CHANNELS];
+	float Quantities[PHYSICAL_QUANTITIES_NUMBER][MAX_NUMBER_OF_CHANNELS];
+	uint16_t NumberOfChannels;
+
+public:
+	void loadChannel( uint8_t Channel, const uint16_t* RowPtr );
+	void convertToPhysicalUnits( uint16_t NewNumberOfChannels );
+
+	uint16_t getRegister( uint8_t Offset, uint8_t Channel ) const;
+	float getQuantity( uint8_t Quantity, uint8_t Channel ) const;
+	void exportModbusRegisters( uint8_t Channel, uint8_t Offset, uint8_t Number, uint8_t* BufferPtr ) const;
+};
+
+//...............................................................................................
+// Global variables
+//...............................................................................................
+
+// This store is filled from TableOfSharedDataForLowLevel at each synchronization; peripheral thread
+extern RegisterStore RegisterStoreForLowLevel;
+
+// The last store published by the peripheral thread; it is read by the main FLTK thread and by the Modbus TCP slave thread
+extern SeqlockSnapshot<RegisterStore> PublishedRegisterStore;
+
+// The copy of PublishedRegisterStore used by the main FLTK thread (see refreshSharedDataForGui)
+extern RegisterStore RegisterStoreForGui;
+
+#endif /* REGISTERSTORE_H_ */
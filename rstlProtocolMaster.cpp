@@ -3,6 +3,8 @@
 // Threads: peripheral thread
 //
 // This module is designed to handle a single communication channel with the power supply unit.
+// Several channels may share one serial port (class SerialBus), when the power supplies are connected
+// to the same RS-485 line and have different Modbus slave addresses.
 // The module is designed to operate in a peripheral thread.
 
 #include <stdio.h>
@@ -16,7 +18,15 @@
 #include <time.h>
 #include <ctype.h>
 #include <pthread.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <linux/serial.h>
 #include "rstlProtocolMaster.h"
+#include "modbusCrc.h"
+#include "rtuFrameCatalog.h"
+#include "rtuFrameDecoder.h"
+#include "wireCapture.h"
+#include "orderQueue.h"
 
 #include "dataSharingInterface.h"
 
@@ -24,26 +34,41 @@
 // Preprocessor directives
 //.................................................................................................
 
-#define HISTORY_ELEMENT_BITS				32
-
 // This constant determines Modbus speed; it is defined in termios.h
 #define MODBUS_RTU_HARDWARE_SPEED			B19200
+#define MODBUS_RTU_BAUD_RATE				19200	// must match MODBUS_RTU_HARDWARE_SPEED
+
+// One character is 11 bits long: start bit, 8 data bits, parity bit, stop bit
+#define MODBUS_RTU_CHARACTER_TIME_US		((11ul * 1000000ul + MODBUS_RTU_BAUD_RATE - 1) / MODBUS_RTU_BAUD_RATE)
+
+// The Modbus specification fixes t1.5 and t3.5 for baud rates higher than 19200
+#if MODBUS_RTU_BAUD_RATE > 19200
+#define MODBUS_RTU_INTERCHARACTER_TIMEOUT_US	750ul													// t1.5
+#define MODBUS_RTU_INTERFRAME_DELAY_US		1750ul													// t3.5
+#else
+#define MODBUS_RTU_INTERCHARACTER_TIMEOUT_US	((15ul * MODBUS_RTU_CHARACTER_TIME_US + 9) / 10)		// t1.5
+#define MODBUS_RTU_INTERFRAME_DELAY_US		((35ul * MODBUS_RTU_CHARACTER_TIME_US + 9) / 10)		// t3.5
+#endif
 
-#define MODBUS_FRAME_SIZE_READING_ALL		33
-#define MODBUS_FRAME_SIZE_READING_FIRST		21
-#define MODBUS_FRAME_SIZE_READING_LAST		19
-#define MODBUS_FRAME_SIZE_MAX				40
-
-#define WRITE_NEW_VALUE_FRAME_SIZE			8
+// The silent intervals are measured on the host side, so the latency of the serial port driver must be taken into account
+// (the low latency mode is requested for each serial port, which for USB adapters means about 1 ms); if the driver
+// refuses it, a USB adapter passes the bytes in portions every latency timer period (16 ms by default for FTDI).
+// An adapter that accepts the flag but ignores it (e.g. CH340) needs 'margines' in the configuration file
+#define MODBUS_RTU_SILENCE_MARGIN_US		1000ul
+#define MODBUS_RTU_SILENCE_MARGIN_SLOW_US	20000ul
 
-#define POSITION_OF_VALUE_IN_FRAME			4	// this refers to the command to write a single register
-#define POSITION_OF_CRC_IN_FRAME			6
+// The maximum time the power supply interface needs to start its response (after receiving the request)
+#define MODBUS_RTU_SLAVE_TURNAROUND_US		30000ul
 
-#define POSITION_OF_DATA_IN_FRAME			3	// this refers to a response frame
 #define READING_REGISTERS_NUMBER			7	// this refers to ORDER_READING_FIRST and ORDER_READING_LAST
 
+// The read planner (see TransmissionChannel::planReading) falls back to the halves of the register window
+// after READING_ALL_FAILURES_LIMIT consecutive corrupted responses to RTU_ORDER_READING_ALL
+#define READING_ALL_FAILURES_LIMIT			3
+#define READING_ALL_BACKOFF_READINGS		64
+
 #define POWERING_DOWN_TIMEOUT_IN_SECONDS	8	// will actually be 2 seconds more
-#define POWERING_DOWN_TIMEOUT				(POWERING_DOWN_TIMEOUT_IN_SECONDS * TIME_SYNCHRONIZATION_FREQUENCY)		// not tested for other values of TIME_SYNCHRONIZATION_FREQUENCY than 4
+#define POWERING_DOWN_TIMEOUT				(POWERING_DOWN_TIMEOUT_IN_SECONDS * TickFrequency)		// not tested for other values of TickFrequency than 4
 #define POWERING_DOWN_CURRENT_LIMIT			200		// Amperes * 100
 #define POWERING_DOWN_COUNTER_MAX			30000
 
@@ -51,61 +76,65 @@
 // Definitions of types
 //.................................................................................................
 
-typedef struct FrameInfoStruct{
-	const uint8_t *outgoingFramePtr;
-	const uint8_t outgoingFrameLength;
-	const uint8_t *responseFramePtr;
-	const uint8_t responseFrameTotalLength;
-	const uint8_t knownResponseLength;
-}FrameInfo;
 
 //.................................................................................................
 // Local variables
 //.................................................................................................
 
-static uint8_t WriteNewValueFrame[WRITE_NEW_VALUE_FRAME_SIZE];
-
-static uint8_t BufferForModbusFrames[MODBUS_FRAME_SIZE_MAX+2];
+// multiclickCountdown() may be called by several polling workers at the same time
+static pthread_mutex_t MulticlickMutex = PTHREAD_MUTEX_INITIALIZER;
 
 //.................................................................................................
 // Local constants
 //.................................................................................................
 
-// Modbus commands are prepared in such a way that the response to a given command cannot be mistaken with the response to another command.
-
-static const uint8_t ReadAllRegistersFrame[] =	{0x01, 0x03, 0x03, 0xE8, 0x00, 0x0E, 0x44, 0x7E}; // Registers: 1000 ... 1013
-static const uint8_t ReadFirstRegistersFrame[] ={0x01, 0x03, 0x03, 0xE8, 0x00, 0x08, 0xC4, 0x7C}; // Registers: 1000 ... 1007
-static const uint8_t ReadLastRegistersFrame[] = {0x01, 0x03, 0x03, 0xEF, 0x00, 0x07, 0x35, 0xB9}; // Registers: 1007 ... 1013
-static const uint8_t WritePowerOnFrame[]  = 	{0x01, 0x06, 0x03, 0xe8, 0x00, 0x01, 0xc8, 0x7a};
-static const uint8_t WritePowerOffFrame[] =		{0x01, 0x06, 0x03, 0xe8, 0x00, 0x00, 0x09, 0xba};
-
-static const uint8_t WriteZeroValueFrame[]= 	{0x01, 0x06, 0x03, 0xe9, 0x00, 0x00, 0x58, 0x7a}; // Value = 0; for a different value will be a different crc
-static const uint8_t ResponseOfReadAll[] = 		{0x01, 0x03, 0x1C}; // The beginning of the response
-static const uint8_t ResponseOfReadFirst[] =	{0x01, 0x03, 0x10}; // The beginning of the response
-static const uint8_t ResponseOfReadLast[] =		{0x01, 0x03, 0x0E}; // The beginning of the response
-
-// See ORDER_READING_ALL and so on
-static const FrameInfo FrameInfoTable[RTU_PRIMITIVE_ORDER_TOTAL_NUMBER] =
-	{{ReadAllRegistersFrame,	sizeof(ReadAllRegistersFrame),	ResponseOfReadAll,	MODBUS_FRAME_SIZE_READING_ALL,	sizeof(ResponseOfReadAll)},
-	{ReadFirstRegistersFrame,	sizeof(ReadFirstRegistersFrame),ResponseOfReadFirst,MODBUS_FRAME_SIZE_READING_FIRST,	sizeof(ResponseOfReadFirst)},
-	{ReadLastRegistersFrame,	sizeof(ReadLastRegistersFrame),	ResponseOfReadLast,	MODBUS_FRAME_SIZE_READING_LAST,	sizeof(ResponseOfReadLast)},
-	{WritePowerOnFrame,			sizeof(WritePowerOnFrame),		WritePowerOnFrame, 	sizeof(WritePowerOnFrame),	sizeof(WritePowerOnFrame)},
-	{WritePowerOffFrame,		sizeof(WritePowerOffFrame),		WritePowerOffFrame, sizeof(WritePowerOffFrame),	sizeof(WritePowerOffFrame)},
-	{WriteNewValueFrame,		sizeof(WriteNewValueFrame),		WriteNewValueFrame, sizeof(WriteNewValueFrame),	sizeof(WriteNewValueFrame)}
-	};
+// The frames of all the slave addresses are generated at compile time (see rtuFrameCatalog.h)
+static constexpr RtuFrameCatalogTable<RTU_REGISTERS_WINDOW_START, MODBUS_RTU_REGISTERS_AREA> FrameCatalogs;
+
+// The generated frames must be identical to the frames the power supply interfaces were tested with
+static_assert( (0x44 == FrameCatalogs[1].requestFrame[RTU_ORDER_READING_ALL][6]) &&
+		(0x7E == FrameCatalogs[1].requestFrame[RTU_ORDER_READING_ALL][7]), "assert: RTU_ORDER_READING_ALL frame" );
+static_assert( (0x08 == FrameCatalogs[1].requestFrame[RTU_ORDER_READING_FIRST][5]) &&
+		(0xC4 == FrameCatalogs[1].requestFrame[RTU_ORDER_READING_FIRST][6]) &&
+		(0x7C == FrameCatalogs[1].requestFrame[RTU_ORDER_READING_FIRST][7]), "assert: RTU_ORDER_READING_FIRST frame" );
+static_assert( (0xEF == FrameCatalogs[1].requestFrame[RTU_ORDER_READING_LAST][3]) &&
+		(0x35 == FrameCatalogs[1].requestFrame[RTU_ORDER_READING_LAST][6]) &&
+		(0xB9 == FrameCatalogs[1].requestFrame[RTU_ORDER_READING_LAST][7]), "assert: RTU_ORDER_READING_LAST frame" );
+static_assert( (0xC8 == FrameCatalogs[1].requestFrame[RTU_ORDER_POWER_ON][6]) &&
+		(0x7A == FrameCatalogs[1].requestFrame[RTU_ORDER_POWER_ON][7]), "assert: RTU_ORDER_POWER_ON frame" );
+static_assert( (0x09 == FrameCatalogs[1].requestFrame[RTU_ORDER_POWER_OFF][6]) &&
+		(0xBA == FrameCatalogs[1].requestFrame[RTU_ORDER_POWER_OFF][7]), "assert: RTU_ORDER_POWER_OFF frame" );
+static_assert( (0x58 == FrameCatalogs[1].requestFrame[RTU_ORDER_SET_VALUE][6]) &&
+		(0x7A == FrameCatalogs[1].requestFrame[RTU_ORDER_SET_VALUE][7]), "assert: RTU_ORDER_SET_VALUE frame" );
+static_assert( (MODBUS_FRAME_SIZE_READING_ALL == FrameCatalogs[1].responseFrameTotalLength[RTU_ORDER_READING_ALL]) &&
+		(21 == FrameCatalogs[1].responseFrameTotalLength[RTU_ORDER_READING_FIRST]) &&
+		(19 == FrameCatalogs[1].responseFrameTotalLength[RTU_ORDER_READING_LAST]), "assert: response sizes" );
+static_assert( WRITE_NEW_VALUE_FRAME_SIZE == RTU_REQUEST_FRAME_SIZE, "assert: WRITE_NEW_VALUE_FRAME_SIZE" );
 
 //.................................................................................................
 // Local function prototypes
 //.................................................................................................
 
 // This function opens and configures a serial port
-static int configureSerialPort(const char *DeviceName);
+static int configureSerialPort(const char *DeviceName, LowLatencyStateClass* LowLatencyStatePtr);
 
 // This function reads a packet of bytes from the serial port
 static int16_t receiveResponse(int FileHandler, uint8_t *FrameBuffer, uint8_t ExpectedNumberOfBytes);
 
-// This function calculates crc16 of Modbus type for a given frame
-static uint16_t crc16( const uint8_t *Buffer, uint8_t Length );
+// This function receives a Modbus RTU frame delimited by the silent interval t3.5 (the reception must have been started)
+static int16_t receiveDelimitedFrame(int FileHandler, uint8_t *FrameBuffer, FrameReceptionStruct* ReceptionPtr);
+
+// This function reads the bytes of the frame that have arrived; it returns false on a serial port error
+static bool receiveFramePortion(int FileHandler, uint8_t *FrameBuffer, FrameReceptionStruct* ReceptionPtr);
+
+// This function returns the end of the reception: the deadline of the first byte of the frame
+// or, once the frame has begun, the end of the silent interval t3.5 after its last portion
+static void calculateReceptionDeadline(const FrameReceptionStruct* ReceptionPtr, struct timespec* DeadlinePtr);
+
+// This function returns the time needed to send a request and receive the response (including the slave turnaround time)
+static uint32_t transactionTimeout( uint8_t OutgoingFrameLength, uint8_t ResponseFrameLength );
+
+static void addMicroseconds( struct timespec* TimePtr, uint32_t Microseconds );
 
 
 //........................................................................................................
@@ -113,56 +142,137 @@ static uint16_t crc16( const uint8_t *Buffer, uint8_t Length );
 //........................................................................................................
 
 TransmissionErrorsMonitor::TransmissionErrorsMonitor() {
-	uint8_t J;
-	for (J = 0; J < TRANSMISSION_ERRORS_TABLE; J++) {
-		TransmissionErrorsHistory[J] = 0lu;
-	}
-	TransmissionErrorsHead = 0;
-	TransmissionErrorsValue = 0;
-	TransmissionErrorsSequence = 0;
+	Statistics.reset();
 }
 
 void TransmissionErrorsMonitor::addSampleAndCalculateStatistics(bool New){
-	uint16_t BitIndex;
-	uint16_t LengthOfSequence, J;
+	Statistics.addSample( New );
+}
+
+uint16_t TransmissionErrorsMonitor::getErrorPerMille(void){
+	return (uint16_t)(((uint64_t)1000 * (uint64_t)Statistics.getNumberOfErrors()) / (uint64_t)TRANSMISSION_ERRORS_WINDOW);
+}
+
+uint16_t TransmissionErrorsMonitor::getErrorMaxSequence(void){
+	uint32_t LongestSequence = Statistics.getLongestSequence();
+	return (LongestSequence > 0xFFFFu)? 0xFFFFu : (uint16_t)LongestSequence;
+}
 
-	static_assert(HISTORY_ELEMENT_BITS == 8*sizeof(TransmissionErrorsHistory[0]), "assert: HISTORY_ELEMENT_BITS");
+//........................................................................................................
+// Function definitions of class SerialBus
+//........................................................................................................
+
+SerialBus::SerialBus(){
+	SerialPortHandler = -1;
+	NumberOfMembers = 0;
+	FirstMemberOfRound = 0;
+	IsDeviceWatched = false;
+	IsDeviceAbsent = false;
+	IsDeviceEventPending = false;
+	SilenceEnd.tv_sec = 0;
+	SilenceEnd.tv_nsec = 0;
+	ConfiguredSilenceMarginUs = SILENCE_MARGIN_AUTOMATIC;
+	LowLatencyState = LowLatencyStateClass::NOT_SUPPORTED;
+}
 
-	if(New){
-		TransmissionErrorsHistory[TransmissionErrorsHead/HISTORY_ELEMENT_BITS] |= (1 << (TransmissionErrorsHead % HISTORY_ELEMENT_BITS));
+SerialBus::~SerialBus(){
+	closePort();
+}
+
+// This function opens and configures the serial port; it returns true on success
+bool SerialBus::open(void){
+	const char* PortNameCharPtr;
+
+	assert(-1 == SerialPortHandler);
+	PortNameCharPtr = PortName.c_str();
+	IsDeviceAbsent = (0 != access(PortNameCharPtr, F_OK ));
+	if(!IsDeviceAbsent){
+		SerialPortHandler = configureSerialPort( PortNameCharPtr, &LowLatencyState );
 	}
-	else{
-		TransmissionErrorsHistory[TransmissionErrorsHead/HISTORY_ELEMENT_BITS] &= ~(1 << (TransmissionErrorsHead % HISTORY_ELEMENT_BITS));
-	}
-	TransmissionErrorsHead++;
-	TransmissionErrorsHead %= 8*sizeof(TransmissionErrorsHistory);
-
-	TransmissionErrorsValue = 0;
-	TransmissionErrorsSequence = 0;
-	LengthOfSequence = 0;
-	BitIndex = TransmissionErrorsHead;
-	for(J=0; J<TRANSMISSION_ERRORS_TABLE*HISTORY_ELEMENT_BITS; J++){
-		if((TransmissionErrorsHistory[BitIndex/HISTORY_ELEMENT_BITS] & (1 << (BitIndex % HISTORY_ELEMENT_BITS))) == 0){
-			LengthOfSequence = 0;
-		}
-		else{
-			TransmissionErrorsValue++;
-			LengthOfSequence++;
-			if(LengthOfSequence > TransmissionErrorsSequence){
-				TransmissionErrorsSequence = LengthOfSequence;
-			}
-		}
-		BitIndex++;
-		BitIndex %= 8*sizeof(TransmissionErrorsHistory);
+	return (-1 != SerialPortHandler);
+}
+
+void SerialBus::closePort(void){
+	if(-1 != SerialPortHandler){
+		close(SerialPortHandler);
+		SerialPortHandler = -1;
 	}
 }
 
-uint16_t TransmissionErrorsMonitor::getErrorPerMille(void){
-	return ((uint32_t)1000 * (uint32_t)TransmissionErrorsValue) / ((uint32_t)8 * (uint32_t)sizeof(TransmissionErrorsHistory));
+bool SerialBus::isOpen(void){
+	return (-1 != SerialPortHandler);
 }
 
-uint16_t TransmissionErrorsMonitor::getErrorMaxSequence(void){
-	return TransmissionErrorsSequence;
+int SerialBus::getHandler(void){
+	return SerialPortHandler;
+}
+
+std::string* SerialBus::getPortNamePtr(void){
+	return &PortName;
+}
+
+uint8_t SerialBus::getNumberOfMembers(void){
+	return NumberOfMembers;
+}
+
+uint8_t SerialBus::getMemberChannel( uint8_t MemberIndex ){
+	assert(MemberIndex < NumberOfMembers);
+	return MemberChannels[MemberIndex];
+}
+
+// This function returns the index of the member that starts the current tick and moves the round robin forward
+uint8_t SerialBus::takeFirstMemberOfRound(void){
+	uint8_t Result = FirstMemberOfRound;
+
+	assert(0 != NumberOfMembers);
+	FirstMemberOfRound++;
+	if(FirstMemberOfRound >= NumberOfMembers){
+		FirstMemberOfRound = 0;
+	}
+	return Result;
+}
+
+void SerialBus::setDeviceWatched( bool IsWatched ){
+	IsDeviceWatched = IsWatched;
+}
+
+// The device node of the serial port has appeared or its permissions have changed (peripheral thread, workers idle)
+void SerialBus::notifyDeviceEvent(void){
+	IsDeviceEventPending = true;
+}
+
+// This function decides if the closed serial port should be opened now.
+// It is opened at once after an event of its device node; otherwise it is probed once per second,
+// unless its device node is known to be absent and any change of the node will be reported by inotify.
+bool SerialBus::isReopeningDue( bool IsNewSecond ){
+	if(IsDeviceEventPending){
+		IsDeviceEventPending = false;
+		return true;
+	}
+	return IsNewSecond && !(IsDeviceWatched && IsDeviceAbsent);
+}
+
+// The next request may be sent after the silent interval t3.5 (see getSilenceEnd)
+void SerialBus::noteEndOfTransaction(void){
+	clock_gettime(CLOCK_MONOTONIC, &SilenceEnd);
+	addMicroseconds( &SilenceEnd, MODBUS_RTU_INTERFRAME_DELAY_US );
+}
+
+LowLatencyStateClass SerialBus::getLowLatencyState(void){
+	return LowLatencyState;
+}
+
+// This function returns the margin of the silent intervals; unless it is given in the configuration file, it depends
+// on the low latency mode (a device without serial settings is assumed to pass the bytes at once)
+uint32_t SerialBus::getSilenceMargin(void){
+	if(SILENCE_MARGIN_AUTOMATIC != ConfiguredSilenceMarginUs){
+		return ConfiguredSilenceMarginUs;
+	}
+	return (LowLatencyStateClass::REFUSED == LowLatencyState)? MODBUS_RTU_SILENCE_MARGIN_SLOW_US : MODBUS_RTU_SILENCE_MARGIN_US;
+}
+
+const struct timespec* SerialBus::getSilenceEnd(void){
+	return &SilenceEnd;
 }
 
 //........................................................................................................
@@ -172,7 +282,7 @@ uint16_t TransmissionErrorsMonitor::getErrorMaxSequence(void){
 TransmissionChannel::TransmissionChannel(){
 	uint8_t J;
 	PowerSupplyExpectedId = 0xFFFFu;
-	SerialPortHandler = -1;
+	BusPtr = nullptr;
 	CommunicationConsecutiveErrors = 255;
 	TransmissionAcknowledgement = false;
 	FrameLastError = LastFrameErrorClass::UNSPECIFIED;
@@ -180,26 +290,114 @@ TransmissionChannel::TransmissionChannel(){
 		ModbusRegisters[J] = 0;
 	}
 	PresentOrder = RTU_ORDER_NONE;
+	PreviousReadingOrder = RTU_ORDER_READING_LAST;
+	ReadingAllFailures = 0;
+	SplitReadingsLeft = 0;
+	for(J=0; J<(uint8_t)OrderPriorityClass::STATUS_READING; J++){
+		PendingOrders[J].order = RTU_ORDER_NONE;
+	}
+	PresentOrderPlacementTime = 0;
+	OrderToWireLatencyLast = 0;
+	OrderToWireLatencyMax = 0;
+	RequestWriteTime = 0;
 	PoweringDownCounter = -1;
+	assignSerialBus( nullptr, RTU_DEFAULT_SLAVE_ADDRESS );
 }
 
 TransmissionChannel::~TransmissionChannel(){
-	if(-1 != SerialPortHandler){
-		close(SerialPortHandler);
-		SerialPortHandler = -1;
+}
+
+// This function connects the power supply to the serial port (RS-485 line) and selects the frames of its slave address
+void TransmissionChannel::assignSerialBus( SerialBus* NewBusPtr, uint8_t NewSlaveAddress ){
+	assert((RTU_SLAVE_ADDRESS_MIN <= NewSlaveAddress) && (NewSlaveAddress <= RTU_SLAVE_ADDRESS_MAX));
+
+	BusPtr = NewBusPtr;
+	SlaveAddress = NewSlaveAddress;
+	FrameCatalogPtr = &FrameCatalogs[SlaveAddress];
+	memcpy( WriteNewValueFrame, FrameCatalogPtr->requestFrame[RTU_ORDER_SET_VALUE], sizeof(WriteNewValueFrame) );
+	CachedSetValue = 0;		// the value of the frame above
+}
+
+// This function moves a new order from the shared data into the priority lane of the channel.
+// A safety order cancels the older setpoint order, so that the power supply never receives them in the reverse order.
+// An order that would overwrite a different order waiting in its lane is left in the shared data (and the next orders
+// wait in the queue); a duplicate of the waiting order is merged with it (the last setpoint wins)
+void TransmissionChannel::acceptNewOrder( int ChannelId ){
+	PendingOrderStruct NewOrder;
+	OrderPriorityClass Priority;
+
+	if ( !TableOfSharedDataForLowLevel[ChannelId].isNewPrimitiveOrder() ){
+		return;
+	}
+	NewOrder.order = TableOfSharedDataForLowLevel[ChannelId].previewOrder();
+	NewOrder.value = TableOfSharedDataForLowLevel[ChannelId].previewOrderValue();
+
+	if ((RTU_ORDER_POWER_OFF == NewOrder.order) || ((RTU_ORDER_SET_VALUE == NewOrder.order) && (0 == NewOrder.value))){
+		Priority = OrderPriorityClass::SAFETY;
+	}
+	else if ((RTU_ORDER_POWER_ON == NewOrder.order) || (RTU_ORDER_SET_VALUE == NewOrder.order)){
+		Priority = OrderPriorityClass::SETPOINT;
+	}
+	else{
+		// the readings are performed anyway
+		(void) TableOfSharedDataForLowLevel[ChannelId].takePrimitiveOrder( &NewOrder.value, &NewOrder.placementTime );
+		return;
+	}
+
+	PendingOrderStruct* LanePtr = &PendingOrders[(int)Priority];
+	if ((RTU_ORDER_NONE != LanePtr->order) && (NewOrder.order != LanePtr->order)){
+		return;		// the order waits until the lane is free
+	}
+	(void) TableOfSharedDataForLowLevel[ChannelId].takePrimitiveOrder( &NewOrder.value, &NewOrder.placementTime );
+	if (RTU_ORDER_NONE != LanePtr->order){
+		// the placement time of the older order is kept (it is used to measure the latency)
+		NewOrder.placementTime = LanePtr->placementTime;
+		TableOfOrderQueues[ChannelId].noteCoalescedOrder();
+	}
+	if ((OrderPriorityClass::SAFETY == Priority) && (RTU_ORDER_NONE != PendingOrders[(int)OrderPriorityClass::SETPOINT].order)){
+		PendingOrders[(int)OrderPriorityClass::SETPOINT].order = RTU_ORDER_NONE;
+		TableOfOrderQueues[ChannelId].noteCoalescedOrder();
+	}
+	*LanePtr = NewOrder;
+}
+
+// This function returns the priority class of the most important order waiting in the priority lane
+OrderPriorityClass TransmissionChannel::getPendingPriority(void){
+	if (RTU_ORDER_NONE != PendingOrders[(int)OrderPriorityClass::SAFETY].order){
+		return OrderPriorityClass::SAFETY;
+	}
+	if (RTU_ORDER_NONE != PendingOrders[(int)OrderPriorityClass::SETPOINT].order){
+		return OrderPriorityClass::SETPOINT;
 	}
+	return OrderPriorityClass::STATUS_READING;
 }
 
+// This function takes the most important order from the priority lane; it returns RTU_ORDER_NONE if the lane is empty
+uint8_t TransmissionChannel::takePendingOrder( uint16_t* ValuePtr ){
+	OrderPriorityClass Priority;
+	uint8_t Result;
+
+	Priority = getPendingPriority();
+	if (OrderPriorityClass::STATUS_READING == Priority){
+		PresentOrderPlacementTime = 0;
+		return RTU_ORDER_NONE;
+	}
+	Result = PendingOrders[(int)Priority].order;
+	*ValuePtr = PendingOrders[(int)Priority].value;
+	PresentOrderPlacementTime = PendingOrders[(int)Priority].placementTime;
+	PendingOrders[(int)Priority].order = RTU_ORDER_NONE;
+	return Result;
+}
+
+// This function opens the serial port (unless another power supply on the same line has opened it)
+// and starts the communication with the power supply from scratch
 void TransmissionChannel::open( int ChannelId ){
-	int Result;
-	static const char* PortNameCharPtr;
+	assert(nullptr != BusPtr);
 
-	PortNameCharPtr = PortName.c_str();
-	Result = access(PortNameCharPtr, F_OK );
-	if(0 == Result){
-		SerialPortHandler = configureSerialPort( PortNameCharPtr );
+	if(!BusPtr->isOpen()){
+		(void)BusPtr->open();
 	}
-	if(-1 == SerialPortHandler){
+	if(!BusPtr->isOpen()){
 		TableOfSharedDataForLowLevel[ChannelId].loadRstlProtocolData( CommunicationStatesClass::PORT_NOT_OPEN, nullptr,
 				LastFrameErrorClass::UNSPECIFIED, 0xFFFFu, 0xFFFFu, false );
 	}
@@ -210,14 +408,8 @@ void TransmissionChannel::open( int ChannelId ){
 void TransmissionChannel::singleInquiryOfSlave( int ChannelId ){
 	uint16_t NewValueUint16;
     int16_t NumberOfReceivedBytes;
-    int16_t NumberOfSentBytes;
-    uint16_t CrcCalculated;
-    bool IsDataTransmissionError;
-    uint8_t ExpectedResponseLength;
-    uint16_t J;
-    LastFrameErrorClass FrameErrorCode;
 
-	if (-1 == SerialPortHandler){
+	if (!BusPtr->isOpen()){
 		return;
 	}
 
@@ -226,187 +418,357 @@ void TransmissionChannel::singleInquiryOfSlave( int ChannelId ){
 		assert(PresentOrder < RTU_PRIMITIVE_ORDER_TOTAL_NUMBER);
 
 		// Receiving data from the interface
-		ExpectedResponseLength = FrameInfoTable[PresentOrder].responseFrameTotalLength;
-		IsDataTransmissionError = false;
-		NumberOfReceivedBytes = receiveResponse(SerialPortHandler, BufferForModbusFrames, ExpectedResponseLength);
-		if (-1 == NumberOfReceivedBytes) {
-			close(SerialPortHandler);
-			SerialPortHandler = -1;
-			IsDataTransmissionError = true;
-
-			TableOfSharedDataForLowLevel[ChannelId].loadRstlProtocolData( CommunicationStatesClass::PORT_NOT_OPEN, nullptr,
-					LastFrameErrorClass::UNSPECIFIED, CommunicationMonitor.getErrorPerMille(),
-					CommunicationMonitor.getErrorMaxSequence(), TransmissionAcknowledgement );
+		NumberOfReceivedBytes = receiveResponse(BusPtr->getHandler(), BufferForModbusFrames,
+				FrameCatalogPtr->responseFrameTotalLength[PresentOrder]);
+		captureWireFrame( WIRE_CAPTURE_RTU_RESPONSE, (uint8_t)ChannelId, PresentOrder, SlaveAddress,
+				(NumberOfReceivedBytes < 0)? WIRE_CAPTURE_FLAG_PORT_ERROR : 0,
+				BufferForModbusFrames, (NumberOfReceivedBytes > 0)? (uint16_t)NumberOfReceivedBytes : 0, 0 );
+		(void)handleResponse( ChannelId, NumberOfReceivedBytes, false );
+	}
+
+	if (!BusPtr->isOpen()){
+		return;
+	}
+
+	usleep(1000);
+
+	// Preparing the order; an order from the priority lane is sent in the first tick after it has been placed;
+	// the response is read in the next tick, so the whole tick is available for the transaction
+	PresentOrder = takePendingOrder( &NewValueUint16 );
+	if (RTU_ORDER_NONE == PresentOrder){
+		// common situation
+		PresentOrder = planReading( 1000000ul / TickFrequency );
+	}
+	else{
+		PreviousReadingOrder = RTU_ORDER_READING_LAST;	// the first half holds the state changed by the order
+	}
+
+	(void)sendRequest( ChannelId, NewValueUint16 );
+}
+
+// This function performs a single Modbus RTU transaction (a request and the response read as soon as it arrives);
+// the transaction is started only if it can be completed before *TickDeadlinePtr
+TransactionResultClass TransmissionChannel::transactionWithSlave( int ChannelId, const struct timespec* TickDeadlinePtr ){
+	TransactionResultClass Result;
+    int16_t NumberOfReceivedBytes;
+
+	Result = beginTransaction( ChannelId, TickDeadlinePtr, true );
+	if (TransactionResultClass::STARTED != Result){
+		return Result;
+	}
+	NumberOfReceivedBytes = receiveDelimitedFrame( BusPtr->getHandler(), BufferForModbusFrames, &Reception );
+	return completeTransaction( ChannelId, NumberOfReceivedBytes < 0 );
+}
+
+// This function sends the request of a transaction and starts the reception of the response;
+// the transaction is started only if it can be completed before *TickDeadlinePtr.
+// If IsSilenceAwaited is false, the caller has already kept the silent interval t3.5 (see SerialBus::getSilenceEnd).
+// It returns TransactionResultClass::STARTED if the response is awaited (see continueReception, completeTransaction)
+TransactionResultClass TransmissionChannel::beginTransaction( int ChannelId, const struct timespec* TickDeadlinePtr,
+		bool IsSilenceAwaited )
+{
+	uint16_t NewValueUint16 = 0;
+	struct timespec Now;
+	uint32_t AvailableTimeUs;
+	uint8_t ShortestResponseLength;
+
+	if (!BusPtr->isOpen()){
+		return TransactionResultClass::PORT_CLOSED;
+	}
+
+	// the shortest transaction that can be performed must be completed before the deadline of the tick,
+	// even if the slave does not respond
+	clock_gettime(CLOCK_MONOTONIC, &Now);
+	AvailableTimeUs = microsecondsUntil( &Now, TickDeadlinePtr );
+	ShortestResponseLength = (OrderPriorityClass::STATUS_READING != getPendingPriority())?
+			WRITE_NEW_VALUE_FRAME_SIZE : FrameCatalogPtr->responseFrameTotalLength[RTU_ORDER_READING_FIRST];
+	if (AvailableTimeUs < MODBUS_RTU_INTERFRAME_DELAY_US + transactionTimeout( RTU_REQUEST_FRAME_SIZE, ShortestResponseLength )){
+		return TransactionResultClass::NO_TIME;
+	}
+
+	// Preparing the order; an order from the priority lane is sent at the first opportunity,
+	// otherwise the register area is read as a whole or in halves (see planReading)
+	PresentOrder = takePendingOrder( &NewValueUint16 );
+	if (RTU_ORDER_NONE == PresentOrder){
+		PresentOrder = planReading( AvailableTimeUs );
+	}
+	else{
+		PreviousReadingOrder = RTU_ORDER_READING_LAST;	// the first half holds the state changed by the order
+	}
+
+	// the silent interval between Modbus RTU frames; bytes that arrived after the deadline of an earlier transaction are discarded
+	if (IsSilenceAwaited){
+		usleep( MODBUS_RTU_INTERFRAME_DELAY_US );
+	}
+	tcflush( BusPtr->getHandler(), TCIFLUSH );
+
+	if (!sendRequest( ChannelId, NewValueUint16 )){
+		return TransactionResultClass::PORT_CLOSED;
+	}
+
+	// the deadline refers to the beginning of the response frame
+	Reception.totalBytes = 0;
+	Reception.isInterrupted = false;
+	Reception.silenceMarginUs = BusPtr->getSilenceMargin();
+	clock_gettime(CLOCK_MONOTONIC, &Reception.firstByteDeadline);
+	addMicroseconds( &Reception.firstByteDeadline, transactionTimeout(
+			RTU_REQUEST_FRAME_SIZE, FrameCatalogPtr->responseFrameTotalLength[PresentOrder] ));
+	return TransactionResultClass::STARTED;
+}
+
+// This function reads the part of the response that has arrived (the serial port is readable);
+// it returns false on a serial port error
+bool TransmissionChannel::continueReception(void){
+	return receiveFramePortion( BusPtr->getHandler(), BufferForModbusFrames, &Reception );
+}
+
+// The reception of the response is complete when this moment has passed without new bytes
+void TransmissionChannel::getReceptionDeadline( struct timespec* DeadlinePtr ){
+	calculateReceptionDeadline( &Reception, DeadlinePtr );
+}
+
+// This function checks the response received so far and finishes the transaction
+TransactionResultClass TransmissionChannel::completeTransaction( int ChannelId, bool IsPortError ){
+    int16_t NumberOfReceivedBytes;
+	uint64_t FrameEndTime;
+
+	NumberOfReceivedBytes = IsPortError? -1 : Reception.totalBytes;
+	FrameEndTime = (uint64_t)Reception.lastPortionTime.tv_sec * 1000000ull + (uint64_t)Reception.lastPortionTime.tv_nsec / 1000ull;
+	captureWireFrame( WIRE_CAPTURE_RTU_RESPONSE, (uint8_t)ChannelId, PresentOrder, SlaveAddress,
+			(Reception.isInterrupted? WIRE_CAPTURE_FLAG_INTERRUPTED : 0) | (IsPortError? WIRE_CAPTURE_FLAG_PORT_ERROR : 0),
+			BufferForModbusFrames, (NumberOfReceivedBytes > 0)? (uint16_t)NumberOfReceivedBytes : 0,
+			(NumberOfReceivedBytes > 0)? FrameEndTime : 0 );
+	BusPtr->noteEndOfTransaction();
+
+	// after a failed transaction the channel waits for the next tick,
+	// so that the consecutive errors are counted in the same way as in the tick-driven mode
+	if (handleResponse( ChannelId, NumberOfReceivedBytes, Reception.isInterrupted )){
+		PresentOrder = RTU_ORDER_NONE;
+		return BusPtr->isOpen()? TransactionResultClass::FAILED : TransactionResultClass::PORT_CLOSED;
+	}
+	RoundTripHistograms[PresentOrder].addSample( (FrameEndTime > RequestWriteTime)? (uint32_t)(FrameEndTime - RequestWriteTime) : 0 );
+	PresentOrder = RTU_ORDER_NONE;	// the response has been consumed
+	return TransactionResultClass::DONE;
+}
+
+// This function chooses the reading of the registers for the next transaction (the read planner).
+// The whole register area is read in one transaction (RTU_ORDER_READING_ALL), so that all the registers come from
+// the same moment, whenever this transaction can be completed within AvailableTimeUs; otherwise the halves are read
+// alternately, the first half first after an order. A power supply which corrupts the long response repeatedly
+// (READING_ALL_FAILURES_LIMIT times) is read in halves for the next READING_ALL_BACKOFF_READINGS readings
+uint8_t TransmissionChannel::planReading( uint32_t AvailableTimeUs ){
+	if ((0 == SplitReadingsLeft) && (AvailableTimeUs >= MODBUS_RTU_INTERFRAME_DELAY_US +
+			transactionTimeout( RTU_REQUEST_FRAME_SIZE, FrameCatalogPtr->responseFrameTotalLength[RTU_ORDER_READING_ALL] )))
+	{
+		PreviousReadingOrder = RTU_ORDER_READING_LAST;
+		return RTU_ORDER_READING_ALL;
+	}
+	if (0 != SplitReadingsLeft){
+		SplitReadingsLeft--;
+	}
+	PreviousReadingOrder = (RTU_ORDER_READING_FIRST == PreviousReadingOrder)? RTU_ORDER_READING_LAST : RTU_ORDER_READING_FIRST;
+	return PreviousReadingOrder;
+}
+
+// This function sends the frame related to PresentOrder;
+// NewValue is used only if PresentOrder is RTU_ORDER_SET_VALUE.
+// For an order from the priority lane, the time from placing the order to writing its frame is measured.
+// It returns false if the serial port has been closed
+bool TransmissionChannel::sendRequest( int ChannelId, uint16_t NewValue ){
+    int16_t NumberOfSentBytes;
+    uint16_t CrcCalculated;
+    const uint8_t* OutgoingFramePtr;
+
+	assert(PresentOrder < RTU_PRIMITIVE_ORDER_TOTAL_NUMBER);
+
+	if(RTU_ORDER_SET_VALUE == PresentOrder){
+		// the frame of the last set value is kept, so a repeated value costs neither copying nor CRC calculation;
+		// for a new value the CRC of the constant beginning of the frame is updated with the 2 bytes of the value
+		if(NewValue != CachedSetValue){
+			WriteNewValueFrame[POSITION_OF_VALUE_IN_FRAME] = (uint8_t)(NewValue >> 8);
+			WriteNewValueFrame[POSITION_OF_VALUE_IN_FRAME+1] = (uint8_t)(NewValue & 0xFFu);
+			CrcCalculated = modbusCrcUpdate(FrameCatalogPtr->setValuePrefixCrc, &WriteNewValueFrame[POSITION_OF_VALUE_IN_FRAME], 2);
+			WriteNewValueFrame[POSITION_OF_CRC_IN_FRAME] = (uint8_t)(CrcCalculated & 0xFFu);
+			WriteNewValueFrame[POSITION_OF_CRC_IN_FRAME+1] = (uint8_t)(CrcCalculated >> 8);
+			CachedSetValue = NewValue;
+		}
+		OutgoingFramePtr = WriteNewValueFrame;
+	}
+	else{
+		OutgoingFramePtr = FrameCatalogPtr->requestFrame[PresentOrder];
+	}
+	NumberOfSentBytes = write(BusPtr->getHandler(), OutgoingFramePtr, RTU_REQUEST_FRAME_SIZE);
+	if (-1 == NumberOfSentBytes) {
+		BusPtr->closePort();
+		PresentOrder = RTU_ORDER_NONE;
+		return false;
+	}
+	RequestWriteTime = getMonotonicMicroseconds();
+	captureWireFrame( WIRE_CAPTURE_RTU_REQUEST, (uint8_t)ChannelId, PresentOrder, SlaveAddress, 0,
+			OutgoingFramePtr, RTU_REQUEST_FRAME_SIZE, RequestWriteTime );
+	if (0 != PresentOrderPlacementTime){
+		uint64_t Latency = RequestWriteTime - PresentOrderPlacementTime;
+		OrderToWireLatencyLast = (Latency < 0xFFFFFFFFull)? (uint32_t)Latency : 0xFFFFFFFFul;
+		if (OrderToWireLatencyLast > OrderToWireLatencyMax){
+			OrderToWireLatencyMax = OrderToWireLatencyLast;
+		}
+		TableOfSharedDataForLowLevel[ChannelId].loadOrderToWireLatency( OrderToWireLatencyLast, OrderToWireLatencyMax );
+		PresentOrderPlacementTime = 0;
+	}
+	return true;
+}
+
+// This function checks the response to PresentOrder (located in BufferForModbusFrames) and updates the channel data;
+// NumberOfReceivedBytes equal to -1 means a serial port error; IsFrameInterrupted means the violation of t1.5.
+// It returns true if there was a transmission error
+bool TransmissionChannel::handleResponse( int ChannelId, int16_t NumberOfReceivedBytes, bool IsFrameInterrupted ){
+    bool IsDataTransmissionError;
+    uint8_t ExpectedResponseLength;
+    LastFrameErrorClass FrameErrorCode;
+    const uint8_t* ResponseFramePtr;
+
+	assert(PresentOrder < RTU_PRIMITIVE_ORDER_TOTAL_NUMBER);
+
+	ExpectedResponseLength = FrameCatalogPtr->responseFrameTotalLength[PresentOrder];
+	if (-1 == NumberOfReceivedBytes) {
+		BusPtr->closePort();
+		IsDataTransmissionError = true;
+
+		TableOfSharedDataForLowLevel[ChannelId].loadRstlProtocolData( CommunicationStatesClass::PORT_NOT_OPEN, nullptr,
+				LastFrameErrorClass::UNSPECIFIED, CommunicationMonitor.getErrorPerMille(),
+				CommunicationMonitor.getErrorMaxSequence(), TransmissionAcknowledgement );
+	}
+	else{
+		// Checking the formal correctness of the Modbus frame
+		ResponseFramePtr = (RTU_ORDER_SET_VALUE == PresentOrder)? WriteNewValueFrame : FrameCatalogPtr->knownResponse[PresentOrder];
+		FrameErrorCode = checkRtuResponse( BufferForModbusFrames, NumberOfReceivedBytes, IsFrameInterrupted,
+				ExpectedResponseLength, ResponseFramePtr, FrameCatalogPtr->knownResponseLength[PresentOrder] );
+		IsDataTransmissionError = (LastFrameErrorClass::PERFECTION != FrameErrorCode);
+		if (RTU_ORDER_READING_ALL == PresentOrder){
+			if (!IsDataTransmissionError){
+				ReadingAllFailures = 0;
+			}
+			else if ((0 != NumberOfReceivedBytes) && (++ReadingAllFailures >= READING_ALL_FAILURES_LIMIT)){
+				ReadingAllFailures = 0;
+				SplitReadingsLeft = READING_ALL_BACKOFF_READINGS;
+			}
+		}
+		if (LastFrameErrorClass::PERFECTION != FrameErrorCode){
+			FrameLastError = FrameErrorCode;
 		}
 		else{
-			// Checking the formal correctness of the Modbus frame
-			IsDataTransmissionError = false;
-			FrameErrorCode = LastFrameErrorClass::PERFECTION;
-			if(NumberOfReceivedBytes != ExpectedResponseLength){
-				IsDataTransmissionError = true;
-				if(0 == NumberOfReceivedBytes){
-					FrameErrorCode = LastFrameErrorClass::NO_RESPONSE;
-				}
-				else{
-					FrameErrorCode = LastFrameErrorClass::NOT_COMPLETE_FRAME;
-				}
+			TransmissionAcknowledgement = true;
+		}
+
+		if(IsDataTransmissionError && (0 != NumberOfReceivedBytes)){
+			// in order to reset the Modbus machine after any transmission failure
+			NumberOfReceivedBytes = receiveResponse(BusPtr->getHandler(), BufferForModbusFrames, MODBUS_FRAME_SIZE_MAX);
+			if (-1 == NumberOfReceivedBytes) {
+				BusPtr->closePort();
 			}
-			else{
-				CrcCalculated = crc16(BufferForModbusFrames,NumberOfReceivedBytes-2);
-				if((BufferForModbusFrames[NumberOfReceivedBytes-2] != (uint8_t)(CrcCalculated & 0xFFu) ||
-						(BufferForModbusFrames[NumberOfReceivedBytes-1] != (uint8_t)(CrcCalculated >> 8))))
-				{
-					IsDataTransmissionError = true;
-					FrameErrorCode = LastFrameErrorClass::BAD_CRC;
-				}
-				else{
-					for(J=0; J < FrameInfoTable[PresentOrder].knownResponseLength; J++) {
-						if(BufferForModbusFrames[J] != FrameInfoTable[PresentOrder].responseFramePtr[J]){
-							IsDataTransmissionError = true;
-							FrameErrorCode = LastFrameErrorClass::OTHER_FRAME_ERROR;
-						}
-					}
-				}
+		}
+		if(!IsDataTransmissionError){
+			CommunicationConsecutiveErrors = 0;
+			if(RTU_ORDER_READING_ALL == PresentOrder){
+				decodeRtuRegisters( BufferForModbusFrames, MODBUS_RTU_REGISTERS_AREA, &ModbusRegisters[0] );
 			}
-			if (LastFrameErrorClass::PERFECTION != FrameErrorCode){
-				FrameLastError = FrameErrorCode;
+			if(RTU_ORDER_READING_FIRST == PresentOrder){
+				decodeRtuRegisters( BufferForModbusFrames, READING_REGISTERS_NUMBER, &ModbusRegisters[0] );
 			}
-			else{
-				TransmissionAcknowledgement = true;
+			if((RTU_ORDER_READING_ALL == PresentOrder) || (RTU_ORDER_READING_FIRST == PresentOrder)){
+				// information about updating the register containing the setpoint is needed
+				// in the GUI to protect against fast multiclicking (the buttons '+1A' '-0.1A' ... '-1A')
+				pthread_mutex_lock( &MulticlickMutex );
+				multiclickCountdown( ChannelId );
+				pthread_mutex_unlock( &MulticlickMutex );
 			}
-
-			if(IsDataTransmissionError && (0 != NumberOfReceivedBytes)){
-				// in order to reset the Modbus machine after any transmission failure
-				NumberOfReceivedBytes = receiveResponse(SerialPortHandler, BufferForModbusFrames, MODBUS_FRAME_SIZE_MAX);
-				if (-1 == NumberOfReceivedBytes) {
-					close(SerialPortHandler);
-					SerialPortHandler = -1;
-				}
+			if(RTU_ORDER_READING_LAST == PresentOrder){
+				decodeRtuRegisters( BufferForModbusFrames, READING_REGISTERS_NUMBER, &ModbusRegisters[READING_REGISTERS_NUMBER] );
 			}
-			if(!IsDataTransmissionError){
-				CommunicationConsecutiveErrors = 0;
-				if(RTU_ORDER_READING_FIRST == PresentOrder){
-					for( J=0; J < READING_REGISTERS_NUMBER; J++ ){
-						ModbusRegisters[J] = 256 * (uint16_t)BufferForModbusFrames[POSITION_OF_DATA_IN_FRAME+2*J] +
-								(uint16_t)BufferForModbusFrames[POSITION_OF_DATA_IN_FRAME+2*J+1];
-					}
-
-					// information about updating the register containing the setpoint is needed
-					// in the GUI to protect against fast multiclicking (the buttons '+1A' '-0.1A' ... '-1A')
-					pthread_mutex_t MutexLock = PTHREAD_MUTEX_INITIALIZER;
-					pthread_mutex_lock( &MutexLock );
-					multiclickCountdown();
-					pthread_mutex_unlock( &MutexLock );
-				}
-				if(RTU_ORDER_READING_LAST == PresentOrder){
-					for( J=0; J < READING_REGISTERS_NUMBER; J++ ){
-						ModbusRegisters[J+READING_REGISTERS_NUMBER] =
-								256 * (uint16_t)BufferForModbusFrames[POSITION_OF_DATA_IN_FRAME+2*J] +
-								(uint16_t)BufferForModbusFrames[POSITION_OF_DATA_IN_FRAME+2*J+1];
-					}
-				}
 
-				TableOfSharedDataForLowLevel[ChannelId].loadRstlProtocolData( CommunicationStatesClass::HEALTHY, &ModbusRegisters[0],
-						FrameLastError, CommunicationMonitor.getErrorPerMille(),
-						CommunicationMonitor.getErrorMaxSequence(), TransmissionAcknowledgement );
+			TableOfSharedDataForLowLevel[ChannelId].loadRstlProtocolData( CommunicationStatesClass::HEALTHY, &ModbusRegisters[0],
+					FrameLastError, CommunicationMonitor.getErrorPerMille(),
+					CommunicationMonitor.getErrorMaxSequence(), TransmissionAcknowledgement );
 
 #if 0
-				if(RTU_ORDER_READING_FIRST == PresentOrder){
-					if (ModbusRegisters[MODBUS_ADDRES_CURRENT_FILTERED] > 200){
-						printf("*");
-					}
-					else{
-						printf(".");
-					}
-					fflush( stdout );
+			if(RTU_ORDER_READING_FIRST == PresentOrder){
+				if (ModbusRegisters[MODBUS_ADDRES_CURRENT_FILTERED] > 200){
+					printf("*");
+				}
+				else{
+					printf(".");
 				}
+				fflush( stdout );
+			}
 #endif
 
-			} // if(!IsResponseFrameError)
-			else{
+		} // if(!IsResponseFrameError)
+		else{
 
 #if 0
-				if((CommunicationConsecutiveErrors % 8) == 0){
-					printf("c.err [%d] %d ", ChannelId, CommunicationConsecutiveErrors);
-					fflush( stdout );
-				}
+			if((CommunicationConsecutiveErrors % 8) == 0){
+				printf("c.err [%d] %d ", ChannelId, CommunicationConsecutiveErrors);
+				fflush( stdout );
+			}
 #endif
 
-				if(CommunicationConsecutiveErrors < 255){
-					CommunicationConsecutiveErrors++;
-				}
-				if(CommunicationConsecutiveErrors > COMMUNICATION_ERRORS_TOLERANCE){
-					TableOfSharedDataForLowLevel[ChannelId].loadRstlProtocolData( CommunicationStatesClass::PERMANENT_ERRORS, nullptr,
+			if(CommunicationConsecutiveErrors < 255){
+				CommunicationConsecutiveErrors++;
+			}
+			if(CommunicationConsecutiveErrors > COMMUNICATION_ERRORS_TOLERANCE){
+				TableOfSharedDataForLowLevel[ChannelId].loadRstlProtocolData( CommunicationStatesClass::PERMANENT_ERRORS, nullptr,
+						FrameLastError, CommunicationMonitor.getErrorPerMille(),
+						CommunicationMonitor.getErrorMaxSequence(), TransmissionAcknowledgement );
+			}
+			else{
+				if(CommunicationConsecutiveErrors > COMMUNICATION_WARNING_TOLERANCE){
+					TableOfSharedDataForLowLevel[ChannelId].loadRstlProtocolData( CommunicationStatesClass::TEMPORARY_ERRORS, nullptr,
 							FrameLastError, CommunicationMonitor.getErrorPerMille(),
 							CommunicationMonitor.getErrorMaxSequence(), TransmissionAcknowledgement );
 				}
-				else{
-					if(CommunicationConsecutiveErrors > COMMUNICATION_WARNING_TOLERANCE){
-						TableOfSharedDataForLowLevel[ChannelId].loadRstlProtocolData( CommunicationStatesClass::TEMPORARY_ERRORS, nullptr,
-								FrameLastError, CommunicationMonitor.getErrorPerMille(),
-								CommunicationMonitor.getErrorMaxSequence(), TransmissionAcknowledgement );
-					}
-				}
 			}
-		} // if (-1 == NumberOfReceivedBytes){ ... }else{
-
-		CommunicationMonitor.addSampleAndCalculateStatistics(IsDataTransmissionError);
-
-	} // if(ORDER_NONE != PresentOrder)
-
-	if (-1 == SerialPortHandler){
-		return;
-	}
-
-	usleep(1000);
-
-	// Preparing the order
-	if((FractionOfSecond % 2) == 0){
-		if ( ! TableOfSharedDataForLowLevel[ChannelId].isNewPrimitiveOrder() ){
-			// common situation
-			PresentOrder = RTU_ORDER_READING_LAST;
 		}
-		else{
-			// event coming from GUI
-			PresentOrder = TableOfSharedDataForLowLevel[ChannelId].takePrimitiveOrder( &NewValueUint16 );
-		}
-	}
-	else{
-		PresentOrder = RTU_ORDER_READING_FIRST;
-	}
-
-	// Sending frame
-	if(RTU_ORDER_SET_VALUE == PresentOrder){
-		// put together a frame with a set value
-		memcpy(WriteNewValueFrame,WriteZeroValueFrame,sizeof(WriteNewValueFrame));
-		WriteNewValueFrame[POSITION_OF_VALUE_IN_FRAME] = (uint8_t)(NewValueUint16 >> 8);
-		WriteNewValueFrame[POSITION_OF_VALUE_IN_FRAME+1] = (uint8_t)(NewValueUint16 & 0xFFu);
-		NewValueUint16 = crc16(WriteNewValueFrame,POSITION_OF_CRC_IN_FRAME);
-		WriteNewValueFrame[POSITION_OF_CRC_IN_FRAME] = (uint8_t)(NewValueUint16 & 0xFFu);
-		WriteNewValueFrame[POSITION_OF_CRC_IN_FRAME+1] = (uint8_t)(NewValueUint16 >> 8);
-	}
+	} // if (-1 == NumberOfReceivedBytes){ ... }else{
 
-	NumberOfSentBytes = write(SerialPortHandler, FrameInfoTable[PresentOrder].outgoingFramePtr, FrameInfoTable[PresentOrder].outgoingFrameLength);
-	if (-1 == NumberOfSentBytes) {
-		close(SerialPortHandler);
-		SerialPortHandler = -1;
-		return;
-	}
+	CommunicationMonitor.addSampleAndCalculateStatistics(IsDataTransmissionError);
+	return IsDataTransmissionError;
 }
 
 bool TransmissionChannel::isOpen(void){
-	if (-1 != SerialPortHandler){
-		return true;
-	}
-	return false;
+	return BusPtr->isOpen();
+}
+
+// This function returns true if the power supply has not responded correctly for longer than COMMUNICATION_ERRORS_TOLERANCE
+// (or has not responded at all since the serial port was opened)
+bool TransmissionChannel::isSilentPermanently(void){
+	return (CommunicationConsecutiveErrors > COMMUNICATION_ERRORS_TOLERANCE);
+}
+
+uint8_t TransmissionChannel::getSlaveAddress(void){
+	return SlaveAddress;
 }
 
 uint8_t TransmissionChannel::getPhisicalIdOfPowerSupply(void){
 	return (uint8_t)ModbusRegisters[MODBUS_ADDRES_POWER_SOURCE_ID];
 }
 
+// This function passes the percentiles of the round-trip latencies (for each order and for all of them) to the shared data
+void TransmissionChannel::exportRoundTripStatistics( int ChannelId ){
+	LatencyHistogram AllOrders;
+	LatencySummaryStruct Summary;
+
+	for (uint8_t Order = 0; Order < RTU_PRIMITIVE_ORDER_TOTAL_NUMBER; Order++){
+		RoundTripHistograms[Order].getSummary( &Summary );
+		TableOfSharedDataForLowLevel[ChannelId].loadRoundTripLatency( Order, &Summary );
+		AllOrders.merge( RoundTripHistograms[Order] );
+	}
+	AllOrders.getSummary( &Summary );
+	TableOfSharedDataForLowLevel[ChannelId].loadRoundTripLatency( ROUND_TRIP_ALL_ORDERS, &Summary );
+}
+
+// FilteredCurrent is the register MODBUS_ADDRES_CURRENT_FILTERED taken from RegisterStoreForLowLevel
 PoweringDownActionsClass TransmissionChannel::drivePoweringDownStateMachine( PoweringDownStatesClass *NewPoweringDownStatePtr,
-		bool PossibilityOfPsuShuttingdown, uint8_t PreviewedOrder )
+		bool PossibilityOfPsuShuttingdown, uint8_t PreviewedOrder, uint16_t FilteredCurrent )
 {
 
 #if DEBUG_POWERING_DOWN_STATE_MACHINE
@@ -427,7 +789,7 @@ PoweringDownActionsClass TransmissionChannel::drivePoweringDownStateMachine( Pow
 			if (PoweringDownCounter < POWERING_DOWN_TIMEOUT){
 				PoweringDownCounter++;
 				*NewPoweringDownStatePtr = PoweringDownStatesClass::CURRENT_DECELERATING;
-				if (ModbusRegisters[MODBUS_ADDRES_CURRENT_FILTERED] <= POWERING_DOWN_CURRENT_LIMIT){
+				if (FilteredCurrent <= POWERING_DOWN_CURRENT_LIMIT){
 					return PoweringDownActionsClass::NEW_STATE_PLACE_POWER_OFF;
 				}
 			}
@@ -445,7 +807,7 @@ PoweringDownActionsClass TransmissionChannel::drivePoweringDownStateMachine( Pow
 				if (RTU_ORDER_DELAYED_POWER_OFF == PreviewedOrder){
 					return PoweringDownActionsClass::NEW_STATE_PLACE_POWER_OFF;
 				}
-				if (ModbusRegisters[MODBUS_ADDRES_CURRENT_FILTERED] <= POWERING_DOWN_CURRENT_LIMIT){
+				if (FilteredCurrent <= POWERING_DOWN_CURRENT_LIMIT){
 					return PoweringDownActionsClass::NEW_STATE_PLACE_POWER_OFF;
 				}
 				if (POWERING_DOWN_TIMEOUT+1 == PoweringDownCounter){
@@ -472,9 +834,10 @@ PoweringDownActionsClass TransmissionChannel::drivePoweringDownStateMachine( Pow
 //........................................................................................................
 
 // This function opens and configures a serial port
-static int configureSerialPort(const char *DeviceName){
+static int configureSerialPort(const char *DeviceName, LowLatencyStateClass* LowLatencyStatePtr){
     int FileHandler;
     struct termios PortSettings;
+    struct serial_struct SerialSettings;
 
     FileHandler = open(DeviceName, O_RDWR | O_NOCTTY | O_SYNC);
     if (FileHandler == -1) {
@@ -505,6 +868,19 @@ static int configureSerialPort(const char *DeviceName){
         return -1;
     }
 
+    // the low latency mode shortens the time the bytes wait in the driver (it matters for the detection of silent intervals);
+    // not all drivers support it, so the flag is read back (see SerialBus::getSilenceMargin)
+    *LowLatencyStatePtr = LowLatencyStateClass::NOT_SUPPORTED;
+    if (ioctl(FileHandler, TIOCGSERIAL, &SerialSettings) == 0) {
+        *LowLatencyStatePtr = LowLatencyStateClass::REFUSED;
+        SerialSettings.flags |= ASYNC_LOW_LATENCY;
+        if ((ioctl(FileHandler, TIOCSSERIAL, &SerialSettings) == 0) && (ioctl(FileHandler, TIOCGSERIAL, &SerialSettings) == 0) &&
+        		(0 != (SerialSettings.flags & ASYNC_LOW_LATENCY)))
+        {
+        	*LowLatencyStatePtr = LowLatencyStateClass::SET;
+        }
+    }
+
     return FileHandler;
 }
 
@@ -541,26 +917,131 @@ static int16_t receiveResponse(int FileHandler, uint8_t *FrameBuffer, uint8_t Ex
     return (int16_t)ReceivedBytes1;
 }
 
-// This function calculates crc16 of Modbus type for a given frame
-static uint16_t crc16( const uint8_t *Buffer, uint8_t Length ){
-	uint16_t crc;
-	uint8_t i;
-	uint8_t bit;
+// This function receives a Modbus RTU frame. The beginning of the frame is awaited until the deadline (CLOCK_MONOTONIC);
+// the end of the frame is recognized by the silent interval t3.5 after the last received byte.
+// Each portion of bytes read from the kernel is timestamped; if the silence between two portions is longer
+// than t1.5, the frame is marked as interrupted (such a frame must be discarded).
+// The function returns the number of bytes of the frame (0 if nothing has been received), or -1 on a serial port error
+static int16_t receiveDelimitedFrame(int FileHandler, uint8_t *FrameBuffer, FrameReceptionStruct* ReceptionPtr){
+    struct pollfd PollDescriptor;
+    struct timespec Now, Deadline, Timeout;
+    int Result;
 
-	crc = 0xFFFFu;
-	for( i = 0; i < Length; i++ ){
-		crc ^= (uint16_t)Buffer[i];
-		for( bit = 0; bit < 8; bit++ ){
-			if((crc & 0x0001u) != 0u){
-				crc >>= 1;
-				crc ^= 0xA001u;
-			}
-			else{
-				crc >>= 1;
-			}
+    assert(FileHandler != -1);
+
+	PollDescriptor.fd = FileHandler;
+	PollDescriptor.events = POLLIN;
+
+	while (true){
+		// the deadline does not apply to a frame that has begun; from then on, the end of the frame is awaited
+		calculateReceptionDeadline( ReceptionPtr, &Deadline );
+		clock_gettime(CLOCK_MONOTONIC, &Now);
+		if (!isLater( &Deadline, &Now )){
+			break;		// no frame until the deadline, or the silence t3.5 after the frame
+		}
+		Timeout.tv_sec = Deadline.tv_sec - Now.tv_sec;
+		Timeout.tv_nsec = Deadline.tv_nsec - Now.tv_nsec;
+		if (Timeout.tv_nsec < 0){
+			Timeout.tv_sec--;
+			Timeout.tv_nsec += 1000000000l;
+		}
+		Result = ppoll( &PollDescriptor, 1, &Timeout, nullptr );
+		if (Result < 0){
+			return -1;
 		}
+		if (0 == Result){
+			break;
+		}
+		if (0 != (PollDescriptor.revents & (POLLERR | POLLHUP | POLLNVAL))){
+			return -1;	// e.g. USB adapter unplugged
+		}
+		if (!receiveFramePortion( FileHandler, FrameBuffer, ReceptionPtr )){
+			return -1;
+		}
+	}
+
+#if FRAME_DEBUGGING
+	printf(" <%2d%s> ", ReceptionPtr->totalBytes, ReceptionPtr->isInterrupted? " t1.5" : "");
+#endif
+	return ReceptionPtr->totalBytes;
+}
+
+static bool receiveFramePortion(int FileHandler, uint8_t *FrameBuffer, FrameReceptionStruct* ReceptionPtr){
+    ssize_t ReceivedBytes;
+    struct timespec Now;
+    uint8_t DiscardedBytes[MODBUS_FRAME_SIZE_MAX];
+    int64_t SilenceInMicroseconds;
+
+	if (ReceptionPtr->totalBytes <= MODBUS_FRAME_SIZE_MAX){
+		ReceivedBytes = read(FileHandler, FrameBuffer+ReceptionPtr->totalBytes, MODBUS_FRAME_SIZE_MAX+1-ReceptionPtr->totalBytes);
+	}
+	else{
+		ReceivedBytes = read(FileHandler, DiscardedBytes, sizeof(DiscardedBytes));	// too long frame
+	}
+	if (ReceivedBytes < 0) {
+		return false;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &Now);
+	if (0 != ReceptionPtr->totalBytes){
+		// the silence before the first byte of this portion
+		SilenceInMicroseconds = (int64_t)(Now.tv_sec - ReceptionPtr->lastPortionTime.tv_sec) * 1000000ll +
+				(Now.tv_nsec - ReceptionPtr->lastPortionTime.tv_nsec) / 1000l - (int64_t)ReceivedBytes * MODBUS_RTU_CHARACTER_TIME_US;
+		if (SilenceInMicroseconds > (int64_t)(MODBUS_RTU_INTERCHARACTER_TIMEOUT_US + ReceptionPtr->silenceMarginUs)){
+			ReceptionPtr->isInterrupted = true;
+		}
+	}
+	ReceptionPtr->lastPortionTime = Now;
+	if (ReceptionPtr->totalBytes + ReceivedBytes > MODBUS_FRAME_SIZE_MAX+1){
+		ReceptionPtr->totalBytes = MODBUS_FRAME_SIZE_MAX+1;
+	}
+	else{
+		ReceptionPtr->totalBytes += (int16_t)ReceivedBytes;
+	}
+	return true;
+}
+
+static void calculateReceptionDeadline(const FrameReceptionStruct* ReceptionPtr, struct timespec* DeadlinePtr){
+	if (0 == ReceptionPtr->totalBytes){
+		*DeadlinePtr = ReceptionPtr->firstByteDeadline;
+	}
+	else{
+		*DeadlinePtr = ReceptionPtr->lastPortionTime;
+		addMicroseconds( DeadlinePtr, MODBUS_RTU_INTERFRAME_DELAY_US + ReceptionPtr->silenceMarginUs );
+	}
+}
+
+// This function returns the time needed to send a request and receive the response (including the slave turnaround time)
+static uint32_t transactionTimeout( uint8_t OutgoingFrameLength, uint8_t ResponseFrameLength ){
+	return ((uint32_t)OutgoingFrameLength + (uint32_t)ResponseFrameLength) * MODBUS_RTU_CHARACTER_TIME_US + MODBUS_RTU_SLAVE_TURNAROUND_US;
+}
+
+static void addMicroseconds( struct timespec* TimePtr, uint32_t Microseconds ){
+	TimePtr->tv_sec += Microseconds / 1000000ul;
+	TimePtr->tv_nsec += (long)(Microseconds % 1000000ul) * 1000l;
+	if (TimePtr->tv_nsec >= 1000000000l){
+		TimePtr->tv_sec++;
+		TimePtr->tv_nsec -= 1000000000l;
+	}
+}
+
+// This function returns true if *Time1Ptr is later than *Time2Ptr
+bool isLater( const struct timespec* Time1Ptr, const struct timespec* Time2Ptr ){
+	if (Time1Ptr->tv_sec != Time2Ptr->tv_sec){
+		return Time1Ptr->tv_sec > Time2Ptr->tv_sec;
+	}
+	return Time1Ptr->tv_nsec > Time2Ptr->tv_nsec;
+}
+
+// This function returns the time from *FromPtr to *ToPtr in microseconds (0 if *ToPtr is not later)
+uint32_t microsecondsUntil( const struct timespec* FromPtr, const struct timespec* ToPtr ){
+	int64_t Difference;
+
+	Difference = ((int64_t)ToPtr->tv_sec - (int64_t)FromPtr->tv_sec) * 1000000ll +
+			((int64_t)ToPtr->tv_nsec - (int64_t)FromPtr->tv_nsec) / 1000ll;
+	if (Difference <= 0){
+		return 0;
 	}
-	return crc;
+	return (Difference > (int64_t)UINT32_MAX)? UINT32_MAX : (uint32_t)Difference;
 }
 
 //........................................................................................................
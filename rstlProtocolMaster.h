@@ -10,6 +10,10 @@
 
 #include "modbusTcpSlave.h"
 #include "multiChannel.h"
+#include "rtuFrameCatalog.h"
+#include "linkStatistics.h"
+#include "latencyHistogram.h"
+#include "tickScheduler.h"
 
 //.................................................................................................
 // Preprocessor directives
@@ -38,21 +42,57 @@
 #define MASK_OF_EXT_ERROR_BIT				4
 #define MASK_OF_SUM_ERROR_BIT				8
 
-// This is the frequency of querying the interface for the status of the power current source
-// Some frequencies were tested: 4Hz, 8Hz, 16Hz
+// This is the default frequency of querying the interface for the status of the power current source;
+// it can be changed at runtime with option "-f" (see TickFrequency). Some frequencies were tested: 4Hz, 8Hz, 16Hz
 #define TIME_SYNCHRONIZATION_FREQUENCY		4
 
-#define TRANSMISSION_ERRORS_TABLE			16
+// 1: response-driven transactions; the response is read as soon as it arrives and the next request is sent
+//    immediately afterwards, as long as the time budget of the tick allows (several transactions per tick)
+// 0: the response is read in the next tick (one transaction per tick)
+#define RTU_RESPONSE_DRIVEN_TRANSACTIONS	1
 
-#define COMMUNICATION_WARNING_TOLERANCE	(1*TIME_SYNCHRONIZATION_FREQUENCY)
-#define COMMUNICATION_ERRORS_TOLERANCE	(4*TIME_SYNCHRONIZATION_FREQUENCY)
+// The part of the tick period that can be used for Modbus RTU transactions in the response-driven mode;
+// the rest is left for the data synchronization between threads
+#define RTU_TRANSACTIONS_TIME_BUDGET_PERCENT	70
+
+// After the data synchronization at the end of the tick, the orders which came during the tick are sent
+// in an additional pass (only the orders, no readings) that can use this part of the tick period
+#define RTU_ORDERS_PASS_TIME_BUDGET_PERCENT	25
+
+// The maximum number of power supplies sharing one serial port (the scheduler makes one pass over them per tick)
+#define SERIAL_BUS_MEMBERS_MAX_NUMBER		32
+
+// The margin added to the silent intervals t1.5 and t3.5 measured on the host side (see SerialBus::getSilenceMargin);
+// it can be given for each serial port in the configuration file ('margines', microseconds)
+#define SILENCE_MARGIN_AUTOMATIC			0xFFFFFFFFul
+#define SILENCE_MARGIN_MAX_US				100000ul
+
+// The number of the last transactions taken into account in the statistics of transmission errors;
+// a power of 2, for instance 512, 4096 or 65536 (the cost of a sample does not depend on it)
+#define TRANSMISSION_ERRORS_WINDOW			512
+
+// The index of the summary of the round-trip latencies of all the orders (see TransmissionChannel::exportRoundTripStatistics)
+#define ROUND_TRIP_ALL_ORDERS				RTU_PRIMITIVE_ORDER_TOTAL_NUMBER
+
+// The unit of the round-trip latency registers of Modbus TCP (0.1 ms)
+#define ROUND_TRIP_REGISTER_UNIT_US			100
+
+#define MODBUS_FRAME_SIZE_MAX				40
+#define MODBUS_FRAME_SIZE_READING_ALL		33
+#define WRITE_NEW_VALUE_FRAME_SIZE			8
+
+// The tolerances are given in ticks (1 and 4 seconds)
+#define COMMUNICATION_WARNING_TOLERANCE_IN_SECONDS	1
+#define COMMUNICATION_ERRORS_TOLERANCE_IN_SECONDS	4
+#define COMMUNICATION_WARNING_TOLERANCE	(COMMUNICATION_WARNING_TOLERANCE_IN_SECONDS*TickFrequency)
+#define COMMUNICATION_ERRORS_TOLERANCE	(COMMUNICATION_ERRORS_TOLERANCE_IN_SECONDS*TickFrequency)
 
 
 #define DEBUG_POWERING_DOWN_STATE_MACHINE	0
 
 
-static_assert(COMMUNICATION_WARNING_TOLERANCE < COMMUNICATION_ERRORS_TOLERANCE, "assert: COMMUNICATION_WARNING_TOLERANCE");
-static_assert(COMMUNICATION_ERRORS_TOLERANCE <= 255, "assert: COMMUNICATION_ERRORS_TOLERANCE");
+static_assert(COMMUNICATION_WARNING_TOLERANCE_IN_SECONDS < COMMUNICATION_ERRORS_TOLERANCE_IN_SECONDS, "assert: COMMUNICATION_WARNING_TOLERANCE");
+static_assert(COMMUNICATION_ERRORS_TOLERANCE_IN_SECONDS * TICK_FREQUENCY_MAX < 255, "assert: COMMUNICATION_ERRORS_TOLERANCE");
 
 //.................................................................................................
 // Definitions of types
@@ -92,10 +132,7 @@ enum class PoweringDownActionsClass{
 
 class TransmissionErrorsMonitor {
 private:
-	uint32_t TransmissionErrorsHistory[TRANSMISSION_ERRORS_TABLE]; // This is a bit field, where '1' = transmission error, '0' = correct response
-	uint16_t TransmissionErrorsHead;	// bit index, where a current value will be written
-	uint16_t TransmissionErrorsValue;	// percentage of errors
-	uint16_t TransmissionErrorsSequence;// the longest sequence of errors
+	SlidingErrorStatistics<TRANSMISSION_ERRORS_WINDOW> Statistics;
 public:
 	TransmissionErrorsMonitor();
 	void addSampleAndCalculateStatistics(bool New);
@@ -103,36 +140,167 @@ public:
 	uint16_t getErrorMaxSequence(void);
 };
 
+// The priority classes of the transmit scheduler (lower value = higher priority)
+enum class OrderPriorityClass{
+	SAFETY				= 0,	// RTU_ORDER_POWER_OFF and current zeroing (RTU_ORDER_SET_VALUE with the value 0)
+	SETPOINT			= 1,	// RTU_ORDER_SET_VALUE, RTU_ORDER_POWER_ON
+	STATUS_READING		= 2,	// the readings fill the remaining time of the serial line
+	NUMBER_OF_CLASSES	= 3
+};
+
+// An order waiting in the priority lane of the channel
+struct PendingOrderStruct{
+	uint8_t order;				// RTU_ORDER_NONE if the slot is empty
+	uint16_t value;
+	uint64_t placementTime;		// CLOCK_MONOTONIC in microseconds
+};
+
+// The result of a single Modbus RTU transaction in the response-driven mode
+enum class TransactionResultClass{
+	DONE				= 0,	// the response was correct; the next transaction can follow
+	FAILED				= 1,	// transmission error; the power supply will not be asked again in this tick
+	NO_TIME				= 2,	// the transaction was not started, because the time budget of the tick is exhausted
+	PORT_CLOSED			= 3,
+	STARTED				= 4		// the request has been sent and the response is awaited (see beginTransaction)
+};
+
+// The result of requesting the low latency mode of the serial port driver (ASYNC_LOW_LATENCY)
+enum class LowLatencyStateClass{
+	SET					= 0,
+	REFUSED				= 1,	// the driver has rejected the flag (e.g. USB adapter that buffers the bytes for its latency timer)
+	NOT_SUPPORTED		= 2		// the device has no serial settings (e.g. pseudo-terminal)
+};
+
+// The reception of a Modbus RTU frame delimited by the silent interval t3.5; the frame is received in portions,
+// as the bytes arrive, so that the responses of several serial ports can be awaited at the same time
+struct FrameReceptionStruct{
+	int16_t totalBytes;
+	bool isInterrupted;					// the silent interval t1.5 has been violated within the frame
+	struct timespec firstByteDeadline;	// CLOCK_MONOTONIC
+	struct timespec lastPortionTime;	// the end of the frame so far
+	uint32_t silenceMarginUs;			// see SerialBus::getSilenceMargin
+};
+
+// This class is associated with each serial port (RS-485 line) declared in the configuration file.
+// Several power supplies with different Modbus slave addresses can share the line (multi-drop);
+// the transactions with them are interleaved by the bus scheduler (see communicateSerialBus in multiChannel.cpp)
+class SerialBus {
+private:
+	std::string PortName;
+	int SerialPortHandler;
+	uint8_t NumberOfMembers;
+	uint8_t MemberChannels[SERIAL_BUS_MEMBERS_MAX_NUMBER];	// indexes of the channels of the power supplies on this line
+	uint8_t FirstMemberOfRound;							// it rotates every tick, so that no power supply is favoured
+	bool IsDeviceWatched;			// the directory of the device node is watched (see deviceWatcher.h)
+	bool IsDeviceAbsent;			// the device node did not exist at the last attempt to open the serial port
+	bool IsDeviceEventPending;		// the device node has appeared or changed since the last attempt
+	struct timespec SilenceEnd;		// the end of the silent interval t3.5 after the last transaction (CLOCK_MONOTONIC)
+	uint32_t ConfiguredSilenceMarginUs;			// 'margines' from the configuration file or SILENCE_MARGIN_AUTOMATIC
+	LowLatencyStateClass LowLatencyState;		// set when the serial port is opened
+public:
+	SerialBus();
+	~SerialBus();
+	bool open(void);
+	void closePort(void);
+	bool isOpen(void);
+	int getHandler(void);
+	std::string* getPortNamePtr(void);
+	uint8_t getNumberOfMembers(void);
+	uint8_t getMemberChannel( uint8_t MemberIndex );
+	uint8_t takeFirstMemberOfRound(void);
+	void setDeviceWatched( bool IsWatched );
+	void notifyDeviceEvent(void);
+	bool isReopeningDue( bool IsNewSecond );
+	void noteEndOfTransaction(void);
+	const struct timespec* getSilenceEnd(void);
+	LowLatencyStateClass getLowLatencyState(void);
+	uint32_t getSilenceMargin(void);
+
+	friend uint8_t configurationFileParsing(void);
+};
+
 // This class is associated with each power supply.
 // It represents the state of the serial link and the state of the power supply itself.
 // The number of objects of this type is specified in the configuration file.
-class TransmissionChannel {
+// The objects are used by different polling workers, so each of them starts at a cache line.
+class alignas(CACHE_LINE_SIZE) TransmissionChannel {
 private:
 	uint16_t PowerSupplyExpectedId;
-	std::string PortName;
 	std::string Descriptor;
-	int SerialPortHandler;
+	SerialBus* BusPtr;				// the serial port may be shared with other power supplies
+	uint8_t SlaveAddress;
 	uint8_t CommunicationConsecutiveErrors;
 	bool TransmissionAcknowledgement;
 	LastFrameErrorClass FrameLastError;
 	uint16_t ModbusRegisters[MODBUS_RTU_REGISTERS_AREA];
 	TransmissionErrorsMonitor CommunicationMonitor;
 	uint8_t PresentOrder;
+	uint8_t PreviousReadingOrder;	// the halves of the register area are read alternately (see planReading)
+	uint8_t ReadingAllFailures;		// consecutive corrupted responses to RTU_ORDER_READING_ALL
+	uint8_t SplitReadingsLeft;		// the number of readings of the halves before RTU_ORDER_READING_ALL is tried again
+
+	// Priority lane: the orders accepted from the upper layer wait here for the serial line, one slot per priority class
+	// (a newer order of the same class replaces the older one)
+	PendingOrderStruct PendingOrders[(int)OrderPriorityClass::STATUS_READING];
+	uint64_t PresentOrderPlacementTime;	// 0 if PresentOrder is a routine reading
+	uint32_t OrderToWireLatencyLast;	// microseconds
+	uint32_t OrderToWireLatencyMax;		// microseconds
+
+	// Round-trip latencies (from writing the request to the end of the response) of the correct transactions,
+	// one histogram per primitive order; they are collected in the response-driven mode only
+	LatencyHistogram RoundTripHistograms[RTU_PRIMITIVE_ORDER_TOTAL_NUMBER];
+	uint64_t RequestWriteTime;			// CLOCK_MONOTONIC in microseconds
+
+	// The frames of the slave address of the power supply (generated at compile time)
+	const RtuFrameCatalog* FrameCatalogPtr;
+
+	// The buffers are owned by the channel, because the channels are served by several polling workers at the same time;
+	// WriteNewValueFrame holds the frame of the last set value (CachedSetValue)
+	uint8_t WriteNewValueFrame[WRITE_NEW_VALUE_FRAME_SIZE];
+	uint16_t CachedSetValue;
+	uint8_t BufferForModbusFrames[MODBUS_FRAME_SIZE_MAX+2];
+	FrameReceptionStruct Reception;
 
 	// positive number: counting (from 0 upwards) from pressing the power supply shutdown button;
 	// negative number: inactive status
 	int16_t PoweringDownCounter;
+
+	bool sendRequest( int ChannelId, uint16_t NewValue );
+	uint8_t takePendingOrder( uint16_t* ValuePtr );
+	uint8_t planReading( uint32_t AvailableTimeUs );
+	bool handleResponse( int ChannelId, int16_t NumberOfReceivedBytes, bool IsFrameInterrupted );
 public:
 	TransmissionChannel();
 	~TransmissionChannel();
 	void open( int ChannelId );
+	void assignSerialBus( SerialBus* NewBusPtr, uint8_t NewSlaveAddress );
+	void acceptNewOrder( int ChannelId );
+	OrderPriorityClass getPendingPriority(void);
 	void singleInquiryOfSlave( int ChannelId );
+	TransactionResultClass transactionWithSlave( int ChannelId, const struct timespec* TickDeadlinePtr );
+	TransactionResultClass beginTransaction( int ChannelId, const struct timespec* TickDeadlinePtr, bool IsSilenceAwaited );
+	bool continueReception(void);
+	void getReceptionDeadline( struct timespec* DeadlinePtr );
+	TransactionResultClass completeTransaction( int ChannelId, bool IsPortError );
 	bool isOpen(void);
+	bool isSilentPermanently(void);
+	uint8_t getSlaveAddress(void);
 	uint8_t getPhisicalIdOfPowerSupply(void);
+	void exportRoundTripStatistics( int ChannelId );
 	PoweringDownActionsClass drivePoweringDownStateMachine( PoweringDownStatesClass *NewPoweringDownStatePtr,
-			bool PossibilityOfPsuShuttingdown, uint8_t PreviewedOrder );
+			bool PossibilityOfPsuShuttingdown, uint8_t PreviewedOrder, uint16_t FilteredCurrent );
 
 	friend uint8_t configurationFileParsing(void);
 };
 
+//.................................................................................................
+// Global function prototypes
+//.................................................................................................
+
+// This function returns true if *Time1Ptr is later than *Time2Ptr
+bool isLater( const struct timespec* Time1Ptr, const struct timespec* Time2Ptr );
+
+// This function returns the time from *FromPtr to *ToPtr in microseconds (0 if *ToPtr is not later)
+uint32_t microsecondsUntil( const struct timespec* FromPtr, const struct timespec* ToPtr );
+
 #endif // RSTLPROTOCOLMASTER_H_
@@ -0,0 +1,139 @@
+// rtuFrameCatalog.h
+//
+// Threads: any (the catalog is a constant generated at compile time)
+//
+// This module generates the Modbus RTU request frames of the RSTL protocol master (together with their CRCs)
+// and the known beginnings of the expected responses, for every slave address and for a given register window.
+// Modbus commands are prepared in such a way that the response to a given command cannot be mistaken
+// with the response to another command (the numbers of data bytes of the responses are different).
+
+#ifndef RTUFRAMECATALOG_H_
+#define RTUFRAMECATALOG_H_
+
+#include <inttypes.h>
+
+#include "modbusTcpSlave.h"
+
+//.................................................................................................
+// Preprocessor directives
+//.................................................................................................
+
+#define RTU_SLAVE_ADDRESS_MIN				1
+#define RTU_SLAVE_ADDRESS_MAX				247
+#define RTU_DEFAULT_SLAVE_ADDRESS			1
+
+// The register window of the power supply interface: the first register holds the power on/off state,
+// the next one holds the setpoint
+#define RTU_REGISTERS_WINDOW_START			1000
+
+#define RTU_FUNCTION_READ_HOLDING_REGISTERS	0x03
+#define RTU_FUNCTION_WRITE_SINGLE_REGISTER	0x06
+
+#define RTU_REQUEST_FRAME_SIZE				8	// both the reading command and the command to write a single register
+#define RTU_RESPONSE_HEADER_SIZE			3	// slave address, function code, number of data bytes
+#define RTU_CRC_SIZE						2
+
+#define POSITION_OF_VALUE_IN_FRAME			4	// this refers to the command to write a single register
+#define POSITION_OF_CRC_IN_FRAME			6
+
+// The size of the response to the reading of a given number of registers
+#define RTU_READING_RESPONSE_SIZE(n)		(RTU_RESPONSE_HEADER_SIZE + 2*(n) + RTU_CRC_SIZE)
+
+//.................................................................................................
+// Definitions of types
+//.................................................................................................
+
+// The frames related to the primitive orders (see RTU_ORDER_READING_ALL and so on) for a single slave address;
+// the request of RTU_ORDER_SET_VALUE is the frame with the value 0
+struct RtuFrameCatalog{
+	uint8_t requestFrame[RTU_PRIMITIVE_ORDER_TOTAL_NUMBER][RTU_REQUEST_FRAME_SIZE];
+	uint8_t knownResponse[RTU_PRIMITIVE_ORDER_TOTAL_NUMBER][RTU_REQUEST_FRAME_SIZE];
+	uint8_t knownResponseLength[RTU_PRIMITIVE_ORDER_TOTAL_NUMBER];
+	uint8_t responseFrameTotalLength[RTU_PRIMITIVE_ORDER_TOTAL_NUMBER];
+
+	// The CRC of the first 4 bytes of the setpoint frame (slave address, function code, register address);
+	// the CRC of the whole frame is obtained by updating this value with the 2 bytes of the setpoint
+	uint16_t setValuePrefixCrc;
+};
+
+// The catalogs for all the slave addresses; the frames of the register window starting at WindowStart
+// and having WindowSize registers are divided into two overlapping halves (RTU_ORDER_READING_FIRST, RTU_ORDER_READING_LAST)
+template <uint16_t WindowStart, uint8_t WindowSize>
+class RtuFrameCatalogTable{
+public:
+	static constexpr uint8_t FirstHalfSize = WindowSize/2 + 1;
+	static constexpr uint16_t SecondHalfStart = WindowStart + WindowSize/2;
+	static constexpr uint8_t SecondHalfSize = WindowSize - WindowSize/2;
+
+	static_assert( RTU_READING_RESPONSE_SIZE(WindowSize) <= 255, "assert: the register window is too large" );
+	static_assert( (2*FirstHalfSize != 2*SecondHalfSize) && (2*FirstHalfSize != 2*WindowSize),
+			"assert: the responses to the reading commands must be distinguishable" );
+
+	RtuFrameCatalog catalog[RTU_SLAVE_ADDRESS_MAX+1];	// the index is the slave address
+
+	constexpr RtuFrameCatalogTable() : catalog{} {
+		for (int Address = RTU_SLAVE_ADDRESS_MIN; Address <= RTU_SLAVE_ADDRESS_MAX; Address++){
+			fillCatalog( catalog[Address], (uint8_t)Address );
+		}
+	}
+
+	constexpr const RtuFrameCatalog& operator[]( uint8_t SlaveAddress ) const {
+		return catalog[SlaveAddress];
+	}
+
+	// This function calculates CRC16 of Modbus type at compile time
+	static constexpr uint16_t crc16( const uint8_t *Buffer, uint8_t Length ){
+		uint16_t Crc = 0xFFFFu;
+		for (uint8_t J = 0; J < Length; J++){
+			Crc ^= (uint16_t)Buffer[J];
+			for (uint8_t Bit = 0; Bit < 8; Bit++){
+				Crc = ((Crc & 0x0001u) != 0u)? (uint16_t)((Crc >> 1) ^ 0xA001u) : (uint16_t)(Crc >> 1);
+			}
+		}
+		return Crc;
+	}
+
+private:
+	static constexpr void buildRequest( uint8_t *Frame, uint8_t SlaveAddress, uint8_t Function, uint16_t Register, uint16_t Value ){
+		Frame[0] = SlaveAddress;
+		Frame[1] = Function;
+		Frame[2] = (uint8_t)(Register >> 8);
+		Frame[3] = (uint8_t)(Register & 0xFFu);
+		Frame[POSITION_OF_VALUE_IN_FRAME] = (uint8_t)(Value >> 8);
+		Frame[POSITION_OF_VALUE_IN_FRAME+1] = (uint8_t)(Value & 0xFFu);
+		uint16_t Crc = crc16( Frame, POSITION_OF_CRC_IN_FRAME );
+		Frame[POSITION_OF_CRC_IN_FRAME] = (uint8_t)(Crc & 0xFFu);
+		Frame[POSITION_OF_CRC_IN_FRAME+1] = (uint8_t)(Crc >> 8);
+	}
+
+	static constexpr void buildReading( RtuFrameCatalog& Catalog, uint8_t Order, uint8_t SlaveAddress, uint16_t Register, uint8_t Number ){
+		buildRequest( Catalog.requestFrame[Order], SlaveAddress, RTU_FUNCTION_READ_HOLDING_REGISTERS, Register, Number );
+		Catalog.knownResponse[Order][0] = SlaveAddress;
+		Catalog.knownResponse[Order][1] = RTU_FUNCTION_READ_HOLDING_REGISTERS;
+		Catalog.knownResponse[Order][2] = (uint8_t)(2*Number);
+		Catalog.knownResponseLength[Order] = RTU_RESPONSE_HEADER_SIZE;
+		Catalog.responseFrameTotalLength[Order] = RTU_READING_RESPONSE_SIZE(Number);
+	}
+
+	// the response to the command to write a single register is the echo of the request
+	static constexpr void buildWriting( RtuFrameCatalog& Catalog, uint8_t Order, uint8_t SlaveAddress, uint16_t Register, uint16_t Value ){
+		buildRequest( Catalog.requestFrame[Order], SlaveAddress, RTU_FUNCTION_WRITE_SINGLE_REGISTER, Register, Value );
+		for (uint8_t J = 0; J < RTU_REQUEST_FRAME_SIZE; J++){
+			Catalog.knownResponse[Order][J] = Catalog.requestFrame[Order][J];
+		}
+		Catalog.knownResponseLength[Order] = RTU_REQUEST_FRAME_SIZE;
+		Catalog.responseFrameTotalLength[Order] = RTU_REQUEST_FRAME_SIZE;
+	}
+
+	static constexpr void fillCatalog( RtuFrameCatalog& Catalog, uint8_t SlaveAddress ){
+		buildReading( Catalog, RTU_ORDER_READING_ALL, SlaveAddress, WindowStart, WindowSize );
+		buildReading( Catalog, RTU_ORDER_READING_FIRST, SlaveAddress, WindowStart, FirstHalfSize );
+		buildReading( Catalog, RTU_ORDER_READING_LAST, SlaveAddress, SecondHalfStart, SecondHalfSize );
+		buildWriting( Catalog, RTU_ORDER_POWER_ON, SlaveAddress, WindowStart, 1 );
+		buildWriting( Catalog, RTU_ORDER_POWER_OFF, SlaveAddress, WindowStart, 0 );
+		buildWriting( Catalog, RTU_ORDER_SET_VALUE, SlaveAddress, WindowStart+1, 0 );
+		Catalog.setValuePrefixCrc = crc16( Catalog.requestFrame[RTU_ORDER_SET_VALUE], POSITION_OF_VALUE_IN_FRAME );
+	}
+};
+
+#endif // RTUFRAMECATALOG_H_
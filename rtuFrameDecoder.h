@@ -0,0 +1,52 @@
+// rtuFrameDecoder.h
+//
+// Threads: any (the functions are reentrant)
+//
+// This module checks and decodes the Modbus RTU responses of the power supplies. It is used by the RTU master
+// (TransmissionChannel::handleResponse) and by the replay of the wire capture (tools/wireReplay.cpp),
+// so that a captured frame is judged in exactly the same way as it was judged on the line.
+
+#ifndef RTUFRAMEDECODER_H_
+#define RTUFRAMEDECODER_H_
+
+#include <inttypes.h>
+#include "modbusCrc.h"
+#include "rtuFrameCatalog.h"
+#include "rstlProtocolMaster.h"
+
+//.................................................................................................
+// Function definitions
+//.................................................................................................
+
+// This function checks the formal correctness of a response frame: its length, the silent intervals within it (t1.5),
+// the CRC and its known beginning (for the command to write a single register: the echo of the request).
+// It returns LastFrameErrorClass::PERFECTION if the frame is correct
+inline LastFrameErrorClass checkRtuResponse( const uint8_t* Frame, int16_t Length, bool IsInterrupted,
+		uint8_t ExpectedLength, const uint8_t* KnownResponse, uint8_t KnownResponseLength )
+{
+	LastFrameErrorClass FrameErrorCode = LastFrameErrorClass::PERFECTION;
+	uint16_t CrcCalculated;
+
+	if ((Length != ExpectedLength) || IsInterrupted){
+		return (0 == Length)? LastFrameErrorClass::NO_RESPONSE : LastFrameErrorClass::NOT_COMPLETE_FRAME;
+	}
+	CrcCalculated = modbusCrc16( Frame, (size_t)Length - RTU_CRC_SIZE );
+	if ((Frame[Length-2] != (uint8_t)(CrcCalculated & 0xFFu)) || (Frame[Length-1] != (uint8_t)(CrcCalculated >> 8))){
+		return LastFrameErrorClass::BAD_CRC;
+	}
+	for (uint8_t J = 0; J < KnownResponseLength; J++){
+		if (Frame[J] != KnownResponse[J]){
+			FrameErrorCode = LastFrameErrorClass::OTHER_FRAME_ERROR;
+		}
+	}
+	return FrameErrorCode;
+}
+
+// This function decodes the registers of a correct response to a reading command
+inline void decodeRtuRegisters( const uint8_t* Frame, uint8_t NumberOfRegisters, uint16_t* Registers ){
+	for (uint8_t J = 0; J < NumberOfRegisters; J++){
+		Registers[J] = 256 * (uint16_t)Frame[RTU_RESPONSE_HEADER_SIZE+2*J] + (uint16_t)Frame[RTU_RESPONSE_HEADER_SIZE+2*J+1];
+	}
+}
+
+#endif /* RTUFRAMEDECODER_H_ */
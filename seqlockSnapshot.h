@@ -0,0 +1,76 @@
+// seqlockSnapshot.h
+//
+// Threads: one writer thread, any number of reader threads
+//
+// This template passes a snapshot of data from one thread to other threads without locks (a seqlock).
+// The sequence number is odd while the data is being written; a reader copies what it needs and repeats
+// the copy if the sequence number was odd or has changed in the meantime, so it never gets a mixture of two
+// publications. The data is copied as raw memory, so it must be trivially copyable.
+
+#ifndef SEQLOCKSNAPSHOT_H_
+#define SEQLOCKSNAPSHOT_H_
+
+#include <inttypes.h>
+#include <string.h>
+#include <atomic>
+#include <type_traits>
+
+//.................................................................................................
+// Definitions of types
+//.................................................................................................
+
+template <typename DataType>
+class SeqlockSnapshot{
+private:
+	std::atomic<uint32_t> Sequence;
+	DataType Data;
+
+	static_assert( std::is_trivially_copyable<DataType>::value, "assert: SeqlockSnapshot needs a trivially copyable type" );
+
+public:
+	// The sequence number starts even (nothing is being written), also in the objects allocated by new[]
+	SeqlockSnapshot() : Sequence( 0 ), Data() {}
+
+	// Writer thread only
+	void publish( const DataType* SourcePtr ){
+		uint32_t NewSequence = Sequence.load( std::memory_order_relaxed ) + 1;
+
+		Sequence.store( NewSequence, std::memory_order_relaxed );	// odd: the readers have to wait
+		std::atomic_thread_fence( std::memory_order_release );
+		memcpy( (void*)&Data, (const void*)SourcePtr, sizeof(DataType) );
+		Sequence.store( NewSequence + 1, std::memory_order_release );
+	}
+
+	// Writer thread only; the data can be read without the sequence number, because no other thread writes it
+	const DataType* getPublishedData(){
+		return &Data;
+	}
+
+	// This function returns the sequence number of the snapshot that has been copied
+	uint32_t read( DataType* DestinationPtr ){
+		return readPart( [DestinationPtr]( const DataType* DataPtr ){
+			memcpy( (void*)DestinationPtr, (const void*)DataPtr, sizeof(DataType) );
+		});
+	}
+
+	// This function calls Reader( const DataType* ) until it has read one publication;
+	// the reader must not keep the pointer or anything else it has read before the last call
+	template <typename ReaderType>
+	uint32_t readPart( ReaderType Reader ){
+		uint32_t SequenceBefore, SequenceAfter;
+
+		do{
+			SequenceBefore = Sequence.load( std::memory_order_acquire );
+			Reader( (const DataType*)&Data );
+			std::atomic_thread_fence( std::memory_order_acquire );
+			SequenceAfter = Sequence.load( std::memory_order_relaxed );
+		} while ((0 != (SequenceBefore & 1)) || (SequenceBefore != SequenceAfter));
+		return SequenceBefore;
+	}
+
+	uint32_t getSequence(){
+		return Sequence.load( std::memory_order_acquire );
+	}
+};
+
+#endif /* SEQLOCKSNAPSHOT_H_ */
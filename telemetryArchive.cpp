@@ -0,0 +1,251 @@
+// telemetryArchive.cpp
+//
+// Threads: see telemetryArchive.h
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <errno.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "modbusCrc.h"
+#include "telemetryArchive.h"
+
+//.................................................................................................
+// Preprocessor directives
+//.................................................................................................
+
+static_assert( sizeof(TelemetryRecordStruct) == TELEMETRY_ARCHIVE_RECORD_SIZE, "assert: TelemetryRecordStruct" );
+static_assert( (MODBUS_TCP_ADDRESS_ORDER_VALUE == MODBUS_TCP_ADDRESS_ORDER_CODE+1) &&
+		(MODBUS_TCP_SECTOR_READING_SIZE == MODBUS_TCP_SECTOR_SIZE-2), "assert: the registers of the order in TelemetryRecordStruct" );
+static_assert( sizeof(TelemetrySegmentHeaderStruct) <= TELEMETRY_ARCHIVE_HEADER_SIZE, "assert: TelemetrySegmentHeaderStruct" );
+static_assert( 0 == TELEMETRY_ARCHIVE_WRITEBACK_SIZE % TELEMETRY_ARCHIVE_RECORD_SIZE, "assert: TELEMETRY_ARCHIVE_WRITEBACK_SIZE" );
+
+//.................................................................................................
+// Local variables
+//.................................................................................................
+
+// They are set by initializeTelemetryArchive, before the peripheral thread starts
+static char ArchiveDirectory[PATH_MAX];
+static bool IsArchiveEnabled;
+static uint32_t NextSegmentNumber;
+
+// The segment being written; peripheral thread
+static int SegmentFileHandler = -1;
+static TelemetrySegmentHeaderStruct* SegmentHeaderPtr;
+static TelemetryRecordStruct* SegmentRecords;
+static uint64_t WritebackOffset;		// bytes; the writeback of the segment has been started up to here
+
+//.................................................................................................
+// Local function prototypes
+//.................................................................................................
+
+static bool startSegment( void );
+static void closeSegment( void );
+static void deleteSegment( uint32_t SegmentNumber );
+
+static uint64_t getMicroseconds( clockid_t Clock );
+
+//.................................................................................................
+// Function definitions
+//.................................................................................................
+
+bool initializeTelemetryArchive( const char* DirectoryName ){
+	uint32_t NewestSegmentNumber = 0;
+	DIR* DirectoryPtr;
+	struct dirent* EntryPtr;
+
+	IsArchiveEnabled = false;
+	if (strlen( DirectoryName ) + 32 >= sizeof(ArchiveDirectory)){
+		return false;
+	}
+	strcpy( ArchiveDirectory, DirectoryName );
+	if ((0 != mkdir( ArchiveDirectory, 0755 )) && (EEXIST != errno)){
+		return false;
+	}
+	DirectoryPtr = opendir( ArchiveDirectory );
+	if (nullptr == DirectoryPtr){
+		return false;
+	}
+	while (nullptr != (EntryPtr = readdir( DirectoryPtr ))){
+		uint32_t SegmentNumber = parseTelemetrySegmentFileName( EntryPtr->d_name );
+		if (SegmentNumber > NewestSegmentNumber){
+			NewestSegmentNumber = SegmentNumber;
+		}
+	}
+	rewinddir( DirectoryPtr );
+	// the new segment is one of the segments kept
+	while (nullptr != (EntryPtr = readdir( DirectoryPtr ))){
+		uint32_t SegmentNumber = parseTelemetrySegmentFileName( EntryPtr->d_name );
+		if ((0 != SegmentNumber) && (SegmentNumber + TELEMETRY_ARCHIVE_SEGMENTS_MAX <= NewestSegmentNumber + 1)){
+			deleteSegment( SegmentNumber );
+		}
+	}
+	closedir( DirectoryPtr );
+
+	NextSegmentNumber = NewestSegmentNumber + 1;
+	IsArchiveEnabled = true;
+	return true;
+}
+
+void appendTelemetryRecord( uint8_t Channel, const uint16_t* RegistersPtr, uint64_t MonotonicTimestamp ){
+	TelemetryRecordStruct Record;
+	uint64_t Index, EndOffset;
+
+	if (!IsArchiveEnabled){
+		return;
+	}
+	if ((nullptr != SegmentHeaderPtr) && (TELEMETRY_ARCHIVE_CAPACITY == SegmentHeaderPtr->recordCount)){
+		closeSegment();
+	}
+	if ((nullptr == SegmentHeaderPtr) && !startSegment()){
+		IsArchiveEnabled = false;
+		return;
+	}
+	Index = SegmentHeaderPtr->recordCount;
+
+	Record.channel = Channel;
+	Record.reserved = 0;
+	Record.sequence = (uint32_t)(Index + 1);
+	Record.timestamp = SegmentHeaderPtr->realtimeAtStart +
+			(int64_t)((MonotonicTimestamp > SegmentHeaderPtr->monotonicAtStart)? MonotonicTimestamp - SegmentHeaderPtr->monotonicAtStart : 0);
+	memcpy( Record.registers, RegistersPtr, MODBUS_TCP_ADDRESS_ORDER_CODE * sizeof(uint16_t) );
+	memcpy( &Record.registers[MODBUS_TCP_ADDRESS_ORDER_CODE], &RegistersPtr[MODBUS_TCP_ADDRESS_ORDER_VALUE+1],
+			(MODBUS_TCP_SECTOR_SIZE - MODBUS_TCP_ADDRESS_ORDER_VALUE - 1) * sizeof(uint16_t) );
+	Record.checksum = calculateTelemetryChecksum( &Record );
+
+	// the number of the records is updated after the record, so a record counted in the header is complete
+	memcpy( &SegmentRecords[Index], &Record, sizeof(Record) );
+	__atomic_store_n( &SegmentHeaderPtr->recordCount, Index + 1, __ATOMIC_RELEASE );
+
+	EndOffset = TELEMETRY_ARCHIVE_HEADER_SIZE + (Index + 1) * TELEMETRY_ARCHIVE_RECORD_SIZE;
+	if (EndOffset - WritebackOffset >= TELEMETRY_ARCHIVE_WRITEBACK_SIZE){
+		// the writeback is only started; the disk is not waited for
+		(void)sync_file_range( SegmentFileHandler, (off64_t)WritebackOffset, (off64_t)(EndOffset - WritebackOffset), SYNC_FILE_RANGE_WRITE );
+		(void)sync_file_range( SegmentFileHandler, 0, TELEMETRY_ARCHIVE_HEADER_SIZE, SYNC_FILE_RANGE_WRITE );
+		WritebackOffset = EndOffset;
+	}
+}
+
+uint16_t calculateTelemetryChecksum( const TelemetryRecordStruct* RecordPtr ){
+	return modbusCrc16( (const uint8_t*)RecordPtr + sizeof(RecordPtr->checksum), sizeof(TelemetryRecordStruct) - sizeof(RecordPtr->checksum) );
+}
+
+bool isTelemetryRecordValid( const TelemetryRecordStruct* RecordPtr, uint64_t Index ){
+	return ((uint32_t)(Index + 1) == RecordPtr->sequence) && (calculateTelemetryChecksum( RecordPtr ) == RecordPtr->checksum);
+}
+
+uint32_t parseTelemetrySegmentFileName( const char* FileName ){
+	size_t PrefixLength = strlen( TELEMETRY_ARCHIVE_FILE_PREFIX );
+	char* EndPtr;
+	unsigned long SegmentNumber;
+
+	if (0 != strncmp( FileName, TELEMETRY_ARCHIVE_FILE_PREFIX, PrefixLength )){
+		return 0;
+	}
+	SegmentNumber = strtoul( FileName + PrefixLength, &EndPtr, 10 );
+	if ((EndPtr == FileName + PrefixLength) || (0 != strcmp( EndPtr, TELEMETRY_ARCHIVE_FILE_EXTENSION )) ||
+			(SegmentNumber > UINT32_MAX - TELEMETRY_ARCHIVE_SEGMENTS_MAX))
+	{
+		return 0;
+	}
+	return (uint32_t)SegmentNumber;
+}
+
+// After a crash of the program the records and the header are complete (the pages of the mapping stay in the page cache);
+// after a power failure the pages may have reached the disk in any order, so the header may count a record that is lost,
+// or it may not count the last records that have been saved
+uint64_t recoverTelemetryRecordCount( const TelemetrySegmentHeaderStruct* HeaderPtr, const TelemetryRecordStruct* Records ){
+	uint64_t Capacity = HeaderPtr->capacity;
+	uint64_t Count = __atomic_load_n( &HeaderPtr->recordCount, __ATOMIC_ACQUIRE );
+
+	if (Count > Capacity){
+		Count = Capacity;
+	}
+	while ((Count > 0) && !isTelemetryRecordValid( &Records[Count-1], Count-1 )){
+		Count--;
+	}
+	while ((Count < Capacity) && isTelemetryRecordValid( &Records[Count], Count )){
+		Count++;
+	}
+	return Count;
+}
+
+//.................................................................................................
+// Local function definitions
+//.................................................................................................
+
+// The segment is created at its full size, so the appends do not allocate the blocks of the file system
+static bool startSegment( void ){
+	char FileName[sizeof(ArchiveDirectory) + 32];
+	void* MappingPtr;
+	int FileHandler;
+
+	snprintf( FileName, sizeof(FileName), "%s/" TELEMETRY_ARCHIVE_FILE_PREFIX "%08u" TELEMETRY_ARCHIVE_FILE_EXTENSION,
+			ArchiveDirectory, NextSegmentNumber );
+	FileHandler = open( FileName, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644 );
+	if (-1 == FileHandler){
+		return false;
+	}
+	if (0 != posix_fallocate( FileHandler, 0, (off_t)TELEMETRY_ARCHIVE_SEGMENT_SIZE )){
+		// the file system does not support it; the file is sparse then
+		if (0 != ftruncate( FileHandler, (off_t)TELEMETRY_ARCHIVE_SEGMENT_SIZE )){
+			close( FileHandler );
+			return false;
+		}
+	}
+	MappingPtr = mmap( nullptr, TELEMETRY_ARCHIVE_SEGMENT_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, FileHandler, 0 );
+	if (MAP_FAILED == MappingPtr){
+		close( FileHandler );
+		return false;
+	}
+
+	TelemetrySegmentHeaderStruct* HeaderPtr = (TelemetrySegmentHeaderStruct*)MappingPtr;
+	memcpy( HeaderPtr->magic, TELEMETRY_ARCHIVE_MAGIC, sizeof(TELEMETRY_ARCHIVE_MAGIC) );
+	HeaderPtr->version = TELEMETRY_ARCHIVE_VERSION;
+	HeaderPtr->recordSize = TELEMETRY_ARCHIVE_RECORD_SIZE;
+	HeaderPtr->capacity = TELEMETRY_ARCHIVE_CAPACITY;
+	HeaderPtr->segmentNumber = NextSegmentNumber;
+	HeaderPtr->recordCount = 0;
+	HeaderPtr->realtimeAtStart = (int64_t)getMicroseconds( CLOCK_REALTIME );
+	HeaderPtr->monotonicAtStart = getMicroseconds( CLOCK_MONOTONIC );
+
+	SegmentFileHandler = FileHandler;
+	SegmentHeaderPtr = HeaderPtr;
+	SegmentRecords = (TelemetryRecordStruct*)((uint8_t*)MappingPtr + TELEMETRY_ARCHIVE_HEADER_SIZE);
+	WritebackOffset = 0;
+
+	if (NextSegmentNumber > TELEMETRY_ARCHIVE_SEGMENTS_MAX){
+		deleteSegment( NextSegmentNumber - TELEMETRY_ARCHIVE_SEGMENTS_MAX );
+	}
+	NextSegmentNumber++;
+	return true;
+}
+
+static void closeSegment( void ){
+	(void)sync_file_range( SegmentFileHandler, 0, 0, SYNC_FILE_RANGE_WRITE );	// the whole file
+	munmap( (void*)SegmentHeaderPtr, TELEMETRY_ARCHIVE_SEGMENT_SIZE );
+	close( SegmentFileHandler );
+	SegmentFileHandler = -1;
+	SegmentHeaderPtr = nullptr;
+	SegmentRecords = nullptr;
+}
+
+static void deleteSegment( uint32_t SegmentNumber ){
+	char FileName[sizeof(ArchiveDirectory) + 32];
+
+	snprintf( FileName, sizeof(FileName), "%s/" TELEMETRY_ARCHIVE_FILE_PREFIX "%08u" TELEMETRY_ARCHIVE_FILE_EXTENSION,
+			ArchiveDirectory, SegmentNumber );
+	(void)unlink( FileName );
+}
+
+static uint64_t getMicroseconds( clockid_t Clock ){
+	struct timespec Now;
+	clock_gettime( Clock, &Now );
+	return (uint64_t)Now.tv_sec * 1000000ull + (uint64_t)Now.tv_nsec / 1000ull;
+}
@@ -0,0 +1,91 @@
+// telemetryArchive.h
+//
+// Threads: the peripheral thread appends the records (see archiveAllChannels); the tools read the archive
+//
+// This module keeps the registers read from the power supply units in a persistent archive, so that the behaviour
+// of the currents can be reconstructed after a trip (for instance a magnet quench).
+// The archive is a directory of segment files. A segment is a file of a fixed size, mapped to the memory, which holds
+// a header and the records of a fixed size; a new segment is started at each start of the program and when
+// the previous one is full. Only the newest TELEMETRY_ARCHIVE_SEGMENTS_MAX segments are kept.
+// An append is a copy of the registers into the mapped memory; nothing is allocated and the disk is not waited for
+// (the writeback of the written pages is only started from time to time, see TELEMETRY_ARCHIVE_WRITEBACK_SIZE).
+// Each record has a checksum, which is written together with the record, and the number of the records in the header
+// is updated after the record. A reader takes the number from the header and corrects it by checking the checksums
+// around it, so a torn tail (for instance after a power failure) is cut off (see recoverTelemetryRecordCount).
+// The timestamps grow within a segment, so a reader finds the beginning of a time range by a binary search
+// (see telemetryArchiveReader.h).
+
+#ifndef TELEMETRYARCHIVE_H_
+#define TELEMETRYARCHIVE_H_
+
+#include <stdint.h>
+#include "modbusTcpSlave.h"
+
+//.................................................................................................
+// Preprocessor directives
+//.................................................................................................
+
+#define TELEMETRY_ARCHIVE_DIRECTORY			"archive"		// in the directory of the program
+#define TELEMETRY_ARCHIVE_FILE_PREFIX		"telemetry_"
+#define TELEMETRY_ARCHIVE_FILE_EXTENSION	".arc"			// telemetry_00000001.arc ...
+#define TELEMETRY_ARCHIVE_MAGIC				"RSTLARC"
+#define TELEMETRY_ARCHIVE_VERSION			1
+
+#define TELEMETRY_ARCHIVE_RECORD_SIZE		64
+#define TELEMETRY_ARCHIVE_HEADER_SIZE		4096			// the records start at the second page
+#define TELEMETRY_ARCHIVE_CAPACITY			262144			// records per segment (16 MiB; 68 min for 16 channels at 4 Hz)
+#define TELEMETRY_ARCHIVE_SEGMENTS_MAX		128				// the older segments are deleted
+#define TELEMETRY_ARCHIVE_WRITEBACK_SIZE	65536			// bytes; the writeback is started after each such part of a segment
+
+#define TELEMETRY_ARCHIVE_SEGMENT_SIZE		(TELEMETRY_ARCHIVE_HEADER_SIZE + (size_t)TELEMETRY_ARCHIVE_CAPACITY * TELEMETRY_ARCHIVE_RECORD_SIZE)
+
+//.................................................................................................
+// Definitions of types
+//.................................................................................................
+
+struct TelemetrySegmentHeaderStruct{
+	char magic[8];
+	uint32_t version;
+	uint32_t recordSize;
+	uint32_t capacity;
+	uint32_t segmentNumber;				// the number in the name of the file
+	uint64_t recordCount;				// the number of records appended so far (atomic); a reader must check it
+	int64_t realtimeAtStart;			// us; CLOCK_REALTIME and CLOCK_MONOTONIC at the same moment,
+	uint64_t monotonicAtStart;			// used to calculate the timestamps of the records
+};
+
+struct TelemetryRecordStruct{
+	uint16_t checksum;					// CRC16 (Modbus) of the rest of the record
+	uint8_t channel;
+	uint8_t reserved;
+	uint32_t sequence;					// the index of the record in the segment + 1
+	int64_t timestamp;					// us; CLOCK_REALTIME at the start of the segment + the time of CLOCK_MONOTONIC since then
+	uint16_t registers[MODBUS_TCP_SECTOR_READING_SIZE];	// the layout of a Modbus TCP sector (MODBUS_ADDRES_REQUIRED_STATUS ...)
+														// without the registers of the order (the next ones move 2 places down)
+};
+
+//.................................................................................................
+// Global function prototypes
+//.................................................................................................
+
+// This function sets the directory of the archive (it is created if necessary) and deletes the oldest segments;
+// the first segment is created by the first append. It returns false on failure (then nothing is archived)
+bool initializeTelemetryArchive( const char* DirectoryName );
+
+// This function appends the registers of a channel to the archive; peripheral thread
+void appendTelemetryRecord( uint8_t Channel, const uint16_t* RegistersPtr, uint64_t MonotonicTimestamp );
+
+// This function returns the number of a segment taken from the name of its file, or 0 if it is not a name of a segment
+uint32_t parseTelemetrySegmentFileName( const char* FileName );
+
+// This function calculates the checksum of a record
+uint16_t calculateTelemetryChecksum( const TelemetryRecordStruct* RecordPtr );
+
+// This function returns true if a record is complete: its checksum is correct and it is the Index-th record of its segment
+bool isTelemetryRecordValid( const TelemetryRecordStruct* RecordPtr, uint64_t Index );
+
+// This function returns the number of the complete records at the beginning of a segment: it starts with the number
+// in the header and corrects it by checking the records around it
+uint64_t recoverTelemetryRecordCount( const TelemetrySegmentHeaderStruct* HeaderPtr, const TelemetryRecordStruct* Records );
+
+#endif /* TELEMETRYARCHIVE_H_ */
@@ -0,0 +1,121 @@
+// telemetryArchiveReader.cpp
+//
+// Threads: see telemetryArchiveReader.h
+
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <algorithm>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "telemetryArchiveReader.h"
+
+//.................................................................................................
+// Function definitions
+//.................................................................................................
+
+TelemetryArchiveReader::~TelemetryArchiveReader(){
+	close();
+}
+
+bool TelemetryArchiveReader::open( const char* DirectoryName ){
+	std::vector<uint32_t> SegmentNumbers;
+	char FileName[PATH_MAX];
+	DIR* DirectoryPtr;
+	struct dirent* EntryPtr;
+
+	close();
+	DirectoryPtr = opendir( DirectoryName );
+	if (nullptr == DirectoryPtr){
+		return false;
+	}
+	while (nullptr != (EntryPtr = readdir( DirectoryPtr ))){
+		uint32_t SegmentNumber = parseTelemetrySegmentFileName( EntryPtr->d_name );
+		if (0 != SegmentNumber){
+			SegmentNumbers.push_back( SegmentNumber );
+		}
+	}
+	closedir( DirectoryPtr );
+
+	std::sort( SegmentNumbers.begin(), SegmentNumbers.end() );
+	for (uint32_t SegmentNumber : SegmentNumbers){
+		snprintf( FileName, sizeof(FileName), "%s/" TELEMETRY_ARCHIVE_FILE_PREFIX "%08u" TELEMETRY_ARCHIVE_FILE_EXTENSION,
+				DirectoryName, SegmentNumber );
+		(void)mapSegment( FileName, SegmentNumber );
+	}
+	return true;
+}
+
+void TelemetryArchiveReader::close(){
+	for (TelemetrySegmentStruct& Segment : Segments){
+		munmap( (void*)Segment.headerPtr, Segment.mappingSize );
+	}
+	Segments.clear();
+}
+
+size_t TelemetryArchiveReader::getNumberOfSegments() const{
+	return Segments.size();
+}
+
+const TelemetrySegmentStruct* TelemetryArchiveReader::getSegment( size_t Index ) const{
+	return (Index < Segments.size())? &Segments[Index] : nullptr;
+}
+
+bool TelemetryArchiveReader::mapSegment( const char* FileName, uint32_t SegmentNumber ){
+	TelemetrySegmentStruct Segment;
+	struct stat FileStatus;
+	void* MappingPtr;
+	int FileHandler;
+
+	FileHandler = ::open( FileName, O_RDONLY | O_CLOEXEC );
+	if (-1 == FileHandler){
+		return false;
+	}
+	if ((0 != fstat( FileHandler, &FileStatus )) || (FileStatus.st_size < (off_t)TELEMETRY_ARCHIVE_HEADER_SIZE)){
+		::close( FileHandler );
+		return false;
+	}
+	MappingPtr = mmap( nullptr, (size_t)FileStatus.st_size, PROT_READ, MAP_SHARED, FileHandler, 0 );
+	::close( FileHandler );
+	if (MAP_FAILED == MappingPtr){
+		return false;
+	}
+
+	Segment.number = SegmentNumber;
+	Segment.headerPtr = (const TelemetrySegmentHeaderStruct*)MappingPtr;
+	Segment.records = (const TelemetryRecordStruct*)((const uint8_t*)MappingPtr + TELEMETRY_ARCHIVE_HEADER_SIZE);
+	Segment.mappingSize = (size_t)FileStatus.st_size;
+	if ((0 != memcmp( Segment.headerPtr->magic, TELEMETRY_ARCHIVE_MAGIC, sizeof(TELEMETRY_ARCHIVE_MAGIC) )) ||
+			(TELEMETRY_ARCHIVE_VERSION != Segment.headerPtr->version) ||
+			(TELEMETRY_ARCHIVE_RECORD_SIZE != Segment.headerPtr->recordSize) ||
+			(Segment.mappingSize < TELEMETRY_ARCHIVE_HEADER_SIZE + (size_t)Segment.headerPtr->capacity * TELEMETRY_ARCHIVE_RECORD_SIZE))
+	{
+		munmap( MappingPtr, Segment.mappingSize );
+		return false;
+	}
+	Segment.count = recoverTelemetryRecordCount( Segment.headerPtr, Segment.records );
+	// the scans read the records in order
+	(void)madvise( MappingPtr, Segment.mappingSize, MADV_SEQUENTIAL );
+	Segments.push_back( Segment );
+	return true;
+}
+
+// This function returns the index of the first record of a segment with the timestamp not earlier than FromTimestamp
+uint64_t TelemetryArchiveReader::findFirstRecord( const TelemetrySegmentStruct* SegmentPtr, int64_t FromTimestamp ) const{
+	uint64_t Low = 0;
+	uint64_t High = SegmentPtr->count;
+
+	while (Low < High){
+		uint64_t Middle = Low + (High - Low) / 2;
+		if (SegmentPtr->records[Middle].timestamp < FromTimestamp){
+			Low = Middle + 1;
+		}
+		else{
+			High = Middle;
+		}
+	}
+	return Low;
+}
@@ -0,0 +1,89 @@
+// telemetryArchiveReader.h
+//
+// Threads: any (an object is used by one thread)
+//
+// This module reads the telemetry archive (see telemetryArchive.h); it is used by the tools, not by the program itself.
+// All the segments are mapped read-only when the archive is opened, and the number of the complete records
+// of each segment is recovered then (a torn tail is cut off). A scan of a time range finds its first record
+// in each segment by a binary search and then walks the records sequentially in the mapped memory, without copying
+// them, so its speed is limited by the memory (or by the disk, if the segments are not in the page cache).
+// The archive may be read while the program is appending records; the records appended after the opening are not seen.
+
+#ifndef TELEMETRYARCHIVEREADER_H_
+#define TELEMETRYARCHIVEREADER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "telemetryArchive.h"
+
+//.................................................................................................
+// Definitions of types
+//.................................................................................................
+
+struct TelemetrySegmentStruct{
+	uint32_t number;
+	const TelemetrySegmentHeaderStruct* headerPtr;
+	const TelemetryRecordStruct* records;
+	uint64_t count;						// the number of the complete records (see recoverTelemetryRecordCount)
+	size_t mappingSize;
+};
+
+class TelemetryArchiveReader{
+private:
+	std::vector<TelemetrySegmentStruct> Segments;		// ordered by the numbers of the segments
+
+	bool mapSegment( const char* FileName, uint32_t SegmentNumber );
+	uint64_t findFirstRecord( const TelemetrySegmentStruct* SegmentPtr, int64_t FromTimestamp ) const;
+
+public:
+	~TelemetryArchiveReader();
+
+	// This function maps all the segments of the archive; it returns false if the directory can not be read
+	// (the files that are not correct segments are skipped)
+	bool open( const char* DirectoryName );
+	void close();
+
+	size_t getNumberOfSegments() const;
+	const TelemetrySegmentStruct* getSegment( size_t Index ) const;
+
+	// This function calls Visitor( const TelemetryRecordStruct* ) for each record with the timestamp
+	// in the range FromTimestamp ... ToTimestamp (us; CLOCK_REALTIME), in the order of appending;
+	// the records that have not reached the disk completely (the holes after a power failure) are skipped.
+	// It returns the number of the records visited
+	template <typename VisitorType>
+	uint64_t scan( int64_t FromTimestamp, int64_t ToTimestamp, VisitorType Visitor ) const{
+		uint64_t Visited = 0;
+
+		for (size_t SegmentIndex = 0; SegmentIndex < Segments.size(); SegmentIndex++){
+			Visited += scanSegment( SegmentIndex, FromTimestamp, ToTimestamp, Visitor );
+		}
+		return Visited;
+	}
+
+	// The same as scan(), but for one segment
+	template <typename VisitorType>
+	uint64_t scanSegment( size_t SegmentIndex, int64_t FromTimestamp, int64_t ToTimestamp, VisitorType Visitor ) const{
+		const TelemetrySegmentStruct& Segment = Segments[SegmentIndex];
+		uint64_t Visited = 0;
+
+		if ((0 == Segment.count) || (Segment.records[Segment.count-1].timestamp < FromTimestamp) ||
+				(Segment.records[0].timestamp > ToTimestamp))
+		{
+			return 0;
+		}
+		for (uint64_t Index = findFirstRecord( &Segment, FromTimestamp ); Index < Segment.count; Index++){
+			const TelemetryRecordStruct* RecordPtr = &Segment.records[Index];
+			if (RecordPtr->timestamp > ToTimestamp){
+				break;
+			}
+			if ((uint32_t)(Index + 1) == RecordPtr->sequence){
+				Visitor( RecordPtr );
+				Visited++;
+			}
+		}
+		return Visited;
+	}
+};
+
+#endif /* TELEMETRYARCHIVEREADER_H_ */
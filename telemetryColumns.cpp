@@ -0,0 +1,461 @@
+// telemetryColumns.cpp
+//
+// Threads: see telemetryColumns.h
+
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "telemetryColumns.h"
+
+//.................................................................................................
+// Preprocessor directives
+//.................................................................................................
+
+#define CHANNEL_COLUMN						0
+#define TIMESTAMP_COLUMN					1
+#define FIRST_REGISTER_COLUMN				2
+
+#define INDEX_ALIGNMENT						8
+
+//.................................................................................................
+// Local function prototypes
+//.................................................................................................
+
+static void putVarint( std::vector<uint8_t>* BufferPtr, uint64_t Value );
+static bool getVarint( const uint8_t** DataPtrPtr, const uint8_t* EndPtr, uint64_t* ValuePtr );
+
+static uint64_t encodeZigZag( int64_t Value );
+static int64_t decodeZigZag( uint64_t Value );
+
+//.................................................................................................
+// Local definitions of types
+//.................................................................................................
+
+// A run is coded as: varint value | varint (the length of the run - 1)
+class RunLengthWriter{
+private:
+	std::vector<uint8_t>* BufferPtr;
+	uint64_t Value;
+	uint64_t Length;
+
+public:
+	RunLengthWriter( std::vector<uint8_t>* NewBufferPtr ) : BufferPtr( NewBufferPtr ), Value( 0 ), Length( 0 ) {}
+
+	void put( uint64_t NewValue ){
+		if ((0 != Length) && (NewValue != Value)){
+			flush();
+		}
+		Value = NewValue;
+		Length++;
+	}
+
+	void flush(){
+		if (0 != Length){
+			putVarint( BufferPtr, Value );
+			putVarint( BufferPtr, Length - 1 );
+			Length = 0;
+		}
+	}
+};
+
+class RunLengthReader{
+private:
+	const uint8_t* DataPtr;
+	const uint8_t* EndPtr;
+	uint64_t Value;
+	uint64_t Remaining;
+
+public:
+	RunLengthReader( const uint8_t* NewDataPtr, const uint8_t* NewEndPtr ) : DataPtr( NewDataPtr ), EndPtr( NewEndPtr ), Value( 0 ), Remaining( 0 ) {}
+
+	bool get( uint64_t* ValuePtr ){
+		if (0 == Remaining){
+			if (!getVarint( &DataPtr, EndPtr, &Value ) || !getVarint( &DataPtr, EndPtr, &Remaining )){
+				return false;
+			}
+			Remaining++;
+		}
+		Remaining--;
+		*ValuePtr = Value;
+		return true;
+	}
+
+	// This function returns true if the column has been read completely
+	bool isFinished() const{
+		return (0 == Remaining) && (DataPtr == EndPtr);
+	}
+};
+
+//.................................................................................................
+// Function definitions
+//.................................................................................................
+
+TelemetryColumnEncoder::TelemetryColumnEncoder() : FilePtr( nullptr ), Offset( 0 ), RecordCount( 0 ), IsWriteFailed( false ){
+	Block.reserve( TELEMETRY_COLUMNS_BLOCK_RECORDS );
+}
+
+TelemetryColumnEncoder::~TelemetryColumnEncoder(){
+	if (nullptr != FilePtr){
+		fclose( FilePtr );
+	}
+}
+
+bool TelemetryColumnEncoder::open( const char* FileName, uint32_t SegmentNumber, int64_t RealtimeAtStart ){
+	TelemetryColumnsHeaderStruct Header;
+
+	FilePtr = fopen( FileName, "wb" );
+	if (nullptr == FilePtr){
+		return false;
+	}
+	memset( &Header, 0, sizeof(Header) );
+	memcpy( Header.magic, TELEMETRY_COLUMNS_MAGIC, sizeof(TELEMETRY_COLUMNS_MAGIC) );
+	Header.version = TELEMETRY_COLUMNS_VERSION;
+	Header.blockRecords = TELEMETRY_COLUMNS_BLOCK_RECORDS;
+	Header.segmentNumber = SegmentNumber;
+	Header.realtimeAtStart = RealtimeAtStart;
+
+	Offset = 0;
+	RecordCount = 0;
+	IsWriteFailed = false;
+	Block.clear();
+	Index.clear();
+	write( &Header, sizeof(Header) );
+	return !IsWriteFailed;
+}
+
+void TelemetryColumnEncoder::append( const TelemetryRecordStruct* RecordPtr ){
+	Block.push_back( *RecordPtr );
+	RecordCount++;
+	if (TELEMETRY_COLUMNS_BLOCK_RECORDS == Block.size()){
+		writeBlock();
+	}
+}
+
+bool TelemetryColumnEncoder::finish(){
+	TelemetryColumnsTrailerStruct Trailer;
+	static const uint8_t Padding[INDEX_ALIGNMENT] = { 0 };
+
+	if (nullptr == FilePtr){
+		return false;
+	}
+	writeBlock();
+	write( Padding, (INDEX_ALIGNMENT - Offset % INDEX_ALIGNMENT) % INDEX_ALIGNMENT );
+
+	memset( &Trailer, 0, sizeof(Trailer) );
+	Trailer.indexOffset = Offset;
+	Trailer.recordCount = RecordCount;
+	Trailer.blockCount = (uint32_t)Index.size();
+	memcpy( Trailer.magic, TELEMETRY_COLUMNS_MAGIC, sizeof(TELEMETRY_COLUMNS_MAGIC) );
+	write( Index.data(), Index.size() * sizeof(TelemetryColumnsIndexEntryStruct) );
+	write( &Trailer, sizeof(Trailer) );
+
+	// the file is complete on the disk before the caller renames it or deletes the segment of the archive
+	if ((0 != fflush( FilePtr )) || (0 != fsync( fileno( FilePtr ) ))){
+		IsWriteFailed = true;
+	}
+	if (0 != fclose( FilePtr )){
+		IsWriteFailed = true;
+	}
+	FilePtr = nullptr;
+	return !IsWriteFailed;
+}
+
+uint64_t TelemetryColumnEncoder::getSize() const{
+	return Offset;
+}
+
+void TelemetryColumnEncoder::writeBlock(){
+	TelemetryColumnsIndexEntryStruct Entry;
+
+	if (Block.empty()){
+		return;
+	}
+	BlockBuffer.clear();
+
+	// the channels
+	{
+		RunLengthWriter Writer( &Column );
+		uint8_t PreviousChannel = 0xFF;
+		Column.clear();
+		for (const TelemetryRecordStruct& Record : Block){
+			Writer.put( (uint8_t)(Record.channel - PreviousChannel - 1) );
+			PreviousChannel = Record.channel;
+		}
+		Writer.flush();
+		appendColumn();
+	}
+
+	// the timestamps
+	Entry.firstTimestamp = Entry.lastTimestamp = Block[0].timestamp;
+	{
+		int64_t PreviousTimestamp = 0;
+		Column.clear();
+		for (const TelemetryRecordStruct& Record : Block){
+			putVarint( &Column, encodeZigZag( Record.timestamp - PreviousTimestamp ) );
+			PreviousTimestamp = Record.timestamp;
+			Entry.firstTimestamp = (Record.timestamp < Entry.firstTimestamp)? Record.timestamp : Entry.firstTimestamp;
+			Entry.lastTimestamp = (Record.timestamp > Entry.lastTimestamp)? Record.timestamp : Entry.lastTimestamp;
+		}
+		appendColumn();
+	}
+
+	// the registers; each one is compared with its previous value in the same channel
+	memset( PreviousValues, 0, sizeof(PreviousValues) );
+	for (uint8_t RegisterOffset = 0; RegisterOffset < MODBUS_TCP_SECTOR_READING_SIZE; RegisterOffset++){
+		Column.clear();
+		if (isTelemetryDeltaColumn( RegisterOffset )){
+			for (const TelemetryRecordStruct& Record : Block){
+				uint16_t* PreviousPtr = &PreviousValues[Record.channel][RegisterOffset];
+				putVarint( &Column, encodeZigZag( (int16_t)(uint16_t)(Record.registers[RegisterOffset] - *PreviousPtr) ) );
+				*PreviousPtr = Record.registers[RegisterOffset];
+			}
+		}
+		else{
+			RunLengthWriter Writer( &Column );
+			for (const TelemetryRecordStruct& Record : Block){
+				uint16_t* PreviousPtr = &PreviousValues[Record.channel][RegisterOffset];
+				Writer.put( (uint16_t)(Record.registers[RegisterOffset] ^ *PreviousPtr) );
+				*PreviousPtr = Record.registers[RegisterOffset];
+			}
+			Writer.flush();
+		}
+		appendColumn();
+	}
+
+	Entry.offset = Offset;
+	Entry.size = (uint32_t)BlockBuffer.size();
+	Entry.recordCount = (uint32_t)Block.size();
+	Index.push_back( Entry );
+	write( BlockBuffer.data(), BlockBuffer.size() );
+	Block.clear();
+}
+
+void TelemetryColumnEncoder::appendColumn(){
+	putVarint( &BlockBuffer, Column.size() );
+	BlockBuffer.insert( BlockBuffer.end(), Column.begin(), Column.end() );
+}
+
+void TelemetryColumnEncoder::write( const void* DataPtr, size_t Size ){
+	if ((0 != Size) && (Size != fwrite( DataPtr, 1, Size, FilePtr ))){
+		IsWriteFailed = true;
+	}
+	Offset += Size;
+}
+
+TelemetryColumnDecoder::TelemetryColumnDecoder() : MappingPtr( nullptr ), MappingSize( 0 ), HeaderPtr( nullptr ), IndexPtr( nullptr ),
+		BlockCount( 0 ), RecordCount( 0 ){
+	Block.resize( TELEMETRY_COLUMNS_BLOCK_RECORDS );
+}
+
+TelemetryColumnDecoder::~TelemetryColumnDecoder(){
+	close();
+}
+
+bool TelemetryColumnDecoder::open( const char* FileName ){
+	const TelemetryColumnsTrailerStruct* TrailerPtr;
+	struct stat FileStatus;
+	void* NewMappingPtr;
+	int FileHandler;
+
+	close();
+	FileHandler = ::open( FileName, O_RDONLY | O_CLOEXEC );
+	if (-1 == FileHandler){
+		return false;
+	}
+	if ((0 != fstat( FileHandler, &FileStatus )) ||
+			(FileStatus.st_size < (off_t)(sizeof(TelemetryColumnsHeaderStruct) + sizeof(TelemetryColumnsTrailerStruct))))
+	{
+		::close( FileHandler );
+		return false;
+	}
+	NewMappingPtr = mmap( nullptr, (size_t)FileStatus.st_size, PROT_READ, MAP_SHARED, FileHandler, 0 );
+	::close( FileHandler );
+	if (MAP_FAILED == NewMappingPtr){
+		return false;
+	}
+	MappingPtr = (const uint8_t*)NewMappingPtr;
+	MappingSize = (size_t)FileStatus.st_size;
+
+	HeaderPtr = (const TelemetryColumnsHeaderStruct*)MappingPtr;
+	TrailerPtr = (const TelemetryColumnsTrailerStruct*)(MappingPtr + MappingSize - sizeof(TelemetryColumnsTrailerStruct));
+	if ((0 != memcmp( HeaderPtr->magic, TELEMETRY_COLUMNS_MAGIC, sizeof(TELEMETRY_COLUMNS_MAGIC) )) ||
+			(TELEMETRY_COLUMNS_VERSION != HeaderPtr->version) ||
+			(HeaderPtr->blockRecords > TELEMETRY_COLUMNS_BLOCK_RECORDS) ||
+			(0 != memcmp( TrailerPtr->magic, TELEMETRY_COLUMNS_MAGIC, sizeof(TELEMETRY_COLUMNS_MAGIC) )) ||
+			(0 != TrailerPtr->indexOffset % INDEX_ALIGNMENT) ||
+			(TrailerPtr->indexOffset + (uint64_t)TrailerPtr->blockCount * sizeof(TelemetryColumnsIndexEntryStruct) +
+					sizeof(TelemetryColumnsTrailerStruct) != MappingSize))
+	{
+		close();
+		return false;
+	}
+	IndexPtr = (const TelemetryColumnsIndexEntryStruct*)(MappingPtr + TrailerPtr->indexOffset);
+	BlockCount = TrailerPtr->blockCount;
+	RecordCount = TrailerPtr->recordCount;
+	for (uint32_t J = 0; J < BlockCount; J++){
+		if ((IndexPtr[J].offset < sizeof(TelemetryColumnsHeaderStruct)) || (IndexPtr[J].offset + IndexPtr[J].size > TrailerPtr->indexOffset) ||
+				(IndexPtr[J].recordCount > HeaderPtr->blockRecords))
+		{
+			close();
+			return false;
+		}
+	}
+	return true;
+}
+
+void TelemetryColumnDecoder::close(){
+	if (nullptr != MappingPtr){
+		munmap( (void*)MappingPtr, MappingSize );
+	}
+	MappingPtr = nullptr;
+	MappingSize = 0;
+	HeaderPtr = nullptr;
+	IndexPtr = nullptr;
+	BlockCount = 0;
+	RecordCount = 0;
+}
+
+uint32_t TelemetryColumnDecoder::getNumberOfBlocks() const{
+	return BlockCount;
+}
+
+uint64_t TelemetryColumnDecoder::getNumberOfRecords() const{
+	return RecordCount;
+}
+
+const TelemetryColumnsHeaderStruct* TelemetryColumnDecoder::getHeader() const{
+	return HeaderPtr;
+}
+
+uint32_t TelemetryColumnDecoder::findBlock( int64_t FromTimestamp ) const{
+	uint32_t Low = 0;
+	uint32_t High = BlockCount;
+
+	while (Low < High){
+		uint32_t Middle = Low + (High - Low) / 2;
+		if (IndexPtr[Middle].lastTimestamp < FromTimestamp){
+			Low = Middle + 1;
+		}
+		else{
+			High = Middle;
+		}
+	}
+	return Low;
+}
+
+uint32_t TelemetryColumnDecoder::decodeBlock( uint32_t BlockIndex, TelemetryRecordStruct* RecordsPtr ) const{
+	static thread_local uint16_t PreviousValues[TELEMETRY_COLUMNS_CHANNELS_NUMBER][MODBUS_TCP_SECTOR_READING_SIZE];
+	const uint8_t* DataPtr;
+	const uint8_t* BlockEndPtr;
+	uint32_t Number;
+
+	if (BlockIndex >= BlockCount){
+		return 0;
+	}
+	Number = IndexPtr[BlockIndex].recordCount;
+	DataPtr = MappingPtr + IndexPtr[BlockIndex].offset;
+	BlockEndPtr = DataPtr + IndexPtr[BlockIndex].size;
+	memset( PreviousValues, 0, sizeof(PreviousValues) );
+
+	for (uint8_t ColumnIndex = 0; ColumnIndex < TELEMETRY_COLUMNS_NUMBER; ColumnIndex++){
+		uint64_t ColumnSize, Value;
+		const uint8_t* ColumnEndPtr;
+
+		if (!getVarint( &DataPtr, BlockEndPtr, &ColumnSize ) || (ColumnSize > (uint64_t)(BlockEndPtr - DataPtr))){
+			return 0;
+		}
+		ColumnEndPtr = DataPtr + ColumnSize;
+
+		if ((CHANNEL_COLUMN == ColumnIndex) || ((ColumnIndex >= FIRST_REGISTER_COLUMN) && !isTelemetryDeltaColumn( ColumnIndex - FIRST_REGISTER_COLUMN ))){
+			RunLengthReader Reader( DataPtr, ColumnEndPtr );
+			uint8_t PreviousChannel = 0xFF;
+			for (uint32_t J = 0; J < Number; J++){
+				if (!Reader.get( &Value )){
+					return 0;
+				}
+				if (CHANNEL_COLUMN == ColumnIndex){
+					RecordsPtr[J].checksum = 0;
+					RecordsPtr[J].channel = (uint8_t)(PreviousChannel + 1 + Value);
+					RecordsPtr[J].reserved = 0;
+					RecordsPtr[J].sequence = 0;
+					PreviousChannel = RecordsPtr[J].channel;
+				}
+				else{
+					uint8_t Offset = ColumnIndex - FIRST_REGISTER_COLUMN;
+					uint16_t* PreviousPtr = &PreviousValues[RecordsPtr[J].channel][Offset];
+					*PreviousPtr = (uint16_t)(*PreviousPtr ^ Value);
+					RecordsPtr[J].registers[Offset] = *PreviousPtr;
+				}
+			}
+			if (!Reader.isFinished()){
+				return 0;
+			}
+		}
+		else{
+			int64_t PreviousTimestamp = 0;
+			for (uint32_t J = 0; J < Number; J++){
+				if (!getVarint( &DataPtr, ColumnEndPtr, &Value )){
+					return 0;
+				}
+				if (TIMESTAMP_COLUMN == ColumnIndex){
+					PreviousTimestamp += decodeZigZag( Value );
+					RecordsPtr[J].timestamp = PreviousTimestamp;
+				}
+				else{
+					uint8_t Offset = ColumnIndex - FIRST_REGISTER_COLUMN;
+					uint16_t* PreviousPtr = &PreviousValues[RecordsPtr[J].channel][Offset];
+					*PreviousPtr = (uint16_t)(*PreviousPtr + decodeZigZag( Value ));
+					RecordsPtr[J].registers[Offset] = *PreviousPtr;
+				}
+			}
+			if (DataPtr != ColumnEndPtr){
+				return 0;
+			}
+		}
+		DataPtr = ColumnEndPtr;
+	}
+	return (DataPtr == BlockEndPtr)? Number : 0;
+}
+
+//.................................................................................................
+// Local function definitions
+//.................................................................................................
+
+// 7 bits per byte, the least significant first; the highest bit is set in all the bytes except the last one
+static void putVarint( std::vector<uint8_t>* BufferPtr, uint64_t Value ){
+	while (Value >= 0x80){
+		BufferPtr->push_back( (uint8_t)(Value | 0x80) );
+		Value >>= 7;
+	}
+	BufferPtr->push_back( (uint8_t)Value );
+}
+
+static bool getVarint( const uint8_t** DataPtrPtr, const uint8_t* EndPtr, uint64_t* ValuePtr ){
+	const uint8_t* DataPtr = *DataPtrPtr;
+	uint64_t Value = 0;
+
+	for (uint8_t Shift = 0; Shift < 64; Shift += 7){
+		if (DataPtr == EndPtr){
+			return false;
+		}
+		uint8_t Byte = *DataPtr++;
+		Value |= (uint64_t)(Byte & 0x7F) << Shift;
+		if (0 == (Byte & 0x80)){
+			*DataPtrPtr = DataPtr;
+			*ValuePtr = Value;
+			return true;
+		}
+	}
+	return false;
+}
+
+// The small differences of both signs are coded as small numbers: 0, -1, 1, -2, 2 ... -> 0, 1, 2, 3, 4 ...
+static uint64_t encodeZigZag( int64_t Value ){
+	return ((uint64_t)Value << 1) ^ (uint64_t)(Value >> 63);
+}
+
+static int64_t decodeZigZag( uint64_t Value ){
+	return (int64_t)(Value >> 1) ^ -(int64_t)(Value & 1);
+}
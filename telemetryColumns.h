@@ -0,0 +1,167 @@
+// telemetryColumns.h
+//
+// Threads: any (an object is used by one thread)
+//
+// This module keeps the sealed segments of the telemetry archive (see telemetryArchive.h) in a compact columnar format
+// for long-term storage; it is used by the tools (see tools/archiveCompactor.cpp), not by the program itself.
+// The records are grouped in blocks of TELEMETRY_COLUMNS_BLOCK_RECORDS. Within a block each field is a separate column,
+// coded according to the way it changes:
+// - the channel: the difference from the channel of the previous record minus 1 (0 while the channels are polled in turn),
+//   run-length coded;
+// - the timestamp: the difference from the previous record, zig-zag and varint coded;
+// - the measurements (MODBUS_ADDRES_CURRENT_MEAN ... MODBUS_ADDRES_VOLTAGE_STD_DEVIATION): the difference from the previous
+//   value of the same channel, zig-zag and varint coded;
+// - the other registers (the status words, the setpoint, the statistics of the link): the bits that have changed since
+//   the previous value of the same channel, run-length coded (they are mostly 0).
+// Each block starts from zero values, so it can be decoded alone. The index at the end of the file holds the range
+// of the timestamps and the position of each block, so a reader finds the blocks of a time range by a binary search.
+// The records are restored exactly, except their checksums and sequence numbers (the decoded records have them 0).
+//
+// The layout of a file:   header | block 0 | block 1 | ... | index (an entry per block) | trailer
+// The layout of a block:  for each column (the channel, the timestamp, the registers in order): varint length | data
+
+#ifndef TELEMETRYCOLUMNS_H_
+#define TELEMETRYCOLUMNS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+#include "rstlProtocolMaster.h"
+#include "telemetryArchive.h"
+
+//.................................................................................................
+// Preprocessor directives
+//.................................................................................................
+
+#define TELEMETRY_COLUMNS_FILE_EXTENSION	".arz"			// telemetry_00000001.arz ...
+#define TELEMETRY_COLUMNS_MAGIC				"RSTLARZ"
+#define TELEMETRY_COLUMNS_VERSION			1
+
+#define TELEMETRY_COLUMNS_BLOCK_RECORDS		4096
+#define TELEMETRY_COLUMNS_CHANNELS_NUMBER	256				// the channel is uint8_t in the records
+#define TELEMETRY_COLUMNS_NUMBER			(2 + MODBUS_TCP_SECTOR_READING_SIZE)
+
+//.................................................................................................
+// Definitions of types
+//.................................................................................................
+
+struct TelemetryColumnsHeaderStruct{
+	char magic[8];
+	uint32_t version;
+	uint32_t blockRecords;
+	uint32_t segmentNumber;				// the number of the segment of the archive that has been compacted
+	uint32_t reserved;
+	int64_t realtimeAtStart;			// copied from the header of the segment
+};
+
+struct TelemetryColumnsIndexEntryStruct{
+	int64_t firstTimestamp;
+	int64_t lastTimestamp;
+	uint64_t offset;					// the position of the block in the file
+	uint32_t size;						// bytes
+	uint32_t recordCount;
+};
+
+struct TelemetryColumnsTrailerStruct{
+	uint64_t indexOffset;
+	uint64_t recordCount;
+	uint32_t blockCount;
+	uint32_t reserved;
+	char magic[8];
+};
+
+// Streaming encoder: the records are passed one by one and a block is written when it is full
+class TelemetryColumnEncoder{
+private:
+	FILE* FilePtr;
+	uint64_t Offset;
+	uint64_t RecordCount;
+	std::vector<TelemetryRecordStruct> Block;
+	std::vector<TelemetryColumnsIndexEntryStruct> Index;
+	std::vector<uint8_t> Column;
+	std::vector<uint8_t> BlockBuffer;
+	uint16_t PreviousValues[TELEMETRY_COLUMNS_CHANNELS_NUMBER][MODBUS_TCP_SECTOR_READING_SIZE];
+	bool IsWriteFailed;
+
+	void writeBlock();
+	void appendColumn();
+	void write( const void* DataPtr, size_t Size );
+
+public:
+	TelemetryColumnEncoder();
+	~TelemetryColumnEncoder();
+
+	// This function creates the file; it returns false on failure
+	bool open( const char* FileName, uint32_t SegmentNumber, int64_t RealtimeAtStart );
+	void append( const TelemetryRecordStruct* RecordPtr );
+
+	// This function writes the last block, the index and the trailer, and closes the file;
+	// it returns false if anything could not be written
+	bool finish();
+
+	uint64_t getSize() const;
+};
+
+class TelemetryColumnDecoder{
+private:
+	const uint8_t* MappingPtr;
+	size_t MappingSize;
+	const TelemetryColumnsHeaderStruct* HeaderPtr;
+	const TelemetryColumnsIndexEntryStruct* IndexPtr;
+	uint32_t BlockCount;
+	uint64_t RecordCount;
+	std::vector<TelemetryRecordStruct> Block;
+
+public:
+	TelemetryColumnDecoder();
+	~TelemetryColumnDecoder();
+
+	// This function maps the file and checks its header, trailer and index; it returns false if the file is not correct
+	bool open( const char* FileName );
+	void close();
+
+	uint32_t getNumberOfBlocks() const;
+	uint64_t getNumberOfRecords() const;
+	const TelemetryColumnsHeaderStruct* getHeader() const;
+
+	// This function returns the index of the first block that may contain records not earlier than FromTimestamp
+	// (getNumberOfBlocks() if there is none)
+	uint32_t findBlock( int64_t FromTimestamp ) const;
+
+	// This function decodes a block into RecordsPtr (room for TELEMETRY_COLUMNS_BLOCK_RECORDS records);
+	// it returns the number of the records, or 0 if the block is damaged
+	uint32_t decodeBlock( uint32_t BlockIndex, TelemetryRecordStruct* RecordsPtr ) const;
+
+	// This function calls Visitor( const TelemetryRecordStruct* ) for each record with the timestamp in the range
+	// FromTimestamp ... ToTimestamp, in the original order; it returns the number of the records visited
+	template <typename VisitorType>
+	uint64_t scan( int64_t FromTimestamp, int64_t ToTimestamp, VisitorType Visitor ){
+		uint64_t Visited = 0;
+
+		for (uint32_t BlockIndex = findBlock( FromTimestamp ); BlockIndex < BlockCount; BlockIndex++){
+			if (IndexPtr[BlockIndex].firstTimestamp > ToTimestamp){
+				break;
+			}
+			uint32_t Number = decodeBlock( BlockIndex, Block.data() );
+			for (uint32_t J = 0; J < Number; J++){
+				if ((Block[J].timestamp >= FromTimestamp) && (Block[J].timestamp <= ToTimestamp)){
+					Visitor( &Block[J] );
+					Visited++;
+				}
+			}
+		}
+		return Visited;
+	}
+};
+
+//.................................................................................................
+// Function definitions
+//.................................................................................................
+
+// The values of a column whose code is the difference from the previous value (the others are run-length coded)
+inline bool isTelemetryDeltaColumn( uint8_t RegisterOffset ){
+	return (RegisterOffset >= MODBUS_ADDRES_CURRENT_MEAN) && (RegisterOffset <= MODBUS_ADDRES_VOLTAGE_STD_DEVIATION);
+}
+
+#endif /* TELEMETRYCOLUMNS_H_ */
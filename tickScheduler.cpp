@@ -0,0 +1,100 @@
+// tickScheduler.cpp
+//
+// Threads: peripheral thread (see tickScheduler.h)
+
+#include <time.h>
+#include <errno.h>
+#include <assert.h>
+#include "tickScheduler.h"
+
+//.................................................................................................
+// Preprocessor directives
+//.................................................................................................
+
+#define NANOSECONDS_PER_SECOND			1000000000ull
+
+//.................................................................................................
+// Local function prototypes
+//.................................................................................................
+
+static uint64_t getMonotonicNanoseconds(void);
+
+//.................................................................................................
+// Function definitions
+//.................................................................................................
+
+TickScheduler::TickScheduler(){
+	Frequency = 0;
+	EpochNs = 0;
+	TickIndex = 0;
+	Overruns = 0;
+	SkippedTicks = 0;
+}
+
+void TickScheduler::start( uint8_t NewFrequency ){
+	assert( (NewFrequency >= TICK_FREQUENCY_MIN) && (NewFrequency <= TICK_FREQUENCY_MAX) );
+
+	Frequency = NewFrequency;
+	EpochNs = getMonotonicNanoseconds();
+	TickIndex = 0;
+	Overruns = 0;
+	SkippedTicks = 0;
+	Lateness.clear();
+}
+
+// This function sleeps until the deadline of the next tick; if the deadline has passed already,
+// the tick starts at once, and if the deadline of the tick after it has passed too, the missed ticks are skipped
+uint8_t TickScheduler::waitForNextTick(void){
+	uint64_t Now, Deadline, LatestTick;
+	struct timespec DeadlineSpecification;
+
+	assert( 0 != Frequency );
+
+	TickIndex++;
+	Deadline = deadlineOfTick( TickIndex );
+	Now = getMonotonicNanoseconds();
+	if (Now >= deadlineOfTick( TickIndex+1 )){
+		LatestTick = (Now - EpochNs) * Frequency / NANOSECONDS_PER_SECOND;
+		Overruns++;
+		SkippedTicks += LatestTick - TickIndex;
+		TickIndex = LatestTick;
+		Deadline = deadlineOfTick( TickIndex );
+	}
+	else if (Now < Deadline){
+		DeadlineSpecification.tv_sec = (time_t)(Deadline / NANOSECONDS_PER_SECOND);
+		DeadlineSpecification.tv_nsec = (long)(Deadline % NANOSECONDS_PER_SECOND);
+		while (EINTR == clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &DeadlineSpecification, nullptr )){
+		}
+		Now = getMonotonicNanoseconds();
+	}
+	Lateness.addSample( (uint32_t)((Now - Deadline) / 1000ull) );
+
+	return (uint8_t)(TickIndex % Frequency);
+}
+
+uint8_t TickScheduler::getFrequency(void){
+	return Frequency;
+}
+
+void TickScheduler::getStatistics( TickStatisticsStruct* StatisticsPtr ){
+	StatisticsPtr->frequency = Frequency;
+	StatisticsPtr->ticks = TickIndex;
+	StatisticsPtr->overruns = Overruns;
+	StatisticsPtr->skippedTicks = SkippedTicks;
+	Lateness.getSummary( &StatisticsPtr->lateness );
+}
+
+// The deadlines are calculated from the number of the tick, so the rounding errors do not accumulate
+uint64_t TickScheduler::deadlineOfTick( uint64_t Index ){
+	return EpochNs + Index * NANOSECONDS_PER_SECOND / Frequency;
+}
+
+//.................................................................................................
+// Local function definitions
+//.................................................................................................
+
+static uint64_t getMonotonicNanoseconds(void){
+	struct timespec Now;
+	clock_gettime( CLOCK_MONOTONIC, &Now );
+	return (uint64_t)Now.tv_sec * NANOSECONDS_PER_SECOND + (uint64_t)Now.tv_nsec;
+}
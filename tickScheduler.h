@@ -0,0 +1,57 @@
+// tickScheduler.h
+//
+// Threads: peripheral thread
+//
+// This module generates the ticks of the peripheral thread (see FractionOfSecond).
+// The ticks have absolute deadlines on CLOCK_MONOTONIC: the deadline of tick K is Epoch + K/Frequency,
+// so the ticks do not drift and do not jump when the wall clock is set (e.g. by NTP).
+// The thread sleeps in clock_nanosleep() until the deadline, so there are no wakeups between the ticks.
+// If the work of a tick lasts longer than the period (an overrun), the missed ticks are skipped
+// and the next tick starts at once; the overruns and the lateness of the wakeups are counted.
+
+#ifndef TICKSCHEDULER_H_
+#define TICKSCHEDULER_H_
+
+#include <inttypes.h>
+#include "latencyHistogram.h"
+
+//.................................................................................................
+// Preprocessor directives
+//.................................................................................................
+
+// The tick frequency can be chosen at runtime (option -f); the fraction of second is kept in uint8_t and
+// the tolerances of communication errors (see rstlProtocolMaster.h) must stay below 255 ticks
+#define TICK_FREQUENCY_MIN				1
+#define TICK_FREQUENCY_MAX				50
+
+//.................................................................................................
+// Definitions of types
+//.................................................................................................
+
+struct TickStatisticsStruct{
+	uint8_t frequency;
+	uint64_t ticks;						// the number of ticks since the start
+	uint32_t overruns;					// the number of ticks that began after the deadline of the next tick
+	uint64_t skippedTicks;				// the number of ticks skipped because of the overruns
+	LatencySummaryStruct lateness;		// the delays of the wakeups after the deadlines (us)
+};
+
+class TickScheduler{
+private:
+	uint8_t Frequency;
+	uint64_t EpochNs;					// CLOCK_MONOTONIC
+	uint64_t TickIndex;					// the number of the last tick
+	uint32_t Overruns;
+	uint64_t SkippedTicks;
+	LatencyHistogram Lateness;
+
+	uint64_t deadlineOfTick( uint64_t Index );
+public:
+	TickScheduler();
+	void start( uint8_t NewFrequency );
+	uint8_t waitForNextTick(void);		// it returns the fraction of second (0 ... Frequency-1)
+	uint8_t getFrequency(void);
+	void getStatistics( TickStatisticsStruct* StatisticsPtr );
+};
+
+#endif /* TICKSCHEDULER_H_ */
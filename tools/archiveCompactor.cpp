@@ -0,0 +1,198 @@
+// archiveCompactor.cpp
+//
+// This program converts the sealed segments of the telemetry archive (see telemetryArchive.h) to the compact columnar
+// format (see telemetryColumns.h) for long-term storage. The newest segment is not converted, because the program
+// may still be appending to it. A compacted segment is written under a temporary name and renamed when it is
+// complete on the disk, so an interrupted conversion leaves no damaged file; the segments that have a compacted
+// version already are skipped.
+//
+// Usage: archiveCompactor [options] [archive directory]   (default archive)
+//   -v              verify: decode each compacted segment and compare it with the original records
+//   -d              delete the original segment after a successful conversion (and verification, if -v)
+//   -b repetitions  benchmark: decode the compacted segments the given number of times at full speed
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <time.h>
+#include <string>
+#include "telemetryArchiveReader.h"
+#include "telemetryColumns.h"
+
+//.................................................................................................
+// Local variables
+//.................................................................................................
+
+static const char* DirectoryName = TELEMETRY_ARCHIVE_DIRECTORY;
+static bool IsVerifying = false;
+static bool IsDeleting = false;
+static uint32_t BenchmarkRepetitions = 0;
+
+//.................................................................................................
+// Local function prototypes
+//.................................................................................................
+
+static bool compactSegment( const TelemetrySegmentStruct* SegmentPtr, const std::string& FileName );
+static bool verifySegment( const TelemetrySegmentStruct* SegmentPtr, const std::string& FileName );
+static void benchmarkDecoding( const std::string& FileName );
+static std::string getSegmentFileName( uint32_t SegmentNumber, const char* Extension );
+static double getSeconds( void );
+
+//.................................................................................................
+// Function definitions
+//.................................................................................................
+
+int main( int argc, char** argv ){
+	TelemetryArchiveReader Reader;
+	int Option;
+
+	while (-1 != (Option = getopt( argc, argv, "vdb:" ))){
+		switch (Option){
+		case 'v':
+			IsVerifying = true;
+			break;
+		case 'd':
+			IsDeleting = true;
+			break;
+		case 'b':
+			BenchmarkRepetitions = (uint32_t)strtoul( optarg, nullptr, 10 );
+			break;
+		default:
+			fprintf( stderr, "Użycie: %s [-v] [-d] [-b powtórzenia] [katalog archiwum]\n", argv[0] );
+			return 1;
+		}
+	}
+	if (optind < argc){
+		DirectoryName = argv[optind];
+	}
+	if (!Reader.open( DirectoryName )){
+		fprintf( stderr, "Nie można otworzyć katalogu %s\n", DirectoryName );
+		return 1;
+	}
+
+	int Result = 0;
+	for (size_t J = 0; J + 1 < Reader.getNumberOfSegments(); J++){
+		const TelemetrySegmentStruct* SegmentPtr = Reader.getSegment( J );
+		std::string FileName = getSegmentFileName( SegmentPtr->number, TELEMETRY_COLUMNS_FILE_EXTENSION );
+
+		if (0 == access( FileName.c_str(), F_OK )){
+			printf( "%s: już istnieje\n", FileName.c_str() );
+			continue;
+		}
+		if (!compactSegment( SegmentPtr, FileName )){
+			Result = 1;
+			continue;
+		}
+		if (IsVerifying && !verifySegment( SegmentPtr, FileName )){
+			Result = 1;
+			continue;
+		}
+		if (IsDeleting){
+			(void)unlink( getSegmentFileName( SegmentPtr->number, TELEMETRY_ARCHIVE_FILE_EXTENSION ).c_str() );
+		}
+		if (0 != BenchmarkRepetitions){
+			benchmarkDecoding( FileName );
+		}
+	}
+	return Result;
+}
+
+//.................................................................................................
+// Local function definitions
+//.................................................................................................
+
+static bool compactSegment( const TelemetrySegmentStruct* SegmentPtr, const std::string& FileName ){
+	TelemetryColumnEncoder Encoder;
+	std::string TemporaryFileName = FileName + ".tmp";
+	uint64_t Count = 0;
+	double StartTime = getSeconds();
+
+	if (!Encoder.open( TemporaryFileName.c_str(), SegmentPtr->number, SegmentPtr->headerPtr->realtimeAtStart )){
+		fprintf( stderr, "%s: nie można utworzyć pliku\n", TemporaryFileName.c_str() );
+		return false;
+	}
+	for (uint64_t Index = 0; Index < SegmentPtr->count; Index++){
+		// the records lost after a power failure are skipped
+		if (isTelemetryRecordValid( &SegmentPtr->records[Index], Index )){
+			Encoder.append( &SegmentPtr->records[Index] );
+			Count++;
+		}
+	}
+	if (!Encoder.finish() || (0 != rename( TemporaryFileName.c_str(), FileName.c_str() ))){
+		fprintf( stderr, "%s: błąd zapisu\n", FileName.c_str() );
+		(void)unlink( TemporaryFileName.c_str() );
+		return false;
+	}
+	double Seconds = getSeconds() - StartTime;
+	printf( "%s: %" PRIu64 " rekordów, %" PRIu64 " -> %" PRIu64 " B (%.1f B/rekord, %.1fx), %.0f MB/s\n",
+			FileName.c_str(), Count, Count * TELEMETRY_ARCHIVE_RECORD_SIZE, Encoder.getSize(),
+			(0 != Count)? (double)Encoder.getSize() / Count : 0.0,
+			(0 != Encoder.getSize())? (double)(Count * TELEMETRY_ARCHIVE_RECORD_SIZE) / Encoder.getSize() : 0.0,
+			(Seconds > 0.0)? Count * TELEMETRY_ARCHIVE_RECORD_SIZE / Seconds / 1e6 : 0.0 );
+	return true;
+}
+
+// Everything except the checksums and the sequence numbers must be restored
+static bool verifySegment( const TelemetrySegmentStruct* SegmentPtr, const std::string& FileName ){
+	TelemetryColumnDecoder Decoder;
+	uint64_t Index = 0;
+	uint64_t Differences = 0;
+
+	if (!Decoder.open( FileName.c_str() )){
+		fprintf( stderr, "%s: nieprawidłowy plik\n", FileName.c_str() );
+		return false;
+	}
+	(void)Decoder.scan( INT64_MIN, INT64_MAX, [&]( const TelemetryRecordStruct* RecordPtr ){
+		while ((Index < SegmentPtr->count) && !isTelemetryRecordValid( &SegmentPtr->records[Index], Index )){
+			Index++;
+		}
+		const TelemetryRecordStruct* OriginalPtr = &SegmentPtr->records[(Index < SegmentPtr->count)? Index : 0];
+		if ((Index >= SegmentPtr->count) || (OriginalPtr->channel != RecordPtr->channel) ||
+				(OriginalPtr->timestamp != RecordPtr->timestamp) ||
+				(0 != memcmp( OriginalPtr->registers, RecordPtr->registers, sizeof(RecordPtr->registers) )))
+		{
+			Differences++;
+		}
+		Index++;
+	});
+	if ((0 != Differences) || (Decoder.getNumberOfRecords() != Index)){
+		fprintf( stderr, "%s: weryfikacja nieudana (różnice %" PRIu64 ")\n", FileName.c_str(), Differences );
+		return false;
+	}
+	printf( "%s: weryfikacja poprawna\n", FileName.c_str() );
+	return true;
+}
+
+static void benchmarkDecoding( const std::string& FileName ){
+	TelemetryColumnDecoder Decoder;
+	uint64_t Visited = 0;
+	uint64_t Sum = 0;
+
+	if (!Decoder.open( FileName.c_str() )){
+		return;
+	}
+	double StartTime = getSeconds();
+	for (uint32_t J = 0; J < BenchmarkRepetitions; J++){
+		Visited += Decoder.scan( INT64_MIN, INT64_MAX, [&]( const TelemetryRecordStruct* RecordPtr ){
+			Sum += RecordPtr->registers[MODBUS_ADDRES_CURRENT_FILTERED];
+		});
+	}
+	double Seconds = getSeconds() - StartTime;
+	printf( "%s: dekodowanie %.1f ns/rekord (%.0f MB/s rekordów; suma kontrolna %" PRIu64 ")\n", FileName.c_str(),
+			(0 != Visited)? Seconds * 1e9 / Visited : 0.0,
+			(Seconds > 0.0)? Visited * TELEMETRY_ARCHIVE_RECORD_SIZE / Seconds / 1e6 : 0.0, Sum );
+}
+
+static std::string getSegmentFileName( uint32_t SegmentNumber, const char* Extension ){
+	char Name[32];
+	snprintf( Name, sizeof(Name), TELEMETRY_ARCHIVE_FILE_PREFIX "%08u", SegmentNumber );
+	return std::string( DirectoryName ) + "/" + Name + Extension;
+}
+
+static double getSeconds( void ){
+	struct timespec Now;
+	clock_gettime( CLOCK_MONOTONIC, &Now );
+	return (double)Now.tv_sec + 1e-9 * (double)Now.tv_nsec;
+}
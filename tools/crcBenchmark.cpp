@@ -0,0 +1,111 @@
+// crcBenchmark.cpp
+//
+// This program compares the variants of the CRC16 algorithm on frames of the lengths used by the RTU master
+// (see FrameInfoTable in rstlProtocolMaster.cpp): requests and write echoes (8 bytes), responses to
+// RTU_ORDER_READING_LAST (19), RTU_ORDER_READING_FIRST (21), RTU_ORDER_READING_ALL (33) and the longest frame (40).
+//
+// Usage: crcBenchmark [number of iterations]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <time.h>
+#include "modbusCrc.h"
+
+//.................................................................................................
+// Preprocessor directives
+//.................................................................................................
+
+#define DEFAULT_ITERATIONS_NUMBER			2000000ul
+#define FRAMES_NUMBER						64
+
+//.................................................................................................
+// Local constants
+//.................................................................................................
+
+static const uint8_t FrameLengths[] = { 8, 19, 21, 33, 40 };
+
+static const char* const VariantNames[MODBUS_CRC_VARIANTS_NUMBER] = { "bitwise", "table", "slicing-by-4", "slicing-by-8" };
+
+static const uint8_t ReadAllRegistersFrame[] = {0x01, 0x03, 0x03, 0xE8, 0x00, 0x0E, 0x44, 0x7E};
+
+//.................................................................................................
+// Local variables
+//.................................................................................................
+
+static uint8_t Frames[FRAMES_NUMBER][40];
+
+// it prevents the compiler from removing the calculations
+static volatile uint16_t Sink;
+
+//.................................................................................................
+// Function definitions
+//.................................................................................................
+
+static double elapsedNanoseconds( const struct timespec* StartPtr, const struct timespec* StopPtr ){
+	return (double)(StopPtr->tv_sec - StartPtr->tv_sec) * 1e9 + (double)(StopPtr->tv_nsec - StartPtr->tv_nsec);
+}
+
+int main( int argc, char** argv ){
+	unsigned long IterationsNumber, J;
+	struct timespec Start, Stop;
+	uint16_t Crc, Reference;
+	int Variant;
+
+	IterationsNumber = (argc > 1)? strtoul( argv[1], nullptr, 10 ) : DEFAULT_ITERATIONS_NUMBER;
+	if (0 == IterationsNumber){
+		IterationsNumber = DEFAULT_ITERATIONS_NUMBER;
+	}
+
+	srand(1);
+	for (J = 0; J < FRAMES_NUMBER; J++){
+		for (int K = 0; K < 40; K++){
+			Frames[J][K] = (uint8_t)rand();
+		}
+	}
+
+	// correctness: all the variants must give the same results, also when the CRC is updated byte by byte
+	for (Variant = 0; Variant < MODBUS_CRC_VARIANTS_NUMBER; Variant++){
+		if (MODBUS_CRC_VALID_RESIDUE != modbusCrcUpdateVariant( (ModbusCrcVariant)Variant, MODBUS_CRC_INITIAL_VALUE,
+				ReadAllRegistersFrame, sizeof(ReadAllRegistersFrame) )){
+			printf("Błąd: wariant %s daje niepoprawne CRC\n", VariantNames[Variant]);
+			return 1;
+		}
+		for (J = 0; J < FRAMES_NUMBER; J++){
+			Reference = modbusCrcUpdateVariant( MODBUS_CRC_BITWISE, MODBUS_CRC_INITIAL_VALUE, Frames[J], 40 );
+			Crc = MODBUS_CRC_INITIAL_VALUE;
+			for (int K = 0; K < 40; K++){
+				Crc = modbusCrcUpdateVariant( (ModbusCrcVariant)Variant, Crc, &Frames[J][K], 1 );
+			}
+			if ((Crc != Reference) ||
+					(Reference != modbusCrcUpdateVariant( (ModbusCrcVariant)Variant, MODBUS_CRC_INITIAL_VALUE, Frames[J], 40 ))){
+				printf("Błąd: wariant %s daje niepoprawne CRC\n", VariantNames[Variant]);
+				return 1;
+			}
+		}
+	}
+
+	printf("Liczba iteracji: %lu\n", IterationsNumber);
+	printf("%-14s", "długość ramki");
+	for (Variant = 0; Variant < MODBUS_CRC_VARIANTS_NUMBER; Variant++){
+		printf("%14s", VariantNames[Variant]);
+	}
+	printf("   [ns/ramkę]\n");
+
+	for (size_t L = 0; L < sizeof(FrameLengths); L++){
+		printf("%-14u", FrameLengths[L]);
+		for (Variant = 0; Variant < MODBUS_CRC_VARIANTS_NUMBER; Variant++){
+			Crc = 0;
+			clock_gettime(CLOCK_MONOTONIC, &Start);
+			for (J = 0; J < IterationsNumber; J++){
+				Crc ^= modbusCrcUpdateVariant( (ModbusCrcVariant)Variant, MODBUS_CRC_INITIAL_VALUE,
+						Frames[J % FRAMES_NUMBER], FrameLengths[L] );
+			}
+			clock_gettime(CLOCK_MONOTONIC, &Stop);
+			Sink = Crc;
+			printf("%14.1f", elapsedNanoseconds( &Start, &Stop ) / (double)IterationsNumber);
+		}
+		printf("\n");
+	}
+	return 0;
+}
@@ -0,0 +1,179 @@
+// linkStatisticsBenchmark.cpp
+//
+// This program compares the incremental statistics of transmission errors (see linkStatistics.h) with the previous
+// method, which rescanned the whole history bit by bit after every sample, for windows of 512, 4096 and 65536 samples.
+// Both methods are fed with the same sequence of bursty errors and their results are compared after every sample.
+//
+// Usage: linkStatisticsBenchmark [number of samples]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <time.h>
+#include "linkStatistics.h"
+
+//.................................................................................................
+// Preprocessor directives
+//.................................................................................................
+
+#define DEFAULT_SAMPLES_NUMBER				2000000ul
+
+// the rescanning is slow for the large windows, so it is run on a part of the samples
+#define RESCANNED_BITS_LIMIT				1000000000ull
+
+//.................................................................................................
+// Definitions of types
+//.................................................................................................
+
+// The previous method: the statistics are calculated from scratch after every sample
+template <uint32_t WindowSize>
+class RescannedErrorStatistics{
+private:
+	uint32_t History[WindowSize/32];
+	uint32_t Head;
+	uint32_t NumberOfErrors;
+	uint32_t LongestSequence;
+public:
+	RescannedErrorStatistics() : History{}, Head(0), NumberOfErrors(0), LongestSequence(0) {}
+
+	void addSample( bool IsError ){
+		uint32_t BitIndex, LengthOfSequence, J;
+
+		if (IsError){
+			History[Head/32] |= (1u << (Head % 32));
+		}
+		else{
+			History[Head/32] &= ~(1u << (Head % 32));
+		}
+		Head = (Head + 1) % WindowSize;
+
+		NumberOfErrors = 0;
+		LongestSequence = 0;
+		LengthOfSequence = 0;
+		BitIndex = Head;
+		for (J = 0; J < WindowSize; J++){
+			if (0 == (History[BitIndex/32] & (1u << (BitIndex % 32)))){
+				LengthOfSequence = 0;
+			}
+			else{
+				NumberOfErrors++;
+				LengthOfSequence++;
+				if (LengthOfSequence > LongestSequence){
+					LongestSequence = LengthOfSequence;
+				}
+			}
+			BitIndex = (BitIndex + 1) % WindowSize;
+		}
+	}
+
+	uint32_t getNumberOfErrors(void){
+		return NumberOfErrors;
+	}
+
+	uint32_t getLongestSequence(void){
+		return LongestSequence;
+	}
+};
+
+//.................................................................................................
+// Local variables
+//.................................................................................................
+
+static bool* Samples;
+
+// it prevents the compiler from removing the calculations
+static volatile uint32_t Sink;
+
+//.................................................................................................
+// Function definitions
+//.................................................................................................
+
+static double elapsedNanoseconds( const struct timespec* StartPtr, const struct timespec* StopPtr ){
+	return (double)(StopPtr->tv_sec - StartPtr->tv_sec) * 1e9 + (double)(StopPtr->tv_nsec - StartPtr->tv_nsec);
+}
+
+// The errors come in bursts (a two-state model of the line: good and bad)
+static void generateSamples( unsigned long SamplesNumber ){
+	bool IsLineBad = false;
+	for (unsigned long J = 0; J < SamplesNumber; J++){
+		int Random = rand() % 1000;
+		if (IsLineBad){
+			IsLineBad = (Random >= 50);		// a burst lasts 20 samples on average
+			Samples[J] = (Random % 4 != 0);
+		}
+		else{
+			IsLineBad = (Random < 5);
+			Samples[J] = (Random == 999);
+		}
+	}
+}
+
+template <uint32_t WindowSize>
+static bool runBenchmark( unsigned long SamplesNumber ){
+	static SlidingErrorStatistics<WindowSize> Incremental;
+	static RescannedErrorStatistics<WindowSize> Rescanned;
+	struct timespec Start, Stop;
+	unsigned long RescannedSamplesNumber, J;
+	double IncrementalTime, RescannedTime;
+
+	RescannedSamplesNumber = SamplesNumber;
+	if ((unsigned long long)RescannedSamplesNumber * WindowSize > RESCANNED_BITS_LIMIT){
+		RescannedSamplesNumber = (unsigned long)(RESCANNED_BITS_LIMIT / WindowSize);
+	}
+
+	// correctness: both methods give the same results after every sample
+	Incremental.reset();
+	for (J = 0; J < RescannedSamplesNumber; J++){
+		Incremental.addSample( Samples[J] );
+		Rescanned.addSample( Samples[J] );
+		if ((Incremental.getNumberOfErrors() != Rescanned.getNumberOfErrors()) ||
+				(Incremental.getLongestSequence() != Rescanned.getLongestSequence()))
+		{
+			printf( "window %6u: MISMATCH at sample %lu: errors %u/%u, sequence %u/%u\n", (unsigned)WindowSize, J,
+					(unsigned)Incremental.getNumberOfErrors(), (unsigned)Rescanned.getNumberOfErrors(),
+					(unsigned)Incremental.getLongestSequence(), (unsigned)Rescanned.getLongestSequence() );
+			return false;
+		}
+	}
+
+	clock_gettime( CLOCK_MONOTONIC, &Start );
+	for (J = 0; J < RescannedSamplesNumber; J++){
+		Rescanned.addSample( Samples[J] );
+		Sink = Rescanned.getNumberOfErrors() + Rescanned.getLongestSequence();
+	}
+	clock_gettime( CLOCK_MONOTONIC, &Stop );
+	RescannedTime = elapsedNanoseconds( &Start, &Stop ) / (double)RescannedSamplesNumber;
+
+	Incremental.reset();
+	clock_gettime( CLOCK_MONOTONIC, &Start );
+	for (J = 0; J < SamplesNumber; J++){
+		Incremental.addSample( Samples[J] );
+		Sink = Incremental.getNumberOfErrors() + Incremental.getLongestSequence();
+	}
+	clock_gettime( CLOCK_MONOTONIC, &Stop );
+	IncrementalTime = elapsedNanoseconds( &Start, &Stop ) / (double)SamplesNumber;
+
+	printf( "window %6u: rescanning %10.1f ns/sample, incremental %6.1f ns/sample (%lu samples compared)\n",
+			(unsigned)WindowSize, RescannedTime, IncrementalTime, RescannedSamplesNumber );
+	return true;
+}
+
+int main( int argc, char** argv ){
+	unsigned long SamplesNumber;
+	bool Result;
+
+	SamplesNumber = (argc > 1)? strtoul( argv[1], nullptr, 10 ) : DEFAULT_SAMPLES_NUMBER;
+	if (0 == SamplesNumber){
+		SamplesNumber = DEFAULT_SAMPLES_NUMBER;
+	}
+	Samples = new bool[SamplesNumber];
+	srand(1);
+	generateSamples( SamplesNumber );
+
+	Result = runBenchmark<512>( SamplesNumber );
+	Result = runBenchmark<4096>( SamplesNumber ) && Result;
+	Result = runBenchmark<65536>( SamplesNumber ) && Result;
+
+	delete[] Samples;
+	return Result? 0 : 1;
+}
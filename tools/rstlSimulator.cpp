@@ -0,0 +1,700 @@
+// rstlSimulator.cpp
+//
+// This program simulates power supply units of the RSTL type on pseudo-terminals, so that the RTU master
+// (rstlProtocolMaster.cpp) can be run, benchmarked and load-tested without hardware.
+// Every simulated serial port is a pseudo-terminal; its slave side (/dev/pts/N) is written to the configuration
+// file, and several power supplies with consecutive Modbus addresses may share one port (RS-485 multi-drop).
+// The power supplies answer the register window used by the master (RTU_REGISTERS_WINDOW_START and the next
+// MODBUS_RTU_REGISTERS_AREA registers are read, the first two are written); the output current follows the setpoint
+// with a first order lag and some noise, the voltage is proportional to the current.
+// The responses can be delayed (a constant delay plus a random jitter, optionally the transmission time at 19200 baud)
+// and a given part of them can be corrupted (bad CRC), truncated or not sent at all.
+// All the ports are served by a single thread (epoll and timerfd), so hundreds of power supplies can be simulated.
+//
+// The program reports the number of transactions, the cycle time (the time between consecutive readings
+// of the same power supply) and the CPU use of the simulator and of the master, and the resident memory of the master,
+// if the master is started by the simulator (the command after "--"); the master must be placed in the directory
+// of the configuration file.
+//
+// Usage: rstlSimulator [options] [-- master command [arguments]]
+//   -n ports        number of serial ports (default 1)
+//   -a slaves       number of power supplies per port, addresses 1, 2 ... (default 1)
+//   -i id           identifier of the first power supply (default 1)
+//   -d ms           response delay (default 5)
+//   -j ms           maximum random jitter added to the delay (default 0)
+//   -w              the transmission time of the response at 19200 baud is added to the delay
+//   -c per mille    responses with a corrupted CRC
+//   -t per mille    truncated responses
+//   -s per mille    requests without response
+//   -T seconds      duration of the simulation (default: until Ctrl+C)
+//   -r seconds      period of the reports (default 5)
+//   -o file         configuration file of the master (default powerSourceRSTL.cfg)
+//   -p port         TCP port written to the configuration file (default 1502)
+//   -S seed         seed of the random numbers (default 1)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <termios.h>
+#include <time.h>
+#include <math.h>
+#include <queue>
+#include <vector>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "modbusCrc.h"
+#include "rtuFrameCatalog.h"
+#include "rstlProtocolMaster.h"
+
+//.................................................................................................
+// Preprocessor directives
+//.................................................................................................
+
+#define SIMULATOR_MAX_FRAME_SIZE			RTU_READING_RESPONSE_SIZE(MODBUS_RTU_REGISTERS_AREA)
+#define SIMULATOR_RECEIVE_BUFFER_SIZE		64
+
+#define RTU_FUNCTION_EXCEPTION_FLAG			0x80
+#define RTU_EXCEPTION_ILLEGAL_ADDRESS		0x02
+#define RTU_EXCEPTION_FRAME_SIZE			5
+
+// The model of the power supply: the setpoint register covers 0..SETPOINT_FULL_SCALE_A (see graphicalUserInterface.cpp),
+// the measured values are given in units of 0.01 A and 0.01 V
+#define SETPOINT_FULL_SCALE_A				200.0
+#define CURRENT_TIME_CONSTANT_S				0.3
+#define LOAD_RESISTANCE_OHM					0.25
+#define CURRENT_NOISE_A						0.05
+#define MEASUREMENT_UNITS_PER_A				100.0
+
+#define EPOLL_EVENTS_NUMBER					64
+
+//.................................................................................................
+// Definitions of types
+//.................................................................................................
+
+struct SimulatedPsuStruct{
+	uint16_t requiredStatus;		// register MODBUS_ADDRES_REQUIRED_STATUS
+	uint16_t requiredValue;			// register MODBUS_ADDRES_REQUIRED_VALUE
+	uint16_t identifier;			// register MODBUS_ADDRES_POWER_SOURCE_ID
+	double current;					// A
+	uint64_t lastUpdateTime;		// us
+	uint64_t lastReadingTime;		// us; 0 before the first reading
+	uint64_t sumOfCycles;			// us
+	uint64_t maxCycle;				// us
+	uint32_t numberOfCycles;
+};
+
+struct SimulatedPortStruct{
+	int masterHandler;				// the side of the pseudo-terminal used by the simulator
+	int slaveHandler;				// kept open, so that the master side does not report a hang-up
+	char name[64];
+	uint8_t receiveBuffer[SIMULATOR_RECEIVE_BUFFER_SIZE];
+	uint8_t receivedBytes;
+	uint8_t response[SIMULATOR_MAX_FRAME_SIZE];
+	uint8_t responseLength;			// 0 if there is no response waiting
+	uint64_t responseDueTime;		// us
+	SimulatedPsuStruct* psuTable;	// the index is the slave address - 1
+};
+
+struct CountersStruct{
+	uint64_t requests;
+	uint64_t readings;
+	uint64_t writings;
+	uint64_t responses;
+	uint64_t invalidRequests;		// bad CRC or an unknown function
+	uint64_t exceptions;
+	uint64_t corrupted;
+	uint64_t truncated;
+	uint64_t silenced;
+};
+
+// The responses waiting for their time; the earliest one is on the top
+typedef std::pair<uint64_t, uint32_t> DueResponse;		// time in us, index of the port
+
+//.................................................................................................
+// Local variables
+//.................................................................................................
+
+static uint32_t NumberOfPorts = 1;
+static uint32_t SlavesPerPort = 1;
+static uint32_t FirstIdentifier = 1;
+static double DelayMs = 5.0;
+static double JitterMs = 0.0;
+static bool IsWireTimeEmulated = false;
+static uint32_t CorruptionPerMille = 0;
+static uint32_t TruncationPerMille = 0;
+static uint32_t SilencePerMille = 0;
+static double DurationS = 0.0;
+static double ReportPeriodS = 5.0;
+static const char* ConfigurationFileName = CONFIGURATION_FILE_NAME;
+static uint32_t ConfiguredTcpPortNumber = 1502;
+static unsigned int Seed = 1;
+
+static SimulatedPortStruct* Ports;
+static CountersStruct Counters;
+static std::priority_queue<DueResponse, std::vector<DueResponse>, std::greater<DueResponse>> DueResponses;
+static int TimerHandler;
+static uint64_t ArmedTime;
+
+static volatile sig_atomic_t IsStopRequested;
+
+//.................................................................................................
+// Local function prototypes
+//.................................................................................................
+
+static uint64_t getMicroseconds(void);
+static bool parseArguments( int argc, char** argv, int* CommandIndexPtr );
+static bool openPorts(void);
+static bool writeConfigurationFile(void);
+static void onRequestBytes( uint32_t PortIndex, uint64_t Now );
+static void handleRequest( uint32_t PortIndex, const uint8_t* Request, uint64_t Now );
+static uint8_t buildReadingResponse( SimulatedPsuStruct* PsuPtr, const uint8_t* Request, uint8_t* Response, uint64_t Now );
+static void updatePsuModel( SimulatedPsuStruct* PsuPtr, uint64_t Now );
+static void scheduleResponse( uint32_t PortIndex, uint8_t Length, uint64_t Now );
+static void sendDueResponses( uint64_t Now );
+static void armTimer(void);
+static double gaussianNoise(void);
+static double readProcessCpuSeconds( pid_t Pid );
+static long readProcessResidentKilobytes( pid_t Pid );
+static void printReport( double ElapsedS, double SimulatorCpuS, double MasterCpuS, long MasterResidentKB );
+static void onStopSignal( int Signal );
+
+//.................................................................................................
+// Function definitions
+//.................................................................................................
+
+int main( int argc, char** argv ){
+	struct epoll_event Events[EPOLL_EVENTS_NUMBER];
+	int EpollHandler, CommandIndex, J;
+	pid_t MasterPid = -1;
+	uint64_t StartTime, NextReportTime, Now;
+	struct rusage Usage;
+	double ElapsedS, PreviousElapsedS, SimulatorCpuS, PreviousSimulatorCpuS, MasterCpuS, PreviousMasterCpuS;
+
+	if ( !parseArguments( argc, argv, &CommandIndex )){
+		return 1;
+	}
+	srand( Seed );
+	if (( !openPorts()) || ( !writeConfigurationFile())){
+		return 1;
+	}
+
+	EpollHandler = epoll_create1( EPOLL_CLOEXEC );
+	TimerHandler = timerfd_create( CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC );
+	if ((-1 == EpollHandler) || (-1 == TimerHandler)){
+		perror( "epoll/timerfd" );
+		return 1;
+	}
+	struct epoll_event Event;
+	Event.events = EPOLLIN;
+	Event.data.u32 = NumberOfPorts;		// the timer
+	epoll_ctl( EpollHandler, EPOLL_CTL_ADD, TimerHandler, &Event );
+	for (uint32_t Port = 0; Port < NumberOfPorts; Port++){
+		Event.events = EPOLLIN;
+		Event.data.u32 = Port;
+		if (0 != epoll_ctl( EpollHandler, EPOLL_CTL_ADD, Ports[Port].masterHandler, &Event )){
+			perror( "epoll_ctl" );
+			return 1;
+		}
+	}
+
+	signal( SIGINT, onStopSignal );
+	signal( SIGTERM, onStopSignal );
+	signal( SIGPIPE, SIG_IGN );
+
+	if (CommandIndex < argc){
+		MasterPid = fork();
+		if (0 == MasterPid){
+			execvp( argv[CommandIndex], &argv[CommandIndex] );
+			perror( argv[CommandIndex] );
+			_exit( 127 );
+		}
+		if (-1 == MasterPid){
+			perror( "fork" );
+			return 1;
+		}
+		printf( "Uruchomiono program nadrzędny: %s (pid %d)\n", argv[CommandIndex], (int)MasterPid );
+	}
+
+	StartTime = getMicroseconds();
+	NextReportTime = StartTime + (uint64_t)(ReportPeriodS * 1e6);
+	PreviousElapsedS = 0.0;
+	PreviousSimulatorCpuS = 0.0;
+	PreviousMasterCpuS = 0.0;
+
+	while ( !IsStopRequested){
+		int Timeout = (int)((NextReportTime > getMicroseconds())? (NextReportTime - getMicroseconds()) / 1000 + 1 : 0);
+		int NumberOfEvents = epoll_wait( EpollHandler, Events, EPOLL_EVENTS_NUMBER, Timeout );
+		if ((NumberOfEvents < 0) && (EINTR != errno)){
+			perror( "epoll_wait" );
+			break;
+		}
+		Now = getMicroseconds();
+		for (J = 0; J < NumberOfEvents; J++){
+			if (Events[J].data.u32 == NumberOfPorts){
+				uint64_t Expirations;
+				(void)read( TimerHandler, &Expirations, sizeof(Expirations) );
+				ArmedTime = 0;
+			}
+			else{
+				onRequestBytes( Events[J].data.u32, Now );
+			}
+		}
+		sendDueResponses( getMicroseconds() );
+		armTimer();
+
+		Now = getMicroseconds();
+		if ((DurationS > 0.0) && (Now - StartTime >= (uint64_t)(DurationS * 1e6))){
+			IsStopRequested = 1;
+		}
+		if ((Now >= NextReportTime) || IsStopRequested){
+			ElapsedS = (double)(Now - StartTime) / 1e6;
+			getrusage( RUSAGE_SELF, &Usage );
+			SimulatorCpuS = (double)Usage.ru_utime.tv_sec + (double)Usage.ru_utime.tv_usec / 1e6 +
+					(double)Usage.ru_stime.tv_sec + (double)Usage.ru_stime.tv_usec / 1e6;
+			MasterCpuS = (-1 != MasterPid)? readProcessCpuSeconds( MasterPid ) : -1.0;
+			printReport( ElapsedS - PreviousElapsedS, SimulatorCpuS - PreviousSimulatorCpuS,
+					(MasterCpuS >= 0.0)? MasterCpuS - PreviousMasterCpuS : -1.0,
+					(-1 != MasterPid)? readProcessResidentKilobytes( MasterPid ) : -1 );
+			PreviousElapsedS = ElapsedS;
+			PreviousSimulatorCpuS = SimulatorCpuS;
+			PreviousMasterCpuS = MasterCpuS;
+			NextReportTime += (uint64_t)(ReportPeriodS * 1e6);
+		}
+	}
+
+	if (-1 != MasterPid){
+		kill( MasterPid, SIGTERM );
+		waitpid( MasterPid, nullptr, 0 );
+	}
+	return 0;
+}
+
+//.................................................................................................
+// Local function definitions
+//.................................................................................................
+
+static uint64_t getMicroseconds(void){
+	struct timespec Time;
+	clock_gettime( CLOCK_MONOTONIC, &Time );
+	return (uint64_t)Time.tv_sec * 1000000ull + (uint64_t)Time.tv_nsec / 1000ull;
+}
+
+static bool parseArguments( int argc, char** argv, int* CommandIndexPtr ){
+	int Option;
+
+	while (-1 != (Option = getopt( argc, argv, "n:a:i:d:j:wc:t:s:T:r:o:p:S:" ))){
+		switch (Option){
+		case 'n': NumberOfPorts = (uint32_t)strtoul( optarg, nullptr, 10 ); break;
+		case 'a': SlavesPerPort = (uint32_t)strtoul( optarg, nullptr, 10 ); break;
+		case 'i': FirstIdentifier = (uint32_t)strtoul( optarg, nullptr, 10 ); break;
+		case 'd': DelayMs = strtod( optarg, nullptr ); break;
+		case 'j': JitterMs = strtod( optarg, nullptr ); break;
+		case 'w': IsWireTimeEmulated = true; break;
+		case 'c': CorruptionPerMille = (uint32_t)strtoul( optarg, nullptr, 10 ); break;
+		case 't': TruncationPerMille = (uint32_t)strtoul( optarg, nullptr, 10 ); break;
+		case 's': SilencePerMille = (uint32_t)strtoul( optarg, nullptr, 10 ); break;
+		case 'T': DurationS = strtod( optarg, nullptr ); break;
+		case 'r': ReportPeriodS = strtod( optarg, nullptr ); break;
+		case 'o': ConfigurationFileName = optarg; break;
+		case 'p': ConfiguredTcpPortNumber = (uint32_t)strtoul( optarg, nullptr, 10 ); break;
+		case 'S': Seed = (unsigned int)strtoul( optarg, nullptr, 10 ); break;
+		default:
+			fprintf( stderr, "Użycie: %s [-n porty] [-a zasilacze na porcie] [-i id] [-d ms] [-j ms] [-w] [-c ‰] [-t ‰] [-s ‰]"
+					" [-T s] [-r s] [-o plik] [-p port TCP] [-S ziarno] [-- program nadrzędny]\n", argv[0] );
+			return false;
+		}
+	}
+	if ((0 == NumberOfPorts) || (0 == SlavesPerPort) || (SlavesPerPort > RTU_SLAVE_ADDRESS_MAX) ||
+			(FirstIdentifier < 1) || (FirstIdentifier > 255) || (DelayMs < 0.0) || (JitterMs < 0.0) ||
+			(CorruptionPerMille + TruncationPerMille + SilencePerMille > 1000) || (ReportPeriodS <= 0.0))
+	{
+		fprintf( stderr, "Nieprawidłowe parametry\n" );
+		return false;
+	}
+	*CommandIndexPtr = optind;
+	return true;
+}
+
+static bool openPorts(void){
+	struct rlimit Limit;
+	struct termios Settings;
+	uint32_t Port, Slave, PsuIndex;
+
+	// two handlers per port
+	if (0 == getrlimit( RLIMIT_NOFILE, &Limit )){
+		Limit.rlim_cur = Limit.rlim_max;
+		(void)setrlimit( RLIMIT_NOFILE, &Limit );
+	}
+
+	Ports = new SimulatedPortStruct[NumberOfPorts]();
+	PsuIndex = 0;
+	for (Port = 0; Port < NumberOfPorts; Port++){
+		SimulatedPortStruct* PortPtr = &Ports[Port];
+
+		PortPtr->masterHandler = posix_openpt( O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC );
+		if ((-1 == PortPtr->masterHandler) || (0 != grantpt( PortPtr->masterHandler )) ||
+				(0 != unlockpt( PortPtr->masterHandler )) ||
+				(0 != ptsname_r( PortPtr->masterHandler, PortPtr->name, sizeof(PortPtr->name) )))
+		{
+			fprintf( stderr, "Nie udało się utworzyć pseudoterminala nr %u: %s\n", Port, strerror( errno ));
+			return false;
+		}
+		PortPtr->slaveHandler = open( PortPtr->name, O_RDWR | O_NOCTTY | O_CLOEXEC );
+		if (-1 == PortPtr->slaveHandler){
+			fprintf( stderr, "Nie udało się otworzyć %s: %s\n", PortPtr->name, strerror( errno ));
+			return false;
+		}
+		// no echo and no conversions until the master configures the port
+		tcgetattr( PortPtr->slaveHandler, &Settings );
+		cfmakeraw( &Settings );
+		tcsetattr( PortPtr->slaveHandler, TCSANOW, &Settings );
+
+		PortPtr->psuTable = new SimulatedPsuStruct[SlavesPerPort]();
+		for (Slave = 0; Slave < SlavesPerPort; Slave++){
+			PortPtr->psuTable[Slave].identifier = (uint16_t)((FirstIdentifier - 1 + PsuIndex) % 255 + 1);
+			PsuIndex++;
+		}
+	}
+	return true;
+}
+
+// The configuration file in the format of configurationFileParsing() (multiChannel.cpp)
+static bool writeConfigurationFile(void){
+	FILE* File = fopen( ConfigurationFileName, "w" );
+	uint32_t Port, Slave;
+
+	if (nullptr == File){
+		fprintf( stderr, "Nie udało się utworzyć pliku %s: %s\n", ConfigurationFileName, strerror( errno ));
+		return false;
+	}
+	fprintf( File, "tryb_pracy_komputera=lokalny\nnumer_portu_tcp=%u\n", ConfiguredTcpPortNumber );
+	for (Port = 0; Port < NumberOfPorts; Port++){
+		for (Slave = 0; Slave < SlavesPerPort; Slave++){
+			fprintf( File, "id=%u port='%s' adres=%u opis='Symulator %u.%u'\n", Ports[Port].psuTable[Slave].identifier,
+					Ports[Port].name, Slave + RTU_SLAVE_ADDRESS_MIN, Port, Slave + RTU_SLAVE_ADDRESS_MIN );
+		}
+	}
+	fclose( File );
+	printf( "Symulowane zasilacze: %u (porty: %u, zasilacze na porcie: %u), konfiguracja: %s\n",
+			NumberOfPorts * SlavesPerPort, NumberOfPorts, SlavesPerPort, ConfigurationFileName );
+	return true;
+}
+
+// The requests have a constant size; a frame with a bad CRC is dropped together with the rest of the received bytes,
+// as a real slave does when it waits for the silence on the line
+static void onRequestBytes( uint32_t PortIndex, uint64_t Now ){
+	SimulatedPortStruct* PortPtr = &Ports[PortIndex];
+	ssize_t Length;
+
+	while (true){
+		Length = read( PortPtr->masterHandler, &PortPtr->receiveBuffer[PortPtr->receivedBytes],
+				SIMULATOR_RECEIVE_BUFFER_SIZE - PortPtr->receivedBytes );
+		if (Length <= 0){
+			return;
+		}
+		PortPtr->receivedBytes += (uint8_t)Length;
+		while (PortPtr->receivedBytes >= RTU_REQUEST_FRAME_SIZE){
+			if (MODBUS_CRC_VALID_RESIDUE != modbusCrc16( PortPtr->receiveBuffer, RTU_REQUEST_FRAME_SIZE )){
+				Counters.invalidRequests++;
+				PortPtr->receivedBytes = 0;
+				break;
+			}
+			handleRequest( PortIndex, PortPtr->receiveBuffer, Now );
+			PortPtr->receivedBytes -= RTU_REQUEST_FRAME_SIZE;
+			memmove( PortPtr->receiveBuffer, &PortPtr->receiveBuffer[RTU_REQUEST_FRAME_SIZE], PortPtr->receivedBytes );
+		}
+	}
+}
+
+static void handleRequest( uint32_t PortIndex, const uint8_t* Request, uint64_t Now ){
+	SimulatedPortStruct* PortPtr = &Ports[PortIndex];
+	SimulatedPsuStruct* PsuPtr;
+	uint16_t Register, Value;
+	uint8_t Length;
+
+	if ((Request[0] < RTU_SLAVE_ADDRESS_MIN) || (Request[0] >= RTU_SLAVE_ADDRESS_MIN + SlavesPerPort)){
+		return;		// another slave (or a broadcast, which is not used by the master)
+	}
+	Counters.requests++;
+	PsuPtr = &PortPtr->psuTable[Request[0] - RTU_SLAVE_ADDRESS_MIN];
+	Register = (uint16_t)(256 * Request[2] + Request[3]);
+	Value = (uint16_t)(256 * Request[POSITION_OF_VALUE_IN_FRAME] + Request[POSITION_OF_VALUE_IN_FRAME+1]);
+	Length = 0;
+
+	if (RTU_FUNCTION_READ_HOLDING_REGISTERS == Request[1]){
+		if ((Register >= RTU_REGISTERS_WINDOW_START) && (0 != Value) &&
+				(Register + Value <= RTU_REGISTERS_WINDOW_START + MODBUS_RTU_REGISTERS_AREA))
+		{
+			Counters.readings++;
+			if (0 != PsuPtr->lastReadingTime){
+				uint64_t Cycle = Now - PsuPtr->lastReadingTime;
+				PsuPtr->sumOfCycles += Cycle;
+				PsuPtr->numberOfCycles++;
+				if (Cycle > PsuPtr->maxCycle){
+					PsuPtr->maxCycle = Cycle;
+				}
+			}
+			PsuPtr->lastReadingTime = Now;
+			Length = buildReadingResponse( PsuPtr, Request, PortPtr->response, Now );
+		}
+	}
+	else if (RTU_FUNCTION_WRITE_SINGLE_REGISTER == Request[1]){
+		if ((RTU_REGISTERS_WINDOW_START + MODBUS_ADDRES_REQUIRED_STATUS == Register) ||
+				(RTU_REGISTERS_WINDOW_START + MODBUS_ADDRES_REQUIRED_VALUE == Register))
+		{
+			Counters.writings++;
+			updatePsuModel( PsuPtr, Now );
+			if (RTU_REGISTERS_WINDOW_START + MODBUS_ADDRES_REQUIRED_STATUS == Register){
+				PsuPtr->requiredStatus = Value;
+			}
+			else{
+				PsuPtr->requiredValue = Value;
+			}
+			memcpy( PortPtr->response, Request, RTU_REQUEST_FRAME_SIZE );	// the echo of the request
+			Length = RTU_REQUEST_FRAME_SIZE;
+		}
+	}
+	else{
+		Counters.invalidRequests++;
+		return;
+	}
+
+	if (0 == Length){
+		Counters.exceptions++;
+		PortPtr->response[0] = Request[0];
+		PortPtr->response[1] = Request[1] | RTU_FUNCTION_EXCEPTION_FLAG;
+		PortPtr->response[2] = RTU_EXCEPTION_ILLEGAL_ADDRESS;
+		uint16_t Crc = modbusCrc16( PortPtr->response, 3 );
+		PortPtr->response[3] = (uint8_t)(Crc & 0xFFu);
+		PortPtr->response[4] = (uint8_t)(Crc >> 8);
+		Length = RTU_EXCEPTION_FRAME_SIZE;
+	}
+	scheduleResponse( PortIndex, Length, Now );
+}
+
+static uint8_t buildReadingResponse( SimulatedPsuStruct* PsuPtr, const uint8_t* Request, uint8_t* Response, uint64_t Now ){
+	uint16_t Registers[MODBUS_RTU_REGISTERS_AREA];
+	uint16_t FirstRegister = (uint16_t)(256 * Request[2] + Request[3]) - RTU_REGISTERS_WINDOW_START;
+	uint8_t NumberOfRegisters = Request[POSITION_OF_VALUE_IN_FRAME+1];
+	double Noise = CURRENT_NOISE_A * MEASUREMENT_UNITS_PER_A;
+	double Current, Voltage;
+
+	updatePsuModel( PsuPtr, Now );
+	Current = PsuPtr->current * MEASUREMENT_UNITS_PER_A;
+	Voltage = Current * LOAD_RESISTANCE_OHM;
+
+	Registers[MODBUS_ADDRES_REQUIRED_STATUS] = PsuPtr->requiredStatus;
+	Registers[MODBUS_ADDRES_REQUIRED_VALUE] = PsuPtr->requiredValue;
+	Registers[MODBUS_ADDRES_POWER_SOURCE_ID] = PsuPtr->identifier;
+	Registers[MODBUS_ADDRES_SLAVE_STATUS] = PsuPtr->requiredStatus & MASK_OF_POWER_ON_OFF_BIT;
+	Registers[MODBUS_ADDRES_CURRENT_MEAN] = (uint16_t)fmax( 0.0, Current + Noise * gaussianNoise() / 4 );
+	Registers[MODBUS_ADDRES_CURRENT_MEDIAN] = (uint16_t)fmax( 0.0, Current + Noise * gaussianNoise() / 4 );
+	Registers[MODBUS_ADDRES_CURRENT_FILTERED] = (uint16_t)Current;
+	Registers[MODBUS_ADDRES_CURRENT_PEAK_TO_PEAK] = (uint16_t)(4 * Noise);
+	Registers[MODBUS_ADDRES_CURRENT_STD_DEVIATION] = (uint16_t)Noise;
+	Registers[MODBUS_ADDRES_VOLTAGE_MEAN] = (uint16_t)fmax( 0.0, Voltage + LOAD_RESISTANCE_OHM * Noise * gaussianNoise() / 4 );
+	Registers[MODBUS_ADDRES_VOLTAGE_MEDIAN] = (uint16_t)fmax( 0.0, Voltage + LOAD_RESISTANCE_OHM * Noise * gaussianNoise() / 4 );
+	Registers[MODBUS_ADDRES_VOLTAGE_FILTERED] = (uint16_t)Voltage;
+	Registers[MODBUS_ADDRES_VOLTAGE_PEAK_TO_PEAK] = (uint16_t)(4 * LOAD_RESISTANCE_OHM * Noise);
+	Registers[MODBUS_ADDRES_VOLTAGE_STD_DEVIATION] = (uint16_t)(LOAD_RESISTANCE_OHM * Noise);
+
+	Response[0] = Request[0];
+	Response[1] = RTU_FUNCTION_READ_HOLDING_REGISTERS;
+	Response[2] = (uint8_t)(2 * NumberOfRegisters);
+	for (uint8_t J = 0; J < NumberOfRegisters; J++){
+		Response[RTU_RESPONSE_HEADER_SIZE + 2*J] = (uint8_t)(Registers[FirstRegister+J] >> 8);
+		Response[RTU_RESPONSE_HEADER_SIZE + 2*J + 1] = (uint8_t)(Registers[FirstRegister+J] & 0xFFu);
+	}
+	uint8_t Length = RTU_RESPONSE_HEADER_SIZE + 2 * NumberOfRegisters;
+	uint16_t Crc = modbusCrc16( Response, Length );
+	Response[Length] = (uint8_t)(Crc & 0xFFu);
+	Response[Length+1] = (uint8_t)(Crc >> 8);
+	return Length + RTU_CRC_SIZE;
+}
+
+// The output current follows the setpoint with a first order lag; the power switch cuts it off
+static void updatePsuModel( SimulatedPsuStruct* PsuPtr, uint64_t Now ){
+	double Target = 0.0;
+
+	if (0 != (PsuPtr->requiredStatus & MASK_OF_POWER_ON_OFF_BIT)){
+		Target = SETPOINT_FULL_SCALE_A * (double)PsuPtr->requiredValue / 65536.0;
+	}
+	if (0 != PsuPtr->lastUpdateTime){
+		double ElapsedS = (double)(Now - PsuPtr->lastUpdateTime) / 1e6;
+		PsuPtr->current = Target + (PsuPtr->current - Target) * exp( -ElapsedS / CURRENT_TIME_CONSTANT_S );
+	}
+	PsuPtr->lastUpdateTime = Now;
+}
+
+// The faults are injected here; a port has at most one response waiting (the master waits for it)
+static void scheduleResponse( uint32_t PortIndex, uint8_t Length, uint64_t Now ){
+	SimulatedPortStruct* PortPtr = &Ports[PortIndex];
+	uint32_t Random = (uint32_t)rand() % 1000;
+	double DelayUs = DelayMs * 1000.0;
+
+	if (Random < SilencePerMille){
+		Counters.silenced++;
+		return;
+	}
+	Random -= SilencePerMille;
+	if (Random < CorruptionPerMille){
+		Counters.corrupted++;
+		PortPtr->response[(uint32_t)rand() % Length] ^= (uint8_t)(1u << (rand() % 8));
+	}
+	else if (Random - CorruptionPerMille < TruncationPerMille){
+		Counters.truncated++;
+		Length = (uint8_t)(1 + (uint32_t)rand() % (Length - 1));
+	}
+
+	if (JitterMs > 0.0){
+		DelayUs += JitterMs * 1000.0 * (double)rand() / (double)RAND_MAX;
+	}
+	if (IsWireTimeEmulated){
+		DelayUs += (double)Length * 11.0 * 1e6 / 19200.0;
+	}
+	PortPtr->responseLength = Length;
+	PortPtr->responseDueTime = Now + (uint64_t)DelayUs;
+	DueResponses.push( DueResponse( PortPtr->responseDueTime, PortIndex ));
+}
+
+static void sendDueResponses( uint64_t Now ){
+	while (( !DueResponses.empty()) && (DueResponses.top().first <= Now)){
+		SimulatedPortStruct* PortPtr = &Ports[DueResponses.top().second];
+		uint64_t DueTime = DueResponses.top().first;
+		DueResponses.pop();
+		if ((0 == PortPtr->responseLength) || (PortPtr->responseDueTime != DueTime)){
+			continue;	// the response has been replaced by the response to a newer request
+		}
+		if (write( PortPtr->masterHandler, PortPtr->response, PortPtr->responseLength ) > 0){
+			Counters.responses++;
+		}
+		PortPtr->responseLength = 0;
+	}
+}
+
+static void armTimer(void){
+	struct itimerspec Setting = {};
+	uint64_t DueTime;
+
+	if (DueResponses.empty()){
+		return;
+	}
+	DueTime = DueResponses.top().first;
+	if (DueTime == ArmedTime){
+		return;
+	}
+	ArmedTime = DueTime;
+	Setting.it_value.tv_sec = (time_t)(DueTime / 1000000ull);
+	Setting.it_value.tv_nsec = (long)(DueTime % 1000000ull) * 1000l;
+	timerfd_settime( TimerHandler, TFD_TIMER_ABSTIME, &Setting, nullptr );
+}
+
+// Box-Muller transform
+static double gaussianNoise(void){
+	double U1 = ((double)rand() + 1.0) / ((double)RAND_MAX + 2.0);
+	double U2 = (double)rand() / (double)RAND_MAX;
+	return sqrt( -2.0 * log( U1 )) * cos( 2.0 * M_PI * U2 );
+}
+
+// The CPU time of a process (all its threads) from /proc/<pid>/stat
+static double readProcessCpuSeconds( pid_t Pid ){
+	char Path[64], Buffer[1024];
+	unsigned long UserTicks, SystemTicks;
+	FILE* File;
+
+	snprintf( Path, sizeof(Path), "/proc/%d/stat", (int)Pid );
+	File = fopen( Path, "r" );
+	if (nullptr == File){
+		return -1.0;
+	}
+	size_t Length = fread( Buffer, 1, sizeof(Buffer)-1, File );
+	fclose( File );
+	Buffer[Length] = '\0';
+	// the name of the program (field 2) may contain spaces, so the fields are counted from the last ')'
+	char* FieldsPtr = strrchr( Buffer, ')' );
+	if ((nullptr == FieldsPtr) ||
+			(2 != sscanf( FieldsPtr + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &UserTicks, &SystemTicks )))
+	{
+		return -1.0;
+	}
+	return (double)(UserTicks + SystemTicks) / (double)sysconf( _SC_CLK_TCK );
+}
+
+// The resident memory of a process (VmRSS from /proc/<pid>/status); -1 if it can not be read
+static long readProcessResidentKilobytes( pid_t Pid ){
+	char Path[64], Line[256];
+	long Kilobytes = -1;
+	FILE* File;
+
+	snprintf( Path, sizeof(Path), "/proc/%d/status", (int)Pid );
+	File = fopen( Path, "r" );
+	if (nullptr == File){
+		return -1;
+	}
+	while (nullptr != fgets( Line, sizeof(Line), File )){
+		if (1 == sscanf( Line, "VmRSS: %ld kB", &Kilobytes )){
+			break;
+		}
+	}
+	fclose( File );
+	return Kilobytes;
+}
+
+static void printReport( double ElapsedS, double SimulatorCpuS, double MasterCpuS, long MasterResidentKB ){
+	static CountersStruct PreviousCounters;
+	uint64_t SumOfCycles = 0, MaxCycle = 0;
+	uint32_t NumberOfCycles = 0, NeverRead = 0;
+
+	for (uint32_t Port = 0; Port < NumberOfPorts; Port++){
+		for (uint32_t Slave = 0; Slave < SlavesPerPort; Slave++){
+			SimulatedPsuStruct* PsuPtr = &Ports[Port].psuTable[Slave];
+			SumOfCycles += PsuPtr->sumOfCycles;
+			NumberOfCycles += PsuPtr->numberOfCycles;
+			if (PsuPtr->maxCycle > MaxCycle){
+				MaxCycle = PsuPtr->maxCycle;
+			}
+			if (0 == PsuPtr->lastReadingTime){
+				NeverRead++;
+			}
+			PsuPtr->sumOfCycles = 0;
+			PsuPtr->numberOfCycles = 0;
+			PsuPtr->maxCycle = 0;
+		}
+	}
+
+	printf( "[%.1f s] zapytania: %.0f/s (odczyty %llu, zapisy %llu), odpowiedzi %llu, błędne zapytania %llu, wyjątki %llu\n",
+			ElapsedS, (double)(Counters.requests - PreviousCounters.requests) / ElapsedS,
+			(unsigned long long)(Counters.readings - PreviousCounters.readings),
+			(unsigned long long)(Counters.writings - PreviousCounters.writings),
+			(unsigned long long)(Counters.responses - PreviousCounters.responses),
+			(unsigned long long)(Counters.invalidRequests - PreviousCounters.invalidRequests),
+			(unsigned long long)(Counters.exceptions - PreviousCounters.exceptions) );
+	printf( "         zakłócenia: CRC %llu, obcięte %llu, bez odpowiedzi %llu\n",
+			(unsigned long long)(Counters.corrupted - PreviousCounters.corrupted),
+			(unsigned long long)(Counters.truncated - PreviousCounters.truncated),
+			(unsigned long long)(Counters.silenced - PreviousCounters.silenced) );
+	printf( "         cykl odczytu zasilacza: średnio %.1f ms, maks. %.1f ms; nieodczytane zasilacze: %u\n",
+			(0 != NumberOfCycles)? (double)SumOfCycles / (double)NumberOfCycles / 1000.0 : 0.0,
+			(double)MaxCycle / 1000.0, NeverRead );
+	if (MasterCpuS >= 0.0){
+		printf( "         CPU: symulator %.1f%%, program nadrzędny %.1f%%; pamięć programu nadrzędnego %ld kB\n",
+				100.0 * SimulatorCpuS / ElapsedS, 100.0 * MasterCpuS / ElapsedS, MasterResidentKB );
+	}
+	else{
+		printf( "         CPU: symulator %.1f%%\n", 100.0 * SimulatorCpuS / ElapsedS );
+	}
+	fflush( stdout );
+	PreviousCounters = Counters;
+}
+
+static void onStopSignal( int Signal ){
+	(void)Signal;
+	IsStopRequested = 1;
+}
@@ -0,0 +1,516 @@
+// telemetryExport.cpp
+//
+// This program exports the telemetry archive (see telemetryArchive.h) for the analysis tools: the records of the chosen
+// channels in a time range are written to one file per channel, as CSV or in a simple columnar binary format.
+// Both the segments of the archive (.arc) and the compacted segments (.arz, see telemetryColumns.h) are read; if a segment
+// exists in both forms, the original is used. The segments are mapped to the memory and the records are written
+// as they are read, so the memory used does not depend on the size of the archive.
+// The channels are divided among the worker threads (channel modulo the number of the workers); each worker reads
+// the archive and writes the files of its channels. A file is created when the first record of its channel is found.
+// The names of the columns are the names of the registers (MODBUS_ADDRES_CURRENT_MEAN -> current_mean);
+// the currents and the voltages are converted to amperes and volts.
+//
+// Usage: telemetryExport [options] [archive directory]   (default archive)
+//   -f time         the beginning of the range: seconds since 1970 or "YYYY-MM-DD HH:MM:SS" (local time)
+//   -t time         the end of the range (inclusive)
+//   -c channels     the channels (numbered from 0), for instance 0,2,5-7; all by default
+//   -b              the columnar binary format instead of CSV
+//   -o prefix       the prefix of the output files (default telemetry): telemetry_ch00.csv ...
+//   -j workers      the number of the worker threads (default: the number of the processors)
+//
+// The columnar binary format (little-endian):
+//   "RSTLCOL" '\0' | uint32 version | uint32 number of columns | for each column: uint8 type, uint8 length of the name, name
+//   then chunks of up to EXPORT_CHUNK_ROWS rows: uint32 number of rows | for each column: the values of the rows
+//   the last chunk has 0 rows; the types: 0 = int64 (the timestamp in us), 1 = float32, 2 = uint16
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <time.h>
+#include <dirent.h>
+#include <string>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include "registerStore.h"
+#include "telemetryArchiveReader.h"
+#include "telemetryColumns.h"
+
+//.................................................................................................
+// Preprocessor directives
+//.................................................................................................
+
+#define EXPORT_FORMAT_VERSION				1
+#define EXPORT_CHUNK_ROWS					4096
+#define EXPORT_CHANNELS_NUMBER				TELEMETRY_COLUMNS_CHANNELS_NUMBER
+
+#define COLUMN_TYPE_INT64					0
+#define COLUMN_TYPE_FLOAT32					1
+#define COLUMN_TYPE_UINT16					2
+
+// The conversions of the registers
+#define CONVERSION_NONE						0
+#define CONVERSION_SETPOINT					1		// SETPOINT_REGISTER_UNIT
+#define CONVERSION_MEASUREMENT				2		// MEASUREMENT_REGISTER_UNIT
+
+// The name of a column is the name of the register without the prefix, in lower case
+#define RTU_REGISTER_COLUMN( Name, Conversion )		{ MODBUS_ADDRES_##Name, Conversion, #Name }
+#define TCP_REGISTER_COLUMN( Name, Conversion )		{ MODBUS_TCP_ADDRESS_##Name, Conversion, #Name }
+
+//.................................................................................................
+// Definitions of types
+//.................................................................................................
+
+struct RegisterColumnStruct{
+	uint8_t offset;						// in the record (the layout of a Modbus TCP sector)
+	uint8_t conversion;
+	const char* name;
+};
+
+// The output of one channel
+struct ChannelOutputStruct{
+	FILE* filePtr;
+	uint64_t rows;
+	uint32_t chunkRows;
+	std::vector<int64_t> timestamps;			// the chunk of the columnar format
+	std::vector<uint16_t> chunkRegisters;		// the registers of the rows of the chunk (EXPORT_CHUNK_ROWS x the columns)
+};
+
+struct SegmentSourceStruct{
+	uint32_t number;
+	size_t archiveIndex;				// the index in TelemetryArchiveReader, or SIZE_MAX if there is only the compacted segment
+	std::string compactedFileName;
+};
+
+//.................................................................................................
+// Local constants
+//.................................................................................................
+
+static const RegisterColumnStruct RegisterColumns[] = {
+	RTU_REGISTER_COLUMN( REQUIRED_STATUS, CONVERSION_NONE ),
+	RTU_REGISTER_COLUMN( REQUIRED_VALUE, CONVERSION_SETPOINT ),
+	RTU_REGISTER_COLUMN( POWER_SOURCE_ID, CONVERSION_NONE ),
+	RTU_REGISTER_COLUMN( SLAVE_STATUS, CONVERSION_NONE ),
+	RTU_REGISTER_COLUMN( CURRENT_MEAN, CONVERSION_MEASUREMENT ),
+	RTU_REGISTER_COLUMN( CURRENT_MEDIAN, CONVERSION_MEASUREMENT ),
+	RTU_REGISTER_COLUMN( CURRENT_FILTERED, CONVERSION_MEASUREMENT ),
+	RTU_REGISTER_COLUMN( CURRENT_PEAK_TO_PEAK, CONVERSION_MEASUREMENT ),
+	RTU_REGISTER_COLUMN( CURRENT_STD_DEVIATION, CONVERSION_MEASUREMENT ),
+	RTU_REGISTER_COLUMN( VOLTAGE_MEAN, CONVERSION_MEASUREMENT ),
+	RTU_REGISTER_COLUMN( VOLTAGE_MEDIAN, CONVERSION_MEASUREMENT ),
+	RTU_REGISTER_COLUMN( VOLTAGE_FILTERED, CONVERSION_MEASUREMENT ),
+	RTU_REGISTER_COLUMN( VOLTAGE_PEAK_TO_PEAK, CONVERSION_MEASUREMENT ),
+	RTU_REGISTER_COLUMN( VOLTAGE_STD_DEVIATION, CONVERSION_MEASUREMENT ),
+	TCP_REGISTER_COLUMN( PERMILLE_ERROR, CONVERSION_NONE ),
+	TCP_REGISTER_COLUMN( MAX_SEQUENCE, CONVERSION_NONE ),
+	TCP_REGISTER_COLUMN( COMMUNICATION_STATE, CONVERSION_NONE ),
+	TCP_REGISTER_COLUMN( IS_POWER_ON, CONVERSION_NONE ),
+	TCP_REGISTER_COLUMN( LAST_FRAME_ERROR, CONVERSION_NONE )
+};
+
+#define REGISTER_COLUMNS_NUMBER				(sizeof(RegisterColumns)/sizeof(RegisterColumns[0]))
+
+//.................................................................................................
+// Local variables
+//.................................................................................................
+
+static const char* DirectoryName = TELEMETRY_ARCHIVE_DIRECTORY;
+static const char* OutputPrefix = "telemetry";
+static int64_t FromTimestamp = INT64_MIN;
+static int64_t ToTimestamp = INT64_MAX;
+static bool IsBinaryFormat = false;
+static bool IsChannelSelected[EXPORT_CHANNELS_NUMBER];
+static unsigned NumberOfWorkers;
+
+static std::string ColumnNames[REGISTER_COLUMNS_NUMBER];
+static TelemetryArchiveReader Archive;
+static std::vector<SegmentSourceStruct> Sources;
+
+//.................................................................................................
+// Local function prototypes
+//.................................................................................................
+
+static bool parseTime( const char* TextPtr, int64_t* TimestampPtr );
+static bool parseChannels( const char* TextPtr );
+static bool findSources( void );
+static void exportWorker( unsigned WorkerIndex, unsigned Workers, uint64_t* RowsPtr, bool* IsFailedPtr );
+static bool openOutput( ChannelOutputStruct* OutputPtr, uint8_t Channel );
+static void writeRecord( ChannelOutputStruct* OutputPtr, const TelemetryRecordStruct* RecordPtr );
+static void writeChunk( ChannelOutputStruct* OutputPtr );
+static bool closeOutput( ChannelOutputStruct* OutputPtr );
+static float convertRegister( const RegisterColumnStruct* ColumnPtr, uint16_t Value );
+static double getSeconds( void );
+
+//.................................................................................................
+// Function definitions
+//.................................................................................................
+
+int main( int argc, char** argv ){
+	bool IsAnyChannelSelected = false;
+	int Option;
+
+	NumberOfWorkers = std::thread::hardware_concurrency();
+	while (-1 != (Option = getopt( argc, argv, "f:t:c:bo:j:" ))){
+		switch (Option){
+		case 'f':
+			if (!parseTime( optarg, &FromTimestamp )){
+				fprintf( stderr, "Nieprawidłowy czas: %s\n", optarg );
+				return 1;
+			}
+			break;
+		case 't':
+			if (!parseTime( optarg, &ToTimestamp )){
+				fprintf( stderr, "Nieprawidłowy czas: %s\n", optarg );
+				return 1;
+			}
+			break;
+		case 'c':
+			if (!parseChannels( optarg )){
+				fprintf( stderr, "Nieprawidłowa lista kanałów: %s\n", optarg );
+				return 1;
+			}
+			IsAnyChannelSelected = true;
+			break;
+		case 'b':
+			IsBinaryFormat = true;
+			break;
+		case 'o':
+			OutputPrefix = optarg;
+			break;
+		case 'j':
+			NumberOfWorkers = (unsigned)strtoul( optarg, nullptr, 10 );
+			break;
+		default:
+			fprintf( stderr, "Użycie: %s [-f czas] [-t czas] [-c kanały] [-b] [-o przedrostek] [-j wątki] [katalog archiwum]\n", argv[0] );
+			return 1;
+		}
+	}
+	if (optind < argc){
+		DirectoryName = argv[optind];
+	}
+	if (!IsAnyChannelSelected){
+		std::fill( IsChannelSelected, IsChannelSelected + EXPORT_CHANNELS_NUMBER, true );
+	}
+	NumberOfWorkers = (0 == NumberOfWorkers)? 1 : NumberOfWorkers;
+
+	for (size_t J = 0; J < REGISTER_COLUMNS_NUMBER; J++){
+		ColumnNames[J] = RegisterColumns[J].name;
+		std::transform( ColumnNames[J].begin(), ColumnNames[J].end(), ColumnNames[J].begin(), ::tolower );
+	}
+	if (!findSources()){
+		fprintf( stderr, "Nie można otworzyć katalogu %s\n", DirectoryName );
+		return 1;
+	}
+
+	unsigned SelectedChannels = (unsigned)std::count( IsChannelSelected, IsChannelSelected + EXPORT_CHANNELS_NUMBER, true );
+	unsigned Workers = (NumberOfWorkers < SelectedChannels)? NumberOfWorkers : SelectedChannels;
+	std::vector<uint64_t> RowsOfChannels( EXPORT_CHANNELS_NUMBER, 0 );
+	std::vector<std::thread> Threads;
+	bool IsFailed[EXPORT_CHANNELS_NUMBER] = { false };
+	double StartTime = getSeconds();
+
+	for (unsigned J = 0; J < Workers; J++){
+		Threads.emplace_back( exportWorker, J, Workers, RowsOfChannels.data(), &IsFailed[J] );
+	}
+	for (std::thread& Thread : Threads){
+		Thread.join();
+	}
+
+	uint64_t TotalRows = 0;
+	for (unsigned Channel = 0; Channel < EXPORT_CHANNELS_NUMBER; Channel++){
+		if (0 != RowsOfChannels[Channel]){
+			printf( "kanał %u: %" PRIu64 " wierszy\n", Channel, RowsOfChannels[Channel] );
+			TotalRows += RowsOfChannels[Channel];
+		}
+	}
+	if (0 == TotalRows){
+		printf( "Brak rekordów w podanym zakresie\n" );
+	}
+	printf( "Razem %" PRIu64 " wierszy w %.2f s (%u wątków)\n", TotalRows, getSeconds() - StartTime, Workers );
+	for (unsigned J = 0; J < Workers; J++){
+		if (IsFailed[J]){
+			fprintf( stderr, "Błąd zapisu plików wyjściowych\n" );
+			return 1;
+		}
+	}
+	return 0;
+}
+
+//.................................................................................................
+// Local function definitions
+//.................................................................................................
+
+static bool parseTime( const char* TextPtr, int64_t* TimestampPtr ){
+	struct tm Time;
+	char* EndPtr;
+
+	double Seconds = strtod( TextPtr, &EndPtr );
+	if ((EndPtr != TextPtr) && ('\0' == *EndPtr)){
+		*TimestampPtr = (int64_t)(Seconds * 1e6);
+		return true;
+	}
+	memset( &Time, 0, sizeof(Time) );
+	EndPtr = strptime( TextPtr, "%Y-%m-%d %H:%M:%S", &Time );
+	if ((nullptr == EndPtr) || ('\0' != *EndPtr)){
+		return false;
+	}
+	Time.tm_isdst = -1;
+	*TimestampPtr = (int64_t)mktime( &Time ) * 1000000;
+	return true;
+}
+
+static bool parseChannels( const char* TextPtr ){
+	while ('\0' != *TextPtr){
+		char* EndPtr;
+		unsigned long First = strtoul( TextPtr, &EndPtr, 10 );
+		unsigned long Last = First;
+		if (EndPtr == TextPtr){
+			return false;
+		}
+		if ('-' == *EndPtr){
+			TextPtr = EndPtr + 1;
+			Last = strtoul( TextPtr, &EndPtr, 10 );
+			if (EndPtr == TextPtr){
+				return false;
+			}
+		}
+		if ((First > Last) || (Last >= EXPORT_CHANNELS_NUMBER)){
+			return false;
+		}
+		for (unsigned long J = First; J <= Last; J++){
+			IsChannelSelected[J] = true;
+		}
+		TextPtr = (',' == *EndPtr)? EndPtr + 1 : EndPtr;
+		if (('\0' != *TextPtr) && !isdigit( (unsigned char)*TextPtr )){
+			return false;
+		}
+	}
+	return true;
+}
+
+// The sources are ordered by the numbers of the segments; the original segment is preferred to the compacted one
+static bool findSources( void ){
+	std::vector<uint32_t> CompactedNumbers;
+	DIR* DirectoryPtr;
+	struct dirent* EntryPtr;
+
+	if (!Archive.open( DirectoryName )){
+		return false;
+	}
+	DirectoryPtr = opendir( DirectoryName );
+	if (nullptr == DirectoryPtr){
+		return false;
+	}
+	while (nullptr != (EntryPtr = readdir( DirectoryPtr ))){
+		std::string Name = EntryPtr->d_name;
+		size_t ExtensionLength = strlen( TELEMETRY_COLUMNS_FILE_EXTENSION );
+		if ((Name.size() > ExtensionLength) && (0 == Name.compare( Name.size() - ExtensionLength, ExtensionLength, TELEMETRY_COLUMNS_FILE_EXTENSION ))){
+			// the name of the original segment gives the number
+			uint32_t SegmentNumber = parseTelemetrySegmentFileName(
+					(Name.substr( 0, Name.size() - ExtensionLength ) + TELEMETRY_ARCHIVE_FILE_EXTENSION).c_str() );
+			if (0 != SegmentNumber){
+				CompactedNumbers.push_back( SegmentNumber );
+			}
+		}
+	}
+	closedir( DirectoryPtr );
+
+	for (size_t J = 0; J < Archive.getNumberOfSegments(); J++){
+		SegmentSourceStruct Source;
+		Source.number = Archive.getSegment( J )->number;
+		Source.archiveIndex = J;
+		Sources.push_back( Source );
+	}
+	for (uint32_t SegmentNumber : CompactedNumbers){
+		if (Sources.end() == std::find_if( Sources.begin(), Sources.end(),
+				[SegmentNumber]( const SegmentSourceStruct& Source ){ return Source.number == SegmentNumber; } ))
+		{
+			char Name[32];
+			SegmentSourceStruct Source;
+			snprintf( Name, sizeof(Name), TELEMETRY_ARCHIVE_FILE_PREFIX "%08u", SegmentNumber );
+			Source.number = SegmentNumber;
+			Source.archiveIndex = SIZE_MAX;
+			Source.compactedFileName = std::string( DirectoryName ) + "/" + Name + TELEMETRY_COLUMNS_FILE_EXTENSION;
+			Sources.push_back( Source );
+		}
+	}
+	std::sort( Sources.begin(), Sources.end(),
+			[]( const SegmentSourceStruct& Source1, const SegmentSourceStruct& Source2 ){ return Source1.number < Source2.number; } );
+	return true;
+}
+
+// Each worker reads all the segments and writes the records of its channels
+static void exportWorker( unsigned WorkerIndex, unsigned Workers, uint64_t* RowsPtr, bool* IsFailedPtr ){
+	std::unique_ptr<ChannelOutputStruct> Outputs[EXPORT_CHANNELS_NUMBER];
+	bool IsChannelOfWorker[EXPORT_CHANNELS_NUMBER];
+
+	for (unsigned J = 0; J < EXPORT_CHANNELS_NUMBER; J++){
+		IsChannelOfWorker[J] = IsChannelSelected[J] && (WorkerIndex == J % Workers);
+	}
+	auto Visitor = [&]( const TelemetryRecordStruct* RecordPtr ){
+		if (!IsChannelOfWorker[RecordPtr->channel]){
+			return;
+		}
+		if (nullptr == Outputs[RecordPtr->channel]){
+			Outputs[RecordPtr->channel].reset( new ChannelOutputStruct );
+			if (!openOutput( Outputs[RecordPtr->channel].get(), RecordPtr->channel )){
+				Outputs[RecordPtr->channel].reset();
+				IsChannelOfWorker[RecordPtr->channel] = false;
+				*IsFailedPtr = true;
+				return;
+			}
+		}
+		writeRecord( Outputs[RecordPtr->channel].get(), RecordPtr );
+	};
+	for (const SegmentSourceStruct& Source : Sources){
+		if (SIZE_MAX != Source.archiveIndex){
+			(void)Archive.scanSegment( Source.archiveIndex, FromTimestamp, ToTimestamp, Visitor );
+		}
+		else{
+			TelemetryColumnDecoder Decoder;
+			if (Decoder.open( Source.compactedFileName.c_str() )){
+				(void)Decoder.scan( FromTimestamp, ToTimestamp, Visitor );
+			}
+		}
+	}
+
+	for (unsigned J = 0; J < EXPORT_CHANNELS_NUMBER; J++){
+		if (nullptr != Outputs[J]){
+			RowsPtr[J] = Outputs[J]->rows;
+			if (!closeOutput( Outputs[J].get() )){
+				*IsFailedPtr = true;
+			}
+		}
+	}
+}
+
+static bool openOutput( ChannelOutputStruct* OutputPtr, uint8_t Channel ){
+	char FileName[PATH_MAX];
+
+	snprintf( FileName, sizeof(FileName), "%s_ch%02u.%s", OutputPrefix, Channel, IsBinaryFormat? "col" : "csv" );
+	OutputPtr->filePtr = fopen( FileName, "wb" );
+	if (nullptr == OutputPtr->filePtr){
+		fprintf( stderr, "Nie można utworzyć pliku %s\n", FileName );
+		return false;
+	}
+	(void)setvbuf( OutputPtr->filePtr, nullptr, _IOFBF, 1 << 20 );
+	OutputPtr->rows = 0;
+	OutputPtr->chunkRows = 0;
+
+	if (!IsBinaryFormat){
+		fprintf( OutputPtr->filePtr, "timestamp" );
+		for (size_t J = 0; J < REGISTER_COLUMNS_NUMBER; J++){
+			fprintf( OutputPtr->filePtr, ",%s", ColumnNames[J].c_str() );
+		}
+		fprintf( OutputPtr->filePtr, "\n" );
+		return true;
+	}
+
+	uint32_t Header[2] = { EXPORT_FORMAT_VERSION, REGISTER_COLUMNS_NUMBER + 1 };
+	fwrite( "RSTLCOL", 1, 8, OutputPtr->filePtr );
+	fwrite( Header, sizeof(Header), 1, OutputPtr->filePtr );
+	uint8_t Description[2] = { COLUMN_TYPE_INT64, (uint8_t)strlen( "timestamp_us" ) };
+	fwrite( Description, sizeof(Description), 1, OutputPtr->filePtr );
+	fwrite( "timestamp_us", 1, Description[1], OutputPtr->filePtr );
+	for (size_t J = 0; J < REGISTER_COLUMNS_NUMBER; J++){
+		Description[0] = (CONVERSION_NONE == RegisterColumns[J].conversion)? COLUMN_TYPE_UINT16 : COLUMN_TYPE_FLOAT32;
+		Description[1] = (uint8_t)ColumnNames[J].size();
+		fwrite( Description, sizeof(Description), 1, OutputPtr->filePtr );
+		fwrite( ColumnNames[J].c_str(), 1, Description[1], OutputPtr->filePtr );
+	}
+	OutputPtr->timestamps.resize( EXPORT_CHUNK_ROWS );
+	OutputPtr->chunkRegisters.resize( (size_t)EXPORT_CHUNK_ROWS * REGISTER_COLUMNS_NUMBER );
+	return true;
+}
+
+static void writeRecord( ChannelOutputStruct* OutputPtr, const TelemetryRecordStruct* RecordPtr ){
+	OutputPtr->rows++;
+	if (!IsBinaryFormat){
+		int64_t Seconds = RecordPtr->timestamp / 1000000;
+		int64_t Microseconds = RecordPtr->timestamp % 1000000;
+		if (Microseconds < 0){
+			Seconds--;
+			Microseconds += 1000000;
+		}
+		fprintf( OutputPtr->filePtr, "%" PRId64 ".%06" PRId64, Seconds, Microseconds );
+		for (size_t J = 0; J < REGISTER_COLUMNS_NUMBER; J++){
+			uint16_t Value = RecordPtr->registers[RegisterColumns[J].offset];
+			if (CONVERSION_NONE == RegisterColumns[J].conversion){
+				fprintf( OutputPtr->filePtr, ",%u", Value );
+			}
+			else{
+				fprintf( OutputPtr->filePtr, (CONVERSION_SETPOINT == RegisterColumns[J].conversion)? ",%.4f" : ",%.2f",
+						(double)convertRegister( &RegisterColumns[J], Value ) );
+			}
+		}
+		fprintf( OutputPtr->filePtr, "\n" );
+		return;
+	}
+
+	// the columnar format: the rows are collected in a chunk and written column after column
+	OutputPtr->timestamps[OutputPtr->chunkRows] = RecordPtr->timestamp;
+	uint16_t* RowPtr = &OutputPtr->chunkRegisters[(size_t)OutputPtr->chunkRows * REGISTER_COLUMNS_NUMBER];
+	for (size_t J = 0; J < REGISTER_COLUMNS_NUMBER; J++){
+		RowPtr[J] = RecordPtr->registers[RegisterColumns[J].offset];
+	}
+	OutputPtr->chunkRows++;
+	if (EXPORT_CHUNK_ROWS == OutputPtr->chunkRows){
+		writeChunk( OutputPtr );
+	}
+}
+
+static void writeChunk( ChannelOutputStruct* OutputPtr ){
+	uint32_t Rows = OutputPtr->chunkRows;
+	static thread_local float FloatColumn[EXPORT_CHUNK_ROWS];
+	static thread_local uint16_t IntegerColumn[EXPORT_CHUNK_ROWS];
+
+	fwrite( &Rows, sizeof(Rows), 1, OutputPtr->filePtr );
+	fwrite( OutputPtr->timestamps.data(), sizeof(int64_t), Rows, OutputPtr->filePtr );
+	for (size_t J = 0; J < REGISTER_COLUMNS_NUMBER; J++){
+		const uint16_t* ValuesPtr = &OutputPtr->chunkRegisters[J];
+		if (CONVERSION_NONE == RegisterColumns[J].conversion){
+			for (uint32_t Row = 0; Row < Rows; Row++){
+				IntegerColumn[Row] = ValuesPtr[(size_t)Row * REGISTER_COLUMNS_NUMBER];
+			}
+			fwrite( IntegerColumn, sizeof(uint16_t), Rows, OutputPtr->filePtr );
+		}
+		else{
+			for (uint32_t Row = 0; Row < Rows; Row++){
+				FloatColumn[Row] = convertRegister( &RegisterColumns[J], ValuesPtr[(size_t)Row * REGISTER_COLUMNS_NUMBER] );
+			}
+			fwrite( FloatColumn, sizeof(float), Rows, OutputPtr->filePtr );
+		}
+	}
+	OutputPtr->chunkRows = 0;
+}
+
+static bool closeOutput( ChannelOutputStruct* OutputPtr ){
+	if (IsBinaryFormat){
+		if (0 != OutputPtr->chunkRows){
+			writeChunk( OutputPtr );
+		}
+		writeChunk( OutputPtr );		// the empty chunk at the end
+	}
+	bool IsCorrect = (0 == ferror( OutputPtr->filePtr ));
+	return (0 == fclose( OutputPtr->filePtr )) && IsCorrect;
+}
+
+static float convertRegister( const RegisterColumnStruct* ColumnPtr, uint16_t Value ){
+	if (CONVERSION_SETPOINT == ColumnPtr->conversion){
+		return SETPOINT_REGISTER_UNIT * (float)Value;
+	}
+	if (CONVERSION_MEASUREMENT == ColumnPtr->conversion){
+		return MEASUREMENT_REGISTER_UNIT * (float)Value;
+	}
+	return (float)Value;
+}
+
+static double getSeconds( void ){
+	struct timespec Now;
+	clock_gettime( CLOCK_MONOTONIC, &Now );
+	return (double)Now.tv_sec + 1e-9 * (double)Now.tv_nsec;
+}
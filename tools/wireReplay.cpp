@@ -0,0 +1,392 @@
+// wireReplay.cpp
+//
+// This program reads the wire capture of the RTU master (see wireCapture.h) and replays it offline: every captured
+// frame is checked by the same decoders as on the line (rtuFrameDecoder.h for Modbus RTU, a check of the MBAP header
+// and the PDU for Modbus TCP), so that a communication problem can be analysed after the fact, also after a crash.
+// The capture may be read while the master is running; the records being written at that moment are skipped.
+//
+// Usage: wireReplay [options] [capture file]   (default powerSourceRSTL.cap)
+//   -p              print the frames (the time, the source, the channel, the order, the bytes and the verdict)
+//   -c channel      print the frames of the given channel only (RTU)
+//   -b repetitions  benchmark: all the checked frames are decoded the given number of times at full speed
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <vector>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "wireCapture.h"
+#include "rtuFrameDecoder.h"
+
+//.................................................................................................
+// Preprocessor directives
+//.................................................................................................
+
+#define REPLAY_VERDICTS_NUMBER				((int)LastFrameErrorClass::PERFECTION + 1)
+#define REPLAY_CHANNELS_NUMBER				256
+#define REPLAY_REGISTERS_MAX				MODBUS_RTU_REGISTERS_AREA
+
+#define MBAP_HEADER_SIZE					7		// transaction id, protocol id, length, unit id
+#define MODBUS_TCP_EXCEPTION_FLAG			0x80
+
+//.................................................................................................
+// Local variables
+//.................................................................................................
+
+static constexpr RtuFrameCatalogTable<RTU_REGISTERS_WINDOW_START, MODBUS_RTU_REGISTERS_AREA> FrameCatalogs;
+
+static const char* SourceNames[WIRE_CAPTURE_SOURCES_NUMBER] = {
+		"RTU >", "RTU <", "TCP slave <", "TCP slave >", "TCP master >", "TCP master <" };
+
+static const char* OrderNames[RTU_PRIMITIVE_ORDER_TOTAL_NUMBER] = {
+		"ALL", "FIRST", "LAST", "ON", "OFF", "SET" };
+
+// LastFrameErrorClass::UNSPECIFIED is used for the errors of the serial port or the socket
+static const char* VerdictNames[REPLAY_VERDICTS_NUMBER] = {
+		"błąd portu", "brak odpowiedzi", "niekompletna", "błędne CRC", "inny błąd", "poprawna" };
+
+static const char* FileName = WIRE_CAPTURE_FILE_NAME;
+static bool IsPrinting = false;
+static int ChannelFilter = -1;
+static uint32_t BenchmarkRepetitions = 0;
+
+static WireCaptureHeaderStruct Header;
+static std::vector<WireCaptureRecordStruct> Records;
+static uint64_t TornRecords;
+
+//.................................................................................................
+// Local function prototypes
+//.................................................................................................
+
+static bool parseArguments( int argc, char** argv );
+static bool loadCapture(void);
+static LastFrameErrorClass decodeRecord( const WireCaptureRecordStruct* RecordPtr, const uint8_t* LastRequest,
+		uint16_t* Registers, uint8_t* NumberOfRegistersPtr );
+static LastFrameErrorClass checkTcpFrame( const WireCaptureRecordStruct* RecordPtr );
+static bool isCheckedFrame( uint8_t Source );
+static void printRecord( const WireCaptureRecordStruct* RecordPtr, LastFrameErrorClass Verdict,
+		const uint16_t* Registers, uint8_t NumberOfRegisters );
+static void runBenchmark(void);
+
+//.................................................................................................
+// Function definitions
+//.................................................................................................
+
+int main( int argc, char** argv ){
+	static uint8_t LastRequests[REPLAY_CHANNELS_NUMBER][RTU_REQUEST_FRAME_SIZE];
+	static uint64_t ChannelVerdicts[REPLAY_CHANNELS_NUMBER][REPLAY_VERDICTS_NUMBER];
+	uint64_t SourceVerdicts[WIRE_CAPTURE_SOURCES_NUMBER][REPLAY_VERDICTS_NUMBER] = {};
+	uint64_t SourceCounts[WIRE_CAPTURE_SOURCES_NUMBER] = {};
+	uint16_t Registers[REPLAY_REGISTERS_MAX];
+	uint8_t NumberOfRegisters;
+	LastFrameErrorClass Verdict;
+	int J, K;
+
+	if (!parseArguments( argc, argv ) || !loadCapture()){
+		return 1;
+	}
+
+	for (const WireCaptureRecordStruct& Record : Records){
+		if (Record.source >= WIRE_CAPTURE_SOURCES_NUMBER){
+			continue;
+		}
+		SourceCounts[Record.source]++;
+		if (WIRE_CAPTURE_RTU_REQUEST == Record.source){
+			memcpy( LastRequests[Record.channel], Record.data, RTU_REQUEST_FRAME_SIZE );
+		}
+		NumberOfRegisters = 0;
+		Verdict = LastFrameErrorClass::PERFECTION;
+		if (isCheckedFrame( Record.source )){
+			Verdict = decodeRecord( &Record, LastRequests[Record.channel], Registers, &NumberOfRegisters );
+			SourceVerdicts[Record.source][(int)Verdict]++;
+			if (WIRE_CAPTURE_RTU_RESPONSE == Record.source){
+				ChannelVerdicts[Record.channel][(int)Verdict]++;
+			}
+		}
+		if (IsPrinting && ((ChannelFilter < 0) || (Record.channel == ChannelFilter))){
+			printRecord( &Record, Verdict, Registers, NumberOfRegisters );
+		}
+	}
+
+	printf( "Plik %s: rekordy %zu (zapisane %" PRIu64 ", pojemność %u, pominięte w trakcie zapisu %" PRIu64 ")\n",
+			FileName, Records.size(), Header.writeIndex, Header.capacity, TornRecords );
+	for (J = 0; J < WIRE_CAPTURE_SOURCES_NUMBER; J++){
+		if (0 == SourceCounts[J]){
+			continue;
+		}
+		printf( "  %-13s %10" PRIu64, SourceNames[J], SourceCounts[J] );
+		if (isCheckedFrame( (uint8_t)J )){
+			for (K = REPLAY_VERDICTS_NUMBER-1; K >= 0; K--){
+				if (0 != SourceVerdicts[J][K]){
+					printf( "  %s: %" PRIu64, VerdictNames[K], SourceVerdicts[J][K] );
+				}
+			}
+		}
+		printf( "\n" );
+	}
+	printf( "Odpowiedzi RTU według kanałów:\n" );
+	for (J = 0; J < REPLAY_CHANNELS_NUMBER; J++){
+		uint64_t Total = 0;
+		for (K = 0; K < REPLAY_VERDICTS_NUMBER; K++){
+			Total += ChannelVerdicts[J][K];
+		}
+		if (0 == Total){
+			continue;
+		}
+		printf( "  kanał %3d: %8" PRIu64 " poprawne %5.1f%%", J, Total,
+				100.0 * (double)ChannelVerdicts[J][(int)LastFrameErrorClass::PERFECTION] / (double)Total );
+		for (K = REPLAY_VERDICTS_NUMBER-2; K >= 0; K--){
+			if (0 != ChannelVerdicts[J][K]){
+				printf( "  %s: %" PRIu64, VerdictNames[K], ChannelVerdicts[J][K] );
+			}
+		}
+		printf( "\n" );
+	}
+
+	if (0 != BenchmarkRepetitions){
+		runBenchmark();
+	}
+	return 0;
+}
+
+//.................................................................................................
+// Local function definitions
+//.................................................................................................
+
+static bool parseArguments( int argc, char** argv ){
+	int Option;
+
+	while (-1 != (Option = getopt( argc, argv, "pc:b:" ))){
+		switch (Option){
+		case 'p': IsPrinting = true; break;
+		case 'c': ChannelFilter = (int)strtol( optarg, nullptr, 10 ); break;
+		case 'b': BenchmarkRepetitions = (uint32_t)strtoul( optarg, nullptr, 10 ); break;
+		default:
+			fprintf( stderr, "Użycie: %s [-p] [-c kanał] [-b powtórzenia] [plik]\n", argv[0] );
+			return false;
+		}
+	}
+	if (optind < argc){
+		FileName = argv[optind];
+	}
+	if (ChannelFilter >= 0){
+		IsPrinting = true;
+	}
+	return true;
+}
+
+// The records are copied from the oldest to the newest one; a record is taken only if its sequence number
+// is the expected one before and after the copying (it may be overwritten by the running master)
+static bool loadCapture(void){
+	const WireCaptureHeaderStruct* HeaderPtr;
+	const WireCaptureRecordStruct* RingPtr;
+	WireCaptureRecordStruct Record;
+	struct stat FileStatus;
+	uint64_t WriteIndex, Index;
+	uint32_t Sequence;
+	void* MappingPtr;
+	int FileHandler;
+
+	FileHandler = open( FileName, O_RDONLY | O_CLOEXEC );
+	if ((-1 == FileHandler) || (0 != fstat( FileHandler, &FileStatus ))){
+		fprintf( stderr, "Nie udało się otworzyć pliku %s: %s\n", FileName, strerror( errno ));
+		return false;
+	}
+	if ((size_t)FileStatus.st_size < WIRE_CAPTURE_HEADER_SIZE){
+		fprintf( stderr, "Plik %s nie jest zapisem ramek\n", FileName );
+		close( FileHandler );
+		return false;
+	}
+	MappingPtr = mmap( nullptr, (size_t)FileStatus.st_size, PROT_READ, MAP_SHARED, FileHandler, 0 );
+	close( FileHandler );
+	if (MAP_FAILED == MappingPtr){
+		fprintf( stderr, "Nie udało się odwzorować pliku %s: %s\n", FileName, strerror( errno ));
+		return false;
+	}
+
+	HeaderPtr = (const WireCaptureHeaderStruct*)MappingPtr;
+	if ((0 != memcmp( HeaderPtr->magic, WIRE_CAPTURE_MAGIC, sizeof(WIRE_CAPTURE_MAGIC) )) ||
+			(WIRE_CAPTURE_VERSION != HeaderPtr->version) || (WIRE_CAPTURE_RECORD_SIZE != HeaderPtr->recordSize) ||
+			(0 == HeaderPtr->capacity) || (0 != (HeaderPtr->capacity & (HeaderPtr->capacity-1))) ||
+			((size_t)FileStatus.st_size < WIRE_CAPTURE_HEADER_SIZE + (size_t)HeaderPtr->capacity * WIRE_CAPTURE_RECORD_SIZE))
+	{
+		fprintf( stderr, "Plik %s nie jest zapisem ramek w wersji %u\n", FileName, WIRE_CAPTURE_VERSION );
+		munmap( MappingPtr, (size_t)FileStatus.st_size );
+		return false;
+	}
+	Header = *HeaderPtr;
+	WriteIndex = __atomic_load_n( &HeaderPtr->writeIndex, __ATOMIC_ACQUIRE );
+	Header.writeIndex = WriteIndex;
+	RingPtr = (const WireCaptureRecordStruct*)((const uint8_t*)MappingPtr + WIRE_CAPTURE_HEADER_SIZE);
+
+	Records.reserve( (size_t)((WriteIndex < Header.capacity)? WriteIndex : Header.capacity) );
+	TornRecords = 0;
+	for (Index = (WriteIndex > Header.capacity)? WriteIndex - Header.capacity : 0; Index < WriteIndex; Index++){
+		const WireCaptureRecordStruct* RecordPtr = &RingPtr[Index & (Header.capacity-1)];
+
+		Sequence = __atomic_load_n( &RecordPtr->sequence, __ATOMIC_ACQUIRE );
+		memcpy( &Record, RecordPtr, sizeof(Record) );
+		__atomic_thread_fence( __ATOMIC_ACQUIRE );
+		if ((Sequence != (uint32_t)(Index + 1)) || (Sequence != __atomic_load_n( &RecordPtr->sequence, __ATOMIC_RELAXED ))){
+			TornRecords++;
+			continue;
+		}
+		Records.push_back( Record );
+	}
+	munmap( MappingPtr, (size_t)FileStatus.st_size );
+	return true;
+}
+
+// This function checks a RTU response or a TCP frame and decodes the registers of a correct RTU reading;
+// LastRequest is the last request of the channel, needed for the echo of RTU_ORDER_SET_VALUE
+static LastFrameErrorClass decodeRecord( const WireCaptureRecordStruct* RecordPtr, const uint8_t* LastRequest,
+		uint16_t* Registers, uint8_t* NumberOfRegistersPtr )
+{
+	LastFrameErrorClass Verdict;
+	const uint8_t* KnownResponse;
+
+	*NumberOfRegistersPtr = 0;
+	if (0 != (RecordPtr->flags & WIRE_CAPTURE_FLAG_PORT_ERROR)){
+		return LastFrameErrorClass::UNSPECIFIED;
+	}
+	if (WIRE_CAPTURE_RTU_RESPONSE != RecordPtr->source){
+		return checkTcpFrame( RecordPtr );
+	}
+	if ((RecordPtr->order >= RTU_PRIMITIVE_ORDER_TOTAL_NUMBER) ||
+			(RecordPtr->slaveAddress < RTU_SLAVE_ADDRESS_MIN) || (RecordPtr->slaveAddress > RTU_SLAVE_ADDRESS_MAX))
+	{
+		return LastFrameErrorClass::OTHER_FRAME_ERROR;
+	}
+
+	const RtuFrameCatalog& Catalog = FrameCatalogs[RecordPtr->slaveAddress];
+	KnownResponse = (RTU_ORDER_SET_VALUE == RecordPtr->order)? LastRequest : Catalog.knownResponse[RecordPtr->order];
+	Verdict = checkRtuResponse( RecordPtr->data,
+			(int16_t)((RecordPtr->length < WIRE_CAPTURE_DATA_SIZE)? RecordPtr->length : WIRE_CAPTURE_DATA_SIZE + 1),
+			0 != (RecordPtr->flags & WIRE_CAPTURE_FLAG_INTERRUPTED), Catalog.responseFrameTotalLength[RecordPtr->order],
+			KnownResponse, Catalog.knownResponseLength[RecordPtr->order] );
+	if ((LastFrameErrorClass::PERFECTION == Verdict) && (RTU_FUNCTION_READ_HOLDING_REGISTERS == RecordPtr->data[1])){
+		*NumberOfRegistersPtr = RecordPtr->data[2] / 2;
+		decodeRtuRegisters( RecordPtr->data, *NumberOfRegistersPtr, Registers );
+	}
+	return Verdict;
+}
+
+// This function checks the MBAP header and the PDU of a Modbus TCP frame (the functions used by the program:
+// reading holding registers, writing a single register and writing multiple registers)
+static LastFrameErrorClass checkTcpFrame( const WireCaptureRecordStruct* RecordPtr ){
+	const uint8_t* Frame = RecordPtr->data;
+	uint16_t Length = RecordPtr->length;
+	uint16_t ExpectedLength;
+	bool IsRequest = (WIRE_CAPTURE_TCP_SLAVE_REQUEST == RecordPtr->source) || (WIRE_CAPTURE_TCP_MASTER_REQUEST == RecordPtr->source);
+
+	if (0 == Length){
+		return LastFrameErrorClass::NO_RESPONSE;
+	}
+	// a frame longer than WIRE_CAPTURE_DATA_SIZE is captured partly, but its header (checked here) is always complete
+	if ((Length <= MBAP_HEADER_SIZE) ||
+			((uint16_t)(256 * Frame[4] + Frame[5]) != Length - (MBAP_HEADER_SIZE - 1)))
+	{
+		return LastFrameErrorClass::NOT_COMPLETE_FRAME;
+	}
+	if ((0 != Frame[2]) || (0 != Frame[3]) || (0 != (Frame[7] & MODBUS_TCP_EXCEPTION_FLAG))){
+		return LastFrameErrorClass::OTHER_FRAME_ERROR;
+	}
+
+	switch (Frame[7]){
+	case RTU_FUNCTION_READ_HOLDING_REGISTERS:
+		ExpectedLength = IsRequest? MBAP_HEADER_SIZE + 5 : MBAP_HEADER_SIZE + 2 + ((Length > 8)? Frame[8] : 0);
+		break;
+	case RTU_FUNCTION_WRITE_SINGLE_REGISTER:
+		ExpectedLength = MBAP_HEADER_SIZE + 5;
+		break;
+	case 0x10:		// writing multiple registers
+		ExpectedLength = IsRequest? MBAP_HEADER_SIZE + 6 + ((Length > 12)? Frame[12] : 0) : MBAP_HEADER_SIZE + 5;
+		break;
+	default:
+		return LastFrameErrorClass::OTHER_FRAME_ERROR;
+	}
+	return (Length == ExpectedLength)? LastFrameErrorClass::PERFECTION : LastFrameErrorClass::NOT_COMPLETE_FRAME;
+}
+
+// The RTU requests are taken from the frame catalog, so they are not checked
+static bool isCheckedFrame( uint8_t Source ){
+	return WIRE_CAPTURE_RTU_REQUEST != Source;
+}
+
+static void printRecord( const WireCaptureRecordStruct* RecordPtr, LastFrameErrorClass Verdict,
+		const uint16_t* Registers, uint8_t NumberOfRegisters )
+{
+	int64_t Realtime = Header.realtimeAtStart + (int64_t)(RecordPtr->timestamp - Header.monotonicAtStart);
+	time_t Seconds = (time_t)(Realtime / 1000000);
+	struct tm LocalTime;
+	char TimeText[32];
+	uint16_t J, Shown;
+
+	localtime_r( &Seconds, &LocalTime );
+	strftime( TimeText, sizeof(TimeText), "%H:%M:%S", &LocalTime );
+	printf( "%s.%06u %-12s", TimeText, (unsigned)(Realtime % 1000000), SourceNames[RecordPtr->source] );
+	if (RecordPtr->source <= WIRE_CAPTURE_RTU_RESPONSE){
+		printf( " k%-3u a%-3u %-5s", RecordPtr->channel, RecordPtr->slaveAddress,
+				(RecordPtr->order < RTU_PRIMITIVE_ORDER_TOTAL_NUMBER)? OrderNames[RecordPtr->order] : "?" );
+	}
+	Shown = (RecordPtr->length < WIRE_CAPTURE_DATA_SIZE)? RecordPtr->length : WIRE_CAPTURE_DATA_SIZE;
+	printf( " [%3u]", RecordPtr->length );
+	for (J = 0; J < Shown; J++){
+		printf( " %02X", RecordPtr->data[J] );
+	}
+	if (isCheckedFrame( RecordPtr->source )){
+		printf( "  -> %s%s", VerdictNames[(int)Verdict],
+				(0 != (RecordPtr->flags & WIRE_CAPTURE_FLAG_INTERRUPTED))? " (przerwa t1.5)" : "" );
+	}
+	if (0 != NumberOfRegisters){
+		printf( " {" );
+		for (J = 0; J < NumberOfRegisters; J++){
+			printf( "%s%u", (0 == J)? "" : " ", Registers[J] );
+		}
+		printf( "}" );
+	}
+	printf( "\n" );
+}
+
+// All the checked frames are decoded again and again, as fast as possible, in order to measure the cost of the decoders
+static void runBenchmark(void){
+	static uint8_t LastRequests[REPLAY_CHANNELS_NUMBER][RTU_REQUEST_FRAME_SIZE];
+	std::vector<const WireCaptureRecordStruct*> Decoded;
+	uint16_t Registers[REPLAY_REGISTERS_MAX];
+	uint8_t NumberOfRegisters;
+	struct timespec Start, End;
+	uint64_t Frames = 0, Checksum = 0;
+	double ElapsedS;
+
+	for (const WireCaptureRecordStruct& Record : Records){
+		if (isCheckedFrame( Record.source )){
+			Decoded.push_back( &Record );
+		}
+	}
+	if (Decoded.empty()){
+		printf( "Brak ramek do dekodowania\n" );
+		return;
+	}
+
+	clock_gettime( CLOCK_MONOTONIC, &Start );
+	for (uint32_t Repetition = 0; Repetition < BenchmarkRepetitions; Repetition++){
+		for (const WireCaptureRecordStruct* RecordPtr : Decoded){
+			Checksum += (uint64_t)decodeRecord( RecordPtr, LastRequests[RecordPtr->channel], Registers, &NumberOfRegisters );
+			if (0 != NumberOfRegisters){
+				Checksum += Registers[0];
+			}
+			Frames++;
+		}
+	}
+	clock_gettime( CLOCK_MONOTONIC, &End );
+	ElapsedS = (double)(End.tv_sec - Start.tv_sec) + 1e-9 * (double)(End.tv_nsec - Start.tv_nsec);
+
+	printf( "Dekodowanie: %" PRIu64 " ramek w %.3f s, %.1f ns/ramkę, %.2f mln ramek/s (suma kontrolna %" PRIu64 ")\n",
+			Frames, ElapsedS, 1e9 * ElapsedS / (double)Frames, 1e-6 * (double)Frames / ElapsedS, Checksum );
+}
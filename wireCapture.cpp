@@ -0,0 +1,115 @@
+// wireCapture.cpp
+//
+// Threads: any (see wireCapture.h)
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/mman.h>
+#include "wireCapture.h"
+
+//.................................................................................................
+// Preprocessor directives
+//.................................................................................................
+
+#define WIRE_CAPTURE_FILE_SIZE				(WIRE_CAPTURE_HEADER_SIZE + (size_t)WIRE_CAPTURE_CAPACITY * WIRE_CAPTURE_RECORD_SIZE)
+
+static_assert( sizeof(WireCaptureRecordStruct) == WIRE_CAPTURE_RECORD_SIZE, "assert: WireCaptureRecordStruct" );
+static_assert( sizeof(WireCaptureHeaderStruct) <= WIRE_CAPTURE_HEADER_SIZE, "assert: WireCaptureHeaderStruct" );
+static_assert( 0 == (WIRE_CAPTURE_CAPACITY & (WIRE_CAPTURE_CAPACITY-1)), "assert: WIRE_CAPTURE_CAPACITY must be a power of 2" );
+
+//.................................................................................................
+// Local variables
+//.................................................................................................
+
+// They are set once, before the other threads start
+static WireCaptureHeaderStruct* CaptureHeaderPtr;
+static WireCaptureRecordStruct* CaptureRecords;
+
+//.................................................................................................
+// Local function prototypes
+//.................................................................................................
+
+static uint64_t getMicroseconds( clockid_t Clock );
+
+//.................................................................................................
+// Function definitions
+//.................................................................................................
+
+char initializeWireCapture( const char* FileName ){
+	std::string OldFileName = std::string( FileName ) + ".old";
+	void* MappingPtr;
+	int FileHandler;
+
+	(void)rename( FileName, OldFileName.c_str() );
+	FileHandler = open( FileName, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644 );
+	if (-1 == FileHandler){
+		return 0;
+	}
+	if (0 != ftruncate( FileHandler, (off_t)WIRE_CAPTURE_FILE_SIZE )){
+		close( FileHandler );
+		return 0;
+	}
+	MappingPtr = mmap( nullptr, WIRE_CAPTURE_FILE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, FileHandler, 0 );
+	close( FileHandler );
+	if (MAP_FAILED == MappingPtr){
+		return 0;
+	}
+
+	WireCaptureHeaderStruct* HeaderPtr = (WireCaptureHeaderStruct*)MappingPtr;
+	memcpy( HeaderPtr->magic, WIRE_CAPTURE_MAGIC, sizeof(WIRE_CAPTURE_MAGIC) );
+	HeaderPtr->version = WIRE_CAPTURE_VERSION;
+	HeaderPtr->recordSize = WIRE_CAPTURE_RECORD_SIZE;
+	HeaderPtr->capacity = WIRE_CAPTURE_CAPACITY;
+	HeaderPtr->writeIndex = 0;
+	HeaderPtr->realtimeAtStart = (int64_t)getMicroseconds( CLOCK_REALTIME );
+	HeaderPtr->monotonicAtStart = getMicroseconds( CLOCK_MONOTONIC );
+
+	CaptureRecords = (WireCaptureRecordStruct*)((uint8_t*)MappingPtr + WIRE_CAPTURE_HEADER_SIZE);
+	__atomic_store_n( &CaptureHeaderPtr, HeaderPtr, __ATOMIC_RELEASE );
+	return 1;
+}
+
+void captureWireFrame( uint8_t Source, uint8_t Channel, uint8_t Order, uint8_t SlaveAddress, uint8_t Flags,
+		const uint8_t* Frame, uint16_t Length, uint64_t Timestamp )
+{
+	WireCaptureHeaderStruct* HeaderPtr = __atomic_load_n( &CaptureHeaderPtr, __ATOMIC_ACQUIRE );
+	WireCaptureRecordStruct* RecordPtr;
+	uint64_t Index;
+
+	if (nullptr == HeaderPtr){
+		return;
+	}
+	Index = __atomic_fetch_add( &HeaderPtr->writeIndex, 1, __ATOMIC_RELAXED );
+	RecordPtr = &CaptureRecords[Index & (WIRE_CAPTURE_CAPACITY-1)];
+
+	// the reader must not take the old sequence number together with the new contents
+	__atomic_store_n( &RecordPtr->sequence, 0, __ATOMIC_RELAXED );
+	__atomic_thread_fence( __ATOMIC_RELEASE );
+
+	RecordPtr->length = Length;
+	RecordPtr->source = Source;
+	RecordPtr->channel = Channel;
+	RecordPtr->timestamp = (0 != Timestamp)? Timestamp : getMicroseconds( CLOCK_MONOTONIC );
+	RecordPtr->order = Order;
+	RecordPtr->slaveAddress = SlaveAddress;
+	RecordPtr->flags = Flags;
+	RecordPtr->reserved = 0;
+	if (0 != Length){
+		memcpy( RecordPtr->data, Frame, (Length < WIRE_CAPTURE_DATA_SIZE)? Length : WIRE_CAPTURE_DATA_SIZE );
+	}
+	__atomic_store_n( &RecordPtr->sequence, (uint32_t)(Index + 1), __ATOMIC_RELEASE );
+}
+
+//.................................................................................................
+// Local function definitions
+//.................................................................................................
+
+static uint64_t getMicroseconds( clockid_t Clock ){
+	struct timespec Now;
+	clock_gettime( Clock, &Now );
+	return (uint64_t)Now.tv_sec * 1000000ull + (uint64_t)Now.tv_nsec / 1000ull;
+}
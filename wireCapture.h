@@ -0,0 +1,91 @@
+// wireCapture.h
+//
+// Threads: any (the polling workers, the Modbus TCP slave thread and the peripheral thread write the records)
+//
+// This module keeps the last frames of Modbus RTU and Modbus TCP in a capture ring of a fixed size, which is
+// a memory-mapped file (WIRE_CAPTURE_FILE_NAME in the directory of the program), so that the frames are available
+// for a post-mortem analysis (see tools/wireReplay.cpp) even after the program has crashed.
+// The capture is always on; a record costs one atomic increment and a copy of the frame into the mapped memory.
+// The records have a fixed size; a frame longer than WIRE_CAPTURE_DATA_SIZE is truncated (its length is kept).
+// Each record holds its sequence number + 1, which is written last, so a reader can skip a record
+// that is being written. The capture of the previous run is renamed to WIRE_CAPTURE_FILE_NAME ".old".
+
+#ifndef WIRECAPTURE_H_
+#define WIRECAPTURE_H_
+
+#include <stdint.h>
+
+//.................................................................................................
+// Preprocessor directives
+//.................................................................................................
+
+#define WIRE_CAPTURE_FILE_NAME				"powerSourceRSTL.cap"
+#define WIRE_CAPTURE_MAGIC					"RSTLCAP"
+#define WIRE_CAPTURE_VERSION				1
+
+#define WIRE_CAPTURE_CAPACITY				32768		// records; a power of 2
+#define WIRE_CAPTURE_RECORD_SIZE			128
+#define WIRE_CAPTURE_DATA_SIZE				(WIRE_CAPTURE_RECORD_SIZE - 20)
+#define WIRE_CAPTURE_HEADER_SIZE			4096		// the records start at the second page
+
+// The sources of the frames
+#define WIRE_CAPTURE_RTU_REQUEST			0
+#define WIRE_CAPTURE_RTU_RESPONSE			1			// length 0 means no response
+#define WIRE_CAPTURE_TCP_SLAVE_REQUEST		2
+#define WIRE_CAPTURE_TCP_SLAVE_RESPONSE		3
+#define WIRE_CAPTURE_TCP_MASTER_REQUEST		4
+#define WIRE_CAPTURE_TCP_MASTER_RESPONSE	5
+#define WIRE_CAPTURE_SOURCES_NUMBER			6
+
+// The flags of the records
+#define WIRE_CAPTURE_FLAG_INTERRUPTED		0x01		// the silent interval t1.5 has been violated within the frame
+#define WIRE_CAPTURE_FLAG_PORT_ERROR		0x02		// the serial port or the socket has reported an error
+
+//.................................................................................................
+// Definitions of types
+//.................................................................................................
+
+struct WireCaptureHeaderStruct{
+	char magic[8];
+	uint32_t version;
+	uint32_t recordSize;
+	uint32_t capacity;
+	uint32_t reserved;
+	uint64_t writeIndex;				// the number of records written so far (atomic)
+	int64_t realtimeAtStart;			// us; CLOCK_REALTIME and CLOCK_MONOTONIC at the same moment,
+	uint64_t monotonicAtStart;			// used to convert the timestamps of the records to the wall clock time
+};
+
+struct WireCaptureRecordStruct{
+	uint32_t sequence;					// the index of the record + 1 (the lower 32 bits); 0 while the record is written
+	uint16_t length;					// the length of the frame; it may be greater than WIRE_CAPTURE_DATA_SIZE
+	uint8_t source;						// WIRE_CAPTURE_RTU_REQUEST ...
+	uint8_t channel;					// the index of the channel (RTU); 0 for Modbus TCP
+	uint64_t timestamp;					// us; CLOCK_MONOTONIC
+	uint8_t order;						// the order of the RTU transaction (RTU_ORDER_READING_ALL ...) or RTU_ORDER_NONE
+	uint8_t slaveAddress;				// RTU
+	uint8_t flags;						// WIRE_CAPTURE_FLAG_INTERRUPTED ...
+	uint8_t reserved;
+	uint8_t data[WIRE_CAPTURE_DATA_SIZE];
+};
+
+//.................................................................................................
+// Global function prototypes
+//.................................................................................................
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// This function creates the capture file and maps it; it returns 0 on failure (then nothing is captured)
+char initializeWireCapture( const char* FileName );
+
+// This function adds a frame to the capture ring; if Timestamp is 0, the current time is taken
+void captureWireFrame( uint8_t Source, uint8_t Channel, uint8_t Order, uint8_t SlaveAddress, uint8_t Flags,
+		const uint8_t* Frame, uint16_t Length, uint64_t Timestamp );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WIRECAPTURE_H_ */